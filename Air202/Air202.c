@@ -3,18 +3,40 @@
 #include "string.h"
 #include "stdlib.h"
 #include "board.h"
+#include "Trace.h"
 
 extern int AT_Send(const char *str,int size);
-extern int AT_Read(char *str);
+extern int AT_Read(char *str,int cap);
+extern void AT_Unread(const char *str,int size);
 extern void setGPRSCtlPinStatu(bool val);
 extern char ATRXBuffer[];
 extern uint32_t tick_ct;
+extern uint32_t tickUs(void);
 
 const char* IPStatusList[IP_STATUS_MAX] = {"IP INITIAL","IP START","IP CONFIG","IP GPRSACT","IP STATUS","IP PROCESSING",
 				"PDP DEACT","TCP CONNECTING","UDP CONNECTING","SERVER LISTENING","CONNECT OK","TCP CLOSING",
 				"UDP CLOSING","TCP CLOSED","UDP CLOSED"};
 
+#define AT_CMD_NAME(id,name)    name,
+const char* ATCmdList[AT_CMD_MAX] = {AT_CMD_LIST(AT_CMD_NAME)};
+
 char ATTXBuffer[AT_TX_BUF_SIZE];
+#if AT_LATENCY_ENABLE
+HISTOGRAM_T ATLatency[AT_CMD_MAX];  /* us from the command queued to the expected response */
+uint16_t ATFailures[AT_CMD_MAX];    /* expected response missing */
+#endif
+uint32_t ATSendUs = 0;  /* tickUs() when the latest command or data was queued */
+uint16_t ATRXPeak = 0;  /* most bytes of one response in ATRXBuffer,of AT_RX_BUF_SIZE */
+static void (*idleHook)(void) = NULL;   /* called every millisecond of delay_ms */
+
+/**
+* @brief set the function delay_ms calls every millisecond,e.g. to keep the application running
+				 while a command waits for the modem,NULL for none
+**/
+void Air202_setIdle(void (*idle)(void))
+{
+	idleHook = idle;
+}
 
 void delay_ms(uint32_t t)
 {
@@ -22,6 +44,8 @@ void delay_ms(uint32_t t)
 	while(t--){
 		for(i=4800;i>0;i--)
 			__NOP();
+		if(idleHook != NULL)
+			idleHook();
 	}
 }
 
@@ -35,39 +59,168 @@ void delay_us(uint32_t t)
 }
 
 /**
-* @brief send string,if recieved expected string in the limit time set by parameters 
+* @brief the AT_CMD of size bytes about to be sent,data unless it starts with "AT"
+**/
+static int commandOf(const char *data,int size)
+{
+	int i,n;
+	if(size < 2 || data[0] != 'A' || data[1] != 'T')
+		return AT_CMD_DATA;
+	for(i=0;i<AT_CMD_OTHER;i++){
+		n = strlen(ATCmdList[i]);
+		if(n < size && !strncmp(data,ATCmdList[i],n) && data[n] != '+' && (data[n] < 'A' || data[n] > 'Z'))
+			return i;   //"AT" is neither "ATE0" nor "AT+CSQ"
+	}
+	return AT_CMD_OTHER;
+}
+
+/**
+* @brief find exp in the size bytes of buf,unlike strstr it goes on over the NULs server data may hold
+**/
+static char *findBytes(char *buf,int size,const char *exp)
+{
+	int i,n = strlen(exp);
+	for(i=0;i+n<=size;i++){
+		if(buf[i] == exp[0] && !memcmp(buf+i,exp,n))
+			return buf+i;
+	}
+	return NULL;
+}
+
+/**
+* @brief the length of the +IPD message at the start of the size bytes of p,head and data
+* @return the length,0 if not all of it is in yet,negative value if p is no message head
+**/
+static int IPDLength(const char *p,int size)
+{
+	int i = strlen(AT_IP_HEAD),dataBytes = 0;
+	
+	while(i < size && p[i] >= '0' && p[i] <= '9')
+		dataBytes = dataBytes*10+(p[i++]-'0');
+	if(i < size && (p[i] != ':' || i == (int)strlen(AT_IP_HEAD)))
+		return -1;
+	if(i+1+dataBytes > size)
+		return 0;
+	return i+1+dataBytes;
+}
+
+/**
+* @brief find exp in the responses among the size bytes of buf,skipping the +IPD messages the 
+				 server sent meanwhile,up to one not complete yet
+**/
+static char *findResp(char *buf,int size,const char *exp)
+{
+	char *p,*q;
+	int i = 0,len;
+	
+	while(i < size){
+		p = findBytes(buf+i,size-i,AT_IP_HEAD);
+		q = findBytes(buf+i,(p != NULL)?p-buf-i:size-i,exp);
+		if(q != NULL || p == NULL)
+			return q;
+		len = IPDLength(p,size-(p-buf));
+		if(len == 0)
+			return NULL;
+		i = p-buf+((len > 0)?len:(int)strlen(AT_IP_HEAD));
+	}
+	return NULL;
+}
+
+/**
+* @brief give the +IPD messages among the size bytes of buf back for checkSockRecvData,the one
+				 not complete yet with the rest,and close the gaps
+* @return the bytes left in buf
+**/
+static int takeIPD(char *buf,int size)
+{
+	char *p;
+	int i = 0,len;
+	
+	while((p = findBytes(buf+i,size-i,AT_IP_HEAD)) != NULL){
+		len = IPDLength(p,size-(p-buf));
+		if(len < 0){
+			i = p-buf+strlen(AT_IP_HEAD);
+			continue;
+		}
+		if(len == 0)
+			len = size-(p-buf);
+		AT_Unread(p,len);
+		memmove(p,p+len,size-(p-buf)-len);
+		size -= len;
+		memset(buf+size,0,len);
+		i = p-buf;
+	}
+	return size;
+}
+
+/**
+* @brief send size bytes of data,if recieved expected string in the limit time set by parameters 
 				 timeout_ms ,return 0,otherwise return negative value
 **/
-int sendAndGet(const char *strSend,const char* exp,uint32_t timeout_ms)
+static int sendBytesAndGet(const char *data,int size,const char* exp,uint32_t timeout_ms)
 {
 	int n = 0;
 	int time = 0;
 	int byte = 0;
 	char *p = NULL;
+	int cmd;
+	uint32_t matchUs = 0;
+	bool matched = false;
 	
-	if(strSend == NULL || exp == NULL)
+	if(data == NULL || exp == NULL)
 		return -1;
+	cmd = commandOf(data,size);
 	//send 
 	memset(ATRXBuffer,0x0,AT_RX_BUF_SIZE);
-	AT_Send(strSend,strlen(strSend));
+	AT_Send(data,size);
+	ATSendUs = tickUs();
 	while(time<timeout_ms){
-		n = AT_Read(ATRXBuffer + byte);
+		n = AT_Read(ATRXBuffer + byte,AT_RX_BUF_SIZE-byte-1);
 		if(n>0){
 			time = 0;
 			byte += n;
+			//the time the response was complete,not the end of the quiet wait
+			if(!matched && findResp(ATRXBuffer,byte,exp) != NULL){
+				matched = true;
+				matchUs = tickUs();
+			}
 		}else{
 			time++;
 		}
 		delay_ms(1);
 	}
-	DEBUGOUT("recv:%s\r\n",ATRXBuffer);
-	p = strstr(ATRXBuffer,exp);
+	if(byte > ATRXPeak)
+		ATRXPeak = (uint16_t)byte;
+	byte = takeIPD(ATRXBuffer,byte);    //server data that came with the response
+	p = findBytes(ATRXBuffer,byte,exp);
 	if(p==NULL){
+		TRACE2(TRACE_AT_FAIL,cmd,byte); //the bytes themselves are in the capture of SWAuthDemo.c
+		#if AT_LATENCY_ENABLE
+		if(ATFailures[cmd] != 0xFFFF)
+			ATFailures[cmd]++;
+		#endif
 		return -2;
 	}
+	if(!matched)    //not seen while reading,time it now
+		matchUs = tickUs();
+	TRACE3(TRACE_AT_OK,cmd,matchUs-ATSendUs,byte);
+	#if AT_LATENCY_ENABLE
+	Histogram_add(&ATLatency[cmd],matchUs-ATSendUs);
+	#endif
 	return 0;
 }
 
+/**
+* @brief send string,if recieved expected string in the limit time set by parameters 
+				 timeout_ms ,return 0,otherwise return negative value
+**/
+int sendAndGet(const char *strSend,const char* exp,uint32_t timeout_ms)
+{
+	if(strSend == NULL)
+		return -1;
+	return sendBytesAndGet(strSend,strlen(strSend),exp,timeout_ms);
+}
+
 /**
 * @brief send string,if recieved expected string in the limit time set by parameters 
 				 timeout_ms ,return 0,otherwise return negative value,retry n times if failed
@@ -165,7 +318,7 @@ int Air202_IPClose(void)
 }
 
 
-int Air202_CheckRegStatus(void)
+int Air202_checkRegStatus(void)
 {
 	char *p;
 	if(sendAndGet(AT_CHECK_REGISTER,AT_OK,TIMEOUT_MS_1000))
@@ -240,6 +393,20 @@ int Air202_IPSend(const char *data, uint16_t size)
 	return sendAndGet(ATTXBuffer,AT_SEND_OK,TIMEOUT_MS_3000);
 }
 
+/**
+* @brief send binary data,the length is given to AT+CIPSEND up front instead of ending the 
+				 data with 0x1A,so any byte value may be sent
+**/
+int Air202_IPSendRaw(const char *data, uint16_t size)
+{
+	if(data == NULL || size == 0)
+		return RET_CODE_ERROR;
+	sprintf(ATTXBuffer,"%s%d\r",AT_SL_SEND_LEN,size);
+	if(sendAndGet(ATTXBuffer,">",TIMEOUT_MS_1000))
+		return RET_CODE_ERROR;
+	return sendBytesAndGet(data,size,AT_SEND_OK,TIMEOUT_MS_3000);
+}
+
 int Air202_IPShut(void)
 {
 	return sendAndGet(AT_IP_SHUT,AT_SHUT_OK,TIMEOUT_MS_3000);
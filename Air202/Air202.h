@@ -2,6 +2,7 @@
 #define _AIR202_H
 
 #include "chip.h"
+#include "Histogram.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -9,6 +10,7 @@ extern "C"{
 
 #define AT_RX_BUF_SIZE      (512)	
 #define AT_TX_BUF_SIZE      (128)
+#define AT_LATENCY_ENABLE   (1)     /* latency histogram of every command,ATLatency */
 	
 typedef enum RET_CODE{
 	RET_CODE_ERROR = -1,
@@ -49,6 +51,31 @@ typedef enum REG_STAT_NOTIFY_CFG{
 	NOTIFY_CFG_ENABLE_NOTIFY_STAT_CI,
 }REG_STAT_NOTIFY_CFG_T;
 
+/* commands with a latency histogram and their names(ATCmdList),tools/trace_decode prints them too */
+#define AT_CMD_LIST(X) \
+	X(AT_CMD_AT,"AT") \
+	X(AT_CMD_ATE,"ATE") \
+	X(AT_CMD_CSQ,"AT+CSQ") \
+	X(AT_CMD_CGREG,"AT+CGREG") \
+	X(AT_CMD_CGATT,"AT+CGATT") \
+	X(AT_CMD_CPIN,"AT+CPIN") \
+	X(AT_CMD_CIPSTATUS,"AT+CIPSTATUS") \
+	X(AT_CMD_CIFSR,"AT+CIFSR") \
+	X(AT_CMD_CIICR,"AT+CIICR") \
+	X(AT_CMD_CSTT,"AT+CSTT") \
+	X(AT_CMD_CIPHEAD,"AT+CIPHEAD") \
+	X(AT_CMD_CIPSTART,"AT+CIPSTART") \
+	X(AT_CMD_CIPSEND,"AT+CIPSEND") \
+	X(AT_CMD_CIPSHUT,"AT+CIPSHUT") \
+	X(AT_CMD_OTHER,"other")         /* any other command */ \
+	X(AT_CMD_DATA,"data")           /* socket data after the CIPSEND prompt,up to SEND OK */
+
+#define AT_CMD_ENUM(id,name)    id,
+typedef enum AT_CMD{
+	AT_CMD_LIST(AT_CMD_ENUM)
+	AT_CMD_MAX,
+}AT_CMD_T;
+
 enum ATTACH_STAT{
 	ATTACHED = 1,
 	NOT_ATTACHED = 0,
@@ -74,6 +101,7 @@ enum ATTACH_STAT{
 #define    AT_SET_IP_HEAD        "AT+CIPHEAD="
 #define    AT_IP_CLOSE           "AT+IPCLOSE\r"
 #define    AT_SL_SEND            "AT+CIPSEND\r"
+#define    AT_SL_SEND_LEN        "AT+CIPSEND="
 #define    AT_IP_SHUT            "AT+CIPSHUT\r"
 #define    AT_POWER_DOWN         "AT+CPOWD=1\r"
 #define    AT_SEND_OK            "SEND OK"
@@ -100,10 +128,19 @@ enum ATTACH_STAT{
 #define    TIMEOUT_CONNECT       (10000)
 #define    TIMEOUT_SEND_SLOW     (5000)
 
+extern const char* ATCmdList[AT_CMD_MAX];
+#if AT_LATENCY_ENABLE
+extern HISTOGRAM_T ATLatency[AT_CMD_MAX];
+extern uint16_t ATFailures[AT_CMD_MAX];
+#endif
+extern uint32_t ATSendUs;
+extern uint16_t ATRXPeak;
+
 /* function declaration */	
 static int sendAndGet(const char *strSend,const char* exp,uint32_t timeout_ms);
 static int sendAndGetTimes(const char *strSend,const char* exp,uint32_t timeout_ms,uint8_t n);
 
+void Air202_setIdle(void (*idle)(void));
 int Air202_ATInit(void);
 int Air202_checkSignal(void);
 int Air202_checkPIN(void);
@@ -118,6 +155,7 @@ int Air202_setEcho(bool setting);
 int Air202_setIPHead(bool setting);
 int Air202_IPStart(const char *protocol,const char *ip,uint16_t port);
 int Air202_IPSend(const char *data, uint16_t size);
+int Air202_IPSendRaw(const char *data, uint16_t size);
 int Air202_IPClose(void);
 int Air202_IPShut(void);
 int Air202_powerOn(void);
@@ -0,0 +1,130 @@
+#include "AuthFrame.h"
+#include "lib_crc16.h"
+
+/**
+ * @brief	  start a frame in buf,records are appended with AuthFrame_putInt/putBytes
+ * @return  nothing
+ */
+void AuthFrame_begin(AUTH_FRAME_WRITER_T *w,uint8_t *buf,int size)
+{
+	w->buf = buf;
+	w->size = size;
+	w->len = 2;
+	w->error = (size < AUTH_FRAME_OVERHEAD)?AUTH_FRAME_ERR_SPACE:0;
+	if(!w->error)
+		buf[0] = AUTH_FRAME_VERSION;
+}
+
+/**
+ * @brief	  append a record of len bytes
+ * @return  nothing,errors are reported by AuthFrame_end
+ */
+void AuthFrame_putBytes(AUTH_FRAME_WRITER_T *w,uint8_t tag,const uint8_t *data,int len)
+{
+	int i;
+	if(w->error)
+		return;
+	if(len > 255 || w->len+2+len+2 > w->size || w->len-2+2+len > 255){
+		w->error = AUTH_FRAME_ERR_SPACE;
+		return;
+	}
+	w->buf[w->len++] = tag;
+	w->buf[w->len++] = (uint8_t)len;
+	for(i=0;i<len;i++)
+		w->buf[w->len++] = data[i];
+}
+
+/**
+ * @brief	  append an integer record in as few bytes as hold its value
+ * @return  nothing
+ */
+void AuthFrame_putInt(AUTH_FRAME_WRITER_T *w,uint8_t tag,int32_t value)
+{
+	uint8_t bytes[4];
+	int n = 1;
+
+	while(n < 4 && (value >= (int32_t)1<<(8*n-1) || value < -((int32_t)1<<(8*n-1))))
+		n++;
+	bytes[0] = (uint8_t)(value>>24);
+	bytes[1] = (uint8_t)(value>>16);
+	bytes[2] = (uint8_t)(value>>8);
+	bytes[3] = (uint8_t)value;
+	AuthFrame_putBytes(w,tag,bytes+4-n,n);
+}
+
+/**
+ * @brief	  fill in the length and CRC
+ * @return  size of the frame,or nagative value(AUTH_FRAME_ERROR) if it did not fit
+ */
+int AuthFrame_end(AUTH_FRAME_WRITER_T *w)
+{
+	uint16_t crc;
+	if(w->error)
+		return w->error;
+	w->buf[1] = (uint8_t)(w->len-2);
+	crc = calculate_crc16((char*)w->buf,w->len);
+	w->buf[w->len++] = (uint8_t)(crc>>8);
+	w->buf[w->len++] = (uint8_t)crc;
+	return w->len;
+}
+
+/**
+ * @brief	  check version,length and CRC of a received frame and prepare to read its records
+ * @return  0 if the frame is good,otherwise,return nagative value(AUTH_FRAME_ERROR)
+ */
+int AuthFrame_open(AUTH_FRAME_READER_T *r,const uint8_t *frame,int len)
+{
+	int size;
+	uint16_t crc;
+
+	if(len < 1 || frame[0] != AUTH_FRAME_VERSION)
+		return AUTH_FRAME_ERR_VERSION;
+	if(len < AUTH_FRAME_OVERHEAD)
+		return AUTH_FRAME_ERR_LENGTH;
+	size = frame[1]+AUTH_FRAME_OVERHEAD;
+	if(len < size)
+		return AUTH_FRAME_ERR_LENGTH;
+	crc = calculate_crc16((char*)frame,size-2);
+	if(crc != (frame[size-2]<<8 | frame[size-1]))
+		return AUTH_FRAME_ERR_CRC;
+	r->pos = frame+2;
+	r->end = frame+size-2;
+	return 0;
+}
+
+/**
+ * @brief	  get the next record,value points into the frame
+ * @return  1 if a record was read,0 at the end of the frame,nagative value if a record is cut off
+ */
+int AuthFrame_next(AUTH_FRAME_READER_T *r,uint8_t *tag,const uint8_t **value,int *len)
+{
+	if(r->pos >= r->end)
+		return 0;
+	if(r->end-r->pos < 2 || r->end-r->pos-2 < r->pos[1])
+		return AUTH_FRAME_ERR_LENGTH;
+	*tag = r->pos[0];
+	*len = r->pos[1];
+	*value = r->pos+2;
+	r->pos += 2+*len;
+	return 1;
+}
+
+/**
+ * @brief	  sign extend a big-endian integer of 1..4 bytes
+ * @return  the value,0 for an empty record
+ */
+int32_t AuthFrame_getInt(const uint8_t *value,int len)
+{
+	uint32_t v;
+	int i;
+	if(len <= 0)
+		return 0;
+	if(len > 4){
+		value += len-4;
+		len = 4;
+	}
+	v = (value[0] & 0x80)?0xFFFFFFFFUL:0;
+	for(i=0;i<len;i++)
+		v = (v<<8) | value[i];
+	return (int32_t)v;
+}
@@ -0,0 +1,85 @@
+#ifndef _AUTH_FRAME_H
+#define _AUTH_FRAME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Compact binary encoding of the auth protocol, an alternative to the JSON messages.
+ *
+ *   +---------+--------+-----------------------------+-----------+
+ *   | version | length | length bytes of TLV records | CRC16     |
+ *   | 0xB1    | 1 byte | tag(1) len(1) value(len)... | 2 bytes BE|
+ *   +---------+--------+-----------------------------+-----------+
+ *
+ * The CRC is calculate_crc16() over version, length and records, sent big-endian like the
+ * UID record in flash. A JSON message always starts with '{', so the first byte of a payload
+ * tells the two encodings apart. Integers are big-endian two's complement in 1..4 bytes.
+ * Unknown tags are skipped by the reader, so new records can be added without a new version.
+ *
+ * Auth request:  AUTH_TAG_API_ID, AUTH_TAG_UID (16 raw bytes)    25 bytes instead of 50
+ * Auth response: AUTH_TAG_API_ID, AUTH_TAG_RESP_CODE             10 bytes instead of 26
+ * Challenge:     AUTH_TAG_API_ID, AUTH_TAG_RESP_CODE, AUTH_TAG_NONCE (8 bytes)
+ * MAC answer:    AUTH_TAG_API_ID, AUTH_TAG_UID, AUTH_TAG_COUNTER, AUTH_TAG_MAC (8 bytes)
+ * An empty AUTH_TAG_LEASE in a request asks for a lease, a success then carries the
+ * LEASE_WIRE_SIZE bytes of one (Lease.h). Requests carry an AUTH_TAG_SEQ the server echoes,
+ * so a reply is matched to its request (Pending.h). Any other message may carry an authorization
+ * as AUTH_TAG_AUTH_SEQ, answered by an auth response with that AUTH_TAG_SEQ (Cadence.h).
+ * Telemetry:     AUTH_TAG_API_ID, AUTH_TAG_SEQ, AUTH_TAG_UID, AUTH_TAG_TELEMETRY, acknowledged
+ *                with an AUTH_TAG_RESP_CODE like any other message
+ */
+
+#define AUTH_FRAME_VERSION      (0xB1)
+#define AUTH_FRAME_OVERHEAD     (4)         /* version, length and CRC */
+#define AUTH_FRAME_MAX_SIZE     (255+AUTH_FRAME_OVERHEAD)
+
+/* record tags */
+#define AUTH_TAG_API_ID         (0x01)
+#define AUTH_TAG_UID            (0x02)
+#define AUTH_TAG_RESP_CODE      (0x03)
+#define AUTH_TAG_NONCE          (0x04)
+#define AUTH_TAG_COUNTER        (0x05)
+#define AUTH_TAG_MAC            (0x06)
+#define AUTH_TAG_LEASE          (0x07)
+#define AUTH_TAG_SEQ            (0x08)      /* request sequence number,echoed in the reply(Pending.h) */
+#define AUTH_TAG_AUTH_SEQ       (0x09)      /* sequence number of an authorization piggybacked on the message */
+#define AUTH_TAG_TELEMETRY      (0x0A)      /* telemetry records(Telemetry.h),TELEMETRY_RECORD_SIZE bytes each */
+
+enum AUTH_FRAME_ERROR{
+	AUTH_FRAME_ERR_SPACE = -1,      /* does not fit in the buffer, or more than 255 bytes of records */
+	AUTH_FRAME_ERR_VERSION = -2,    /* not a binary frame */
+	AUTH_FRAME_ERR_LENGTH = -3,     /* frame shorter than its length byte says, or a record overruns it */
+	AUTH_FRAME_ERR_CRC = -4,
+};
+
+/* a frame being written into a caller buffer */
+typedef struct AUTH_FRAME_WRITER{
+	uint8_t *buf;
+	int size;
+	int len;
+	int error;
+}AUTH_FRAME_WRITER_T;
+
+/* the records of a received frame */
+typedef struct AUTH_FRAME_READER{
+	const uint8_t *pos;
+	const uint8_t *end;
+}AUTH_FRAME_READER_T;
+
+void AuthFrame_begin(AUTH_FRAME_WRITER_T *w,uint8_t *buf,int size);
+void AuthFrame_putInt(AUTH_FRAME_WRITER_T *w,uint8_t tag,int32_t value);
+void AuthFrame_putBytes(AUTH_FRAME_WRITER_T *w,uint8_t tag,const uint8_t *data,int len);
+int AuthFrame_end(AUTH_FRAME_WRITER_T *w);
+
+int AuthFrame_open(AUTH_FRAME_READER_T *r,const uint8_t *frame,int len);
+int AuthFrame_next(AUTH_FRAME_READER_T *r,uint8_t *tag,const uint8_t **value,int *len);
+int32_t AuthFrame_getInt(const uint8_t *value,int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,23 @@
 
 #include <stdint.h>
 
+/* Table layout used for the 0xA001 (reflected 0x8005) CRCs, chosen at build time. All variants
+   give the same results; the tables come from tools/crc16_gentab (crc16_tab.h). */
+#define CRC16_IMPL_NIBBLE       (1)     /* 16 entry table, 32 bytes of flash, two lookups per byte */
+#define CRC16_IMPL_BYTE         (2)     /* 256 entry table, 512 bytes of flash */
+#define CRC16_IMPL_SLICE4       (3)     /* four 256 entry tables, 2KB of flash, one word load per 4 bytes */
+
+#ifndef CRC16_IMPL
+#define CRC16_IMPL              CRC16_IMPL_BYTE
+#endif
+
+/* Running CRC over data that arrives in pieces: init, update for every piece, final. The
+   plain (initial value 0) and Modbus (initial value 0xFFFF) CRCs share the engine and only
+   differ in the init call, so final(update(init)) over a whole buffer equals calculate_crc16()
+   or calculate_crc16_Modbus(). */
+typedef struct CRC16_CTX{
+    uint16_t crc;
+}CRC16_CTX_T;
 
 //uint16_t update_crc16_normal( uint16_t *table, uint16_t crc, char c );
 uint16_t update_crc16_reflected(const uint16_t *table, uint16_t crc, char c );
@@ -17,4 +34,9 @@ uint16_t update_crc16_A001( uint16_t crc, char c );
 uint16_t calculate_crc16_Modbus(char *p, unsigned int length);
 uint16_t calculate_crc16(char *p, unsigned int length);
 
+void crc16_init(CRC16_CTX_T *ctx);
+void crc16_init_Modbus(CRC16_CTX_T *ctx);
+void crc16_update(CRC16_CTX_T *ctx, const void *p, unsigned int length);
+uint16_t crc16_final(const CRC16_CTX_T *ctx);
+
 #endif /* _LIB_CRC_H_ */
@@ -0,0 +1,80 @@
+#include "Cadence.h"
+
+/**
+ * @brief	  schedule the next authorization interval after now,with jitter(xorshift32)
+ * @return  nothing
+ */
+static void schedule(CADENCE_T *c,uint32_t now)
+{
+	uint32_t span = c->interval>>CADENCE_JITTER_SHIFT;
+	
+	c->rand ^= c->rand<<13;
+	c->rand ^= c->rand>>17;
+	c->rand ^= c->rand<<5;
+	c->last = now;
+	c->next = now+c->interval-span+c->rand%(2*span+1);
+}
+
+/**
+ * @brief	  start with an authorization due at once,seed tells devices apart(e.g. a hash of the UID)
+ * @return  nothing
+ */
+void Cadence_init(CADENCE_T *c,uint32_t seed,uint32_t now)
+{
+	c->interval = CADENCE_MIN_MS;
+	c->rand = seed?seed:0x2545F491UL; //xorshift must not start at 0
+	c->successes = 0;
+	c->failures = 0;
+	c->last = now-CADENCE_MIN_MS;
+	c->next = now;
+}
+
+/**
+ * @brief	  the server authorized the device,stretch the interval after CADENCE_STRETCH in a row
+ * @return  nothing
+ */
+void Cadence_success(CADENCE_T *c,uint32_t now)
+{
+	c->failures = 0;
+	if(c->interval < CADENCE_MIN_MS){
+		c->interval = CADENCE_MIN_MS;
+		c->successes = 0;
+	}
+	if(++c->successes >= CADENCE_STRETCH && c->interval < CADENCE_MAX_MS){
+		c->interval = (c->interval*2 < CADENCE_MAX_MS)?c->interval*2:CADENCE_MAX_MS;
+		c->successes = 0;
+	}
+	schedule(c,now);
+}
+
+/**
+ * @brief	  the authorization was refused,timed out or could not be sent,retry soon
+ * @return  nothing
+ */
+void Cadence_failure(CADENCE_T *c,uint32_t now)
+{
+	c->successes = 0;
+	if(c->failures++ == 0)
+		c->interval = CADENCE_RETRY_MS;
+	else if(c->interval < CADENCE_MIN_MS)
+		c->interval = (c->interval*2 < CADENCE_MIN_MS)?c->interval*2:CADENCE_MIN_MS;
+	schedule(c,now);
+}
+
+/**
+ * @brief	  check if an authorization is due
+ * @return  nonzero if it is
+ */
+int Cadence_due(const CADENCE_T *c,uint32_t now)
+{
+	return (int32_t)(now-c->next) >= 0;
+}
+
+/**
+ * @brief	  check if a message sent now for another reason should carry the authorization
+ * @return  nonzero if it should
+ */
+int Cadence_piggyback(const CADENCE_T *c,uint32_t now)
+{
+	return now-c->last >= c->interval>>CADENCE_PIGGYBACK_SHIFT;
+}
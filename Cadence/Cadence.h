@@ -0,0 +1,48 @@
+#ifndef _CADENCE_H
+#define _CADENCE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * When to authorize next. The interval starts at CADENCE_MIN_MS and doubles after every
+ * CADENCE_STRETCH successes in a row, up to CADENCE_MAX_MS. A failure drops it to
+ * CADENCE_RETRY_MS, doubling with every further failure until it is back at CADENCE_MIN_MS.
+ * Every interval is moved by up to 1/2^CADENCE_JITTER_SHIFT of itself either way, drawn from a
+ * per-device seed, so devices that were switched on together drift apart.
+ *
+ * Once CADENCE_PIGGYBACK_SHIFT of the interval has passed (half of it by default), a message
+ * sent for another reason may carry the authorization instead of a round trip of its own.
+ * Times are in the caller's unit (ms of tick_ct in SWAuthDemo.c) and may wrap.
+ */
+
+#define CADENCE_MIN_MS              (60*1000UL)     /* the old fixed AUTH_PERIOD */
+#define CADENCE_MAX_MS              (32*60*1000UL)
+#define CADENCE_RETRY_MS            (10*1000UL)
+#define CADENCE_STRETCH             (3)
+#define CADENCE_JITTER_SHIFT        (3)
+#define CADENCE_PIGGYBACK_SHIFT     (1)
+
+typedef struct CADENCE{
+	uint32_t interval;      /* without jitter */
+	uint32_t last;          /* time of the latest result */
+	uint32_t next;          /* time the next authorization is due,jitter included */
+	uint32_t rand;          /* jitter generator state */
+	uint16_t successes;     /* in a row */
+	uint16_t failures;      /* in a row */
+}CADENCE_T;
+
+void Cadence_init(CADENCE_T *c,uint32_t seed,uint32_t now);
+void Cadence_success(CADENCE_T *c,uint32_t now);
+void Cadence_failure(CADENCE_T *c,uint32_t now);
+int Cadence_due(const CADENCE_T *c,uint32_t now);
+int Cadence_piggyback(const CADENCE_T *c,uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,110 @@
+#include "Capture.h"
+#include "string.h"
+
+/* byte at offset from the start of the oldest record */
+static uint8_t byte_at(const CAPTURE_T *cap,int offset)
+{
+	return cap->buf[(cap->head+cap->size-cap->used+offset)%cap->size];
+}
+
+/* size of the record at offset,its time difference in *dt */
+static int record_size(const CAPTURE_T *cap,int offset,uint32_t *dt)
+{
+	int n = 0;
+	uint8_t b;
+	*dt = 0;
+	do{
+		b = byte_at(cap,offset+n);
+		*dt |= (uint32_t)(b & 0x7F)<<(7*n);
+		n++;
+	}while((b & 0x80) && n < 5);
+	return n+1+(byte_at(cap,offset+n) & CAPTURE_LEN_MAX);
+}
+
+/* overwrite the oldest record,the next one becomes the oldest */
+static void drop_oldest(CAPTURE_T *cap)
+{
+	uint32_t dt;
+	cap->used -= (uint16_t)record_size(cap,0,&dt);
+	cap->lost++;
+	if(cap->used > 0){
+		record_size(cap,0,&dt);
+		cap->first += dt;
+	}
+}
+
+static void put_byte(CAPTURE_T *cap,uint8_t b)
+{
+	cap->buf[cap->head] = b;
+	if(++cap->head == cap->size)
+		cap->head = 0;
+	cap->used++;
+}
+
+/**
+ * @brief	  start an empty capture in buf
+ * @return  return 0 if started successfully ,otherwise, return nagative value(buf too small for a record)
+ */
+int Capture_init(CAPTURE_T *cap,uint8_t *buf,uint16_t size)
+{
+	memset(cap,0,sizeof(CAPTURE_T));
+	if(size < CAPTURE_RECORD_MAX)
+		return -1;
+	cap->buf = buf;
+	cap->size = size;
+	return 0;
+}
+
+/**
+ * @brief	  add size bytes that went by at now,dir is CAPTURE_RX or CAPTURE_TX
+ * @return  nothing
+ */
+void Capture_put(CAPTURE_T *cap,int dir,uint32_t now,const char *data,int size)
+{
+	uint8_t dt[5];
+	uint32_t v;
+	int n,len,i;
+
+	if(cap->buf == NULL)
+		return;
+	while(size > 0){
+		len = (size > CAPTURE_LEN_MAX)?CAPTURE_LEN_MAX:size;
+		v = cap->used?now-cap->last:0;
+		n = 0;
+		do{
+			dt[n] = (uint8_t)(v & 0x7F);
+			v >>= 7;
+			if(v)
+				dt[n] |= 0x80;
+			n++;
+		}while(v);
+		while(cap->size-cap->used < n+1+len)
+			drop_oldest(cap);
+		if(cap->used == 0)
+			cap->first = now;
+		for(i=0;i<n;i++)
+			put_byte(cap,dt[i]);
+		put_byte(cap,(uint8_t)(dir | len));
+		for(i=0;i<len;i++)
+			put_byte(cap,(uint8_t)data[i]);
+		cap->last = now;
+		data += len;
+		size -= len;
+	}
+}
+
+/**
+ * @brief	  copy up to size bytes of the records from offset on,oldest first
+ * @return  bytes copied,0 past the end
+ */
+int Capture_copy(const CAPTURE_T *cap,int offset,uint8_t *out,int size)
+{
+	int i;
+	if(offset < 0 || offset >= cap->used)
+		return 0;
+	if(size > cap->used-offset)
+		size = cap->used-offset;
+	for(i=0;i<size;i++)
+		out[i] = byte_at(cap,offset+i);
+	return size;
+}
@@ -0,0 +1,46 @@
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Capture of the bytes on the AT UART, both ways, with the time they went by. Records are kept
+ * in a ring the caller provides and the oldest ones are overwritten, so the ring always holds
+ * the latest traffic. A record is the time since the previous record(LEB128, 1 to 5 bytes),
+ * a header byte(CAPTURE_TX in bit 7, the byte count 1..CAPTURE_LEN_MAX below it) and the bytes;
+ * longer writes take several records. The time of the oldest record is kept apart, the time
+ * difference stored with it is meaningless once the record before it was overwritten.
+ *
+ * Capture_copy gives the records as they are stored, oldest first, for a dump(SWAuthDemo.c
+ * prints it in hex, tools/sim/replay.c reads it back). Times are in the caller's unit(ms of
+ * tick_ct in SWAuthDemo.c) and may wrap.
+ */
+
+#define CAPTURE_RX          (0x00)
+#define CAPTURE_TX          (0x80)
+#define CAPTURE_LEN_MAX     (0x7F)
+#define CAPTURE_RECORD_MAX  (5+1+CAPTURE_LEN_MAX)   /* the ring must hold one */
+
+typedef struct CAPTURE{
+	uint8_t *buf;
+	uint16_t size;
+	uint16_t head;          /* where the next record goes */
+	uint16_t used;          /* bytes of records,the oldest starts at head-used */
+	uint32_t first;         /* time of the oldest record */
+	uint32_t last;          /* time of the newest record */
+	uint32_t lost;          /* records overwritten */
+}CAPTURE_T;
+
+int Capture_init(CAPTURE_T *cap,uint8_t *buf,uint16_t size);
+void Capture_put(CAPTURE_T *cap,int dir,uint32_t now,const char *data,int size);
+int Capture_copy(const CAPTURE_T *cap,int offset,uint8_t *out,int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,101 @@
+#include "Chaskey.h"
+
+#define ROTL(x,b)   (uint32_t)(((x) << (b)) | ((x) >> (32-(b))))
+
+static uint32_t load32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1]<<8 | (uint32_t)p[2]<<16 | (uint32_t)p[3]<<24;
+}
+
+/* multiply by x in GF(2^128) */
+static void times2(uint32_t *out,const uint32_t *in)
+{
+	out[0] = (in[0] << 1) ^ ((0-(in[3] >> 31)) & 0x87);   /* no branch on key bits */
+	out[1] = (in[1] << 1) | (in[0] >> 31);
+	out[2] = (in[2] << 1) | (in[1] >> 31);
+	out[3] = (in[3] << 1) | (in[2] >> 31);
+}
+
+static void permute(uint32_t *v)
+{
+	uint32_t v0 = v[0],v1 = v[1],v2 = v[2],v3 = v[3];
+	int i;
+
+	for(i=0;i<CHASKEY_ROUNDS;i++){
+		v0 += v1; v1 = ROTL(v1,5);  v1 ^= v0; v0 = ROTL(v0,16);
+		v2 += v3; v3 = ROTL(v3,8);  v3 ^= v2;
+		v0 += v3; v3 = ROTL(v3,13); v3 ^= v0;
+		v2 += v1; v1 = ROTL(v1,7);  v1 ^= v2; v2 = ROTL(v2,16);
+	}
+	v[0] = v0;
+	v[1] = v1;
+	v[2] = v2;
+	v[3] = v3;
+}
+
+/**
+ * @brief	  key schedule,raw is CHASKEY_KEY_SIZE bytes
+ * @return  nothing
+ */
+void Chaskey_setKey(CHASKEY_KEY_T *key,const uint8_t *raw)
+{
+	int i;
+	for(i=0;i<4;i++)
+		key->k[i] = load32(raw+4*i);
+	times2(key->k1,key->k);
+	times2(key->k2,key->k1);
+}
+
+/**
+ * @brief	  MAC of len bytes of msg,the first tagLen(1..16) bytes of it are written to tag
+ * @return  nothing
+ */
+void Chaskey_mac(const CHASKEY_KEY_T *key,const uint8_t *msg,int len,uint8_t *tag,int tagLen)
+{
+	uint32_t v[4];
+	uint8_t last[16];
+	const uint32_t *l;
+	int i;
+
+	for(i=0;i<4;i++)
+		v[i] = key->k[i];
+	for(;len > 16;len -= 16,msg += 16){
+		for(i=0;i<4;i++)
+			v[i] ^= load32(msg+4*i);
+		permute(v);
+	}
+	if(len == 16){
+		l = key->k1;
+		for(i=0;i<16;i++)
+			last[i] = msg[i];
+	}else{
+		l = key->k2;
+		for(i=0;i<16;i++)
+			last[i] = (i < len)?msg[i]:((i == len)?0x01:0x00);
+	}
+	for(i=0;i<4;i++)
+		v[i] ^= load32(last+4*i)^l[i];
+	permute(v);
+	for(i=0;i<4;i++)
+		v[i] ^= l[i];
+	for(i=0;i<tagLen && i<16;i++)
+		tag[i] = (uint8_t)(v[i>>2] >> (8*(i&3)));
+}
+
+/**
+ * @brief	  check a tag in constant time
+ * @return  0 if the tag matches,otherwise,return -1
+ */
+int Chaskey_verify(const CHASKEY_KEY_T *key,const uint8_t *msg,int len,const uint8_t *tag,int tagLen)
+{
+	uint8_t expect[16];
+	uint8_t diff = 0;
+	int i;
+
+	if(tagLen < 1 || tagLen > 16)
+		return -1;
+	Chaskey_mac(key,msg,len,expect,tagLen);
+	for(i=0;i<tagLen;i++)
+		diff |= expect[i]^tag[i];
+	return diff?-1:0;
+}
@@ -0,0 +1,42 @@
+#ifndef _CHASKEY_H
+#define _CHASKEY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Chaskey MAC (Mouha et al., 2014): a 128 bit key, a 128 bit state and an ARX permutation of
+ * 32 bit additions, rotations and XORs, so it needs no tables, no multiplier and no heap. The
+ * key schedule (the key and the two derived subkeys) is done once by Chaskey_setKey; every MAC
+ * after that runs one permutation per 16 bytes of message.
+ *
+ * Words are loaded little-endian, as on the Cortex-M0. CHASKEY_ROUNDS picks the round count:
+ * 12 (Chaskey-12, the recommended variant) by default, 8 for the original Chaskey.
+ */
+
+#ifndef CHASKEY_ROUNDS
+#define CHASKEY_ROUNDS      (12)
+#endif
+
+#define CHASKEY_KEY_SIZE    (16)
+#define CHASKEY_TAG_SIZE    (8)     /* bytes of the tag sent,at most 16 */
+
+/* precomputed key schedule */
+typedef struct CHASKEY_KEY{
+	uint32_t k[4];
+	uint32_t k1[4];     /* subkey for a message that ends on a full block */
+	uint32_t k2[4];     /* subkey for a padded last block */
+}CHASKEY_KEY_T;
+
+void Chaskey_setKey(CHASKEY_KEY_T *key,const uint8_t *raw);
+void Chaskey_mac(const CHASKEY_KEY_T *key,const uint8_t *msg,int len,uint8_t *tag,int tagLen);
+int Chaskey_verify(const CHASKEY_KEY_T *key,const uint8_t *msg,int len,const uint8_t *tag,int tagLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+#include "Histogram.h"
+
+/**
+ * @brief	  count value in its bucket
+ * @return  nothing
+ */
+void Histogram_add(HISTOGRAM_T *h,uint32_t value)
+{
+	int b = 0;
+	uint32_t v = value>>HISTOGRAM_SHIFT;
+
+	while(v && b < HISTOGRAM_BUCKETS-1){
+		v >>= 1;
+		b++;
+	}
+	if(h->count[b] != 0xFFFF)
+		h->count[b]++;
+	if(value > h->max)
+		h->max = value;
+}
+
+/**
+ * @brief	  count of all buckets
+ * @return  the count
+ */
+uint32_t Histogram_total(const HISTOGRAM_T *h)
+{
+	uint32_t n = 0;
+	int b;
+	for(b=0;b<HISTOGRAM_BUCKETS;b++)
+		n += h->count[b];
+	return n;
+}
+
+/**
+ * @brief	  upper bound of a bucket,values in it are below it
+ * @return  the bound,0xFFFFFFFF for the last bucket
+ */
+uint32_t Histogram_bound(int bucket)
+{
+	if(bucket >= HISTOGRAM_BUCKETS-1)
+		return 0xFFFFFFFFUL;
+	return 1UL<<(HISTOGRAM_SHIFT+bucket);
+}
+
+/**
+ * @brief	  pct percentile(1..100),the bound of the bucket it falls in but no more than the largest value
+ * @return  the percentile,0 if nothing was added
+ */
+uint32_t Histogram_percentile(const HISTOGRAM_T *h,int pct)
+{
+	uint32_t total = Histogram_total(h),rank,n = 0;
+	int b;
+
+	if(total == 0)
+		return 0;
+	rank = (total*pct+99)/100;  //the rank-th smallest value,rounded up
+	for(b=0;b<HISTOGRAM_BUCKETS-1;b++){
+		n += h->count[b];
+		if(n >= rank)
+			break;
+	}
+	return (Histogram_bound(b) < h->max)?Histogram_bound(b):h->max;
+}
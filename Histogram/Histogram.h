@@ -0,0 +1,36 @@
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Latency histogram with fixed log2 buckets. Bucket 0 holds values below 2^HISTOGRAM_SHIFT,
+ * bucket b the values from 2^(HISTOGRAM_SHIFT+b-1) up to 2^(HISTOGRAM_SHIFT+b), and the last
+ * bucket everything above. With values in us(tickUs() in SWAuthDemo.c) that is <256us up to
+ * >=4.2s. The bounds are the same on every device, so the counts of a fleet add up bucket by
+ * bucket and percentiles come from the sum; a percentile is the upper bound of its bucket, at
+ * most a factor 2 above the true value. Counts stop at 65535.
+ */
+
+#define HISTOGRAM_BUCKETS   (16)
+#define HISTOGRAM_SHIFT     (8)
+
+typedef struct HISTOGRAM{
+	uint16_t count[HISTOGRAM_BUCKETS];
+	uint32_t max;           /* largest value added */
+}HISTOGRAM_T;
+
+void Histogram_add(HISTOGRAM_T *h,uint32_t value);
+uint32_t Histogram_total(const HISTOGRAM_T *h);
+uint32_t Histogram_bound(int bucket);
+uint32_t Histogram_percentile(const HISTOGRAM_T *h,int pct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#include "IAP.h"
+#include "chip.h"
+
+#define IAP_PREPARE         (50)
+#define IAP_COPY_RAM        (51)
+#define IAP_ERASE           (52)
+#define IAP_COMPARE         (56)
+
+typedef void (*IAP_ENTRY_T)(uint32_t *cmd,uint32_t *result);
+
+static int iapCall(uint32_t *cmd,uint32_t *result)
+{
+	__disable_irq();
+	((IAP_ENTRY_T)IAP_LOCATION)(cmd,result);
+	__enable_irq();
+	return -(int)result[0];
+}
+
+static int prepare(uint32_t sector)
+{
+	uint32_t cmd[5],result[4];
+	cmd[0] = IAP_PREPARE;
+	cmd[1] = sector;
+	cmd[2] = sector;
+	return iapCall(cmd,result);
+}
+
+/**
+ * @brief	  erase one IAP_SECTOR_SIZE sector
+ * @return  return 0 if erased successfully ,otherwise, return nagative value(IAP_STATUS)
+ */
+int IAP_eraseSector(uintptr_t sector)
+{
+	uint32_t cmd[5],result[4];
+	int ret = prepare((uint32_t)sector);
+	if(ret)
+		return ret;
+	cmd[0] = IAP_ERASE;
+	cmd[1] = (uint32_t)sector;
+	cmd[2] = (uint32_t)sector;
+	cmd[3] = SystemCoreClock/1000;  //kHz
+	return iapCall(cmd,result);
+}
+
+/**
+ * @brief	  write size bytes(256,512,1024 or 4096) from word aligned RAM to erased flash at dst,
+                dst is a multiple of IAP_PAGE_SIZE and the range stays in one sector
+ * @return  return 0 if written and read back successfully ,otherwise, return nagative value(IAP_STATUS)
+ */
+int IAP_write(uintptr_t dst,const uint32_t *src,uint32_t size)
+{
+	uint32_t cmd[5],result[4];
+	int ret = prepare((uint32_t)(dst/IAP_SECTOR_SIZE));
+	if(ret)
+		return ret;
+	cmd[0] = IAP_COPY_RAM;
+	cmd[1] = (uint32_t)dst;
+	cmd[2] = (uint32_t)(uintptr_t)src;
+	cmd[3] = size;
+	cmd[4] = SystemCoreClock/1000;
+	ret = iapCall(cmd,result);
+	if(ret)
+		return ret;
+	cmd[0] = IAP_COMPARE;
+	cmd[1] = (uint32_t)dst;
+	cmd[2] = (uint32_t)(uintptr_t)src;
+	cmd[3] = size;
+	return iapCall(cmd,result);
+}
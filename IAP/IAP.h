@@ -0,0 +1,44 @@
+#ifndef _IAP_H
+#define _IAP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * In-application programming of the LPC1125 flash through the boot ROM. The ROM uses the top
+ * 32 bytes of RAM while it runs, so the project's IRAM1 ends 32 bytes short of 0x10002000.
+ * Flash cannot be read during an erase or a write, interrupts are disabled for the duration of
+ * every call (about 100ms for an erase,1ms for a page) and UART data arriving then may be lost.
+ */
+
+#define IAP_LOCATION        (0x1FFF1FF1UL)
+#define IAP_SECTOR_SIZE     (4096)
+#define IAP_PAGE_SIZE       (256)       /* smallest write */
+
+/* boot ROM status codes,returned negated */
+enum IAP_STATUS{
+	IAP_CMD_SUCCESS = 0,
+	IAP_INVALID_COMMAND = 1,
+	IAP_SRC_ADDR_ERROR = 2,
+	IAP_DST_ADDR_ERROR = 3,
+	IAP_SRC_ADDR_NOT_MAPPED = 4,
+	IAP_DST_ADDR_NOT_MAPPED = 5,
+	IAP_COUNT_ERROR = 6,
+	IAP_INVALID_SECTOR = 7,
+	IAP_SECTOR_NOT_BLANK = 8,
+	IAP_SECTOR_NOT_PREPARED = 9,
+	IAP_COMPARE_ERROR = 10,
+	IAP_BUSY = 11,
+};
+
+int IAP_eraseSector(uintptr_t sector);
+int IAP_write(uintptr_t dst,const uint32_t *src,uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,168 @@
+#include "Lease.h"
+#include "IAP.h"
+#include "string.h"
+
+#define LEASE_PAGES     (IAP_SECTOR_SIZE/IAP_PAGE_SIZE)
+#define LEASE_UID_MAX   (16)
+
+static uint32_t pageImage[IAP_PAGE_SIZE/4];    /* a page being written,kept off the stack */
+
+static uint32_t getBE32(const uint8_t *p)
+{
+	return (uint32_t)p[0]<<24 | (uint32_t)p[1]<<16 | (uint32_t)p[2]<<8 | p[3];
+}
+
+static void putBE32(uint8_t *p,uint32_t v)
+{
+	p[0] = (uint8_t)(v>>24);
+	p[1] = (uint8_t)(v>>16);
+	p[2] = (uint8_t)(v>>8);
+	p[3] = (uint8_t)v;
+}
+
+/**
+ * @brief	  unpack LEASE_WIRE_SIZE bytes,the MAC is not checked here
+ * @return  return 0 if decoded successfully ,otherwise, return nagative value
+ */
+int Lease_decode(LEASE_T *lease,const uint8_t *wire,int len)
+{
+	if(len != LEASE_WIRE_SIZE)
+		return -1;
+	lease->magic = LEASE_MAGIC;
+	lease->issued = getBE32(wire);
+	lease->expiry = getBE32(wire+4);
+	lease->features = getBE32(wire+8);
+	memcpy(lease->mac,wire+12,CHASKEY_TAG_SIZE);
+	return 0;
+}
+
+/**
+ * @brief	  check the MAC of a lease for this device
+ * @return  return 0 if the lease is genuine and not empty ,otherwise, return nagative value
+ */
+int Lease_verify(const LEASE_T *lease,const CHASKEY_KEY_T *key,const uint8_t *uid,int uidLen)
+{
+	uint8_t msg[1+LEASE_UID_MAX+12];
+	
+	if(lease->magic != LEASE_MAGIC || uidLen != LEASE_UID_MAX || lease->expiry <= lease->issued)
+		return -1;
+	msg[0] = 'L';
+	memcpy(msg+1,uid,uidLen);
+	putBE32(msg+1+uidLen,lease->issued);
+	putBE32(msg+5+uidLen,lease->expiry);
+	putBE32(msg+9+uidLen,lease->features);
+	return Chaskey_verify(key,msg,sizeof(msg),lease->mac,CHASKEY_TAG_SIZE)?-2:0;
+}
+
+/**
+ * @brief	  find the latest lease in the sector that verifies for this device(Lease_verify),a
+                newer page with a bad MAC does not hide the older genuine one
+ * @return  page index of the lease,or nagative value if there is none
+ */
+int Lease_load(LEASE_T *lease,uintptr_t sectorAddr,const CHASKEY_KEY_T *key,const uint8_t *uid,int uidLen)
+{
+	const LEASE_T *page;
+	int i,found = -1;
+	
+	for(i=0;i<LEASE_PAGES;i++){
+		page = (const LEASE_T*)(sectorAddr+i*IAP_PAGE_SIZE);
+		if(page->magic != LEASE_MAGIC || (found >= 0 && page->issued < lease->issued))
+			continue;
+		if(!Lease_verify(page,key,uid,uidLen)){
+			memcpy(lease,page,sizeof(LEASE_T));
+			found = i;
+		}
+	}
+	return found;
+}
+
+/* the first blank page of the sector,LEASE_PAGES if there is none */
+static int blankPage(uintptr_t sectorAddr)
+{
+	const uint32_t *p;
+	int i,j;
+	
+	for(i=0;i<LEASE_PAGES;i++){
+		p = (const uint32_t*)(sectorAddr+i*IAP_PAGE_SIZE);
+		for(j=0;j<IAP_PAGE_SIZE/4 && p[j] == 0xFFFFFFFFUL;j++){}
+		if(j == IAP_PAGE_SIZE/4)
+			break;
+	}
+	return i;
+}
+
+/* write size bytes of data as the page at addr,the rest of it left blank */
+static int writePage(uintptr_t addr,const void *data,int size)
+{
+	memset(pageImage,0xFF,sizeof(pageImage));
+	memcpy(pageImage,data,size);
+	return IAP_write(addr,pageImage,IAP_PAGE_SIZE);
+}
+
+/**
+ * @brief	  write lease to the next blank page,the sector is erased when it is full
+ * @return  return 0 if stored successfully ,otherwise, return nagative value
+ */
+int Lease_store(const LEASE_T *lease,uintptr_t sectorAddr)
+{
+	int i = blankPage(sectorAddr),ret;
+	
+	if(i == LEASE_PAGES){
+		ret = IAP_eraseSector(sectorAddr/IAP_SECTOR_SIZE);
+		if(ret)
+			return ret;
+		i = 0;
+	}
+	return writePage(sectorAddr+i*IAP_PAGE_SIZE,lease,sizeof(LEASE_T));
+}
+
+/**
+ * @brief	  revoke every stored lease
+ * @return  return 0 if erased successfully ,otherwise, return nagative value
+ */
+int Lease_erase(uintptr_t sectorAddr)
+{
+	return IAP_eraseSector(sectorAddr/IAP_SECTOR_SIZE);
+}
+
+/**
+ * @brief	  find the latest server time checkpoint in the sector
+ * @return  page index of the checkpoint,or nagative value if there is none
+ */
+int Lease_loadCheckpoint(uint32_t *now,uintptr_t sectorAddr)
+{
+	const LEASE_CHECK_T *page;
+	int i,found = -1;
+	
+	for(i=0;i<LEASE_PAGES;i++){
+		page = (const LEASE_CHECK_T*)(sectorAddr+i*IAP_PAGE_SIZE);
+		if(page->magic != LEASE_CHECK_MAGIC)
+			continue;
+		if(found < 0 || (int32_t)(page->now-*now) >= 0){
+			*now = page->now;
+			found = i;
+		}
+	}
+	return found;
+}
+
+/**
+ * @brief	  write the server time now to the next blank page,when the sector is full it is erased
+                and lease,the one in use,written first
+ * @return  return 0 if stored successfully ,otherwise, return nagative value
+ */
+int Lease_storeCheckpoint(uint32_t now,const LEASE_T *lease,uintptr_t sectorAddr)
+{
+	LEASE_CHECK_T check;
+	int i = blankPage(sectorAddr),ret;
+	
+	if(i == LEASE_PAGES){
+		ret = Lease_store(lease,sectorAddr);    //erases,the lease goes to page 0
+		if(ret)
+			return ret;
+		i = 1;
+	}
+	check.magic = LEASE_CHECK_MAGIC;
+	check.now = now;
+	return writePage(sectorAddr+i*IAP_PAGE_SIZE,&check,sizeof(check));
+}
@@ -0,0 +1,63 @@
+#ifndef _LEASE_H
+#define _LEASE_H
+
+#include <stdint.h>
+#include "Chaskey.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Authorization lease: the server's statement that a device may run until a given time,
+ * with a set of feature bits. The server MACs it with the device's challenge key(Chaskey.h),
+ * so only the server and the device holding that key can produce it.
+ *
+ * On the wire,after AUTH_TAG_LEASE or as the hex string "lease",LEASE_WIRE_SIZE bytes:
+ *   issued(4) expiry(4) features(4) mac(8)        integers big-endian,times in server seconds
+ * The MAC covers 'L',the 16 byte raw UID and the 12 bytes of times and features.
+ *
+ * In flash every lease takes one IAP_PAGE_SIZE page of the sector at the given address. A new
+ * lease goes to the next blank page and the sector is only erased when all 16 are used, the
+ * latest one whose MAC verifies is the current one.
+ *
+ * There is no RTC, so the device also keeps checkpoints of the server time it has reached in
+ * pages of the same sector. After a reset the time goes on from the latest one instead of the
+ * issue time of the lease. Otherwise a device that is reset often would never see its lease
+ * expire. When a checkpoint fills the sector, the sector is erased and the lease is written
+ * again first.
+ */
+
+#define LEASE_WIRE_SIZE     (12+CHASKEY_TAG_SIZE)
+#define LEASE_MAGIC         (0x4C534531UL)     /* "LSE1" */
+#define LEASE_CHECK_MAGIC   (0x4C534331UL)     /* "LSC1" */
+
+#define LEASE_FEATURE_APP   (1UL<<0)    /* userApp may run on the cached lease before the server is reached */
+
+typedef struct LEASE{
+	uint32_t magic;
+	uint32_t issued;
+	uint32_t expiry;
+	uint32_t features;
+	uint8_t mac[CHASKEY_TAG_SIZE];
+}LEASE_T;
+
+/* a checkpoint page */
+typedef struct LEASE_CHECK{
+	uint32_t magic;
+	uint32_t now;       /* server seconds */
+}LEASE_CHECK_T;
+
+int Lease_decode(LEASE_T *lease,const uint8_t *wire,int len);
+int Lease_verify(const LEASE_T *lease,const CHASKEY_KEY_T *key,const uint8_t *uid,int uidLen);
+int Lease_load(LEASE_T *lease,uintptr_t sectorAddr,const CHASKEY_KEY_T *key,const uint8_t *uid,int uidLen);
+int Lease_store(const LEASE_T *lease,uintptr_t sectorAddr);
+int Lease_erase(uintptr_t sectorAddr);
+int Lease_loadCheckpoint(uint32_t *now,uintptr_t sectorAddr);
+int Lease_storeCheckpoint(uint32_t now,const LEASE_T *lease,uintptr_t sectorAddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
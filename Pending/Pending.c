@@ -0,0 +1,120 @@
+#include "Pending.h"
+#include "string.h"
+
+/**
+ * @brief	  empty the table
+ * @return  nothing
+ */
+void Pending_init(PENDING_TABLE_T *table)
+{
+	memset(table,0,sizeof(PENDING_TABLE_T));
+}
+
+/**
+ * @brief	  take a slot for a request of apiId that must be answered within timeout
+ * @return  the sequence number to send,or nagative value if all PENDING_MAX slots are in use
+ */
+int Pending_open(PENDING_TABLE_T *table,int apiId,uint32_t now,uint32_t timeout)
+{
+	int i;
+	for(i=0;i<PENDING_MAX;i++){
+		if(table->req[i].seq == 0){
+			if(++table->lastSeq == 0)
+				table->lastSeq = 1;
+			table->req[i].seq = table->lastSeq;
+			table->req[i].apiId = (int16_t)apiId;
+			table->req[i].deadline = now+timeout;
+			table->req[i].sent = 0;
+			return table->lastSeq;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief	  a message went out at at,it carried the requests not marked sent yet
+ * @return  nothing
+ */
+void Pending_sent(PENDING_TABLE_T *table,uint32_t at)
+{
+	int i;
+	for(i=0;i<PENDING_MAX;i++){
+		if(table->req[i].seq != 0 && !table->req[i].sent){
+			table->req[i].sentAt = at;
+			table->req[i].sent = 1;
+		}
+	}
+}
+
+/**
+ * @brief	  find and free the request a reply answers. A reply without a sequence number(seq < 0,
+                from a server that does not echo it) answers the oldest request of its apiId
+ * @return  return 1 if the reply is expected and *sentAt is when the request went out,0 if it is
+                expected but the request was not marked sent,otherwise, return nagative value(stale reply)
+ */
+int Pending_match(PENDING_TABLE_T *table,int seq,int apiId,uint32_t *sentAt)
+{
+	int i,found = -1;
+	for(i=0;i<PENDING_MAX;i++){
+		if(table->req[i].seq == 0 || table->req[i].apiId != apiId)
+			continue;
+		if(seq >= 0){
+			if(table->req[i].seq == seq){
+				found = i;
+				break;
+			}
+		}else if(found < 0 || (int16_t)(table->req[i].seq-table->req[found].seq) < 0){
+			found = i;
+		}
+	}
+	if(found < 0)
+		return -1;
+	table->req[found].seq = 0;
+	if(!table->req[found].sent)
+		return 0;
+	*sentAt = table->req[found].sentAt;
+	return 1;
+}
+
+/**
+ * @brief	  free the slot of a request that was not sent
+ * @return  nothing
+ */
+void Pending_close(PENDING_TABLE_T *table,int seq)
+{
+	int i;
+	for(i=0;i<PENDING_MAX;i++)
+		if(seq > 0 && table->req[i].seq == seq)
+			table->req[i].seq = 0;
+}
+
+/**
+ * @brief	  free one request whose deadline has passed,call until it returns 0
+ * @return  sequence number of the late request and its apiId,0 if none is late
+ */
+int Pending_expire(PENDING_TABLE_T *table,uint32_t now,int *apiId)
+{
+	int i,seq;
+	for(i=0;i<PENDING_MAX;i++){
+		if(table->req[i].seq != 0 && (int32_t)(now-table->req[i].deadline) >= 0){
+			seq = table->req[i].seq;
+			*apiId = table->req[i].apiId;
+			table->req[i].seq = 0;
+			return seq;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief	  count the requests of apiId in flight,any apiId if it is negative
+ * @return  the count
+ */
+int Pending_count(const PENDING_TABLE_T *table,int apiId)
+{
+	int i,n = 0;
+	for(i=0;i<PENDING_MAX;i++)
+		if(table->req[i].seq != 0 && (apiId < 0 || table->req[i].apiId == apiId))
+			n++;
+	return n;
+}
@@ -0,0 +1,49 @@
+#ifndef _PENDING_H
+#define _PENDING_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Requests sent to the server and not answered yet. Every request gets a sequence number that
+ * the server echoes in its reply ("seq" in JSON,AUTH_TAG_SEQ in a frame), so several requests
+ * can be on the connection at once and each reply finds its own. A reply whose number is not in
+ * the table, because it was answered already or ran past its deadline, is stale.
+ *
+ * Sequence numbers run 1..65535 and skip 0, which marks a free slot. Times are in the caller's
+ * unit (ticks of tick_ct in SWAuthDemo.c) and may wrap. Pending_sent marks the requests opened
+ * since the last message went out with the time it did, in a unit of its own(tickUs() in
+ * SWAuthDemo.c), and Pending_match hands it back to time the round trip.
+ */
+
+#define PENDING_MAX         (4)
+
+typedef struct PENDING_REQ{
+	uint16_t seq;
+	int16_t apiId;
+	uint32_t deadline;
+	uint32_t sentAt;
+	uint8_t sent;           /* sentAt is set */
+}PENDING_REQ_T;
+
+typedef struct PENDING_TABLE{
+	PENDING_REQ_T req[PENDING_MAX];
+	uint16_t lastSeq;
+}PENDING_TABLE_T;
+
+void Pending_init(PENDING_TABLE_T *table);
+int Pending_open(PENDING_TABLE_T *table,int apiId,uint32_t now,uint32_t timeout);
+void Pending_sent(PENDING_TABLE_T *table,uint32_t at);
+int Pending_match(PENDING_TABLE_T *table,int seq,int apiId,uint32_t *sentAt);
+void Pending_close(PENDING_TABLE_T *table,int seq);
+int Pending_expire(PENDING_TABLE_T *table,uint32_t now,int *apiId);
+int Pending_count(const PENDING_TABLE_T *table,int apiId);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -12,11 +12,31 @@
 #include "Air202.h"
 #include "stdlib.h"
 #include "cJSON.h"
+#include "cJSON_Pool.h"
+#include "cJSON_Stream.h"
+#include "cJSON_Schema.h"
+#include "cJSON_Writer.h"
+#include "AuthFrame.h"
+#include "Chaskey.h"
+#include "Lease.h"
+#include "Pending.h"
+#include "Cadence.h"
+#include "Capture.h"
+#include "Histogram.h"
+#include "Trace.h"
+#include "Stack.h"
+#include "Telemetry.h"
 
 /*****************************************************************************
  * Macro definitions
  ****************************************************************************/
 #define AUTH_ENABLE         (1)
+#define JSON_STREAM_ENABLE  (1)     /* parse +IPD payloads while they are recieved */
+#define AUTH_BINARY_ENABLE  (1)     /* offer the binary frame format(AuthFrame.h) on every connection */
+#define SOCK_CRC_ENABLE     (0)     /* JSON messages carry a CRC16 trailer both ways,the server must do the same */
+#define MAC_BENCH_ENABLE    (0)     /* print the cycles of one challenge MAC at startup */
+#define UART_CAPTURE_ENABLE (1)     /* keep the latest AT UART traffic(Capture.h),dumped for tools/sim replay */
+#define TELEMETRY_ENABLE    (1)     /* sample the link and send health records to the server(Telemetry.h) */
 
 #define GPRS_CTL_PORT       (3)
 #define GPRS_CTL_PIN        (3)
@@ -26,16 +46,44 @@
 #define AT_UART_IRQHandler  UART2_IRQHandler
 
 #define TICKRATE_HZ         (1000)	    /* 1000 ticks per second */
+#ifndef UID_ADDR    /* flash addresses,a board.h may place them elsewhere(tools/sim) */
 #define UID_ADDR            (0xF000)
+#define KEY_ADDR            (0xF040)    /* MAC key record: CHASKEY_KEY_SIZE bytes and CRC16,next to the UID */
+#define LEASE_ADDR          (0xE000)    /* lease sector(Lease.h),IROM1 ends here */
+#endif
+#ifndef STACK_BASE  /* the STACK section of keil_startup_lpc112x.s,symbols of armlink */
+extern uint32_t STACK$$Base;
+extern uint32_t STACK$$Limit;
+#define STACK_BASE          (&STACK$$Base)
+#define STACK_LIMIT         (&STACK$$Limit)
+#endif
 #define UID_SIZE            (32)
-#define AUTH_PERIOD         (60*1000)   /* 10000 miniseconds */
+#define AUTH_NONCE_SIZE     (8)
 #define AUTH_TIMEOUT_S      (15)   
+#define AUTH_TIMEOUT_MS     (AUTH_TIMEOUT_S*1000)   /* deadline of every request */
+#define STATS_PERIOD_S      (3600)  /* message counts are logged and restarted every hour */
+#define LEASE_CHECKPOINT_S  (3600)  /* the server time is written to the lease sector this often */
+#define LEASE_RESET_S       (60)    /* server seconds a reset counts at least,the time powered off is not known */
 #define AT_UART_BAUDRATE    (115200)
 #define TX_RB_SIZE          (256)
 #define RX_RB_SIZE          (512)
 #define SQ_DEADLINE         (10)
 #define SOCK_IN_BUF_SIZE    (512)
 #define SOCK_OUT_BUF_SIZE   (256)
+#define SOCK_CRC_SIZE       (2)     /* calculate_crc16() of the message,big-endian like the UID record */
+#define AT_UNREAD_SIZE      (160)   /* bytes after one message of a +IPD kept for the next read,a lease reply fits */
+#define CAPTURE_SIZE        (512)
+#define CAPTURE_LINE_BYTES  (32)    /* bytes of the capture on one dump line */
+#define CAPTURE_DUMP_GAP_S  (60)    /* odd modem output dumps the capture at most this often */
+#define CONSOLE_DUMP_CMD    'c'     /* typed on the debug UART,dumps the capture */
+#define CONSOLE_LATENCY_CMD 'h'     /* typed on the debug UART,prints the latency histograms */
+#define CONSOLE_MEMORY_CMD  'm'     /* typed on the debug UART,prints the stack and buffer usage */
+#define TRACE_SIZE          (128)   /* words of the trace ring(Trace.h),a power of two */
+#define TRACE_LINE_WORDS    (12)    /* words of trace records on one "trc" line,at least TRACE_RECORD_MAX */
+#define TELEMETRY_SAMPLE_S  (300)   /* signal and registration are asked this often,two AT commands */
+#define TELEMETRY_BUDGET    (8192)  /* bytes of telemetry messages a day */
+#define TELEMETRY_JSON_SIZE (104)   /* bytes of a JSON telemetry message besides the records,CRC and a piggybacked authorization included */
+#define TELEMETRY_FRAME_SIZE (40)   /* the same for a frame */
 
 #define SERVER_IP           "orange.55555.io"
 #if 1
@@ -44,8 +92,9 @@
 	#define SERVER_PORT       28581 
 #endif
 
-#define  AUTH_REQ_PACK      "{\"apiId\":%d,\"UID\":\"%s\"}"
 #define  ATUH_API_ID        1
+#define  AUTH_MAC_API_ID    2       /* answer to a challenge */
+#define  TELEMETRY_API_ID   3       /* telemetry records,acknowledged with RESP_CODE_SUCCESS */
 
 /*****************************************************************************
  * Public types/enumerations/variables
@@ -68,6 +117,7 @@
  
 enum RESP_CODE{
 	RESP_CODE_SUCCESS = 100,
+	RESP_CODE_CHALLENGE = 101,  /* prove the key: MAC over nonce,raw UID and counter */
 	RESP_CODE_ERROR = 4,
 };
 
@@ -82,22 +132,113 @@ typedef struct SOCKET_BUFFER{
 	char outBuffer[SOCK_OUT_BUF_SIZE];
 }SOCKET_BUFFER_T;
 
+enum WIRE_FORMAT{
+	WIRE_JSON,          /* JSON messages */
+	WIRE_BINARY,        /* AuthFrame messages,the server answered one */
+	WIRE_PROBE,         /* connected,the next request is sent as a frame */
+	WIRE_PROBE_SENT,    /* a frame was sent,no answer yet */
+};
+
+enum RESP_ITEM{ /* bit n is respSchemaFields[n] */
+	RESP_ITEM_API_ID = (1<<0),
+	RESP_ITEM_RESP_CODE = (1<<1),
+	RESP_ITEM_NONCE = (1<<2),
+	RESP_ITEM_LEASE = (1<<3),
+	RESP_ITEM_SEQ = (1<<4),
+};
+
+typedef struct RESP_INFO{
+	int apiId;
+	int respCode;
+	char nonce[AUTH_NONCE_SIZE*2+1];    /* hex digits */
+	char lease[LEASE_WIRE_SIZE*2+1];    /* hex digits,sent with a success when a renewal was asked for */
+	int seq;        /* sequence number of the request answered(Pending.h) */
+	int items;      /* RESP_ITEM_* present in the message */
+	int format;     /* WIRE_JSON or WIRE_BINARY */
+}RESP_INFO_T;
+
 typedef struct AUTH_INFO{
 	int status; 
-	bool authFlag;
 	bool firstAuthFlag;
-	int authTime;
 }AUTH_INFO_T;
 
+typedef struct MSG_STATS{
+	uint16_t sent;          /* messages sent to the server */
+	uint16_t auth;          /* of them authorization requests and MAC answers */
+	uint16_t piggyback;     /* authorizations carried by messages sent for another reason */
+	uint16_t recv;          /* messages recieved */
+}MSG_STATS_T;
+
+typedef struct MEM_PEAKS{   /* most bytes ever held,to size the buffers from */
+	uint16_t rxRing;        /* in rxring when AT_Read took them,of RX_RB_SIZE */
+	uint16_t unread;        /* in rxUnread,of AT_UNREAD_SIZE */
+	uint16_t inMsg;         /* +IPD length recieved,of SOCK_IN_BUF_SIZE */
+	uint16_t outMsg;        /* message sent,of SOCK_OUT_BUF_SIZE */
+}MEM_PEAKS_T;
+
 bool ledToggleFlag = false;
 char uid[36];   /* 32 bytes uid */
+uint8_t uidRaw[UID_SIZE/2];     /* uid as 16 bytes for the binary format */
+bool uidRawValid = false;
+int wireFormat = WIRE_JSON;
+CHASKEY_KEY_T authKey;
+bool authKeyValid = false;
+uint32_t authCounter = 0;   /* counts MACs since reset,the nonce makes every answer fresh */
+LEASE_T lease;
+bool leaseValid = false;
+bool leaseSynced = false;   /* a lease came from the server since reset,serverTime is current */
+uint32_t serverTime = 0;    /* server seconds at systemTimer == serverTimeAt,taken from the latest lease */
+uint32_t serverTimeAt = 0;
+uint32_t leaseCheckpointAt = 0; /* systemTimer of the latest server time checkpoint */
+PENDING_TABLE_T pending;
+CADENCE_T cadence;
+MSG_STATS_T msgStats;           /* this hour */
+MSG_STATS_T msgStatsLastHour;
+#if UART_CAPTURE_ENABLE
+uint8_t captureBuff[CAPTURE_SIZE];
+CAPTURE_T capture;
+bool captureDumped = false;
+uint32_t captureDumpAt = 0;     /* systemTimer of the latest dump */
+#endif
+#if TRACE_ENABLE
+uint32_t traceBuff[TRACE_SIZE];
+#endif
+uint32_t msgStatsStart = 0;     /* systemTimer when this hour started */
+MEM_PEAKS_T memPeaks;
+TELEMETRY_T telemetry;
+uint32_t telemetrySampleAt = 0;     /* systemTimer of the latest signal sample */
+uint32_t telemetryATFailures = 0;   /* AT commands not answered until the latest record */
+HISTOGRAM_T authRtt;            /* us from an auth request or MAC answer sent to its reply recieved */
+uint16_t authTimeouts = 0;      /* of them not answered in AUTH_TIMEOUT_MS */
+char rxUnread[AT_UNREAD_SIZE];  /* returned by AT_Read before the ring buffer */
+int rxUnreadCount = 0;
+uint32_t rxUnreadUs = 0;        /* tickUs() when the bytes of rxUnread were read */
+uint32_t rxReadUs = 0;          /* tickUs() when the latest bytes AT_Read returned were recieved */
 volatile uint32_t tick_ct = 0;
 volatile uint32_t systemTimer = 0;
 RINGBUFF_T txring, rxring;
 SOCKET_BUFFER_T socketBuffer;
-AUTH_INFO_T authInfo = {AUTH_STATUS_FAIL,false,true};
+AUTH_INFO_T authInfo = {AUTH_STATUS_FAIL,true};
 char rxbuff[RX_RB_SIZE], txbuff[TX_RB_SIZE];
 char ATRXBuffer[AT_RX_BUF_SIZE];
+cJSON_Stream sockStream;
+cJSON_SchemaDecoder respDecoder;
+RESP_INFO_T respInfo;
+
+/* server message schema,regenerate the hash with tools/schema_gen when fields change */
+static const cJSON_SchemaField respSchemaFields[] = {
+	CJSON_SCHEMA_INT(RESP_INFO_T,apiId,"apiId",CJSON_SCHEMA_REQUIRED),
+	CJSON_SCHEMA_INT(RESP_INFO_T,respCode,"respCode",CJSON_SCHEMA_REQUIRED),
+	CJSON_SCHEMA_STRING(RESP_INFO_T,nonce,"nonce",0),
+	CJSON_SCHEMA_STRING(RESP_INFO_T,lease,"lease",0),
+	CJSON_SCHEMA_INT(RESP_INFO_T,seq,"seq",0),
+};
+/* generated by tools/schema_gen resp apiId respCode nonce lease seq */
+#define RESP_SCHEMA_SEED (2)
+#define RESP_SCHEMA_BITS (3)
+static const unsigned char respSchemaHash[8] = {3,0,0,1,0,4,5,2};
+static const cJSON_Schema respSchema = {respSchemaFields,sizeof(respSchemaFields)/sizeof(respSchemaFields[0]),
+	CJSON_SCHEMA_ALLOW_UNKNOWN,RESP_SCHEMA_SEED,RESP_SCHEMA_BITS,respSchemaHash};
 const char *description = "SW Auth Demo\r\n";
 char *authStr = "authorization request\r\n";
 
@@ -118,24 +259,27 @@ void SysTick_Handler(void)
 {
 	if ((tick_ct % 1000) == 0) {
 		systemTimer++;
-		if(authInfo.status == AUTH_STATUS_AUTHORIZING){
-			authInfo.authTime++;
-			if(authInfo.authTime > AUTH_TIMEOUT_S){
-				authInfo.status = AUTH_STATUS_FAIL;
-			}
-		}
 	}
 	if(tick_ct % 500 == 0){
 		ledToggleFlag = true;
 	}
-	#if AUTH_ENABLE
-	if((tick_ct % AUTH_PERIOD) == 0){
-		authInfo.authFlag = true;
-	}
-	#endif
 	tick_ct++;
 }
 
+/**
+ * @brief	  microseconds since reset from tick_ct and the SysTick counter,wraps after 71 minutes
+ * @return	the time in us
+ */
+uint32_t tickUs(void)
+{
+	uint32_t ms,val;
+	do{ //SysTick_Handler may run between the two reads
+		ms = tick_ct;
+		val = SysTick->VAL;
+	}while(ms != tick_ct);
+	return ms*1000+(SysTick->LOAD-val)*1000/(SysTick->LOAD+1); //VAL counts down from LOAD
+}
+
 /**
  * @brief	Handle interrupt from UART2
  * @return	Nothing
@@ -163,6 +307,7 @@ int setupGPRS(void)
 	if(!Air202_setEcho(0))  //Disable echo
 		break;
 	}
+	telemetry.win.retries += 4-retry;   //attempts that failed
 	if(retry==0)
 		return GPRS_ERROR_OTHERS;
 	retry = 5;
@@ -170,6 +315,7 @@ int setupGPRS(void)
 	if(!Air202_setIPHead(1)) //set ip head for recieving data
 		break;
 	}
+	telemetry.win.retries += 4-retry;
 	if(retry == 0)
 		return GPRS_ERROR_OTHERS;
 	retry = 5;
@@ -177,6 +323,7 @@ int setupGPRS(void)
 		if(!Air202_checkPIN())
 			break;	
 	}
+	telemetry.win.retries += 4-retry;
 	if(retry==0)
 		return GPRS_SIM_NOT_READY;
 	signal = Air202_checkSignal();
@@ -187,6 +334,7 @@ int setupGPRS(void)
 		if(Air202_checkAttach() == ATTACHED)
 			break;
 	}
+	telemetry.win.retries += 4-retry;
 	if(retry==0)
 		return GPRS_NOT_ATTACHED;
 	if(Air202_IPShut())
@@ -228,6 +376,58 @@ void userApp(void)
 	}
 }
 
+/**
+ * @brief	  server time estimated from the latest lease and the uptime since it was seen,
+                after a reset it goes on from the latest checkpoint of it in the lease sector
+ * @return	seconds
+ */
+uint32_t serverNow(void)
+{
+	return serverTime+(systemTimer-serverTimeAt);
+}
+
+/**
+ * @brief	  check if the lease lets userApp run without an online authorization
+ * @return	true if it does
+ */
+bool leaseActive(void)
+{
+	return leaseValid && (lease.features & LEASE_FEATURE_APP) && (int32_t)(lease.expiry-serverNow()) > 0;
+}
+
+/**
+ * @brief	  check if the lease is due for renewal at server time now,less than half of its time is left
+ * @return	true if it is
+ */
+bool leaseDue(uint32_t now)
+{
+	return !leaseValid || (int32_t)(lease.expiry-now) < (int32_t)((lease.expiry-lease.issued)/2);
+}
+
+/**
+ * @brief	  check if the next authorization should ask for a new lease,also the first one after
+                a reset to learn the server time
+ * @return	true if it should
+ */
+bool leaseWanted(void)
+{
+	if(!authKeyValid || !uidRawValid)
+		return false;
+	return !leaseSynced || leaseDue(serverNow());
+}
+
+/**
+ * @brief	  run userApp if authorized online or by the lease,called from the main loop and from
+                every millisecond of delay_ms,so it also runs while the GPRS module is set up
+ * @return	Nothing
+ */
+void userIdle(void)
+{
+	if((authInfo.status != AUTH_STATUS_FAIL && authInfo.firstAuthFlag == false) || leaseActive()){
+		userApp();
+	}
+}
+
 /**
  * @brief	 Read UID from flash
  * @return return 0 if read successfully ,otherwise, return nagative value
@@ -250,6 +450,84 @@ int getUID(const char* uid_addr,char *uid_data)
 	return 0;
 }
 
+/**
+ * @brief	 convert 2*n hex digits to n bytes
+ * @return return 0 if converted successfully ,otherwise, return nagative value
+ */
+int hexToBytes(const char *hex,uint8_t *out,int n)
+{
+	int i,h,v;
+	for(i=0;i<2*n;i++){
+		h = hex[i];
+		if(h >= '0' && h <= '9')
+			v = h-'0';
+		else if(h >= 'A' && h <= 'F')
+			v = h-'A'+10;
+		else if(h >= 'a' && h <= 'f')
+			v = h-'a'+10;
+		else
+			return -1;
+		if(i & 1)
+			out[i>>1] |= (uint8_t)v;
+		else
+			out[i>>1] = (uint8_t)(v<<4);
+	}
+	return 0;
+}
+
+/**
+ * @brief	 convert n bytes to 2*n upper case hex digits and a terminating null
+ * @return nothing
+ */
+void bytesToHex(const uint8_t *bytes,int n,char *hex)
+{
+	int i;
+	for(i=0;i<n;i++){
+		hex[2*i] = "0123456789ABCDEF"[bytes[i]>>4];
+		hex[2*i+1] = "0123456789ABCDEF"[bytes[i]&0x0F];
+	}
+	hex[2*n] = '\0';
+}
+
+/**
+ * @brief	 convert v to decimal digits and a terminating null
+ * @return number of digits
+ */
+int uintToDec(uint32_t v,char *dec)
+{
+	char digits[10];
+	int i,n = 0;
+	do{
+		digits[n++] = (char)('0'+v%10);
+		v /= 10;
+	}while(v);
+	for(i=0;i<n;i++)
+		dec[i] = digits[n-1-i];
+	dec[n] = '\0';
+	return n;
+}
+
+/**
+ * @brief	 Read the MAC key record from flash and set up its key schedule
+ * @return return 0 if read successfully ,otherwise, return nagative value
+ */
+int getKey(const uint8_t *key_addr,CHASKEY_KEY_T *key)
+{
+	uint8_t raw[CHASKEY_KEY_SIZE+2];
+	int i,blank = 1;
+	for(i=0;i<CHASKEY_KEY_SIZE+2;i++){
+		raw[i] = key_addr[i];
+		blank &= (raw[i] == 0xFF);
+	}
+	if(blank)   //not provisioned
+		return -1;
+	if(calculate_crc16((char*)raw,CHASKEY_KEY_SIZE) != (raw[CHASKEY_KEY_SIZE]<<8 | raw[CHASKEY_KEY_SIZE+1]))
+		return -2;
+	Chaskey_setKey(key,raw);
+	memset(raw,0,sizeof(raw));
+	return 0;
+}
+
 /**
  * @brief	  setup specified UART
  * @return  nothing
@@ -298,22 +576,65 @@ static void setupUART(LPC_UART_T *pUART,uint32_t baudrate)
  */
 int AT_Send(const char *str,int size)
 {
-   return Chip_UART_SendRB(AT_UART,&txring,str,size);
+	int n = (int)Chip_UART_SendRB(AT_UART,&txring,str,size);
+	#if UART_CAPTURE_ENABLE
+	Capture_put(&capture,CAPTURE_TX,tick_ct,str,n);
+	#endif
+	return n;
 }
 
 /**
- * @brief	  read out the recieved data form ringbuffer
+ * @brief	  read out the recieved data form ringbuffer into str,at most cap bytes,bytes given back 
+                with AT_Unread come first
  * @return  bytes recieved actually
  */
 
-int AT_Read(char *str)
+int AT_Read(char *str,int cap)
 {
-	int n = RingBuffer_GetCount(&rxring);
-	if(n<=0)
+	int n = rxUnreadCount,m;
+	if(cap <= 0)
 		return 0;
-	else{
-		return Chip_UART_ReadRB(AT_UART,&rxring,str,n);
+	if(n > cap)
+		n = cap;
+	if(n > 0){
+		memcpy(str,rxUnread,n);
+		rxUnreadCount -= n;
+		memmove(rxUnread,rxUnread+n,rxUnreadCount);  //the rest comes with the next read
+		rxReadUs = rxUnreadUs;
+	}
+	m = RingBuffer_GetCount(&rxring);
+	if(m <= 0 || n == cap)
+		return n;
+	if(m > memPeaks.rxRing)
+		memPeaks.rxRing = (uint16_t)m;
+	if(m > cap-n)
+		m = cap-n;
+	m = Chip_UART_ReadRB(AT_UART,&rxring,str+n,m);
+	if(m > 0)
+		rxReadUs = tickUs();
+	#if UART_CAPTURE_ENABLE
+	Capture_put(&capture,CAPTURE_RX,tick_ct,str+n,m);  //bytes given back are not captured twice
+	#endif
+	return n+m;
+}
+
+/**
+ * @brief	  give back bytes that were read but belong to the next message,e.g. a +IPD that
+                arrived while waiting for a command response
+ * @return  nothing
+ */
+void AT_Unread(const char *str,int size)
+{
+	if(size > AT_UNREAD_SIZE-rxUnreadCount){
+		DEBUGOUT("unread overflow,%d bytes lost\r\n",size-(AT_UNREAD_SIZE-rxUnreadCount));
+		telemetry.win.uartErrors++;
+		size = AT_UNREAD_SIZE-rxUnreadCount;
 	}
+	memcpy(rxUnread+rxUnreadCount,str,size);
+	rxUnreadCount += size;
+	if(rxUnreadCount > memPeaks.unread)
+		memPeaks.unread = (uint16_t)rxUnreadCount;
+	rxUnreadUs = rxReadUs;  //read at the latest read at most
 }
 
 /**
@@ -339,79 +660,976 @@ void setGPRSCtlPinStatu(bool val)
 }
 
 /**
- * @brief	  check if recieved data from server
+ * @brief	  decode a binary server message(AuthFrame.h) into resp
+ * @return  return 0 if decoded successfully ,otherwise, return nagative value
+ */
+int decodeRespFrame(const char *data,int size,RESP_INFO_T *resp)
+{
+	AUTH_FRAME_READER_T reader;
+	const uint8_t *value;
+	uint8_t tag;
+	int len,ret;
+	
+	memset(resp,0,sizeof(RESP_INFO_T));
+	resp->format = WIRE_BINARY;
+	ret = AuthFrame_open(&reader,(const uint8_t*)data,size);
+	if(ret)
+		return ret;
+	while((ret = AuthFrame_next(&reader,&tag,&value,&len)) > 0){
+		if(tag == AUTH_TAG_API_ID){
+			resp->apiId = (int)AuthFrame_getInt(value,len);
+			resp->items |= RESP_ITEM_API_ID;
+		}else if(tag == AUTH_TAG_RESP_CODE){
+			resp->respCode = (int)AuthFrame_getInt(value,len);
+			resp->items |= RESP_ITEM_RESP_CODE;
+		}else if(tag == AUTH_TAG_NONCE && len == AUTH_NONCE_SIZE){
+			bytesToHex(value,len,resp->nonce);
+			resp->items |= RESP_ITEM_NONCE;
+		}else if(tag == AUTH_TAG_SEQ){
+			resp->seq = (int)AuthFrame_getInt(value,len);
+			resp->items |= RESP_ITEM_SEQ;
+		}else if(tag == AUTH_TAG_LEASE && len == LEASE_WIRE_SIZE){
+			bytesToHex(value,len,resp->lease);
+			resp->items |= RESP_ITEM_LEASE;
+		}
+	}
+	return ret;
+}
+
+#if JSON_STREAM_ENABLE
+/**
+ * @brief	  check if recieved data from server,the payload is fed to sockStream as it arrives
+                and decoded into respInfo with respSchema,only the first SOCK_IN_BUF_SIZE-1 bytes are kept in 
+                socketBuffer.inBuffer for logging. The server answers all it read in one write,so a +IPD
+                may hold several messages: the first is taken and the rest goes back with AT_Unread
+                behind a +IPD head of its own,for the next call
+ * @return  return payload size if recieved a complete message from server,otherwise,return nagative value
+ */
+int checkSockRecvData(void)
+{
+	int dataBytes = 0; //size of recieved 
+	int n,m,cnt,fed,copy,i,left;
+	int size; //bytes of the first message,the whole payload until its end is known
+	int body = -1; //message bytes before the CRC trailer,-1 until known
+	int binary = 0;
+	int ret = CJSON_STREAM_MORE;
+	char *pIPHead,*pData;
+	char head[18];   //"+IPD,n:"
+	uint8_t trailer[SOCK_CRC_SIZE];
+	CRC16_CTX_T crc;
+	memset(ATRXBuffer,0,sizeof(ATRXBuffer)-1);
+	n = AT_Read(ATRXBuffer,sizeof(ATRXBuffer)-1);
+	if(n<=0) //no data
+		return -1;
+	delay_ms(2);//wait for recieving data
+	n += AT_Read(ATRXBuffer+n,sizeof(ATRXBuffer)-n-1);
+
+	pIPHead = strstr(ATRXBuffer,AT_IP_HEAD);
+	if(pIPHead == NULL)
+		return -2;
+	pData = strchr(pIPHead,':');
+	if(pData == NULL){
+		n -= pIPHead-ATRXBuffer;
+		if(n < (int)sizeof(head)) //the rest of the head comes with the next read
+			AT_Unread(pIPHead,n);
+		return -3;
+	}
+	dataBytes = atoi(pIPHead+strlen(AT_IP_HEAD));
+	if(dataBytes > memPeaks.inMsg)
+		memPeaks.inMsg = (uint16_t)dataBytes;
+	pData++;
+	n -= pData-ATRXBuffer; //payload bytes already read
+	if(SOCK_CRC_ENABLE && dataBytes <= SOCK_CRC_SIZE){ //no room for the trailer,the payload is skipped
+		if(n > dataBytes && dataBytes >= 0)
+			AT_Unread(pData+dataBytes,n-dataBytes);
+		cnt = 30;
+		while(n < dataBytes && cnt--){
+			delay_ms(1);
+			n += AT_Read(ATRXBuffer,dataBytes-n);
+		}
+		return -7;
+	}
+	
+	memset(socketBuffer.inBuffer,0x0,sizeof(socketBuffer.inBuffer));
+	memset(&respInfo,0,sizeof(respInfo));
+	cJSON_SchemaBegin(&respDecoder,&respSchema,&respInfo);
+	cJSON_StreamInit(&sockStream,cJSON_SchemaHandler,&respDecoder);
+	crc16_init(&crc);
+	size = dataBytes;
+	fed = 0;
+	cnt = 30;
+	while(1){
+		left = 0;
+		if(n > 0){
+			if(fed == 0)
+				binary = ((uint8_t)pData[0] == AUTH_FRAME_VERSION);
+			if(binary && fed < 2 && fed+n >= 2){ //the frame has its length in byte 1
+				body = (uint8_t)pData[1-fed]+AUTH_FRAME_OVERHEAD;
+				if(body > dataBytes)
+					body = dataBytes;
+				size = body;
+			}
+			if(!binary && body < 0){ //frames are decoded from inBuffer once complete
+				ret = cJSON_StreamConsume(&sockStream,pData,n,&m);
+				if(ret == CJSON_STREAM_DONE)
+					body = fed+m;
+				else if(ret == CJSON_STREAM_ERROR) //the whole payload is taken,it may be a CRC error
+					body = SOCK_CRC_ENABLE?dataBytes-SOCK_CRC_SIZE:dataBytes;
+				if(body >= 0){
+					size = SOCK_CRC_ENABLE?body+SOCK_CRC_SIZE:body;
+					if(size > dataBytes)
+						size = dataBytes;
+				}
+			}
+			if(n > size-fed){ //the next message came in the same read
+				left = n-(size-fed);
+				n = size-fed;
+			}
+			m = (body >= 0 && body-fed < n)?body-fed:n; //message bytes in this piece,the rest is trailer
+			if(m < 0)
+				m = 0;
+			for(i=m;i<n;i++)
+				trailer[fed+i-body] = (uint8_t)pData[i];
+			copy = (int)sizeof(socketBuffer.inBuffer)-1-fed;
+			if(copy > m)
+				copy = m;
+			if(copy > 0)
+				memcpy(socketBuffer.inBuffer+fed,pData,copy);
+			if(SOCK_CRC_ENABLE && !binary)
+				crc16_update(&crc,pData,m);
+			fed += n;
+			cnt = 30;
+			if(fed >= size && size < dataBytes){ //the rest of the payload,read or not,is the next message
+				i = sprintf(head,"%s%d:",AT_IP_HEAD,dataBytes-size);
+				AT_Unread(head,i);
+			}
+		}
+		if(left > 0)
+			AT_Unread(pData+n,left);
+		if(fed >= size || cnt-- == 0) //a parse error still reads the rest,it may be a CRC error
+			break;
+		delay_ms(1);
+		pData = ATRXBuffer;
+		n = AT_Read(ATRXBuffer,sizeof(ATRXBuffer)-1);
+	}
+	if(fed < size)
+		return -3;
+	if(body < 0) //the payload ended inside the text
+		body = size;
+	if(body < size && (size-body != SOCK_CRC_SIZE || crc16_final(&crc) != (trailer[0]<<8 | trailer[1])))
+		return -7; //a payload that ends inside the trailer is a CRC error too
+	dataBytes = body;
+	if(binary){
+		if(dataBytes > (int)sizeof(socketBuffer.inBuffer)-1 || decodeRespFrame(socketBuffer.inBuffer,dataBytes,&respInfo))
+			return -6;
+		return dataBytes;
+	}
+	respInfo.format = WIRE_JSON;
+	if(cJSON_StreamFinish(&sockStream) != CJSON_STREAM_DONE)
+		return -4;
+	respInfo.items = (int)cJSON_SchemaEnd(&respDecoder);
+	if(respInfo.items < 0)
+		return -5;
+	return dataBytes;
+}
+#else
+/**
+ * @brief	  size of the JSON object at txt,strings and nesting are skipped like the server does
+ * @return  the size,0 if it does not end within size bytes
+ */
+int jsonSize(const char *txt,int size)
+{
+	int i,depth = 0,inString = 0;
+	
+	for(i=0;i<size;i++){
+		if(inString){
+			if(txt[i] == '\\')
+				i++;
+			else if(txt[i] == '"')
+				inString = 0;
+		}else if(txt[i] == '"'){
+			inString = 1;
+		}else if(txt[i] == '{' || txt[i] == '['){
+			depth++;
+		}else if((txt[i] == '}' || txt[i] == ']') && --depth == 0){
+			return i+1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief	  check if recieved data from server,a +IPD may hold several messages(the server answers
+                all it read in one write),the first is taken and the rest goes back with AT_Unread
+                behind a +IPD head of its own,for the next call
  * @return  return 0 if recieved data from server,otherwise,return nagative value
  */
 int checkSockRecvData(void)
 {
 	int dataBytes = 0; //size of recieved 
-	int n,cnt;
+	int n,cnt,left,size;
 	char *pIPHead,*pData;
+	char head[18];   //"+IPD,n:"
 	memset(ATRXBuffer,0,sizeof(ATRXBuffer)-1);
-	n = AT_Read(ATRXBuffer);
+	n = AT_Read(ATRXBuffer,sizeof(ATRXBuffer)-1);
 	if(n<=0) //no data
 		return -1;
 	delay_ms(2);//wait for recieving data
-	n += AT_Read(ATRXBuffer+n);
+	n += AT_Read(ATRXBuffer+n,sizeof(ATRXBuffer)-n-1);
 
 	pIPHead = strstr(ATRXBuffer,AT_IP_HEAD);
 	if(pIPHead == NULL)
 		return -2;
 	
-	pData = pIPHead;
-	pData += strlen(AT_IP_HEAD);
-	dataBytes = atoi(pData);
-	while(*pData++ != ':'){}
+	pData = strchr(pIPHead,':');
+	if(pData == NULL){
+		n -= pIPHead-ATRXBuffer;
+		if(n < (int)sizeof(head)) //the rest of the head comes with the next read
+			AT_Unread(pIPHead,n);
+		return -3;
+	}
+	dataBytes = atoi(pIPHead+strlen(AT_IP_HEAD));
+	if(dataBytes > memPeaks.inMsg)
+		memPeaks.inMsg = (uint16_t)dataBytes;
+	pData++;
 	cnt = 30;
 	while((n-(pData-pIPHead)<dataBytes) && cnt--){//extra data isn't recieved
-			n += AT_Read(ATRXBuffer+n);
+			n += AT_Read(ATRXBuffer+n,sizeof(ATRXBuffer)-n-1);
 			delay_ms(1);
 	}
 	if(n-(pData-pIPHead)<dataBytes){
 //		DEBUGOUT("n=%d,pHead=%x,pData=%x,cnt=%d\r\n",n,(int)pIPHead,(int)pData,cnt);
 		return -3;
 	}
+	left = n-(pData-ATRXBuffer)-dataBytes;
+	if((uint8_t)pData[0] == AUTH_FRAME_VERSION)
+		size = (dataBytes > 1)?(uint8_t)pData[1]+AUTH_FRAME_OVERHEAD:dataBytes;
+	else if((size = jsonSize(pData,dataBytes)) > 0 && SOCK_CRC_ENABLE)
+		size += SOCK_CRC_SIZE;
+	if(size > 0 && size < dataBytes){ //the rest of the payload is the next message
+		cnt = sprintf(head,"%s%d:",AT_IP_HEAD,dataBytes-size);
+		AT_Unread(head,cnt);
+		AT_Unread(pData+size,dataBytes-size);
+	}
+	if(left > 0) //the next message came in the same read
+		AT_Unread(pData+dataBytes,left);
+	if(size > 0 && size < dataBytes)
+		dataBytes = size;
 	memset(socketBuffer.inBuffer,0x0,sizeof(socketBuffer.inBuffer));
 	memcpy(socketBuffer.inBuffer,pData,dataBytes);
+	if(SOCK_CRC_ENABLE && (uint8_t)pData[0] != AUTH_FRAME_VERSION){ //check and strip the CRC trailer
+		dataBytes -= SOCK_CRC_SIZE;
+		if(dataBytes <= 0 || calculate_crc16(socketBuffer.inBuffer,dataBytes) != 
+			((uint8_t)socketBuffer.inBuffer[dataBytes]<<8 | (uint8_t)socketBuffer.inBuffer[dataBytes+1]))
+			return -7;
+		socketBuffer.inBuffer[dataBytes] = '\0';
+		socketBuffer.inBuffer[dataBytes+1] = '\0';
+	}
 	return dataBytes;
 }
+#endif
+
+/**
+ * @brief	  build the authorization request {"apiId":..,"seq":..,"UID":".."} into buf
+ * @return  length of the request,or nagative value if it does not fit in size bytes
+ */
+int buildAuthReq(char *buf,int size,int seq)
+{
+	cJSON_Writer writer;
+	
+	cJSON_WriterInit(&writer,buf,size);
+	cJSON_WriterObject(&writer);
+	cJSON_WriterKey(&writer,"apiId");
+	cJSON_WriterInt(&writer,ATUH_API_ID);
+	cJSON_WriterKey(&writer,"seq");
+	cJSON_WriterInt(&writer,seq);
+	cJSON_WriterKey(&writer,"UID");
+	cJSON_WriterString(&writer,uid);
+	if(leaseWanted()){
+		cJSON_WriterKey(&writer,"renew");
+		cJSON_WriterBool(&writer,1);
+	}
+	cJSON_WriterEndObject(&writer);
+	return cJSON_WriterFinish(&writer);
+}
+
+/**
+ * @brief	  build the authorization request as a binary frame(AuthFrame.h) into buf
+ * @return  length of the frame,or nagative value if it does not fit in size bytes
+ */
+int buildAuthFrame(uint8_t *buf,int size,int seq)
+{
+	AUTH_FRAME_WRITER_T writer;
+	
+	AuthFrame_begin(&writer,buf,size);
+	AuthFrame_putInt(&writer,AUTH_TAG_API_ID,ATUH_API_ID);
+	AuthFrame_putInt(&writer,AUTH_TAG_SEQ,seq);
+	AuthFrame_putBytes(&writer,AUTH_TAG_UID,uidRaw,sizeof(uidRaw));
+	if(leaseWanted())
+		AuthFrame_putBytes(&writer,AUTH_TAG_LEASE,NULL,0);  //empty record asks for a lease
+	return AuthFrame_end(&writer);
+}
+
+/**
+ * @brief	  send size bytes of socketBuffer.outBuffer,a JSON text gets the CRC trailer if enabled
+ * @return  return 0 if sent successfully ,otherwise, return nagative value
+ */
+int sendMessage(int size,bool frame)
+{
+	#if SOCK_CRC_ENABLE
+	uint16_t crc;
+	#endif
+	
+	msgStats.sent++;
+	if(size > memPeaks.outMsg)
+		memPeaks.outMsg = (uint16_t)size;
+	if(frame){
+		if(Air202_IPSendRaw(socketBuffer.outBuffer,size))
+			return GPRS_SEND_FAILED;
+		Pending_sent(&pending,ATSendUs);
+		TRACE1(TRACE_SEND_FRAME,size);
+		return GPRS_SUCCESS;
+	}
+	TRACE1(TRACE_SEND_JSON,size);
+	#if SOCK_CRC_ENABLE
+	if(size+SOCK_CRC_SIZE > (int)sizeof(socketBuffer.outBuffer))
+		return GPRS_ERROR_OTHERS;
+	crc = calculate_crc16(socketBuffer.outBuffer,size);
+	socketBuffer.outBuffer[size++] = (char)(crc>>8);
+	socketBuffer.outBuffer[size++] = (char)crc;
+	if(size > memPeaks.outMsg)
+		memPeaks.outMsg = (uint16_t)size;
+	if(Air202_IPSendRaw(socketBuffer.outBuffer,size)) //the trailer may hold any byte value
+		return GPRS_SEND_FAILED;
+	#else
+	if(Air202_IPSend(socketBuffer.outBuffer,size))
+		return GPRS_SEND_FAILED;
+	#endif
+	Pending_sent(&pending,ATSendUs); //the requests it carries,the payload went out then
+	return GPRS_SUCCESS;
+}
+
+/**
+ * @brief	  check if a message about to be sent for another reason should carry the authorization,
+                that is the cadence says it is close to due and none is in flight
+ * @return  the sequence number the authorization was given,0 if the message goes without it
+ */
+int piggybackAuth(void)
+{
+	int seq;
+	
+	if(!AUTH_ENABLE || !Cadence_piggyback(&cadence,tick_ct) || Pending_count(&pending,ATUH_API_ID) || 
+		Pending_count(&pending,AUTH_MAC_API_ID))
+		return 0;
+	seq = Pending_open(&pending,ATUH_API_ID,tick_ct,AUTH_TIMEOUT_MS);
+	if(seq < 0)
+		return 0;
+	authInfo.status = AUTH_STATUS_AUTHORIZING;
+	msgStats.piggyback++;
+	return seq;
+}
+
+/**
+ * @brief	  add the authorization to a JSON message being written,"authSeq" and "renew" go into the
+                open object and the server answers with an ordinary auth reply for authSeq,the message
+                must carry "UID" itself. If it is not sent,Pending_close() the returned number
+ * @return  the sequence number of the authorization,0 if none was added
+ */
+int piggybackAuthJson(cJSON_Writer *writer)
+{
+	int seq = piggybackAuth();
+	
+	if(seq){
+		cJSON_WriterKey(writer,"authSeq");
+		cJSON_WriterInt(writer,seq);
+		if(leaseWanted()){
+			cJSON_WriterKey(writer,"renew");
+			cJSON_WriterBool(writer,1);
+		}
+	}
+	return seq;
+}
+
+/**
+ * @brief	  add the authorization to a frame being written,AUTH_TAG_AUTH_SEQ and the lease request
+ * @return  the sequence number of the authorization,0 if none was added
+ */
+int piggybackAuthFrame(AUTH_FRAME_WRITER_T *writer)
+{
+	int seq = piggybackAuth();
+	
+	if(seq){
+		AuthFrame_putInt(writer,AUTH_TAG_AUTH_SEQ,seq);
+		if(leaseWanted())
+			AuthFrame_putBytes(writer,AUTH_TAG_LEASE,NULL,0);
+	}
+	return seq;
+}
+
+/**
+ * @brief	  send a request of size bytes built for pending slot seq,the slot is freed again
+                if the request could not be built(size < 0) or sent
+ * @return  return 0 if sent successfully ,otherwise, return nagative value
+ */
+int sendRequest(int seq,int size,bool frame)
+{
+	int ret = (size < 0)?GPRS_ERROR_OTHERS:sendMessage(size,frame);
+	if(ret == GPRS_SEND_FAILED)
+		telemetry.win.sendFailures++;
+	if(ret)
+		Pending_close(&pending,seq);
+	return ret;
+}
 
 /**
- * @brief	  parse recieved data
+ * @brief	  send the authorization request in the format of the connection,a frame that
+                is never answered means the server only speaks JSON
+ * @return  return 0 if sent successfully ,otherwise, return nagative value
+ */
+int sendAuthReq(void)
+{
+	int size,seq;
+	
+	if(wireFormat == WIRE_PROBE_SENT){
+		DEBUGOUT("frame not answered,use JSON\r\n");
+		wireFormat = WIRE_JSON;
+	}
+	seq = Pending_open(&pending,ATUH_API_ID,tick_ct,AUTH_TIMEOUT_MS);
+	if(seq < 0){
+		DEBUGOUT("too many requests in flight\r\n");
+		return GPRS_ERROR_OTHERS;
+	}
+	msgStats.auth++;
+	if(wireFormat != WIRE_JSON){
+		size = buildAuthFrame((uint8_t*)socketBuffer.outBuffer,sizeof(socketBuffer.outBuffer),seq);
+		if(size >= 0 && wireFormat == WIRE_PROBE)
+			wireFormat = WIRE_PROBE_SENT;
+		return sendRequest(seq,size,true);
+	}
+	size = buildAuthReq(socketBuffer.outBuffer,sizeof(socketBuffer.outBuffer),seq);
+	if(size < 0)
+		DEBUGOUT("auth request too long\r\n");
+	return sendRequest(seq,size,false);
+}
+
+/**
+ * @brief	  MAC over nonce,raw UID and counter(big-endian) with the key from flash
  * @return  nothing
  */
-void parseRecvData(const char *txt)
+void authMac(const uint8_t *nonce,uint32_t counter,uint8_t *mac)
 {
-	int respCode;
-	int apiId;
-	cJSON *json = cJSON_Parse(txt);
-	if(!json){
-		DEBUGOUT("no json format\r\n");
+	uint8_t msg[AUTH_NONCE_SIZE+sizeof(uidRaw)+4];
+	
+	memcpy(msg,nonce,AUTH_NONCE_SIZE);
+	memcpy(msg+AUTH_NONCE_SIZE,uidRaw,sizeof(uidRaw));
+	msg[sizeof(msg)-4] = (uint8_t)(counter>>24);
+	msg[sizeof(msg)-3] = (uint8_t)(counter>>16);
+	msg[sizeof(msg)-2] = (uint8_t)(counter>>8);
+	msg[sizeof(msg)-1] = (uint8_t)counter;
+	Chaskey_mac(&authKey,msg,sizeof(msg),mac,CHASKEY_TAG_SIZE);
+}
+
+/**
+ * @brief	  answer a challenge,{"apiId":2,"seq":..,"UID":..,"ctr":..,"mac":".."} or the same as a frame
+ * @return  return 0 if sent successfully ,otherwise, return nagative value
+ */
+int sendAuthMac(const char *nonceHex)
+{
+	uint8_t nonce[AUTH_NONCE_SIZE],mac[CHASKEY_TAG_SIZE];
+	cJSON_Writer writer;
+	AUTH_FRAME_WRITER_T frame;
+	int seq;
+	
+	if(hexToBytes(nonceHex,nonce,AUTH_NONCE_SIZE))
+		return GPRS_ERROR_OTHERS;
+	seq = Pending_open(&pending,AUTH_MAC_API_ID,tick_ct,AUTH_TIMEOUT_MS);
+	if(seq < 0)
+		return GPRS_ERROR_OTHERS;
+	msgStats.auth++;
+	authCounter++;
+	authMac(nonce,authCounter,mac);
+	if(wireFormat == WIRE_BINARY){
+		AuthFrame_begin(&frame,(uint8_t*)socketBuffer.outBuffer,sizeof(socketBuffer.outBuffer));
+		AuthFrame_putInt(&frame,AUTH_TAG_API_ID,AUTH_MAC_API_ID);
+		AuthFrame_putInt(&frame,AUTH_TAG_SEQ,seq);
+		AuthFrame_putBytes(&frame,AUTH_TAG_UID,uidRaw,sizeof(uidRaw));
+		AuthFrame_putInt(&frame,AUTH_TAG_COUNTER,(int32_t)authCounter);
+		AuthFrame_putBytes(&frame,AUTH_TAG_MAC,mac,sizeof(mac));
+		if(leaseWanted())
+			AuthFrame_putBytes(&frame,AUTH_TAG_LEASE,NULL,0);
+		return sendRequest(seq,AuthFrame_end(&frame),true);
+	}
+	cJSON_WriterInit(&writer,socketBuffer.outBuffer,sizeof(socketBuffer.outBuffer));
+	cJSON_WriterObject(&writer);
+	cJSON_WriterKey(&writer,"apiId");
+	cJSON_WriterInt(&writer,AUTH_MAC_API_ID);
+	cJSON_WriterKey(&writer,"seq");
+	cJSON_WriterInt(&writer,seq);
+	cJSON_WriterKey(&writer,"UID");
+	cJSON_WriterString(&writer,uid);
+	cJSON_WriterKey(&writer,"ctr");
+	cJSON_WriterInt(&writer,(long)authCounter);
+	cJSON_WriterKey(&writer,"mac");
+	cJSON_WriterHex(&writer,mac,sizeof(mac));
+	if(leaseWanted()){
+		cJSON_WriterKey(&writer,"renew");
+		cJSON_WriterBool(&writer,1);
+	}
+	cJSON_WriterEndObject(&writer);
+	return sendRequest(seq,cJSON_WriterFinish(&writer),false);
+}
+
+#if MAC_BENCH_ENABLE
+/**
+ * @brief	  print the core cycles of one challenge MAC,counted with SysTick
+ * @return  nothing
+ */
+void benchAuthMac(void)
+{
+	uint8_t nonce[AUTH_NONCE_SIZE] = {0},mac[CHASKEY_TAG_SIZE];
+	uint32_t start,end,reload = SysTick->LOAD+1;
+	
+	__disable_irq();    //SysTick counts down,one reload period is 1ms
+	start = SysTick->VAL;
+	authMac(nonce,0,mac);
+	end = SysTick->VAL;
+	__enable_irq();
+	if(end > start)     //wrapped once,the interrupt is pending
+		start += reload;
+	DEBUGOUT("MAC: %d cycles,%d us\r\n",(int)(start-end),(int)((start-end)/(SystemCoreClock/1000000)));
+}
+#endif
+
+/**
+ * @brief	  check a lease from the server and keep it,it is written to flash when the stored
+                one is due for renewal
+ * @return  return 0 if the lease was accepted ,otherwise, return nagative value
+ */
+int acceptLease(const char *hex)
+{
+	uint8_t wire[LEASE_WIRE_SIZE];
+	LEASE_T newLease;
+	bool store;
+	
+	if(!authKeyValid || !uidRawValid || hexToBytes(hex,wire,LEASE_WIRE_SIZE) || Lease_decode(&newLease,wire,LEASE_WIRE_SIZE))
+		return -1;
+	if(Lease_verify(&newLease,&authKey,uidRaw,sizeof(uidRaw)))
+		return -2;
+	if(leaseValid && (int32_t)(newLease.issued-lease.issued) < 0) //an older lease played back
+		return -3;
+	store = leaseDue(newLease.issued); //flash is only written when the stored lease needs it
+	memcpy(&lease,&newLease,sizeof(lease));
+	leaseValid = true;
+	leaseSynced = true;
+	serverTime = lease.issued;
+	serverTimeAt = systemTimer;
+	if(store && Lease_store(&lease,LEASE_ADDR))
+		DEBUGOUT("lease not stored\r\n");
+	DEBUGOUT("lease until %u,features %x\r\n",(unsigned)lease.expiry,(unsigned)lease.features);
+	return 0;
+}
+
+/**
+ * @brief	  write the server time to the lease sector every LEASE_CHECKPOINT_S or when forced,a
+                reset goes on from there instead of the issue time of the lease
+ * @return  nothing
+ */
+void checkpointLease(bool force)
+{
+	if(!leaseValid || (!force && systemTimer-leaseCheckpointAt < LEASE_CHECKPOINT_S))
 		return;
+	leaseCheckpointAt = systemTimer;
+	if(Lease_storeCheckpoint(serverNow(),&lease,LEASE_ADDR))
+		DEBUGOUT("lease time not stored\r\n");
+}
+
+/**
+ * @brief	  drop the lease after the server refused the device
+ * @return  nothing
+ */
+void revokeLease(void)
+{
+	LEASE_T stored;
+	
+	if(leaseValid || Lease_load(&stored,LEASE_ADDR,&authKey,uidRaw,sizeof(uidRaw)) >= 0){
+		leaseValid = false;
+		if(Lease_erase(LEASE_ADDR))
+			DEBUGOUT("lease not erased\r\n");
 	}
-	if(cJSON_GetObjectItem(json,"apiId") == NULL || cJSON_GetObjectItem(json,"respCode") == NULL){
+}
+
+/**
+ * @brief	  an authorization under way fails when no request of it is in flight any more,because
+                the last one timed out or was never sent
+ * @return  nothing
+ */
+void authIdleFail(void)
+{
+	if(authInfo.status == AUTH_STATUS_AUTHORIZING && !Pending_count(&pending,ATUH_API_ID) && 
+		!Pending_count(&pending,AUTH_MAC_API_ID)){
+		authInfo.status = AUTH_STATUS_FAIL;
+		Cadence_failure(&cadence,tick_ct);
+	}
+}
+
+/**
+ * @brief	  handle a decoded server message
+ * @return  nothing
+ */
+void handleResp(const RESP_INFO_T *resp)
+{
+	uint32_t sentUs;
+	int ret;
+	
+	if(wireFormat != WIRE_JSON) //the server answers in the format it understands
+		wireFormat = resp->format;
+	if((resp->items & (RESP_ITEM_API_ID|RESP_ITEM_RESP_CODE)) != (RESP_ITEM_API_ID|RESP_ITEM_RESP_CODE)){
 		DEBUGOUT("lack of item!\r\n");
 		return;
 	}
-	apiId = cJSON_GetObjectItem(json,"apiId")->valueint;
-	respCode = cJSON_GetObjectItem(json,"respCode")->valueint;
-	DEBUGOUT("apiId:%d,respCode:%d\r\n",apiId,respCode);
-	if(apiId == ATUH_API_ID && respCode == RESP_CODE_SUCCESS){
-		if(authInfo.status == AUTH_STATUS_AUTHORIZING && authInfo.authTime < AUTH_TIMEOUT_S){
-			authInfo.status = AUTH_STATUS_SUCCESS;
-			if(authInfo.firstAuthFlag == true)
-				authInfo.firstAuthFlag = false;
-			DEBUGOUT("Authorization pass\r\n");
-		}else{
-			DEBUGOUT("Authorization error\r\n");
+	TRACE3(TRACE_RESP,resp->apiId,resp->respCode,(resp->items & RESP_ITEM_SEQ)?resp->seq:-1);
+	ret = Pending_match(&pending,(resp->items & RESP_ITEM_SEQ)?resp->seq:-1,resp->apiId,&sentUs);
+	if(ret < 0){
+		DEBUGOUT("stale reply dropped\r\n");
+		return;
+	}
+	if(ret > 0 && (resp->apiId == ATUH_API_ID || resp->apiId == AUTH_MAC_API_ID)){
+		Histogram_add(&authRtt,rxReadUs-sentUs);
+		Telemetry_rtt(&telemetry,(rxReadUs-sentUs)/1000);
+	}
+	if(resp->apiId == TELEMETRY_API_ID){
+		if(resp->respCode == RESP_CODE_SUCCESS)
+			Telemetry_acked(&telemetry);
+		else
+			Telemetry_lost(&telemetry); //sent again with the next batch
+		return;
+	}
+	if(resp->respCode == RESP_CODE_CHALLENGE){
+		if(!(resp->items & RESP_ITEM_NONCE) || !authKeyValid || !uidRawValid){
+			authInfo.status = AUTH_STATUS_FAIL;
+			Cadence_failure(&cadence,tick_ct);
+			DEBUGOUT("challenge not answered\r\n");
+		}else if(sendAuthMac(resp->nonce)){
+			authIdleFail();
+			DEBUGOUT("Send failed\r\n");
 		}
+		return;
+	}
+	if((resp->apiId == ATUH_API_ID || resp->apiId == AUTH_MAC_API_ID) && resp->respCode == RESP_CODE_SUCCESS){
+		authInfo.status = AUTH_STATUS_SUCCESS;
+		if(authInfo.firstAuthFlag == true)
+			authInfo.firstAuthFlag = false;
+		Cadence_success(&cadence,tick_ct);
+		TRACE1(TRACE_AUTH_PASS,(cadence.next-tick_ct)/1000);
+		if((resp->items & RESP_ITEM_LEASE) && acceptLease(resp->lease))
+			DEBUGOUT("bad lease\r\n");
 	}else{
 		authInfo.status = AUTH_STATUS_FAIL;
-		DEBUGOUT("Authorization failed\r\n");
+		revokeLease();
+		Cadence_failure(&cadence,tick_ct);
+		TRACE0(TRACE_AUTH_FAIL);
 	}
-	cJSON_Delete(json); //take care!
 }
 
+#if UART_CAPTURE_ENABLE
+/**
+ * @brief	  print the AT UART capture in hex,"cap begin <time of the oldest record> <bytes> <records lost>
+                <reason>",the records CAPTURE_LINE_BYTES a line and "cap end <CRC16>",tools/sim/fleetsim -P
+                replays it. Unless forced at most once every CAPTURE_DUMP_GAP_S
+ * @return  nothing
+ */
+void dumpCapture(const char *reason,bool force)
+{
+	uint8_t chunk[CAPTURE_LINE_BYTES];
+	char hex[2*CAPTURE_LINE_BYTES+1];
+	CRC16_CTX_T crc;
+	int offset,n;
+	
+	if(!force && captureDumped && systemTimer-captureDumpAt < CAPTURE_DUMP_GAP_S)
+		return;
+	captureDumped = true;
+	captureDumpAt = systemTimer;
+	DEBUGOUT("cap begin %u %u %u %s\r\n",(unsigned)capture.first,(unsigned)capture.used,(unsigned)capture.lost,reason);
+	crc16_init(&crc);
+	for(offset=0;(n = Capture_copy(&capture,offset,chunk,sizeof(chunk))) > 0;offset += n){
+		crc16_update(&crc,chunk,n);
+		bytesToHex(chunk,n,hex);
+		DEBUGOUT("cap %s\r\n",hex);
+	}
+	DEBUGOUT("cap end %04X\r\n",(unsigned)crc16_final(&crc));
+}
+#endif
+
+/**
+ * @brief	  print the oldest trace records,up to TRACE_LINE_WORDS words as "trc <hex>" with every word
+                big-endian,tools/trace_decode turns them into text. Called when the main loop has time
+ * @return  words printed,0 if the trace is empty
+ */
+int drainTrace(void)
+{
+	#if TRACE_ENABLE
+	uint32_t words[TRACE_LINE_WORDS];
+	uint8_t bytes[4*TRACE_LINE_WORDS];
+	char hex[8*TRACE_LINE_WORDS+1];
+	int i,n = Trace_read(words,TRACE_LINE_WORDS);
+	
+	if(n <= 0)
+		return 0;
+	for(i=0;i<n;i++){
+		bytes[4*i] = (uint8_t)(words[i]>>24);
+		bytes[4*i+1] = (uint8_t)(words[i]>>16);
+		bytes[4*i+2] = (uint8_t)(words[i]>>8);
+		bytes[4*i+3] = (uint8_t)words[i];
+	}
+	bytesToHex(bytes,4*n,hex);
+	DEBUGOUT("trc %s\r\n",hex);
+	return n;
+	#else
+	return 0;
+	#endif
+}
+
+/**
+ * @brief	  drop requests past their deadline,authorization fails when none is left in flight
+ * @return  nothing
+ */
+void expireRequests(void)
+{
+	int seq,apiId;
+	
+	while((seq = Pending_expire(&pending,tick_ct,&apiId)) > 0){
+		TRACE2(TRACE_TIMEOUT,seq,apiId);
+		if((apiId == ATUH_API_ID || apiId == AUTH_MAC_API_ID) && authTimeouts != 0xFFFF){
+			authTimeouts++;
+			telemetry.win.timeouts++;
+		}
+		if(apiId == TELEMETRY_API_ID)
+			Telemetry_lost(&telemetry);
+		#if UART_CAPTURE_ENABLE
+		dumpCapture("timeout",false);
+		#endif
+		authIdleFail();
+	}
+}
+
+/**
+ * @brief	  print a latency histogram,"lat <name> n <count> fail <failures> p50 <us> p95 <us> p99 <us>
+                max <us>:" and the count of every bucket(Histogram.h),the buckets of a fleet add up
+ * @return  nothing
+ */
+void printHistogram(const char *name,const HISTOGRAM_T *h,uint16_t failures)
+{
+	char counts[HISTOGRAM_BUCKETS*6+1];
+	int b,n = 0;
+	
+	for(b=0;b<HISTOGRAM_BUCKETS;b++){
+		counts[n++] = ' ';
+		n += uintToDec(h->count[b],counts+n);
+	}
+	DEBUGOUT("lat %s n %u fail %u p50 %u p95 %u p99 %u max %u:%s\r\n",name,(unsigned)Histogram_total(h),
+		(unsigned)failures,(unsigned)Histogram_percentile(h,50),(unsigned)Histogram_percentile(h,95),
+		(unsigned)Histogram_percentile(h,99),(unsigned)h->max,counts);
+}
+
+/**
+ * @brief	  print the latency of every AT command used and of the auth round trips since reset
+ * @return  nothing
+ */
+void printLatency(void)
+{
+	#if AT_LATENCY_ENABLE
+	int i;
+	for(i=0;i<AT_CMD_MAX;i++)
+		if(Histogram_total(&ATLatency[i]) || ATFailures[i])
+			printHistogram(ATCmdList[i],&ATLatency[i],ATFailures[i]);
+	#endif
+	printHistogram("auth",&authRtt,authTimeouts);
+}
+
+/**
+ * @brief	  bytes of the stack ever used,scanned for the paint of Stack_paint at boot
+ * @return  the bytes
+ */
+uint32_t stackUsed(void)
+{
+	return (uint32_t)(STACK_LIMIT-STACK_BASE)*sizeof(uint32_t)-Stack_unused(STACK_BASE,STACK_LIMIT);
+}
+
+/**
+ * @brief	  print how much of the stack,the cJSON pool and the buffers was ever used,"mem stack
+                <used>/<size>" and so on
+ * @return  nothing
+ */
+void printMemory(void)
+{
+	cJSON_PoolStats poolStats;
+	
+	cJSON_PoolGetStats(&poolStats);
+	DEBUGOUT("mem stack %u/%u,pool nodes %u/%u arena %u/%u fail %lu leak %lu\r\n",
+		(unsigned)stackUsed(),(unsigned)((STACK_LIMIT-STACK_BASE)*sizeof(uint32_t)),
+		(unsigned)poolStats.nodesPeak,CJSON_POOL_NODES,(unsigned)poolStats.arenaPeak,CJSON_POOL_ARENA_SIZE,
+		poolStats.failures,poolStats.leaks);
+	DEBUGOUT("mem rx ring %u/%u,at rx %u/%u,unread %u/%u,in %u/%u,out %u/%u\r\n",
+		(unsigned)memPeaks.rxRing,RX_RB_SIZE,(unsigned)ATRXPeak,AT_RX_BUF_SIZE,(unsigned)memPeaks.unread,
+		AT_UNREAD_SIZE,(unsigned)memPeaks.inMsg,SOCK_IN_BUF_SIZE,(unsigned)memPeaks.outMsg,SOCK_OUT_BUF_SIZE);
+}
+
+/**
+ * @brief	  close the telemetry window with the AT failures since the latest record and the
+                watermarks
+ * @return  nothing
+ */
+void closeTelemetry(void)
+{
+	cJSON_PoolStats poolStats;
+	#if AT_LATENCY_ENABLE
+	uint32_t failures = 0;
+	int i;
+	
+	for(i=0;i<AT_CMD_MAX;i++)
+		failures += ATFailures[i];
+	telemetry.win.uartErrors += (uint16_t)(failures-telemetryATFailures);
+	telemetryATFailures = failures;
+	#endif
+	cJSON_PoolGetStats(&poolStats);
+	Telemetry_close(&telemetry,systemTimer,(uint16_t)stackUsed(),(uint8_t)poolStats.nodesPeak);
+}
+
+/**
+ * @brief	  send the queued telemetry records when a batch is due and the budget of the day allows,
+                {"apiId":3,"seq":..,"UID":..,"tlm":"<hex records>"} or the same as a frame. The records
+                stay queued until acknowledged. The authorization goes along when it is close to due
+ * @return  return 0 if sent or nothing to send,otherwise,return nagative value
+ */
+int sendTelemetry(void)
+{
+	const uint8_t *records;
+	cJSON_Writer writer;
+	AUTH_FRAME_WRITER_T frame;
+	bool binary = (wireFormat == WIRE_BINARY);
+	int per = binary?TELEMETRY_RECORD_SIZE:2*TELEMETRY_RECORD_SIZE;    //hex in JSON
+	int other = binary?TELEMETRY_FRAME_SIZE:TELEMETRY_JSON_SIZE;
+	int max = ((int)sizeof(socketBuffer.outBuffer)-other)/per;
+	int n,seq,auth,size,ret;
+	
+	if(wireFormat == WIRE_PROBE || wireFormat == WIRE_PROBE_SENT)  //the format is not settled yet
+		return GPRS_SUCCESS;
+	n = (Telemetry_left(&telemetry,systemTimer)-other)/per;
+	if(max > n)
+		max = n;
+	n = Telemetry_batch(&telemetry,max,&records);
+	if(n <= 0)
+		return GPRS_SUCCESS;
+	seq = Pending_open(&pending,TELEMETRY_API_ID,tick_ct,AUTH_TIMEOUT_MS);
+	if(seq < 0)
+		return GPRS_SUCCESS;    //the slots are busy,next time
+	if(binary){
+		AuthFrame_begin(&frame,(uint8_t*)socketBuffer.outBuffer,sizeof(socketBuffer.outBuffer));
+		AuthFrame_putInt(&frame,AUTH_TAG_API_ID,TELEMETRY_API_ID);
+		AuthFrame_putInt(&frame,AUTH_TAG_SEQ,seq);
+		AuthFrame_putBytes(&frame,AUTH_TAG_UID,uidRaw,sizeof(uidRaw));
+		AuthFrame_putBytes(&frame,AUTH_TAG_TELEMETRY,records,n*TELEMETRY_RECORD_SIZE);
+		auth = piggybackAuthFrame(&frame);
+		size = AuthFrame_end(&frame);
+	}else{
+		cJSON_WriterInit(&writer,socketBuffer.outBuffer,sizeof(socketBuffer.outBuffer));
+		cJSON_WriterObject(&writer);
+		cJSON_WriterKey(&writer,"apiId");
+		cJSON_WriterInt(&writer,TELEMETRY_API_ID);
+		cJSON_WriterKey(&writer,"seq");
+		cJSON_WriterInt(&writer,seq);
+		cJSON_WriterKey(&writer,"UID");
+		cJSON_WriterString(&writer,uid);
+		cJSON_WriterKey(&writer,"tlm");
+		cJSON_WriterHex(&writer,records,n*TELEMETRY_RECORD_SIZE);
+		auth = piggybackAuthJson(&writer);
+		cJSON_WriterEndObject(&writer);
+		size = cJSON_WriterFinish(&writer);
+	}
+	ret = sendRequest(seq,size,binary);
+	if(ret && auth){    //the authorization did not go either
+		Pending_close(&pending,auth);
+		authIdleFail();
+	}
+	if(ret)
+		return ret;
+	Telemetry_sent(&telemetry,n,size);
+	TRACE3(TRACE_TELEMETRY,n,size,Telemetry_left(&telemetry,systemTimer));
+	return GPRS_SUCCESS;
+}
+
+/**
+ * @brief	  ask the modem for signal and registration every TELEMETRY_SAMPLE_S,close the telemetry
+                window when it is over and then send a batch of records if one is queued
+ * @return  nothing
+ */
+void runTelemetry(void)
+{
+	if(!TELEMETRY_ENABLE)
+		return;
+	if(systemTimer-telemetrySampleAt >= TELEMETRY_SAMPLE_S){
+		telemetrySampleAt = systemTimer;
+		Telemetry_signal(&telemetry,Air202_checkSignal(),Air202_checkRegStatus());
+	}
+	if(!Telemetry_due(&telemetry,systemTimer))
+		return;
+	closeTelemetry();
+	if(sendTelemetry())     //tried again when the next window closes
+		DEBUGOUT("Send failed\r\n");
+}
+
+/**
+ * @brief	  log the message counts of the past STATS_PERIOD_S and start counting again
+ * @return  nothing
+ */
+void rollMsgStats(void)
+{
+	if(systemTimer-msgStatsStart < STATS_PERIOD_S)
+		return;
+	msgStatsLastHour = msgStats;
+	memset(&msgStats,0,sizeof(msgStats));
+	msgStatsStart += STATS_PERIOD_S;
+	DEBUGOUT("msgs/h:sent %d(auth %d),piggybacked %d,recv %d,auth interval %ds\r\n",msgStatsLastHour.sent,
+		msgStatsLastHour.auth,msgStatsLastHour.piggyback,msgStatsLastHour.recv,(int)(cadence.interval/1000));
+	printHistogram("auth",&authRtt,authTimeouts);
+	printMemory();
+}
+
+/**
+ * @brief	  parse recieved data,a JSON text or a binary frame of size bytes
+ * @return  nothing
+ */
+void parseRecvData(const char *txt,int size)
+{
+	RESP_INFO_T resp;
+	cJSON *json;
+	cJSON_PoolStats poolStats;
+	
+	if((uint8_t)txt[0] == AUTH_FRAME_VERSION){
+		if(decodeRespFrame(txt,size,&resp))
+			DEBUGOUT("bad frame\r\n");
+		else
+			handleResp(&resp);
+		return;
+	}
+	cJSON_PoolReset(); //every message starts with an empty pool
+	json = cJSON_Parse(txt);
+	if(!json){
+		cJSON_PoolGetStats(&poolStats);
+		DEBUGOUT("no json format,pool nodes:%d/%d arena:%d/%d fail:%d\r\n",poolStats.nodesPeak,CJSON_POOL_NODES,
+			poolStats.arenaPeak,CJSON_POOL_ARENA_SIZE,(int)poolStats.failures);
+		return;
+	}
+	memset(&resp,0,sizeof(resp));
+	resp.format = WIRE_JSON;
+	resp.items = (int)cJSON_SchemaDecodeItem(&respSchema,json,&resp);
+	cJSON_Delete(json); //take care!
+	if(resp.items < 0){
+		DEBUGOUT("schema error:%d\r\n",resp.items);
+		return;
+	}
+	handleResp(&resp);
+}
 
 /**
  * @brief	  test function
@@ -481,7 +1699,10 @@ int main(void)
 {
 	int ret;
 	int size;
+	int cmd;
+	uint32_t checkpoint;
 	
+	Stack_paint(STACK_BASE);    //before anything runs deeper than main
 	SystemCoreClockUpdate();
 	Board_Init();
 	GPIO_Init();
@@ -491,58 +1712,136 @@ int main(void)
   setupUART(AT_UART,AT_UART_BAUDRATE);
 	RingBuffer_Init(&rxring, rxbuff, 1, RX_RB_SIZE);
 	RingBuffer_Init(&txring, txbuff, 1, TX_RB_SIZE);
+	Air202_setIdle(userIdle);   //userApp keeps running while the modem is waited for
+	#if UART_CAPTURE_ENABLE
+	Capture_init(&capture,captureBuff,sizeof(captureBuff));
+	#endif
+	#if TRACE_ENABLE
+	Trace_init(traceBuff,TRACE_SIZE,&tick_ct);
+	#endif
+	TRACE1(TRACE_BOOT,TRACE_TABLE_CRC);
+	
+	cJSON_PoolInit();
+	Pending_init(&pending);
+	Telemetry_init(&telemetry,systemTimer,TELEMETRY_BUDGET);
+	if(cJSON_SchemaCheck(&respSchema))
+		DEBUGOUT("respSchema hash is out of date\r\n");
 	
 	DEBUGOUT("%s",description);
 	if(!getUID((char*)UID_ADDR,uid)){
 		DEBUGOUT("get uid:%s\r\n",uid);
+		uidRawValid = !hexToBytes(uid,uidRaw,sizeof(uidRaw));
 	}else{
 		DEBUGOUT("get uid failed\r\n");
 	}
+	authKeyValid = !getKey((const uint8_t*)KEY_ADDR,&authKey);
+	if(!authKeyValid)
+		DEBUGOUT("no MAC key,challenges are refused\r\n");
+	#if MAC_BENCH_ENABLE
+	benchAuthMac();
+	#endif
+	if(authKeyValid && uidRawValid && Lease_load(&lease,LEASE_ADDR,&authKey,uidRaw,sizeof(uidRaw)) >= 0){
+		leaseValid = true;
+		serverTime = lease.issued; //no RTC,the time spent powered off is not known
+		if(Lease_loadCheckpoint(&checkpoint,LEASE_ADDR) >= 0 && (int32_t)(checkpoint-serverTime) > 0)
+			serverTime = checkpoint;
+		serverTime += LEASE_RESET_S;    //so that resetting over and over still runs the lease out
+		serverTimeAt = systemTimer;
+		checkpointLease(true);
+		DEBUGOUT("cached lease,features %x,%ds left\r\n",(unsigned)lease.features,(int)(lease.expiry-serverTime));
+	}
 	
 //	test();
 	
 	ret = setupGPRS();
+	while(drainTrace() > 0){}   //the commands of the setup,before the ring fills up
 	if(!ret){
 		DEBUGOUT("GPRS had been setup\r\n");
 	}else{
 		DEBUGOUT("GPRS Setup failed,ret=%d\r\n",ret);
-		for(;;);
+		for(;;){
+			drainTrace();
+			checkpointLease(false);
+			userIdle();  //a valid lease keeps the application running offline
+		}
 	}
 	if(!Air202_IPStart(TCP_PROTOCOL,SERVER_IP,SERVER_PORT)){
 		DEBUGOUT("Connect to server\r\n");
+		telemetry.win.connects++;
+		wireFormat = (AUTH_BINARY_ENABLE && uidRawValid)?WIRE_PROBE:WIRE_JSON;
 	}else{
 		DEBUGOUT("Failed to connect to server\r\n");
-		for(;;);
+		for(;;){
+			drainTrace();
+			checkpointLease(false);
+			userIdle();  //a valid lease keeps the application running offline
+		}
 	}
 	
+	Cadence_init(&cadence,(uint32_t)calculate_crc16(uid,UID_SIZE/2)<<16 | calculate_crc16(uid+UID_SIZE/2,UID_SIZE/2),
+		tick_ct); //the UID seeds the jitter,authorize at once
+	msgStatsStart = systemTimer;
+	telemetrySampleAt = systemTimer-TELEMETRY_SAMPLE_S;    //the first sample at once
+	
 	while (1){
 		#if AUTH_ENABLE
-		if(authInfo.authFlag == true){
-			DEBUGOUT("Authorizing...!\r\n");
-			authInfo.authFlag = false;
+		if(Cadence_due(&cadence,tick_ct) && !Pending_count(&pending,ATUH_API_ID) && 
+			!Pending_count(&pending,AUTH_MAC_API_ID)){
+			TRACE0(TRACE_AUTHORIZING);
 			authInfo.status = AUTH_STATUS_AUTHORIZING;
-			authInfo.authTime = 0;
-			sprintf(socketBuffer.outBuffer,AUTH_REQ_PACK,ATUH_API_ID,uid);
-			if(!Air202_IPSend(socketBuffer.outBuffer,strlen(socketBuffer.outBuffer))){
-				DEBUGOUT("Send: %s\r\n",socketBuffer.outBuffer);
-			}else{
+			if(sendAuthReq()){
 				DEBUGOUT("Send failed\r\n");
+				authIdleFail();
 			}
 		}
 		#endif
 		
+		expireRequests();
+		rollMsgStats();
+		checkpointLease(false);
+		runTelemetry();
 		size = checkSockRecvData();
 		if(size >0){
-			DEBUGOUT("recieved %d bytes,%s\r\n",size,socketBuffer.inBuffer);
-			parseRecvData(socketBuffer.inBuffer);
+			msgStats.recv++;
+			if((uint8_t)socketBuffer.inBuffer[0] == AUTH_FRAME_VERSION)
+				TRACE1(TRACE_RECV_FRAME,size);
+			else
+				TRACE1(TRACE_RECV_JSON,size);
+			#if JSON_STREAM_ENABLE
+			handleResp(&respInfo);
+			#else
+			parseRecvData(socketBuffer.inBuffer,size);
+			#endif
 		}else{
 			if(size==-3)
 				DEBUGOUT("Recieved error!\r\n");
+			else if(size==-4)
+				DEBUGOUT("no json format\r\n");
+			else if(size==-5)
+				DEBUGOUT("schema error:%d\r\n",respInfo.items);
+			else if(size==-6)
+				DEBUGOUT("bad frame\r\n");
+			else if(size==-7)
+				DEBUGOUT("CRC error\r\n");
+			if(size < -1)   //not a message the driver understood
+				telemetry.win.uartErrors++;
+			#if UART_CAPTURE_ENABLE
+			if(size < -1)
+				dumpCapture("recv",false);
+			#endif
 		}
+		cmd = DEBUGIN();
+		#if UART_CAPTURE_ENABLE
+		if(cmd == CONSOLE_DUMP_CMD)
+			dumpCapture("console",true);
+		#endif
+		if(cmd == CONSOLE_LATENCY_CMD)
+			printLatency();
+		if(cmd == CONSOLE_MEMORY_CMD)
+			printMemory();
 		
-		if(authInfo.status != AUTH_STATUS_FAIL && authInfo.firstAuthFlag == false){
-			userApp();
-		}
+		drainTrace();
+		userIdle();
 	}
 	return 0;
 }
@@ -0,0 +1,29 @@
+#include "Stack.h"
+
+/**
+ * @brief	  paint the stack from base up to a little below the current stack pointer,the
+                words in use by the callers are left as they are
+ * @return  nothing
+ */
+void Stack_paint(uint32_t *base)
+{
+	volatile uint32_t here = 0;     //a local,the stack pointer is just below it
+	uint32_t *top = (uint32_t*)((uintptr_t)&here-STACK_PAINT_MARGIN*sizeof(uint32_t));
+	uint32_t *p;
+
+	for(p=base;p<top;p++)
+		*p = STACK_PAINT;
+}
+
+/**
+ * @brief	  count the painted words from base up to the first one written since Stack_paint
+ * @return  bytes of the stack never used
+ */
+uint32_t Stack_unused(const uint32_t *base,const uint32_t *limit)
+{
+	const uint32_t *p = base;
+
+	while(p < limit && *p == STACK_PAINT)
+		p++;
+	return (uint32_t)(p-base)*sizeof(uint32_t);
+}
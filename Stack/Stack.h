@@ -0,0 +1,29 @@
+#ifndef _STACK_H
+#define _STACK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Stack high-water mark. Stack_paint fills the free stack below the caller with STACK_PAINT
+ * once at boot, Stack_unused counts later how much of it was never written, from the bottom
+ * (lowest address) up. What the deepest call chain and interrupt so far left over is the
+ * difference to the size of the STACK section, which may then be shrunk to the RAM that is
+ * really needed or grown before it runs into the heap. A scan reads every painted word, do it
+ * rarely(rollMsgStats() in SWAuthDemo.c) and not from an interrupt handler.
+ */
+
+#define STACK_PAINT         (0xA5A5A5A5UL)
+#define STACK_PAINT_MARGIN  (16)        /* words below the locals of Stack_paint left alone */
+
+void Stack_paint(uint32_t *base);
+uint32_t Stack_unused(const uint32_t *base,const uint32_t *limit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
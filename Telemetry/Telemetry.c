@@ -0,0 +1,177 @@
+#include "Telemetry.h"
+#include "string.h"
+
+/* a count as one record byte */
+static uint8_t count8(uint32_t n)
+{
+	return (n > 0xFF)?0xFF:(uint8_t)n;
+}
+
+static uint8_t *put16(uint8_t *p,uint32_t v)
+{
+	if(v > 0xFFFF)
+		v = 0xFFFF;
+	*p++ = (uint8_t)(v>>8);
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+/* start a window at now */
+static void open_window(TELEMETRY_T *t,uint32_t now)
+{
+	memset(&t->win,0,sizeof(t->win));
+	t->win.start = now;
+	t->win.rssiMin = TELEMETRY_RSSI_UNKNOWN;
+	t->win.rssiMax = TELEMETRY_RSSI_UNKNOWN;
+}
+
+/**
+ * @brief	  empty queue,the first window starts at now
+ * @return  nothing
+ */
+void Telemetry_init(TELEMETRY_T *t,uint32_t now,uint16_t budget)
+{
+	memset(t,0,sizeof(TELEMETRY_T));
+	open_window(t,now);
+	t->dayStart = now;
+	t->budget = budget;
+}
+
+/**
+ * @brief	  add a sample of the link,rssi of Air202_checkSignal and reg of Air202_checkRegStatus,
+                negative if the modem did not answer
+ * @return  nothing
+ */
+void Telemetry_signal(TELEMETRY_T *t,int rssi,int reg)
+{
+	TELEMETRY_WINDOW_T *w = &t->win;
+
+	w->samples++;
+	if(reg != 1 && reg != 5)    //REG_STAT_REGISTERED,REG_STAT_REGISTERED_ROAM
+		w->unregistered++;
+	if(rssi < 0 || rssi >= TELEMETRY_RSSI_UNKNOWN)
+		return;
+	w->rssiSamples++;
+	w->rssiSum += (uint16_t)rssi;
+	if(w->rssiMin == TELEMETRY_RSSI_UNKNOWN || rssi < w->rssiMin)
+		w->rssiMin = (uint8_t)rssi;
+	if(w->rssiMax == TELEMETRY_RSSI_UNKNOWN || rssi > w->rssiMax)
+		w->rssiMax = (uint8_t)rssi;
+}
+
+/**
+ * @brief	  add an auth round trip of ms
+ * @return  nothing
+ */
+void Telemetry_rtt(TELEMETRY_T *t,uint32_t ms)
+{
+	t->win.auths++;
+	t->win.rttSum += ms;
+	if(ms > t->win.rttMax)
+		t->win.rttMax = (ms > 0xFFFF)?0xFFFF:(uint16_t)ms;
+}
+
+/**
+ * @brief	  check if the window is over
+ * @return  1 if it is,0 if not
+ */
+int Telemetry_due(const TELEMETRY_T *t,uint32_t now)
+{
+	return now-t->win.start >= TELEMETRY_WINDOW_S;
+}
+
+/**
+ * @brief	  close the window into a record with the watermarks at the end of it and start the
+                next one,the oldest record that was not sent makes room if the queue is full
+ * @return  nothing
+ */
+void Telemetry_close(TELEMETRY_T *t,uint32_t now,uint16_t stackUsed,uint8_t poolPeak)
+{
+	TELEMETRY_WINDOW_T *w = &t->win;
+	uint8_t *p;
+
+	if(t->queued == TELEMETRY_QUEUE){
+		if(t->inFlight == TELEMETRY_QUEUE)  //keep what the server is acknowledging
+			t->inFlight--;
+		memmove(t->queue[t->inFlight],t->queue[t->inFlight+1],(TELEMETRY_QUEUE-1-t->inFlight)*TELEMETRY_RECORD_SIZE);
+		t->queued--;
+		t->dropped++;
+	}
+	p = put16(t->queue[t->queued],(w->start/60) & 0xFFFF);
+	*p++ = w->rssiMin;
+	*p++ = w->rssiSamples?(uint8_t)(w->rssiSum/w->rssiSamples):TELEMETRY_RSSI_UNKNOWN;
+	*p++ = w->rssiMax;
+	*p++ = count8(w->samples);
+	*p++ = count8(w->unregistered);
+	*p++ = count8(w->auths);
+	p = put16(p,w->auths?w->rttSum/w->auths:0);
+	p = put16(p,w->rttMax);
+	*p++ = count8(w->timeouts);
+	*p++ = count8(w->connects);
+	*p++ = count8(w->retries);
+	*p++ = count8(w->sendFailures);
+	*p++ = count8(w->uartErrors);
+	*p++ = count8(t->dropped);
+	p = put16(p,stackUsed);
+	*p = poolPeak;
+	t->queued++;
+	t->dropped = 0;
+	open_window(t,now);
+}
+
+/**
+ * @brief	  bytes that may still be sent today,a day starts every TELEMETRY_DAY_S from init
+ * @return  the bytes
+ */
+int Telemetry_left(TELEMETRY_T *t,uint32_t now)
+{
+	while(now-t->dayStart >= TELEMETRY_DAY_S){
+		t->dayStart += TELEMETRY_DAY_S;
+		t->dayBytes = 0;
+	}
+	return (t->dayBytes < t->budget)?t->budget-t->dayBytes:0;
+}
+
+/**
+ * @brief	  the records for the next message,at most max,when TELEMETRY_BATCH or more are
+                queued and no message is waiting for its acknowledgement
+ * @return  number of records,the oldest first in *records,0 if none goes now
+ */
+int Telemetry_batch(const TELEMETRY_T *t,int max,const uint8_t **records)
+{
+	if(t->inFlight || t->queued < TELEMETRY_BATCH || max <= 0)
+		return 0;
+	*records = t->queue[0];
+	return (t->queued < max)?t->queued:max;
+}
+
+/**
+ * @brief	  the oldest count records went out in a message of bytes
+ * @return  nothing
+ */
+void Telemetry_sent(TELEMETRY_T *t,int count,int bytes)
+{
+	t->inFlight = (uint8_t)count;
+	bytes += t->dayBytes;
+	t->dayBytes = (bytes > 0xFFFF)?0xFFFF:(uint16_t)bytes;
+}
+
+/**
+ * @brief	  the server has the records sent,drop them
+ * @return  nothing
+ */
+void Telemetry_acked(TELEMETRY_T *t)
+{
+	memmove(t->queue[0],t->queue[t->inFlight],(t->queued-t->inFlight)*TELEMETRY_RECORD_SIZE);
+	t->queued -= t->inFlight;
+	t->inFlight = 0;
+}
+
+/**
+ * @brief	  the message was not acknowledged,its records go again with the next one
+ * @return  nothing
+ */
+void Telemetry_lost(TELEMETRY_T *t)
+{
+	t->inFlight = 0;
+}
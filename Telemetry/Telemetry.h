@@ -0,0 +1,94 @@
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Device health telemetry. The link and performance figures of TELEMETRY_WINDOW_S are added up
+ * in the open window and closed into one fixed-size record, kept in a queue until the server
+ * acknowledged the message that carried it. Records go out in batches of TELEMETRY_BATCH or more,
+ * one message each on the auth connection(sendTelemetry() in SWAuthDemo.c), and at most budget
+ * bytes of messages a day; while the budget is spent or the server does not answer the queue
+ * fills up and the oldest records are dropped, the next record counts them.
+ *
+ * A record is TELEMETRY_RECORD_SIZE bytes, multi-byte fields big-endian like AuthFrame.h:
+ *
+ *   offset  size  field
+ *    0      2     start,minutes since reset the window began at(wraps)
+ *    2      1     rssi min,CSQ 0..31 of Air202_checkSignal,99 when no sample answered
+ *    3      1     rssi average
+ *    4      1     rssi max
+ *    5      1     samples taken
+ *    6      1     samples not registered(home or roaming) or not answered
+ *    7      1     auth round trips
+ *    8      2     auth round trip average,ms
+ *   10      2     auth round trip max,ms
+ *   12      1     auth requests timed out
+ *   13      1     connections to the server opened
+ *   14      1     failed attempts of the commands setupGPRS retries
+ *   15      1     messages the modem did not take
+ *   16      1     UART errors,AT commands not answered and messages not understood
+ *   17      1     records dropped before this one
+ *   18      2     stack high-water mark since reset,bytes
+ *   20      1     most cJSON pool nodes in use since reset
+ *
+ * Counts stop at 255. Times are seconds of the caller(systemTimer in SWAuthDemo.c).
+ */
+
+#define TELEMETRY_RECORD_SIZE   (21)
+#define TELEMETRY_QUEUE         (8)     /* records kept until acknowledged */
+#define TELEMETRY_BATCH         (4)     /* records that make a message worth sending */
+#define TELEMETRY_WINDOW_S      (900)
+#define TELEMETRY_DAY_S         (86400)
+#define TELEMETRY_RSSI_UNKNOWN  (99)
+
+/* the figures of the open window */
+typedef struct TELEMETRY_WINDOW{
+	uint32_t start;
+	uint16_t samples;
+	uint16_t unregistered;
+	uint16_t rssiSamples;   /* samples with a signal */
+	uint16_t rssiSum;
+	uint8_t rssiMin;
+	uint8_t rssiMax;
+	uint16_t auths;
+	uint32_t rttSum;        /* ms */
+	uint16_t rttMax;        /* ms */
+	uint16_t timeouts;
+	uint16_t connects;
+	uint16_t retries;
+	uint16_t sendFailures;
+	uint16_t uartErrors;
+}TELEMETRY_WINDOW_T;
+
+typedef struct TELEMETRY{
+	TELEMETRY_WINDOW_T win;
+	uint8_t queue[TELEMETRY_QUEUE][TELEMETRY_RECORD_SIZE];  /* oldest first */
+	uint8_t queued;
+	uint8_t inFlight;       /* the oldest records,sent and not acknowledged yet */
+	uint16_t dropped;       /* records dropped since the latest one queued */
+	uint32_t dayStart;
+	uint16_t dayBytes;      /* bytes sent since dayStart */
+	uint16_t budget;        /* bytes a day */
+}TELEMETRY_T;
+
+void Telemetry_init(TELEMETRY_T *t,uint32_t now,uint16_t budget);
+void Telemetry_signal(TELEMETRY_T *t,int rssi,int reg);
+void Telemetry_rtt(TELEMETRY_T *t,uint32_t ms);
+int Telemetry_due(const TELEMETRY_T *t,uint32_t now);
+void Telemetry_close(TELEMETRY_T *t,uint32_t now,uint16_t stackUsed,uint8_t poolPeak);
+int Telemetry_left(TELEMETRY_T *t,uint32_t now);
+int Telemetry_batch(const TELEMETRY_T *t,int max,const uint8_t **records);
+void Telemetry_sent(TELEMETRY_T *t,int count,int bytes);
+void Telemetry_acked(TELEMETRY_T *t);
+void Telemetry_lost(TELEMETRY_T *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
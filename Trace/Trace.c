@@ -0,0 +1,85 @@
+#include "Trace.h"
+#include "stddef.h"
+
+static uint32_t *ring = NULL;
+static uint16_t mask;
+static uint16_t wrPos;          /* where the next word goes */
+static uint16_t rdPos;          /* the oldest word not read */
+static uint32_t lost;           /* records dropped since the latest TRACE_LOST */
+static const volatile uint32_t *now;
+
+/**
+ * @brief	  start an empty trace in buf,words must be a power of two
+ * @return  return 0 if started successfully ,otherwise, return nagative value
+ */
+int Trace_init(uint32_t *buf,uint16_t words,const volatile uint32_t *clock)
+{
+	ring = NULL;
+	if(words < TRACE_RECORD_MAX || (words & (words-1)) || clock == NULL)
+		return -1;
+	ring = buf;
+	mask = words-1;
+	wrPos = rdPos = 0;
+	lost = 0;
+	now = clock;
+	return 0;
+}
+
+/**
+ * @brief	  add a record,head is TRACE_HEAD(),use the TRACE0..TRACE4 macros
+ * @return  nothing
+ */
+void Trace_put(uint32_t head,uint32_t a,uint32_t b,uint32_t c,uint32_t d)
+{
+	int n = (int)(head & 0xFF);
+	uint16_t space;
+	uint32_t t;
+
+	if(ring == NULL)
+		return;
+	space = (uint16_t)(mask+1-(uint16_t)(wrPos-rdPos));
+	t = *now;
+	if(lost){
+		if(space < 3+2+n){   //the TRACE_LOST record and this one
+			lost++;
+			return;
+		}
+		ring[wrPos++ & mask] = TRACE_HEAD(TRACE_LOST,1);
+		ring[wrPos++ & mask] = t;
+		ring[wrPos++ & mask] = lost;
+		lost = 0;
+	}else if(space < 2+n){
+		lost = 1;
+		return;
+	}
+	ring[wrPos++ & mask] = head;
+	ring[wrPos++ & mask] = t;
+	if(n > 0)
+		ring[wrPos++ & mask] = a;
+	if(n > 1)
+		ring[wrPos++ & mask] = b;
+	if(n > 2)
+		ring[wrPos++ & mask] = c;
+	if(n > 3)
+		ring[wrPos++ & mask] = d;
+}
+
+/**
+ * @brief	  take the oldest whole records that fit in words out of the ring
+ * @return  words copied,0 if none
+ */
+int Trace_read(uint32_t *out,int words)
+{
+	int n = 0,size;
+
+	if(ring == NULL)
+		return 0;
+	while(rdPos != wrPos){
+		size = 2+(int)(ring[rdPos & mask] & 0xFF);
+		if(n+size > words)
+			break;
+		while(size-- > 0)
+			out[n++] = ring[rdPos++ & mask];
+	}
+	return n;
+}
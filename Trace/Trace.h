@@ -0,0 +1,58 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+#include "TraceEvents.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Binary trace log. TRACE0..TRACE4 put the event number, the time and the raw arguments into a
+ * ring of words in RAM, no formatting and nothing on the UART, so they can stay on hot paths and
+ * in production. Trace_read takes whole records out again when there is time(drainTrace() in
+ * SWAuthDemo.c prints them as "trc <hex>" lines) and tools/trace_decode turns those back into
+ * text with the formats of TraceEvents.h.
+ *
+ * A record is a head word, event number << 8 | argument count, the time(*clock of Trace_init,
+ * ms of tick_ct in SWAuthDemo.c) and the arguments. When the ring is full new records are
+ * dropped and counted, a TRACE_LOST record with the count goes in before the next one that fits.
+ * Not for interrupt handlers, the ring has no lock.
+ */
+
+#define TRACE_ENABLE        (1)
+#define TRACE_ARGS_MAX      (4)
+#define TRACE_RECORD_MAX    (2+TRACE_ARGS_MAX)  /* words */
+
+#define TRACE_EVENT_ENUM(id,format)     id,
+typedef enum TRACE_EVENT{
+	TRACE_EVENT_LIST(TRACE_EVENT_ENUM)
+	TRACE_EVENT_MAX,
+}TRACE_EVENT_T;
+
+#define TRACE_HEAD(id,argc)     ((uint32_t)(id)<<8 | (argc))
+
+#if TRACE_ENABLE
+#define TRACE0(id)              Trace_put(TRACE_HEAD(id,0),0,0,0,0)
+#define TRACE1(id,a)            Trace_put(TRACE_HEAD(id,1),(uint32_t)(a),0,0,0)
+#define TRACE2(id,a,b)          Trace_put(TRACE_HEAD(id,2),(uint32_t)(a),(uint32_t)(b),0,0)
+#define TRACE3(id,a,b,c)        Trace_put(TRACE_HEAD(id,3),(uint32_t)(a),(uint32_t)(b),(uint32_t)(c),0)
+#define TRACE4(id,a,b,c,d)      Trace_put(TRACE_HEAD(id,4),(uint32_t)(a),(uint32_t)(b),(uint32_t)(c),(uint32_t)(d))
+#else
+#define TRACE0(id)
+#define TRACE1(id,a)
+#define TRACE2(id,a,b)
+#define TRACE3(id,a,b,c)
+#define TRACE4(id,a,b,c,d)
+#endif
+
+int Trace_init(uint32_t *buf,uint16_t words,const volatile uint32_t *clock);
+void Trace_put(uint32_t head,uint32_t a,uint32_t b,uint32_t c,uint32_t d);
+int Trace_read(uint32_t *out,int words);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
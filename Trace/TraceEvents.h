@@ -0,0 +1,31 @@
+#ifndef _TRACE_EVENTS_H
+#define _TRACE_EVENTS_H
+
+/*
+ * The trace events and their formats. The firmware only records the event number and up to
+ * TRACE_ARGS_MAX 32-bit arguments; tools/trace_decode is built from this list and prints the
+ * format with them on the host. Conversions are %u %d %x %X with flags and width, and %k, the
+ * name of an AT_CMD(Air202.h). Add events at the end and run "trace_decode -g" after any change
+ * to the list, TRACE_TABLE_CRC tells a log of an older build apart.
+ */
+
+#define TRACE_EVENT_LIST(X) \
+	X(TRACE_LOST,"%u records lost,the trace ring was full") \
+	X(TRACE_BOOT,"boot,trace table %04X") \
+	X(TRACE_AT_OK,"%k answered in %uus,%u bytes") \
+	X(TRACE_AT_FAIL,"%k not answered,%u bytes") \
+	X(TRACE_SEND_JSON,"Send: %u bytes") \
+	X(TRACE_SEND_FRAME,"Send: %u bytes frame") \
+	X(TRACE_RECV_JSON,"recieved %u bytes") \
+	X(TRACE_RECV_FRAME,"recieved %u bytes frame") \
+	X(TRACE_AUTHORIZING,"Authorizing...!") \
+	X(TRACE_RESP,"apiId:%d,respCode:%d,seq:%d") \
+	X(TRACE_AUTH_PASS,"Authorization pass,next in %us") \
+	X(TRACE_AUTH_FAIL,"Authorization failed") \
+	X(TRACE_TIMEOUT,"request %u(apiId %d) timed out") \
+	X(TRACE_TELEMETRY,"telemetry: %u records in %u bytes,%u bytes left today")
+
+/* generated by tools/trace_decode -g */
+#define TRACE_TABLE_CRC     (0xF89F)
+
+#endif
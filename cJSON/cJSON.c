@@ -25,9 +25,11 @@
 
 #include <string.h>
 #include <stdio.h>
-#include <math.h>
 #include <stdlib.h>
+#ifndef CJSON_NO_FLOAT
+#include <math.h>
 #include <float.h>
+#endif
 #include <limits.h>
 #include <ctype.h>
 #include "cJSON.h"
@@ -43,8 +45,32 @@ static int cJSON_strcasecmp(const char *s1,const char *s2)
     return tolower(*(const unsigned char *)s1) - tolower(*(const unsigned char *)s2);
 }
 
+#ifdef CJSON_COMPACT
+/* Items refer to each other by 16-bit offsets from cJSON_CompactBase, 0 is a null reference. */
+char *cJSON_CompactBase;
+static cJSON_ref to_ref(const void *ptr) {return (cJSON_ref)(ptr?(const char*)ptr-cJSON_CompactBase:0);}
+#define SET_NEXT(item,ptr)          ((item)->next=to_ref(ptr))
+#define SET_PREV(item,ptr)          ((void)0)
+#define SET_CHILD(item,ptr)         ((item)->child=to_ref(ptr))
+#define SET_NAME(item,ptr)          ((item)->string=to_ref(ptr))
+#define SET_VALUESTRING(item,ptr)   ((item)->value.valuestring=to_ref(ptr))
+#define HAS_VALUESTRING(item)       ((item)->value.valuestring!=0)
+#else
+#define SET_NEXT(item,ptr)          ((item)->next=(ptr))
+#define SET_PREV(item,ptr)          ((item)->prev=(ptr))
+#define SET_CHILD(item,ptr)         ((item)->child=(ptr))
+#define SET_NAME(item,ptr)          ((item)->string=(ptr))
+#define SET_VALUESTRING(item,ptr)   ((item)->valuestring=(ptr))
+#define HAS_VALUESTRING(item)       ((item)->valuestring!=0)
+#endif
+/* Links are tested on the field, cJSON_FromRef() in a condition is never null to the compiler. */
+#define HAS_NEXT(item)              ((item)->next!=0)
+#define HAS_CHILD(item)             ((item)->child!=0)
+#define HAS_NAME(item)              ((item)->string!=0)
+
 static void *(*cJSON_malloc)(size_t sz) = malloc;
 static void (*cJSON_free)(void *ptr) = free;
+static void *(*cJSON_node_malloc)(void) = 0;  /* items,when they come from elsewhere than strings */
 
 static char* cJSON_strdup(const char* str)
 {
@@ -59,6 +85,7 @@ static char* cJSON_strdup(const char* str)
 
 void cJSON_InitHooks(cJSON_Hooks* hooks)
 {
+    cJSON_node_malloc = 0;
     if (!hooks) { /* Reset hooks */
         cJSON_malloc = malloc;
         cJSON_free = free;
@@ -69,10 +96,15 @@ void cJSON_InitHooks(cJSON_Hooks* hooks)
     cJSON_free   = (hooks->free_fn)?hooks->free_fn:free;
 }
 
+void cJSON_InitNodeHook(void *(*node_malloc_fn)(void))
+{
+    cJSON_node_malloc = node_malloc_fn;
+}
+
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(void)
 {
-    cJSON* node = (cJSON*)cJSON_malloc(sizeof(cJSON));
+    cJSON* node = (cJSON*)(cJSON_node_malloc?cJSON_node_malloc():cJSON_malloc(sizeof(cJSON)));
     if (node) memset(node,0,sizeof(cJSON));
     return node;
 }
@@ -83,10 +115,10 @@ void cJSON_Delete(cJSON *c)
     cJSON *next;
     while (c)
     {
-        next=c->next;
-        if (!(c->type&cJSON_IsReference) && c->child) cJSON_Delete(c->child);
-        if (!(c->type&cJSON_IsReference) && c->valuestring) cJSON_free(c->valuestring);
-        if (!(c->type&cJSON_StringIsConst) && c->string) cJSON_free(c->string);
+        next=cJSON_Next(c);
+        if (!(c->type&cJSON_IsReference) && HAS_CHILD(c)) cJSON_Delete(cJSON_Child(c));
+        if (!(c->type&cJSON_IsReference) && (c->type&255)==cJSON_String && HAS_VALUESTRING(c)) cJSON_free(cJSON_ValueString(c));
+        if (!(c->type&cJSON_StringIsConst) && HAS_NAME(c)) cJSON_free(cJSON_Name(c));
         cJSON_free(c);
         c=next;
     }
@@ -95,8 +127,45 @@ void cJSON_Delete(cJSON *c)
 /* Parse the input text to generate a number, and populate the result into item. */
 static const char *parse_number(cJSON *item,const char *num)
 {
+    unsigned long i=0,limit;int neg=0,overflow=0,dropped=0,d;
+#ifdef CJSON_NO_FLOAT
+    const char *frac=0;int subscale=0,signsubscale=1;
+#else
     double n=0,sign=1,scale=0;int subscale=0,signsubscale=1;
+    const char *start=num;
+#endif
+
+    /* Integer fast path: plain integers that fit an int never touch floating point. */
+    if (*num=='-') neg=1,num++;
+    limit=neg?(unsigned long)INT_MAX+1:(unsigned long)INT_MAX;
+    if (*num=='0') num++;
+    /* i*10+d is only formed when it stays within limit: with a 32-bit unsigned long it would wrap first.
+       The digits after those that fit are counted instead, a negative exponent may scale them back. */
+    if (*num>='1' && *num<='9') do {d=*num++ -'0';if (overflow || i>(limit-d)/10) {overflow=1;if (dropped<10000) dropped++;} else i=i*10+d;} while (*num>='0' && *num<='9');
+    if (!overflow && !(*num=='.' && num[1]>='0' && num[1]<='9') && *num!='e' && *num!='E')
+    {
+        cJSON_ValueInt(item)=neg?((i>(unsigned long)INT_MAX)?INT_MIN:-(int)i):(int)i;
+#ifndef CJSON_NO_FLOAT
+        item->valuedouble=cJSON_ValueInt(item);
+#endif
+        item->type=cJSON_Number;
+        return num;
+    }
 
+#ifdef CJSON_NO_FLOAT
+    /* Without floating point the value is truncated towards zero: shift fraction digits in for a positive exponent, divide for a negative one. */
+    if (*num=='.' && num[1]>='0' && num[1]<='9') {frac=++num;while (*num>='0' && *num<='9') num++;}  /* Fractional part? */
+    if (*num=='e' || *num=='E')     /* Exponent? */
+    {   num++;if (*num=='+') num++; else if (*num=='-') signsubscale=-1,num++;      /* With sign? */
+        while (*num>='0' && *num<='9') {if (subscale<10000) subscale=(subscale*10)+(*num - '0');num++;}   /* Number? */
+    }
+    subscale=subscale*signsubscale+dropped;     /* i holds the leading digits only */
+    if (dropped && subscale>0) i=limit;         /* saturate the result, not the mantissa */
+    else if (subscale<0) while (subscale++ < 0 && i) i/=10;
+    else while (subscale-- > 0 && i<limit) {d=(frac && *frac>='0' && *frac<='9')?(*frac++ -'0'):0;i=(i>(limit-d)/10)?limit:i*10+d;}
+    cJSON_ValueInt(item)=neg?((i>(unsigned long)INT_MAX)?INT_MIN:-(int)i):(int)i;
+#else
+    num=start;
     if (*num=='-') sign=-1,num++;   /* Has sign? */
     if (*num=='0') num++;           /* is zero */
     if (*num>='1' && *num<='9') do  n=(n*10.0)+(*num++ -'0');   while (*num>='0' && *num<='9'); /* Number? */
@@ -109,7 +178,8 @@ static const char *parse_number(cJSON *item,const char *num)
     n=sign*n*pow(10.0,(scale+subscale*signsubscale));   /* number = +/- number.fraction * 10^+/- exponent */
     
     item->valuedouble=n;
-    item->valueint=(int)n;
+    cJSON_ValueInt(item)=(int)n;
+#endif
     item->type=cJSON_Number;
     return num;
 }
@@ -144,6 +214,16 @@ static int update(printbuffer *p)
 }
 
 /* Render the number nicely from the given item into a string. */
+#ifdef CJSON_NO_FLOAT
+static char *print_number(cJSON *item,printbuffer *p)
+{
+    char *str=0;
+    if (p)  str=ensure(p,12);
+    else    str=(char*)cJSON_malloc(12);    /* -2147483648 */
+    if (str)    sprintf(str,"%d",cJSON_ValueInt(item));
+    return str;
+}
+#else
 static char *print_number(cJSON *item,printbuffer *p)
 {
     char *str=0;
@@ -154,11 +234,11 @@ static char *print_number(cJSON *item,printbuffer *p)
         else    str=(char*)cJSON_malloc(2); /* special case for 0. */
         if (str) strcpy(str,"0");
     }
-    else if (fabs(((double)item->valueint)-d)<=DBL_EPSILON && d<=INT_MAX && d>=INT_MIN)
+    else if (fabs(((double)cJSON_ValueInt(item))-d)<=DBL_EPSILON && d<=INT_MAX && d>=INT_MIN)
     {
         if (p)  str=ensure(p,21);
         else    str=(char*)cJSON_malloc(21);    /* 2^64+1 can be represented in 21 chars. */
-        if (str)    sprintf(str,"%d",item->valueint);
+        if (str)    sprintf(str,"%d",cJSON_ValueInt(item));
     }
     else
     {
@@ -174,6 +254,7 @@ static char *print_number(cJSON *item,printbuffer *p)
     }
     return str;
 }
+#endif
 
 static unsigned parse_hex4(const char *str)
 {
@@ -195,11 +276,12 @@ static const char *parse_string(cJSON *item,const char *str,const char **ep)
     const char *ptr=str+1,*end_ptr=str+1;char *ptr2;char *out;int len=0;unsigned uc,uc2;
     if (*str!='\"') {*ep=str;return 0;} /* not a string! */
     
-    while (*end_ptr!='\"' && *end_ptr && ++len) if (*end_ptr++ == '\\') end_ptr++;  /* Skip escaped quotes. */
+    while (*end_ptr!='\"' && *end_ptr && ++len) if (*end_ptr++ == '\\' && *end_ptr) end_ptr++;  /* Skip escaped quotes. */
+    if (*end_ptr!='\"') {*ep=str;return 0;}    /* unterminated string, don't read past the end of the input */
     
     out=(char*)cJSON_malloc(len+1); /* This is how long we need for the string, roughly. */
     if (!out) return 0;
-    item->valuestring=out; /* assign here so out will be deleted during cJSON_Delete() later */
+    SET_VALUESTRING(item,out); /* assign here so out will be deleted during cJSON_Delete() later */
     item->type=cJSON_String;
     
     ptr=str+1;ptr2=out;
@@ -310,7 +392,7 @@ static char *print_string_ptr(const char *str,printbuffer *p)
     return out;
 }
 /* Invote print_string_ptr (which is useful) on an item. */
-static char *print_string(cJSON *item,printbuffer *p)   {return print_string_ptr(item->valuestring,p);}
+static char *print_string(cJSON *item,printbuffer *p)   {return print_string_ptr(cJSON_ValueString(item),p);}
 
 /* Predeclare these prototypes. */
 static const char *parse_value(cJSON *item,const char *value,const char **ep);
@@ -362,7 +444,7 @@ static const char *parse_value(cJSON *item,const char *value,const char **ep)
     if (!value)                     return 0;   /* Fail on null. */
     if (!strncmp(value,"null",4))   { item->type=cJSON_NULL;  return value+4; }
     if (!strncmp(value,"false",5))  { item->type=cJSON_False; return value+5; }
-    if (!strncmp(value,"true",4))   { item->type=cJSON_True; item->valueint=1;  return value+4; }
+    if (!strncmp(value,"true",4))   { item->type=cJSON_True; cJSON_ValueInt(item)=1;  return value+4; }
     if (*value=='\"')               { return parse_string(item,value,ep); }
     if (*value=='-' || (*value>='0' && *value<='9'))    { return parse_number(item,value); }
     if (*value=='[')                { return parse_array(item,value,ep); }
@@ -415,8 +497,9 @@ static const char *parse_array(cJSON *item,const char *value,const char **ep)
     value=skip(value+1);
     if (*value==']') return value+1;    /* empty array. */
 
-    item->child=child=cJSON_New_Item();
-    if (!item->child) return 0;      /* memory fail */
+    child=cJSON_New_Item();
+    if (!child) return 0;      /* memory fail */
+    SET_CHILD(item,child);
     value=skip(parse_value(child,skip(value),ep));  /* skip any spacing, get the value. */
     if (!value) return 0;
 
@@ -424,7 +507,7 @@ static const char *parse_array(cJSON *item,const char *value,const char **ep)
     {
         cJSON *new_item;
         if (!(new_item=cJSON_New_Item())) return 0;     /* memory fail */
-        child->next=new_item;new_item->prev=child;child=new_item;
+        SET_NEXT(child,new_item);SET_PREV(new_item,child);child=new_item;
         value=skip(parse_value(child,skip(value+1),ep));
         if (!value) return 0;   /* memory fail */
     }
@@ -438,12 +521,12 @@ static char *print_array(cJSON *item,int depth,int fmt,printbuffer *p)
 {
     char **entries;
     char *out=0,*ptr,*ret;int len=5;
-    cJSON *child=item->child;
+    cJSON *child=cJSON_Child(item);
     int numentries=0,i=0,fail=0;
     size_t tmplen=0;
     
     /* How many entries in the array? */
-    while (child) numentries++,child=child->next;
+    while (child) numentries++,child=cJSON_Next(child);
     /* Explicitly handle numentries==0 */
     if (!numentries)
     {
@@ -458,13 +541,13 @@ static char *print_array(cJSON *item,int depth,int fmt,printbuffer *p)
         /* Compose the output array. */
         i=p->offset;
         ptr=ensure(p,1);if (!ptr) return 0; *ptr='[';   p->offset++;
-        child=item->child;
+        child=cJSON_Child(item);
         while (child && !fail)
         {
             print_value(child,depth+1,fmt,p);
             p->offset=update(p);
-            if (child->next) {len=fmt?2:1;ptr=ensure(p,len+1);if (!ptr) return 0;*ptr++=',';if(fmt)*ptr++=' ';*ptr=0;p->offset+=len;}
-            child=child->next;
+            if (cJSON_Next(child)) {len=fmt?2:1;ptr=ensure(p,len+1);if (!ptr) return 0;*ptr++=',';if(fmt)*ptr++=' ';*ptr=0;p->offset+=len;}
+            child=cJSON_Next(child);
         }
         ptr=ensure(p,2);if (!ptr) return 0; *ptr++=']';*ptr=0;
         out=(p->buffer)+i;
@@ -476,13 +559,13 @@ static char *print_array(cJSON *item,int depth,int fmt,printbuffer *p)
         if (!entries) return 0;
         memset(entries,0,numentries*sizeof(char*));
         /* Retrieve all the results: */
-        child=item->child;
+        child=cJSON_Child(item);
         while (child && !fail)
         {
             ret=print_value(child,depth+1,fmt,0);
             entries[i++]=ret;
             if (ret) len+=strlen(ret)+2+(fmt?1:0); else fail=1;
-            child=child->next;
+            child=cJSON_Next(child);
         }
         
         /* If we didn't fail, try to malloc the output string */
@@ -523,11 +606,12 @@ static const char *parse_object(cJSON *item,const char *value,const char **ep)
     value=skip(value+1);
     if (*value=='}') return value+1;    /* empty array. */
     
-    item->child=child=cJSON_New_Item();
-    if (!item->child) return 0;
+    child=cJSON_New_Item();
+    if (!child) return 0;
+    SET_CHILD(item,child);
     value=skip(parse_string(child,skip(value),ep));
     if (!value) return 0;
-    child->string=child->valuestring;child->valuestring=0;
+    SET_NAME(child,cJSON_ValueString(child));SET_VALUESTRING(child,0);
     if (*value!=':') {*ep=value;return 0;}  /* fail! */
     value=skip(parse_value(child,skip(value+1),ep));    /* skip any spacing, get the value. */
     if (!value) return 0;
@@ -536,10 +620,10 @@ static const char *parse_object(cJSON *item,const char *value,const char **ep)
     {
         cJSON *new_item;
         if (!(new_item=cJSON_New_Item()))   return 0; /* memory fail */
-        child->next=new_item;new_item->prev=child;child=new_item;
+        SET_NEXT(child,new_item);SET_PREV(new_item,child);child=new_item;
         value=skip(parse_string(child,skip(value+1),ep));
         if (!value) return 0;
-        child->string=child->valuestring;child->valuestring=0;
+        SET_NAME(child,cJSON_ValueString(child));SET_VALUESTRING(child,0);
         if (*value!=':') {*ep=value;return 0;}  /* fail! */
         value=skip(parse_value(child,skip(value+1),ep));    /* skip any spacing, get the value. */
         if (!value) return 0;
@@ -555,11 +639,11 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
 {
     char **entries=0,**names=0;
     char *out=0,*ptr,*ret,*str;int len=7,i=0,j;
-    cJSON *child=item->child;
+    cJSON *child=cJSON_Child(item);
     int numentries=0,fail=0;
     size_t tmplen=0;
     /* Count the number of entries. */
-    while (child) numentries++,child=child->next;
+    while (child) numentries++,child=cJSON_Next(child);
     /* Explicitly handle empty object case */
     if (!numentries)
     {
@@ -577,7 +661,7 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
         i=p->offset;
         len=fmt?2:1;    ptr=ensure(p,len+1);    if (!ptr) return 0;
         *ptr++='{'; if (fmt) *ptr++='\n';   *ptr=0; p->offset+=len;
-        child=item->child;depth++;
+        child=cJSON_Child(item);depth++;
         while (child)
         {
             if (fmt)
@@ -586,7 +670,7 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
                 for (j=0;j<depth;j++) *ptr++='\t';
                 p->offset+=depth;
             }
-            print_string_ptr(child->string,p);
+            print_string_ptr(cJSON_Name(child),p);
             p->offset=update(p);
             
             len=fmt?2:1;
@@ -597,12 +681,12 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
             print_value(child,depth,fmt,p);
             p->offset=update(p);
 
-            len=(fmt?1:0)+(child->next?1:0);
+            len=(fmt?1:0)+(HAS_NEXT(child)?1:0);
             ptr=ensure(p,len+1); if (!ptr) return 0;
-            if (child->next) *ptr++=',';
+            if (HAS_NEXT(child)) *ptr++=',';
             if (fmt) *ptr++='\n';*ptr=0;
             p->offset+=len;
-            child=child->next;
+            child=cJSON_Next(child);
         }
         ptr=ensure(p,fmt?(depth+1):2);   if (!ptr) return 0;
         if (fmt)    for (i=0;i<depth-1;i++) *ptr++='\t';
@@ -620,13 +704,13 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
         memset(names,0,sizeof(char*)*numentries);
 
         /* Collect all the results into our arrays: */
-        child=item->child;depth++;if (fmt) len+=depth;
+        child=cJSON_Child(item);depth++;if (fmt) len+=depth;
         while (child && !fail)
         {
-            names[i]=str=print_string_ptr(child->string,0);
+            names[i]=str=print_string_ptr(cJSON_Name(child),0);
             entries[i++]=ret=print_value(child,depth,fmt,0);
             if (str && ret) len+=strlen(ret)+strlen(str)+2+(fmt?2+depth:0); else fail=1;
-            child=child->next;
+            child=cJSON_Next(child);
         }
         
         /* Try to allocate the output string */
@@ -666,11 +750,11 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
 {
     char **entries=0,**names=0;
     char *out=0,*ptr,*ret,*str;int len=7,i=0,j;
-    cJSON *child=item->child;
+    cJSON *child=cJSON_Child(item);
     int numentries=0,fail=0;
     size_t tmplen=0;
     /* Count the number of entries. */
-    while (child) numentries++,child=child->next;
+    while (child) numentries++,child=cJSON_Next(child);
     /* Explicitly handle empty object case */
     if (!numentries)
     {
@@ -688,7 +772,7 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
         i=p->offset;
         len=fmt?2:1;    ptr=ensure(p,len+1);    if (!ptr) return 0;
         *ptr++='{'; /*if (fmt) *ptr++='\n';*/   *ptr=0; p->offset+=len;
-        child=item->child;depth++;
+        child=cJSON_Child(item);depth++;
         while (child)
         {
             if (fmt)
@@ -697,7 +781,7 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
                 for (j=0;j<depth;j++) /**ptr++='\t'*/;
                 p->offset+=depth;
             }
-            print_string_ptr(child->string,p);
+            print_string_ptr(cJSON_Name(child),p);
             p->offset=update(p);
             
             len=fmt?2:1;
@@ -708,12 +792,12 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
             print_value(child,depth,fmt,p);
             p->offset=update(p);
 
-            len=(fmt?1:0)+(child->next?1:0);
+            len=(fmt?1:0)+(HAS_NEXT(child)?1:0);
             ptr=ensure(p,len+1); if (!ptr) return 0;
-            if (child->next) *ptr++=',';
+            if (HAS_NEXT(child)) *ptr++=',';
             /*if (fmt) *ptr++='\n';*ptr=0;*/
             p->offset+=len;
-            child=child->next;
+            child=cJSON_Next(child);
         }
         ptr=ensure(p,fmt?(depth+1):2);   if (!ptr) return 0;
         if (fmt)    for (i=0;i<depth-1;i++) /**ptr++='\t'*/;
@@ -731,13 +815,13 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
         memset(names,0,sizeof(char*)*numentries);
 
         /* Collect all the results into our arrays: */
-        child=item->child;depth++;if (fmt) len+=depth;
+        child=cJSON_Child(item);depth++;if (fmt) len+=depth;
         while (child && !fail)
         {
-            names[i]=str=print_string_ptr(child->string,0);
+            names[i]=str=print_string_ptr(cJSON_Name(child),0);
             entries[i++]=ret=print_value(child,depth,fmt,0);
             if (str && ret) len+=strlen(ret)+strlen(str)+2+(fmt?2+depth:0); else fail=1;
-            child=child->next;
+            child=cJSON_Next(child);
         }
         
         /* Try to allocate the output string */
@@ -776,52 +860,64 @@ static char *print_object(cJSON *item,int depth,int fmt,printbuffer *p)
 
 
 /* Get Array size/item / object item. */
-int    cJSON_GetArraySize(cJSON *array)                         {cJSON *c=array->child;int i=0;while(c)i++,c=c->next;return i;}
-cJSON *cJSON_GetArrayItem(cJSON *array,int item)                {cJSON *c=array?array->child:0;while (c && item>0) item--,c=c->next; return c;}
-cJSON *cJSON_GetObjectItem(cJSON *object,const char *string)    {cJSON *c=object?object->child:0;while (c && cJSON_strcasecmp(c->string,string)) c=c->next; return c;}
+int    cJSON_GetArraySize(cJSON *array)                         {cJSON *c=cJSON_Child(array);int i=0;while(c)i++,c=cJSON_Next(c);return i;}
+cJSON *cJSON_GetArrayItem(cJSON *array,int item)                {cJSON *c=array?cJSON_Child(array):0;while (c && item>0) item--,c=cJSON_Next(c); return c;}
+cJSON *cJSON_GetObjectItem(cJSON *object,const char *string)    {cJSON *c=object?cJSON_Child(object):0;while (c && cJSON_strcasecmp(cJSON_Name(c),string)) c=cJSON_Next(c); return c;}
 int cJSON_HasObjectItem(cJSON *object,const char *string)       {return cJSON_GetObjectItem(object,string)?1:0;}
 
 /* Utility for array list handling. */
-static void suffix_object(cJSON *prev,cJSON *item) {prev->next=item;item->prev=prev;}
+static void suffix_object(cJSON *prev,cJSON *item) {SET_NEXT(prev,item);SET_PREV(item,prev);}
 /* Utility for handling references. */
-static cJSON *create_reference(cJSON *item) {cJSON *ref=cJSON_New_Item();if (!ref) return 0;memcpy(ref,item,sizeof(cJSON));ref->string=0;ref->type|=cJSON_IsReference;ref->next=ref->prev=0;return ref;}
+static cJSON *create_reference(cJSON *item) {cJSON *ref=cJSON_New_Item();if (!ref) return 0;memcpy(ref,item,sizeof(cJSON));SET_NAME(ref,0);ref->type|=cJSON_IsReference;SET_NEXT(ref,0);SET_PREV(ref,0);return ref;}
 
 /* Add item to array/object. */
-void   cJSON_AddItemToArray(cJSON *array, cJSON *item)                      {cJSON *c=array->child;if (!item) return; if (!c) {array->child=item;} else {while (c && c->next) c=c->next; suffix_object(c,item);}}
-void   cJSON_AddItemToObject(cJSON *object,const char *string,cJSON *item)  {if (!item) return; if (item->string) cJSON_free(item->string);item->string=cJSON_strdup(string);cJSON_AddItemToArray(object,item);}
+void   cJSON_AddItemToArray(cJSON *array, cJSON *item)                      {cJSON *c=cJSON_Child(array);if (!item) return; if (!c) {SET_CHILD(array,item);} else {while (c && HAS_NEXT(c)) c=cJSON_Next(c); suffix_object(c,item);}}
+void   cJSON_AddItemToObject(cJSON *object,const char *string,cJSON *item)  {if (!item) return; if (HAS_NAME(item)) cJSON_free(cJSON_Name(item));SET_NAME(item,cJSON_strdup(string));cJSON_AddItemToArray(object,item);}
+#ifdef CJSON_COMPACT
+/* A const name may live outside the reach of a 16-bit reference, so it is copied like any other. */
+void   cJSON_AddItemToObjectCS(cJSON *object,const char *string,cJSON *item)    {cJSON_AddItemToObject(object,string,item);}
+#else
 void   cJSON_AddItemToObjectCS(cJSON *object,const char *string,cJSON *item)    {if (!item) return; if (!(item->type&cJSON_StringIsConst) && item->string) cJSON_free(item->string);item->string=(char*)string;item->type|=cJSON_StringIsConst;cJSON_AddItemToArray(object,item);}
+#endif
 void    cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item)                        {cJSON_AddItemToArray(array,create_reference(item));}
 void    cJSON_AddItemReferenceToObject(cJSON *object,const char *string,cJSON *item)    {cJSON_AddItemToObject(object,string,create_reference(item));}
 
-cJSON *cJSON_DetachItemFromArray(cJSON *array,int which)            {cJSON *c=array->child;while (c && which>0) c=c->next,which--;if (!c) return 0;
-    if (c->prev) c->prev->next=c->next;if (c->next) c->next->prev=c->prev;if (c==array->child) array->child=c->next;c->prev=c->next=0;return c;}
+/* The list walks below track the previous item themselves, the compact layout has no prev link. */
+cJSON *cJSON_DetachItemFromArray(cJSON *array,int which)            {cJSON *c=cJSON_Child(array),*prev=0;while (c && which>0) prev=c,c=cJSON_Next(c),which--;if (!c) return 0;
+    if (prev) SET_NEXT(prev,cJSON_Next(c)); else SET_CHILD(array,cJSON_Next(c));if (cJSON_Next(c)) SET_PREV(cJSON_Next(c),prev);SET_NEXT(c,0);SET_PREV(c,0);return c;}
 void   cJSON_DeleteItemFromArray(cJSON *array,int which)            {cJSON_Delete(cJSON_DetachItemFromArray(array,which));}
-cJSON *cJSON_DetachItemFromObject(cJSON *object,const char *string) {int i=0;cJSON *c=object->child;while (c && cJSON_strcasecmp(c->string,string)) i++,c=c->next;if (c) return cJSON_DetachItemFromArray(object,i);return 0;}
+cJSON *cJSON_DetachItemFromObject(cJSON *object,const char *string) {int i=0;cJSON *c=cJSON_Child(object);while (c && cJSON_strcasecmp(cJSON_Name(c),string)) i++,c=cJSON_Next(c);if (c) return cJSON_DetachItemFromArray(object,i);return 0;}
 void   cJSON_DeleteItemFromObject(cJSON *object,const char *string) {cJSON_Delete(cJSON_DetachItemFromObject(object,string));}
 
 /* Replace array/object items with new ones. */
-void   cJSON_InsertItemInArray(cJSON *array,int which,cJSON *newitem)       {cJSON *c=array->child;while (c && which>0) c=c->next,which--;if (!c) {cJSON_AddItemToArray(array,newitem);return;}
-    newitem->next=c;newitem->prev=c->prev;c->prev=newitem;if (c==array->child) array->child=newitem; else newitem->prev->next=newitem;}
-void   cJSON_ReplaceItemInArray(cJSON *array,int which,cJSON *newitem)      {cJSON *c=array->child;while (c && which>0) c=c->next,which--;if (!c) return;
-    newitem->next=c->next;newitem->prev=c->prev;if (newitem->next) newitem->next->prev=newitem;
-    if (c==array->child) array->child=newitem; else newitem->prev->next=newitem;c->next=c->prev=0;cJSON_Delete(c);}
-void   cJSON_ReplaceItemInObject(cJSON *object,const char *string,cJSON *newitem){int i=0;cJSON *c=object->child;while(c && cJSON_strcasecmp(c->string,string))i++,c=c->next;if(c){newitem->string=cJSON_strdup(string);cJSON_ReplaceItemInArray(object,i,newitem);}}
+void   cJSON_InsertItemInArray(cJSON *array,int which,cJSON *newitem)       {cJSON *c=cJSON_Child(array),*prev=0;while (c && which>0) prev=c,c=cJSON_Next(c),which--;if (!c) {cJSON_AddItemToArray(array,newitem);return;}
+    SET_NEXT(newitem,c);SET_PREV(newitem,prev);SET_PREV(c,newitem);if (!prev) SET_CHILD(array,newitem); else SET_NEXT(prev,newitem);}
+void   cJSON_ReplaceItemInArray(cJSON *array,int which,cJSON *newitem)      {cJSON *c=cJSON_Child(array),*prev=0;while (c && which>0) prev=c,c=cJSON_Next(c),which--;if (!c) return;
+    SET_NEXT(newitem,cJSON_Next(c));SET_PREV(newitem,prev);if (cJSON_Next(newitem)) SET_PREV(cJSON_Next(newitem),newitem);
+    if (!prev) SET_CHILD(array,newitem); else SET_NEXT(prev,newitem);SET_NEXT(c,0);SET_PREV(c,0);cJSON_Delete(c);}
+void   cJSON_ReplaceItemInObject(cJSON *object,const char *string,cJSON *newitem){int i=0;cJSON *c=cJSON_Child(object);while(c && cJSON_strcasecmp(cJSON_Name(c),string))i++,c=cJSON_Next(c);if(c){SET_NAME(newitem,cJSON_strdup(string));cJSON_ReplaceItemInArray(object,i,newitem);}}
 
 /* Create basic types: */
 cJSON *cJSON_CreateNull(void)                   {cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_NULL;return item;}
 cJSON *cJSON_CreateTrue(void)                   {cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_True;return item;}
 cJSON *cJSON_CreateFalse(void)                  {cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_False;return item;}
 cJSON *cJSON_CreateBool(int b)                  {cJSON *item=cJSON_New_Item();if(item)item->type=b?cJSON_True:cJSON_False;return item;}
-cJSON *cJSON_CreateNumber(double num)           {cJSON *item=cJSON_New_Item();if(item){item->type=cJSON_Number;item->valuedouble=num;item->valueint=(int)num;}return item;}
-cJSON *cJSON_CreateString(const char *string)   {cJSON *item=cJSON_New_Item();if(item){item->type=cJSON_String;item->valuestring=cJSON_strdup(string);if(!item->valuestring){cJSON_Delete(item);return 0;}}return item;}
+#ifdef CJSON_NO_FLOAT
+cJSON *cJSON_CreateNumber(int num)              {cJSON *item=cJSON_New_Item();if(item){item->type=cJSON_Number;cJSON_ValueInt(item)=num;}return item;}
+#else
+cJSON *cJSON_CreateNumber(double num)           {cJSON *item=cJSON_New_Item();if(item){item->type=cJSON_Number;item->valuedouble=num;cJSON_ValueInt(item)=(int)num;}return item;}
+#endif
+cJSON *cJSON_CreateString(const char *string)   {cJSON *item=cJSON_New_Item();if(item){item->type=cJSON_String;SET_VALUESTRING(item,cJSON_strdup(string));if(!HAS_VALUESTRING(item)){cJSON_Delete(item);return 0;}}return item;}
 cJSON *cJSON_CreateArray(void)                  {cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_Array;return item;}
 cJSON *cJSON_CreateObject(void)                 {cJSON *item=cJSON_New_Item();if(item)item->type=cJSON_Object;return item;}
 
 /* Create Arrays: */
-cJSON *cJSON_CreateIntArray(const int *numbers,int count)       {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
-cJSON *cJSON_CreateFloatArray(const float *numbers,int count)   {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
-cJSON *cJSON_CreateDoubleArray(const double *numbers,int count) {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
-cJSON *cJSON_CreateStringArray(const char **strings,int count)  {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateString(strings[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)a->child=n;else suffix_object(p,n);p=n;}return a;}
+cJSON *cJSON_CreateIntArray(const int *numbers,int count)       {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)SET_CHILD(a,n);else suffix_object(p,n);p=n;}return a;}
+#ifndef CJSON_NO_FLOAT
+cJSON *cJSON_CreateFloatArray(const float *numbers,int count)   {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)SET_CHILD(a,n);else suffix_object(p,n);p=n;}return a;}
+cJSON *cJSON_CreateDoubleArray(const double *numbers,int count) {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateNumber(numbers[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)SET_CHILD(a,n);else suffix_object(p,n);p=n;}return a;}
+#endif
+cJSON *cJSON_CreateStringArray(const char **strings,int count)  {int i;cJSON *n=0,*p=0,*a=cJSON_CreateArray();for(i=0;a && i<count;i++){n=cJSON_CreateString(strings[i]);if(!n){cJSON_Delete(a);return 0;}if(!i)SET_CHILD(a,n);else suffix_object(p,n);p=n;}return a;}
 
 /* Duplication */
 cJSON *cJSON_Duplicate(cJSON *item,int recurse)
@@ -833,20 +929,23 @@ cJSON *cJSON_Duplicate(cJSON *item,int recurse)
     newitem=cJSON_New_Item();
     if (!newitem) return 0;
     /* Copy over all vars */
-    newitem->type=item->type&(~cJSON_IsReference),newitem->valueint=item->valueint,newitem->valuedouble=item->valuedouble;
-    if (item->valuestring)  {newitem->valuestring=cJSON_strdup(item->valuestring);  if (!newitem->valuestring)  {cJSON_Delete(newitem);return 0;}}
-    if (item->string)       {newitem->string=cJSON_strdup(item->string);            if (!newitem->string)       {cJSON_Delete(newitem);return 0;}}
+    newitem->type=item->type&(~cJSON_IsReference),cJSON_ValueInt(newitem)=cJSON_ValueInt(item);
+#ifndef CJSON_NO_FLOAT
+    newitem->valuedouble=item->valuedouble;
+#endif
+    if ((item->type&255)==cJSON_String && HAS_VALUESTRING(item))  {SET_VALUESTRING(newitem,cJSON_strdup(cJSON_ValueString(item)));  if (!HAS_VALUESTRING(newitem))  {cJSON_Delete(newitem);return 0;}}
+    if (HAS_NAME(item))   {SET_NAME(newitem,cJSON_strdup(cJSON_Name(item)));      if (!HAS_NAME(newitem))   {cJSON_Delete(newitem);return 0;}}
     /* If non-recursive, then we're done! */
     if (!recurse) return newitem;
     /* Walk the ->next chain for the child. */
-    cptr=item->child;
+    cptr=cJSON_Child(item);
     while (cptr)
     {
         newchild=cJSON_Duplicate(cptr,1);       /* Duplicate (with recurse) each item in the ->next chain */
         if (!newchild) {cJSON_Delete(newitem);return 0;}
-        if (nptr)   {nptr->next=newchild,newchild->prev=nptr;nptr=newchild;}    /* If newitem->child already set, then crosswire ->prev and ->next and move on */
-        else        {newitem->child=newchild;nptr=newchild;}                    /* Set newitem->child and move to it */
-        cptr=cptr->next;
+        if (nptr)   {SET_NEXT(nptr,newchild);SET_PREV(newchild,nptr);nptr=newchild;}  /* If newitem->child already set, then crosswire ->prev and ->next and move on */
+        else        {SET_CHILD(newitem,newchild);nptr=newchild;}                /* Set newitem->child and move to it */
+        cptr=cJSON_Next(cptr);
     }
     return newitem;
 }
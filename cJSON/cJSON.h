@@ -40,6 +40,41 @@ extern "C"
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
 
+/* Define CJSON_NO_FLOAT to build cJSON without any floating point: numbers are held in valueint only,
+   fractions and exponents are truncated towards zero, and valuedouble and the float/double creators go away. */
+
+/* Define CJSON_COMPACT for a smaller item: links and strings become 16-bit offsets from cJSON_CompactBase,
+   there is no prev link and a string item keeps its text where a number keeps valueint. All items and
+   strings must then come from one block of under 64KB, which cJSON_PoolInit() (cJSON_Pool.h) sets up;
+   read the links with the accessor macros below, which work for both layouts. */
+
+#ifdef CJSON_COMPACT
+typedef unsigned short cJSON_ref;
+
+/* The compact cJSON structure: */
+typedef struct cJSON {
+    cJSON_ref next;             /* next item in the array/object chain */
+    cJSON_ref child;            /* first item of an array or object */
+    cJSON_ref string;           /* the item's name string, if it is in an object */
+    unsigned short type;        /* The type of the item, as above. */
+    union {
+        int valueint;           /* The item's number, if type==cJSON_Number */
+        cJSON_ref valuestring;  /* The item's string, if type==cJSON_String */
+    } value;
+#ifndef CJSON_NO_FLOAT
+    double valuedouble;         /* The item's number, if type==cJSON_Number */
+#endif
+} cJSON;
+
+extern char *cJSON_CompactBase;
+#define cJSON_FromRef(ref)      ((ref)?(void*)(cJSON_CompactBase+(ref)):(void*)0)
+
+#define cJSON_Next(item)        ((cJSON*)cJSON_FromRef((item)->next))
+#define cJSON_Child(item)       ((cJSON*)cJSON_FromRef((item)->child))
+#define cJSON_Name(item)        ((char*)cJSON_FromRef((item)->string))
+#define cJSON_ValueString(item) ((char*)cJSON_FromRef((item)->value.valuestring))
+#define cJSON_ValueInt(item)    ((item)->value.valueint)
+#else
 /* The cJSON structure: */
 typedef struct cJSON {
     struct cJSON *next,*prev;   /* next/prev allow you to walk array/object chains. Alternatively, use GetArraySize/GetArrayItem/GetObjectItem */
@@ -49,11 +84,20 @@ typedef struct cJSON {
 
     char *valuestring;          /* The item's string, if type==cJSON_String */
     int valueint;               /* The item's number, if type==cJSON_Number */
+#ifndef CJSON_NO_FLOAT
     double valuedouble;         /* The item's number, if type==cJSON_Number */
+#endif
 
     char *string;               /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
 } cJSON;
 
+#define cJSON_Next(item)        ((item)->next)
+#define cJSON_Child(item)       ((item)->child)
+#define cJSON_Name(item)        ((item)->string)
+#define cJSON_ValueString(item) ((item)->valuestring)
+#define cJSON_ValueInt(item)    ((item)->valueint)
+#endif
+
 typedef struct cJSON_Hooks {
       void *(*malloc_fn)(size_t sz);
       void (*free_fn)(void *ptr);
@@ -61,6 +105,8 @@ typedef struct cJSON_Hooks {
 
 /* Supply malloc, realloc and free functions to cJSON */
 extern void cJSON_InitHooks(cJSON_Hooks* hooks);
+/* Supply the allocator of items alone, e.g. a pool of fixed blocks: a string may be as long as an item, so the size does not tell them apart. Items are still freed through the free hook. cJSON_InitHooks() removes it. */
+extern void cJSON_InitNodeHook(void *(*node_malloc_fn)(void));
 
 
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. Call cJSON_Delete when finished. */
@@ -89,15 +135,21 @@ extern cJSON *cJSON_CreateNull(void);
 extern cJSON *cJSON_CreateTrue(void);
 extern cJSON *cJSON_CreateFalse(void);
 extern cJSON *cJSON_CreateBool(int b);
+#ifdef CJSON_NO_FLOAT
+extern cJSON *cJSON_CreateNumber(int num);
+#else
 extern cJSON *cJSON_CreateNumber(double num);
+#endif
 extern cJSON *cJSON_CreateString(const char *string);
 extern cJSON *cJSON_CreateArray(void);
 extern cJSON *cJSON_CreateObject(void);
 
 /* These utilities create an Array of count items. */
 extern cJSON *cJSON_CreateIntArray(const int *numbers,int count);
+#ifndef CJSON_NO_FLOAT
 extern cJSON *cJSON_CreateFloatArray(const float *numbers,int count);
 extern cJSON *cJSON_CreateDoubleArray(const double *numbers,int count);
+#endif
 extern cJSON *cJSON_CreateStringArray(const char **strings,int count);
 
 /* Append item to the specified array/object. */
@@ -140,11 +192,16 @@ extern void cJSON_Minify(char *json);
 #define cJSON_AddStringToObject(object,name,s)  cJSON_AddItemToObject(object, name, cJSON_CreateString(s))
 
 /* When assigning an integer value, it needs to be propagated to valuedouble too. */
-#define cJSON_SetIntValue(object,val)           ((object)?(object)->valueint=(object)->valuedouble=(val):(val))
-#define cJSON_SetNumberValue(object,val)        ((object)?(object)->valueint=(object)->valuedouble=(val):(val))
+#ifdef CJSON_NO_FLOAT
+#define cJSON_SetIntValue(object,val)           ((object)?cJSON_ValueInt(object)=(val):(val))
+#define cJSON_SetNumberValue(object,val)        ((object)?cJSON_ValueInt(object)=(val):(val))
+#else
+#define cJSON_SetIntValue(object,val)           ((object)?cJSON_ValueInt(object)=(object)->valuedouble=(val):(val))
+#define cJSON_SetNumberValue(object,val)        ((object)?cJSON_ValueInt(object)=(object)->valuedouble=(val):(val))
+#endif
 
 /* Macro for iterating over an array */
-#define cJSON_ArrayForEach(pos, head)           for(pos = (head)->child; pos != NULL; pos = pos->next)
+#define cJSON_ArrayForEach(pos, head)           for(pos = cJSON_Child(head); pos != NULL; pos = cJSON_Next(pos))
 
 #ifdef __cplusplus
 }
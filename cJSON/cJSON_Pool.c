@@ -0,0 +1,108 @@
+/* cJSON_Pool */
+/* Fixed-block node pool and bump arena for cJSON, installed through cJSON_InitHooks and cJSON_InitNodeHook. */
+
+#include <stddef.h>
+#include "cJSON.h"
+#include "cJSON_Pool.h"
+
+#define POOL_ALIGN      (sizeof(void*))
+
+typedef union pool_node {
+    union pool_node *next;              /* free list link while the block is unused */
+    cJSON item;
+} pool_node;
+
+/* One block, so that a CJSON_COMPACT build can address every item and string with a 16-bit offset. */
+static struct {
+#ifdef CJSON_COMPACT
+    union { char bytes[POOL_ALIGN]; void *align; } guard;   /* keeps offset 0 free for the null reference */
+#endif
+    pool_node nodes[CJSON_POOL_NODES];
+    union { char bytes[CJSON_POOL_ARENA_SIZE]; void *align; } arena;
+} pool;
+#ifdef CJSON_COMPACT
+typedef char pool_fits_cJSON_ref[(sizeof(pool)<=0xFFFF)?1:-1];
+#endif
+
+static pool_node *freeList;             /* blocks returned by cJSON_Delete() */
+static unsigned short nodesFresh;       /* blocks never handed out since the last reset */
+
+static unsigned short arenaTop;         /* next free arena byte */
+static unsigned short arenaLast;        /* start of the most recent arena block, for LIFO free */
+
+static cJSON_PoolStats stats;
+
+static void *pool_node_malloc(void)
+{
+    pool_node *node;
+
+    if (freeList) {node=freeList;freeList=node->next;}
+    else if (nodesFresh < CJSON_POOL_NODES) node=&pool.nodes[nodesFresh++];
+    else {stats.failures++;return 0;}
+    if (++stats.nodesUsed > stats.nodesPeak) stats.nodesPeak=stats.nodesUsed;
+    return node;
+}
+
+/* Strings and print buffers, whatever their size. */
+static void *pool_malloc(size_t sz)
+{
+    size_t size;
+
+    size=(sz+POOL_ALIGN-1)&~(POOL_ALIGN-1);
+    if (size > (size_t)(CJSON_POOL_ARENA_SIZE-arenaTop)) {stats.failures++;return 0;}
+    arenaLast=arenaTop;
+    arenaTop+=(unsigned short)size;
+    stats.arenaUsed=arenaTop;
+    if (arenaTop > stats.arenaPeak) stats.arenaPeak=arenaTop;
+    return pool.arena.bytes+arenaLast;
+}
+
+static void pool_free(void *ptr)
+{
+    char *p=(char*)ptr;
+
+    if (p >= (char*)pool.nodes && p < (char*)(pool.nodes+CJSON_POOL_NODES))
+    {
+        ((pool_node*)p)->next=freeList;
+        freeList=(pool_node*)p;
+        stats.nodesUsed--;
+    }
+    else if (p == pool.arena.bytes+arenaLast && arenaLast < arenaTop)
+    {
+        /* Only the newest block can be handed back; the rest waits for cJSON_PoolReset(). */
+        arenaTop=arenaLast;
+        stats.arenaUsed=arenaTop;
+    }
+}
+
+void cJSON_PoolReset(void)
+{
+    freeList=0;
+    nodesFresh=0;
+    arenaTop=arenaLast=0;
+    stats.leaks+=stats.nodesUsed;
+    stats.nodesUsed=0;
+    stats.arenaUsed=0;
+}
+
+void cJSON_PoolInit(void)
+{
+    cJSON_Hooks hooks;
+
+    cJSON_PoolReset();
+#ifdef CJSON_COMPACT
+    cJSON_CompactBase=(char*)&pool;
+#endif
+    stats.nodesPeak=stats.arenaPeak=0;
+    stats.failures=0;
+    stats.leaks=0;
+    hooks.malloc_fn=pool_malloc;
+    hooks.free_fn=pool_free;
+    cJSON_InitHooks(&hooks);
+    cJSON_InitNodeHook(pool_node_malloc);
+}
+
+void cJSON_PoolGetStats(cJSON_PoolStats *out)
+{
+    if (out) *out=stats;
+}
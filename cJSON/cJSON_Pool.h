@@ -0,0 +1,43 @@
+#ifndef cJSON_Pool__h
+#define cJSON_Pool__h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Static allocator for cJSON: a fixed-size block pool for cJSON nodes plus a bump
+   arena for strings and print buffers. Install it with cJSON_PoolInit() and call
+   cJSON_PoolReset() before every message; everything handed out since the last
+   reset is released at once, so the heap is never touched and cannot fragment.
+   A CJSON_COMPACT build of cJSON needs this allocator: nodes and arena share one
+   static block and cJSON_PoolInit() makes it the base of the 16-bit references. */
+
+#ifndef CJSON_POOL_NODES
+#define CJSON_POOL_NODES        (16)    /* cJSON items per message */
+#endif
+#ifndef CJSON_POOL_ARENA_SIZE
+#define CJSON_POOL_ARENA_SIZE   (256)   /* bytes of strings per message */
+#endif
+
+typedef struct cJSON_PoolStats {
+    unsigned short nodesUsed;           /* nodes currently handed out */
+    unsigned short nodesPeak;           /* most nodes handed out since cJSON_PoolInit() */
+    unsigned short arenaUsed;           /* arena bytes currently in use */
+    unsigned short arenaPeak;           /* most arena bytes in use since cJSON_PoolInit() */
+    unsigned long  failures;            /* allocations refused because the pool or arena was full */
+    unsigned long  leaks;               /* nodes still handed out at a cJSON_PoolReset(), trees never deleted */
+} cJSON_PoolStats;
+
+/* Reset the pool and install it as the cJSON allocator (via cJSON_InitHooks). */
+extern void cJSON_PoolInit(void);
+/* Release every node and string at once. Items parsed before the reset must not be used afterwards. */
+extern void cJSON_PoolReset(void);
+/* Copy out the current usage counters. */
+extern void cJSON_PoolGetStats(cJSON_PoolStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+/* cJSON_Schema */
+/* Single pass decoding of flat JSON objects into structs through a perfect hash of member names. */
+
+#include <string.h>
+#include <stdbool.h>
+#include "cJSON_Schema.h"
+
+unsigned cJSON_SchemaHash(const char *name,unsigned seed)
+{
+    unsigned long h=(2166136261UL^seed)&0xFFFFFFFFUL;     /* FNV-1a, seeded */
+    while (*name) {h^=(unsigned char)*name++;h=(h*16777619UL)&0xFFFFFFFFUL;}
+    return (unsigned)((h^(h>>16))&0xFFFF);
+}
+
+int cJSON_SchemaLookup(const cJSON_Schema *schema,const char *name)
+{
+    int i=schema->table[cJSON_SchemaHash(name,schema->seed)&((1u<<schema->bits)-1)]-1;
+    if (i<0 || strcmp(schema->fields[i].name,name)) return -1;
+    return i;
+}
+
+int cJSON_SchemaCheck(const cJSON_Schema *schema)
+{
+    int i;
+    if (schema->count>31 || schema->count>(1<<schema->bits)) return -1;
+    for (i=0;i<schema->count;i++) if (cJSON_SchemaLookup(schema,schema->fields[i].name)!=i) return -1;
+    return 0;
+}
+
+/* Store one member; returns 0 or an error code. */
+static int store(const cJSON_Schema *schema,void *out,long *present,const char *name,int type,const char *valuestring,int valueint)
+{
+    const cJSON_SchemaField *f;
+    char *slot;
+    size_t len;
+    int on;
+    int i=cJSON_SchemaLookup(schema,name);
+
+    if (i<0) return (schema->flags&CJSON_SCHEMA_ALLOW_UNKNOWN)?0:CJSON_SCHEMA_ERR_UNKNOWN;
+    if (type==cJSON_NULL) return 0;     /* same as absent */
+    f=&schema->fields[i];
+    on=(type==cJSON_True);
+    if (type==cJSON_False) type=cJSON_True;
+    if (type!=f->type) return CJSON_SCHEMA_ERR_TYPE;
+    slot=(char*)out+f->offset;
+    switch (type)
+    {
+        case cJSON_String:
+            len=strlen(valuestring);
+            if (len>=f->size) return CJSON_SCHEMA_ERR_SIZE;
+            memcpy(slot,valuestring,len+1);
+            break;
+        case cJSON_True:        /* the type, a created true has no valueint */
+            if (f->size==sizeof(bool)) *(bool*)slot=on;
+            else if (f->size==sizeof(int)) *(int*)slot=on;
+            else return CJSON_SCHEMA_ERR_SIZE;
+            break;
+        default:
+            if (f->size!=sizeof(int)) return CJSON_SCHEMA_ERR_SIZE;
+            *(int*)slot=valueint;
+            break;
+    }
+    *present|=1L<<i;
+    return 0;
+}
+
+static long finish(const cJSON_Schema *schema,long present)
+{
+    int i;
+    for (i=0;i<schema->count;i++)
+        if ((schema->fields[i].flags&CJSON_SCHEMA_REQUIRED) && !(present&(1L<<i))) return CJSON_SCHEMA_ERR_MISSING;
+    return present;
+}
+
+void cJSON_SchemaBegin(cJSON_SchemaDecoder *d,const cJSON_Schema *schema,void *out)
+{
+    d->schema=schema;
+    d->out=out;
+    d->present=0;
+    d->error=CJSON_SCHEMA_ERR_SYNTAX;   /* until the top level object opens */
+}
+
+void cJSON_SchemaHandler(void *ctx,const cJSON_StreamEvent *event)
+{
+    cJSON_SchemaDecoder *d=(cJSON_SchemaDecoder*)ctx;
+    int type=event->type&255;
+
+    if (event->depth==0)
+    {
+        if (event->type==cJSON_Object) d->error=0;
+        return;
+    }
+    if (event->depth>1 || d->error || (event->type&cJSON_StreamClose)) return;
+    if (event->cut&CJSON_STREAM_CUT_NAME)
+    {
+        /* Longer than any field name the stream keeps, so not in the schema. */
+        if (!(d->schema->flags&CJSON_SCHEMA_ALLOW_UNKNOWN)) d->error=CJSON_SCHEMA_ERR_UNKNOWN;
+        return;
+    }
+    if (type==cJSON_Object || type==cJSON_Array)
+    {
+        /* Nested values are never part of a schema; skip them if unknown members are allowed. */
+        if (cJSON_SchemaLookup(d->schema,event->string)>=0) d->error=CJSON_SCHEMA_ERR_TYPE;
+        else if (!(d->schema->flags&CJSON_SCHEMA_ALLOW_UNKNOWN)) d->error=CJSON_SCHEMA_ERR_UNKNOWN;
+        return;
+    }
+    if ((event->cut&CJSON_STREAM_CUT_VALUE) && type==cJSON_String && cJSON_SchemaLookup(d->schema,event->string)>=0)
+    {
+        d->error=CJSON_SCHEMA_ERR_SIZE;     /* only its start was kept */
+        return;
+    }
+    d->error=store(d->schema,d->out,&d->present,event->string,type,event->valuestring,event->valueint);
+}
+
+long cJSON_SchemaEnd(cJSON_SchemaDecoder *d)
+{
+    if (d->error) return d->error;
+    return finish(d->schema,d->present);
+}
+
+long cJSON_SchemaDecode(const cJSON_Schema *schema,const char *text,int len,void *out)
+{
+    cJSON_Stream stream;
+    cJSON_SchemaDecoder d;
+
+    cJSON_SchemaBegin(&d,schema,out);
+    cJSON_StreamInit(&stream,cJSON_SchemaHandler,&d);
+    if (cJSON_StreamFeed(&stream,text,len)!=CJSON_STREAM_DONE) return CJSON_SCHEMA_ERR_SYNTAX;
+    return cJSON_SchemaEnd(&d);
+}
+
+long cJSON_SchemaDecodeItem(const cJSON_Schema *schema,cJSON *object,void *out)
+{
+    cJSON *c;
+    long present=0;
+    int err,type;
+
+    if (!object || (object->type&255)!=cJSON_Object) return CJSON_SCHEMA_ERR_SYNTAX;
+    for (c=cJSON_Child(object);c;c=cJSON_Next(c))
+    {
+        type=c->type&255;
+        if (type==cJSON_Object || type==cJSON_Array)
+        {
+            if (cJSON_SchemaLookup(schema,cJSON_Name(c))>=0) return CJSON_SCHEMA_ERR_TYPE;
+            if (!(schema->flags&CJSON_SCHEMA_ALLOW_UNKNOWN)) return CJSON_SCHEMA_ERR_UNKNOWN;
+            continue;
+        }
+        err=store(schema,out,&present,cJSON_Name(c),type,(type==cJSON_String)?cJSON_ValueString(c):0,(type==cJSON_String)?0:cJSON_ValueInt(c));
+        if (err) return err;
+    }
+    return finish(schema,present);
+}
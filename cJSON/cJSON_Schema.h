@@ -0,0 +1,84 @@
+#ifndef cJSON_Schema__h
+#define cJSON_Schema__h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include "cJSON.h"
+#include "cJSON_Stream.h"
+
+/* Compile-time message schemas. A schema lists the members of a flat JSON object and the
+   struct slot each one is decoded into. Member names are mapped to fields with a perfect
+   hash whose seed and table are generated by tools/schema_gen, so a lookup is one hash and
+   one strcmp; unknown, missing or mistyped members are rejected while decoding. Name
+   matching is case sensitive, unlike cJSON_GetObjectItem(). Field names must be shorter than
+   CJSON_STREAM_KEY_SIZE, unknown members of any length are skipped when allowed. */
+
+/* cJSON_SchemaField.flags */
+#define CJSON_SCHEMA_REQUIRED       (1<<0)
+
+/* cJSON_Schema.flags */
+#define CJSON_SCHEMA_ALLOW_UNKNOWN  (1<<0)  /* skip members that are not in the schema instead of failing */
+
+/* Decode errors, the decode functions return a bit mask of the fields found otherwise. */
+#define CJSON_SCHEMA_ERR_SYNTAX     (-1)    /* not JSON, or not an object */
+#define CJSON_SCHEMA_ERR_UNKNOWN    (-2)    /* member not in the schema */
+#define CJSON_SCHEMA_ERR_TYPE       (-3)    /* member has the wrong type */
+#define CJSON_SCHEMA_ERR_SIZE       (-4)    /* string longer than its slot, or a slot of the wrong size */
+#define CJSON_SCHEMA_ERR_MISSING    (-5)    /* required member absent */
+
+typedef struct cJSON_SchemaField {
+    const char *name;
+    unsigned char type;         /* cJSON_Number (int slots), cJSON_True (bool or int slots), cJSON_String (char array slots) */
+    unsigned char flags;
+    unsigned short offset;      /* offset of the slot in the decoded struct */
+    unsigned short size;        /* size of the slot */
+} cJSON_SchemaField;
+
+typedef struct cJSON_Schema {
+    const cJSON_SchemaField *fields;
+    unsigned char count;        /* at most 31 fields */
+    unsigned char flags;
+    unsigned char seed;         /* perfect hash seed, from tools/schema_gen */
+    unsigned char bits;         /* log2 of the hash table size */
+    const unsigned char *table; /* hash -> field index + 1, 0 for an empty slot */
+} cJSON_Schema;
+
+/* Field declarations for a struct type st. */
+#define CJSON_SCHEMA_INT(st,member,name,flags)      {name,cJSON_Number,flags,(unsigned short)offsetof(st,member),(unsigned short)sizeof(((st*)0)->member)}
+#define CJSON_SCHEMA_BOOL(st,member,name,flags)     {name,cJSON_True,flags,(unsigned short)offsetof(st,member),(unsigned short)sizeof(((st*)0)->member)}
+#define CJSON_SCHEMA_STRING(st,member,name,flags)   {name,cJSON_String,flags,(unsigned short)offsetof(st,member),(unsigned short)sizeof(((st*)0)->member)}
+
+/* State for decoding a schema from cJSON_Stream events. */
+typedef struct cJSON_SchemaDecoder {
+    const cJSON_Schema *schema;
+    void *out;
+    long present;               /* bit n set when fields[n] was decoded */
+    int error;
+} cJSON_SchemaDecoder;
+
+/* The hash shared by the decoder and tools/schema_gen. */
+extern unsigned cJSON_SchemaHash(const char *name,unsigned seed);
+/* Returns 0 if the hash table of schema is perfect for its fields, -1 if it has to be regenerated. */
+extern int cJSON_SchemaCheck(const cJSON_Schema *schema);
+/* Field index of name, or -1. */
+extern int cJSON_SchemaLookup(const cJSON_Schema *schema,const char *name);
+
+/* Streaming decode: pass cJSON_SchemaHandler and the decoder to cJSON_StreamInit(), feed the text, then call cJSON_SchemaEnd(). */
+extern void cJSON_SchemaBegin(cJSON_SchemaDecoder *decoder,const cJSON_Schema *schema,void *out);
+extern void cJSON_SchemaHandler(void *ctx,const cJSON_StreamEvent *event);
+extern long cJSON_SchemaEnd(cJSON_SchemaDecoder *decoder);
+
+/* Decode len bytes of text into out in one call. Returns the mask of fields found, or a CJSON_SCHEMA_ERR_* code. */
+extern long cJSON_SchemaDecode(const cJSON_Schema *schema,const char *text,int len,void *out);
+/* Same for an already parsed object. */
+extern long cJSON_SchemaDecodeItem(const cJSON_Schema *schema,cJSON *object,void *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,299 @@
+/* cJSON_Stream */
+/* Resumable push parser: text arrives in fragments, values are reported through a handler. */
+
+#include <limits.h>
+#include "cJSON_Stream.h"
+
+enum {
+    ST_VALUE,           /* expecting a value */
+    ST_VALUE_OR_CLOSE,  /* after '[' */
+    ST_KEY_OR_CLOSE,    /* after '{' */
+    ST_KEY,             /* after ',' inside an object */
+    ST_IN_KEY,
+    ST_COLON,
+    ST_IN_STRING,
+    ST_IN_NUMBER,
+    ST_IN_LITERAL,
+    ST_NEXT,            /* after a value: ',' or the end of the container */
+    ST_DONE,
+    ST_ERROR
+};
+
+/* Escape handling inside strings (cJSON_Stream.sub). */
+#define ESC_NONE    0
+#define ESC_START   1   /* after '\' */
+#define ESC_HEX     2   /* 2..5: hex digits of a \u escape */
+#define ESC_LOW_BS  6   /* high surrogate seen, expecting '\' */
+#define ESC_LOW_U   7   /* expecting 'u' */
+#define ESC_LOW_HEX 8   /* 8..11: hex digits of the low surrogate */
+
+static const unsigned char firstByteMark[5] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0 };
+
+static int hex_value(char c)
+{
+    if (c>='0' && c<='9') return c-'0';
+    if (c>='A' && c<='F') return c-'A'+10;
+    if (c>='a' && c<='f') return c-'a'+10;
+    return -1;
+}
+
+static int in_object(const cJSON_Stream *s) {return s->depth && ((s->objects>>(s->depth-1))&1);}
+
+/* Append a byte to the name or value being collected, bytes past its buffer are dropped. */
+static int put_char(cJSON_Stream *s,char c)
+{
+    if (s->state==ST_IN_KEY)
+    {
+        if (s->keyLen >= CJSON_STREAM_KEY_SIZE-1) s->cut|=CJSON_STREAM_CUT_NAME;
+        else s->key[s->keyLen++]=c;
+    }
+    else
+    {
+        if (s->tokenLen >= CJSON_STREAM_TOKEN_SIZE-1) s->cut|=CJSON_STREAM_CUT_VALUE;
+        else s->token[s->tokenLen++]=c;
+    }
+    return 1;
+}
+
+/* Append a code point as utf8. */
+static int put_utf8(cJSON_Stream *s,unsigned long uc)
+{
+    char out[4];int len,i;
+    len=4;if (uc<0x80) len=1;else if (uc<0x800) len=2;else if (uc<0x10000) len=3;
+    for (i=len-1;i>0;i--) {out[i]=(char)((uc | 0x80) & 0xBF);uc>>=6;}
+    out[0]=(char)(uc | firstByteMark[len]);
+    for (i=0;i<len;i++) if (!put_char(s,out[i])) return 0;
+    return 1;
+}
+
+/* Strict JSON number grammar, cJSON's parse_number() is more lenient but we can't rewind here.
+   A number cut to the token buffer is only checked as far as it was kept. */
+static int number_valid(const char *p,int cut)
+{
+    if (*p=='-') p++;
+    if (*p=='0') p++;
+    else if (*p>='1' && *p<='9') while (*p>='0' && *p<='9') p++;
+    else return 0;
+    if (*p=='.') {p++;if (cut && !*p) return 1;if (!(*p>='0' && *p<='9')) return 0;while (*p>='0' && *p<='9') p++;}
+    if (*p=='e' || *p=='E')
+    {
+        p++;if (*p=='+' || *p=='-') p++;
+        if (cut && !*p) return 1;
+        if (!(*p>='0' && *p<='9')) return 0;
+        while (*p>='0' && *p<='9') p++;
+    }
+    return *p==0;
+}
+
+/* Integer part of a validated number, saturated to the int range. */
+static int number_int(const char *p)
+{
+    unsigned long v=0,limit;int neg=0,d;
+    if (*p=='-') neg=1,p++;
+    limit=neg?(unsigned long)INT_MAX+1:(unsigned long)INT_MAX;
+    while (*p>='0' && *p<='9')
+    {
+        d=*p++ -'0';
+        if (v>(limit-d)/10) {v=limit;break;}    /* before v*10 wraps a 32-bit unsigned long */
+        v=v*10+d;
+    }
+    if (neg) return (v>(unsigned long)INT_MAX)?INT_MIN:-(int)v;
+    return (int)v;
+}
+
+static void emit(cJSON_Stream *s,int type,int depth,const char *valuestring,int valueint)
+{
+    cJSON_StreamEvent ev;
+    ev.type=type;
+    ev.depth=depth;
+    ev.string=(!(type&cJSON_StreamClose) && in_object(s))?s->key:0;
+    ev.valuestring=valuestring;
+    ev.valueint=valueint;
+    ev.cut=ev.string?s->cut:(s->cut&CJSON_STREAM_CUT_VALUE);
+    if (s->handler) s->handler(s->ctx,&ev);
+}
+
+/* A scalar has been completed at the current depth. */
+static void value_done(cJSON_Stream *s,int type,const char *valuestring,int valueint)
+{
+    emit(s,type,s->depth,valuestring,valueint);
+    s->state=s->depth?ST_NEXT:ST_DONE;
+}
+
+static int open_container(cJSON_Stream *s,int type)
+{
+    if (s->depth>=CJSON_STREAM_MAX_DEPTH) return 0;
+    emit(s,type,s->depth,0,0);
+    if (type==cJSON_Object) s->objects|=1UL<<s->depth;
+    else s->objects&=~(1UL<<s->depth);
+    s->depth++;
+    s->state=(type==cJSON_Object)?ST_KEY_OR_CLOSE:ST_VALUE_OR_CLOSE;
+    return 1;
+}
+
+static int close_container(cJSON_Stream *s,char c)
+{
+    int type=in_object(s)?cJSON_Object:cJSON_Array;
+    if (c!=((type==cJSON_Object)?'}':']')) return 0;
+    s->depth--;
+    emit(s,type|cJSON_StreamClose,s->depth,0,0);
+    s->state=s->depth?ST_NEXT:ST_DONE;
+    return 1;
+}
+
+/* First character of a value; 0 if it can't start one. */
+static int begin_value(cJSON_Stream *s,char c)
+{
+    s->cut&=~CJSON_STREAM_CUT_VALUE;
+    switch (c)
+    {
+        case '{':   return open_container(s,cJSON_Object);
+        case '[':   return open_container(s,cJSON_Array);
+        case '\"':  s->state=ST_IN_STRING;s->sub=ESC_NONE;s->tokenLen=0;return 1;
+        case 't':   s->literal="true";break;
+        case 'f':   s->literal="false";break;
+        case 'n':   s->literal="null";break;
+        default:
+            if (c=='-' || (c>='0' && c<='9')) {s->state=ST_IN_NUMBER;s->token[0]=c;s->tokenLen=1;return 1;}
+            return 0;
+    }
+    s->state=ST_IN_LITERAL;s->sub=1;
+    return 1;
+}
+
+/* One character inside a name or string value; 0 on error. */
+static int string_char(cJSON_Stream *s,char c)
+{
+    int h;
+    switch (s->sub)
+    {
+        case ESC_NONE:
+            if (c=='\\') {s->sub=ESC_START;return 1;}
+            if (c!='\"') return put_char(s,c);
+            if (s->state==ST_IN_KEY) {s->key[s->keyLen]=0;s->state=ST_COLON;return 1;}
+            s->token[s->tokenLen]=0;
+            value_done(s,cJSON_String,s->token,0);
+            return 1;
+        case ESC_START:
+            s->sub=ESC_NONE;
+            switch (c)
+            {
+                case 'b': return put_char(s,'\b');
+                case 'f': return put_char(s,'\f');
+                case 'n': return put_char(s,'\n');
+                case 'r': return put_char(s,'\r');
+                case 't': return put_char(s,'\t');
+                case 'u': s->uc=0;s->sub=ESC_HEX;return 1;
+                default:  return put_char(s,c);
+            }
+        case ESC_LOW_BS:
+            if (c!='\\') return 0;  /* missing second-half of surrogate. */
+            s->sub=ESC_LOW_U;return 1;
+        case ESC_LOW_U:
+            if (c!='u') return 0;
+            s->sub=ESC_LOW_HEX;return 1;
+        default:                    /* hex digits */
+            if ((h=hex_value(c))<0) return 0;
+            if (s->sub<ESC_LOW_BS)
+            {
+                s->uc=(s->uc<<4)|h;
+                if (++s->sub<ESC_LOW_BS) return 1;
+                if ((s->uc>=0xDC00 && s->uc<=0xDFFF) || s->uc==0) return 0;
+                if (s->uc>=0xD800 && s->uc<=0xDBFF) {s->uc=(s->uc&0x3FF)<<16;return 1;}  /* sub is ESC_LOW_BS now */
+                s->sub=ESC_NONE;
+                return put_utf8(s,s->uc);
+            }
+            s->uc=(s->uc&0xFFFF0000UL)|(((s->uc&0xFFFF)<<4)|h);
+            if (++s->sub<ESC_LOW_HEX+4) return 1;
+            if ((s->uc&0xFFFF)<0xDC00 || (s->uc&0xFFFF)>0xDFFF) return 0;
+            s->sub=ESC_NONE;
+            return put_utf8(s,0x10000 + (((s->uc>>16)<<10) | (s->uc&0x3FF)));
+    }
+}
+
+static int number_done(cJSON_Stream *s)
+{
+    s->token[s->tokenLen]=0;
+    if (!number_valid(s->token,s->cut&CJSON_STREAM_CUT_VALUE)) return 0;
+    value_done(s,cJSON_Number,s->token,number_int(s->token));
+    return 1;
+}
+
+void cJSON_StreamInit(cJSON_Stream *s,cJSON_StreamHandler handler,void *ctx)
+{
+    s->handler=handler;
+    s->ctx=ctx;
+    s->state=ST_VALUE;
+    s->depth=0;
+    s->sub=0;
+    s->keyLen=0;
+    s->cut=0;
+    s->tokenLen=0;
+    s->objects=0;
+    s->uc=0;
+    s->literal=0;
+    s->key[0]=0;
+}
+
+static int status(const cJSON_Stream *s)
+{
+    if (s->state==ST_ERROR) return CJSON_STREAM_ERROR;
+    return (s->state==ST_DONE)?CJSON_STREAM_DONE:CJSON_STREAM_MORE;
+}
+
+int cJSON_StreamConsume(cJSON_Stream *s,const char *text,int len,int *used)
+{
+    int i=0,ok;
+    char c;
+
+    while (i<len && s->state<ST_DONE)
+    {
+        c=text[i];
+        if (s->state<=ST_KEY || s->state==ST_COLON || s->state==ST_NEXT)
+            if ((unsigned char)c<=32) {i++;continue;}
+        switch (s->state)
+        {
+            case ST_VALUE_OR_CLOSE: ok=(c==']')?close_container(s,c):begin_value(s,c);break;
+            case ST_VALUE:          ok=begin_value(s,c);break;
+            case ST_KEY_OR_CLOSE:   if (c=='}') {ok=close_container(s,c);break;}   /* fall through */
+            case ST_KEY:            ok=(c=='\"');s->state=ST_IN_KEY;s->sub=ESC_NONE;s->keyLen=0;s->cut=0;break;
+            case ST_COLON:          ok=(c==':');s->state=ST_VALUE;break;
+            case ST_IN_KEY:
+            case ST_IN_STRING:      ok=string_char(s,c);break;
+            case ST_IN_LITERAL:
+                ok=(c==s->literal[s->sub]);
+                if (ok && !s->literal[++s->sub])
+                    value_done(s,(s->literal[0]=='t')?cJSON_True:(s->literal[0]=='f')?cJSON_False:cJSON_NULL,0,s->literal[0]=='t');
+                break;
+            case ST_IN_NUMBER:
+                if ((c>='0' && c<='9') || c=='.' || c=='e' || c=='E' || c=='+' || c=='-') ok=put_char(s,c);
+                else if (!number_done(s)) ok=0;
+                else continue;      /* c ends the number, look at it again */
+                break;
+            default:                /* ST_NEXT */
+                if (c==',') {ok=1;s->state=in_object(s)?ST_KEY:ST_VALUE;}
+                else ok=close_container(s,c);
+                break;
+        }
+        if (!ok) s->state=ST_ERROR;
+        i++;
+    }
+    *used=i;
+    return status(s);
+}
+
+int cJSON_StreamFeed(cJSON_Stream *s,const char *text,int len)
+{
+    int i;
+
+    cJSON_StreamConsume(s,text,len,&i);
+    /* Only whitespace may follow a complete value. */
+    for (;i<len && s->state==ST_DONE;i++) if ((unsigned char)text[i]>32) s->state=ST_ERROR;
+    return status(s);
+}
+
+int cJSON_StreamFinish(cJSON_Stream *s)
+{
+    if (s->state==ST_IN_NUMBER && s->depth==0 && !number_done(s)) s->state=ST_ERROR;
+    return (s->state==ST_DONE)?CJSON_STREAM_DONE:(s->state==ST_ERROR)?CJSON_STREAM_ERROR:CJSON_STREAM_MORE;
+}
@@ -0,0 +1,78 @@
+#ifndef cJSON_Stream__h
+#define cJSON_Stream__h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include "cJSON.h"
+
+/* Push-style (SAX) JSON parser. Text is fed in fragments of any size with cJSON_StreamFeed();
+   the parser keeps its state between calls and reports every value to a handler as soon as it
+   is complete, so a message never has to be held in RAM as a whole. Only the current member
+   name and the current scalar are buffered; a longer one is cut to its buffer and flagged in
+   cJSON_StreamEvent.cut, so members nobody reads may be of any length. */
+
+#ifndef CJSON_STREAM_KEY_SIZE
+#define CJSON_STREAM_KEY_SIZE       (16)    /* longest member name kept + 1 */
+#endif
+#ifndef CJSON_STREAM_TOKEN_SIZE
+#define CJSON_STREAM_TOKEN_SIZE     (48)    /* longest string or number value kept + 1 */
+#endif
+#define CJSON_STREAM_MAX_DEPTH      (32)
+
+/* cJSON_StreamFeed() results */
+#define CJSON_STREAM_MORE           (0)     /* value not complete yet, feed more text */
+#define CJSON_STREAM_DONE           (1)     /* top level value complete */
+#define CJSON_STREAM_ERROR          (-1)    /* malformed text */
+
+/* cJSON_StreamEvent.cut */
+#define CJSON_STREAM_CUT_NAME       (1)     /* string holds only the start of the member name */
+#define CJSON_STREAM_CUT_VALUE      (2)     /* valuestring holds only the start of the value */
+
+/* Set in cJSON_StreamEvent.type when an object or array is closed. */
+#define cJSON_StreamClose           1024
+
+typedef struct cJSON_StreamEvent {
+    int type;                   /* cJSON_Object/cJSON_Array when opened (with cJSON_StreamClose when closed), else the value type */
+    int depth;                  /* 0 for the top level value, 1 for its members, ... */
+    const char *string;         /* member name if the value is inside an object, otherwise 0 */
+    const char *valuestring;    /* unescaped text of a string, raw text of a number, otherwise 0 */
+    int valueint;               /* integer part of a number, 1 for true */
+    int cut;                    /* CJSON_STREAM_CUT_* of a name or value longer than its buffer */
+} cJSON_StreamEvent;
+
+typedef void (*cJSON_StreamHandler)(void *ctx,const cJSON_StreamEvent *event);
+
+typedef struct cJSON_Stream {
+    cJSON_StreamHandler handler;
+    void *ctx;
+    unsigned char state;
+    unsigned char depth;
+    unsigned char sub;          /* position inside an escape sequence or a literal */
+    unsigned char keyLen;
+    unsigned char cut;          /* CJSON_STREAM_CUT_* of the current name and value */
+    unsigned short tokenLen;
+    unsigned long objects;      /* bit n set: level n+1 is an object, clear: an array */
+    unsigned long uc;           /* code point of a \u escape being decoded */
+    const char *literal;        /* "true", "false" or "null" while one is being matched */
+    char key[CJSON_STREAM_KEY_SIZE];
+    char token[CJSON_STREAM_TOKEN_SIZE];
+} cJSON_Stream;
+
+/* Prepare a parser for a new top level value. */
+extern void cJSON_StreamInit(cJSON_Stream *stream,cJSON_StreamHandler handler,void *ctx);
+/* Consume len bytes of text. Returns CJSON_STREAM_MORE, CJSON_STREAM_DONE or CJSON_STREAM_ERROR; once done or failed, further text is ignored (trailing whitespace is accepted). */
+extern int cJSON_StreamFeed(cJSON_Stream *stream,const char *text,int len);
+/* Like cJSON_StreamFeed() but stops at the end of the top level value and leaves what follows to the caller, for texts sent back to back. *used is set to the bytes consumed. */
+extern int cJSON_StreamConsume(cJSON_Stream *stream,const char *text,int len,int *used);
+/* Signal end of input, which completes a top level number. Returns CJSON_STREAM_DONE if a whole value was parsed. */
+extern int cJSON_StreamFinish(cJSON_Stream *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
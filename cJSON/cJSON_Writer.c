@@ -0,0 +1,151 @@
+/* cJSON_Writer */
+/* Allocation free JSON output into a fixed buffer or through a flush callback. */
+
+#include "cJSON_Writer.h"
+
+static const char hexDigits[]="0123456789ABCDEF";
+static const char escapeDigits[]="0123456789abcdef";   /* \u00xx like print_string_ptr() in cJSON.c */
+
+static int in_object(const cJSON_Writer *w) {return w->depth && ((w->objects>>(w->depth-1))&1);}
+
+static void put_char(cJSON_Writer *w,char c)
+{
+    if (w->error) return;
+    if (w->len>=w->size-(w->flush?0:1))
+    {
+        if (!w->flush) {w->error=1;return;}
+        w->flush(w->ctx,w->buf,w->len);
+        w->len=0;
+    }
+    w->buf[w->len++]=c;
+    w->total++;
+}
+
+static void put_string(cJSON_Writer *w,const char *str)
+{
+    while (*str && !w->error) put_char(w,*str++);
+}
+
+/* Quoted and escaped, the same escapes as cJSON's print_string_ptr(). */
+static void put_quoted(cJSON_Writer *w,const char *str)
+{
+    unsigned char c;
+    put_char(w,'\"');
+    while ((c=(unsigned char)*str++)!=0 && !w->error)
+    {
+        if (c>31 && c!='\"' && c!='\\') {put_char(w,(char)c);continue;}
+        put_char(w,'\\');
+        switch (c)
+        {
+            case '\\':  put_char(w,'\\');break;
+            case '\"':  put_char(w,'\"');break;
+            case '\b':  put_char(w,'b');break;
+            case '\f':  put_char(w,'f');break;
+            case '\n':  put_char(w,'n');break;
+            case '\r':  put_char(w,'r');break;
+            case '\t':  put_char(w,'t');break;
+            default:    put_string(w,"u00");put_char(w,escapeDigits[c>>4]);put_char(w,escapeDigits[c&15]);break;
+        }
+    }
+    put_char(w,'\"');
+}
+
+/* Separator before a value; 0 if a value is not allowed here. */
+static int begin_value(cJSON_Writer *w)
+{
+    if (w->error) return 0;
+    if (w->key) w->key=0;
+    else if (in_object(w) || (!w->depth && w->total)) {w->error=1;return 0;}   /* member without a name, or a second top level value */
+    else if (w->depth && ((w->members>>(w->depth-1))&1)) put_char(w,',');
+    if (w->depth) w->members|=1UL<<(w->depth-1);
+    return 1;
+}
+
+static void open_container(cJSON_Writer *w,int object)
+{
+    if (w->depth>=CJSON_WRITER_MAX_DEPTH) w->error=1;
+    if (!begin_value(w)) return;
+    put_char(w,object?'{':'[');
+    if (object) w->objects|=1UL<<w->depth;
+    else w->objects&=~(1UL<<w->depth);
+    w->members&=~(1UL<<w->depth);
+    w->depth++;
+}
+
+static void close_container(cJSON_Writer *w,int object)
+{
+    if (w->error) return;
+    if (!w->depth || w->key || in_object(w)!=object) {w->error=1;return;}
+    w->depth--;
+    put_char(w,object?'}':']');
+}
+
+void cJSON_WriterInitFlush(cJSON_Writer *w,char *buf,int size,cJSON_WriterFlush flush,void *ctx)
+{
+    w->buf=buf;
+    w->size=size;
+    w->len=0;
+    w->total=0;
+    w->flush=flush;
+    w->ctx=ctx;
+    w->depth=0;
+    w->key=0;
+    w->error=(size<1);
+    w->objects=0;
+    w->members=0;
+}
+
+void cJSON_WriterInit(cJSON_Writer *w,char *buf,int size) {cJSON_WriterInitFlush(w,buf,size,0,0);}
+
+void cJSON_WriterObject(cJSON_Writer *w)    {open_container(w,1);}
+void cJSON_WriterEndObject(cJSON_Writer *w) {close_container(w,1);}
+void cJSON_WriterArray(cJSON_Writer *w)     {open_container(w,0);}
+void cJSON_WriterEndArray(cJSON_Writer *w)  {close_container(w,0);}
+
+void cJSON_WriterKey(cJSON_Writer *w,const char *name)
+{
+    if (w->error) return;
+    if (!in_object(w) || w->key) {w->error=1;return;}
+    if ((w->members>>(w->depth-1))&1) put_char(w,',');
+    put_quoted(w,name);
+    put_char(w,':');
+    w->key=1;
+}
+
+void cJSON_WriterInt(cJSON_Writer *w,long value)
+{
+    char digits[3*sizeof(long)];     /* enough decimal digits for any long */
+    unsigned long v;
+    int n=0;
+
+    if (!begin_value(w)) return;
+    if (value<0) {put_char(w,'-');v=0UL-(unsigned long)value;}
+    else v=(unsigned long)value;
+    do {digits[n++]=(char)('0'+v%10);v/=10;} while (v && n<(int)sizeof(digits));
+    while (n) put_char(w,digits[--n]);
+}
+
+void cJSON_WriterBool(cJSON_Writer *w,int value)    {if (begin_value(w)) put_string(w,value?"true":"false");}
+void cJSON_WriterNull(cJSON_Writer *w)              {if (begin_value(w)) put_string(w,"null");}
+void cJSON_WriterString(cJSON_Writer *w,const char *string) {if (begin_value(w)) put_quoted(w,string?string:"");}
+
+void cJSON_WriterHex(cJSON_Writer *w,const unsigned char *data,int len)
+{
+    int i;
+    if (!begin_value(w)) return;
+    put_char(w,'\"');
+    for (i=0;i<len;i++) {put_char(w,hexDigits[data[i]>>4]);put_char(w,hexDigits[data[i]&15]);}
+    put_char(w,'\"');
+}
+
+int cJSON_WriterFinish(cJSON_Writer *w)
+{
+    if (w->depth || w->key) w->error=1;
+    if (w->flush)
+    {
+        if (w->len) w->flush(w->ctx,w->buf,w->len);
+        w->len=0;
+    }
+    else if (w->size>0) w->buf[w->len]=0;
+    return w->error?CJSON_WRITER_TRUNCATED:w->total;
+}
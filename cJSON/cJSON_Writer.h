@@ -0,0 +1,63 @@
+#ifndef cJSON_Writer__h
+#define cJSON_Writer__h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Streaming JSON writer. Values are appended to a caller supplied buffer as they are written,
+   with commas and colons put in automatically; nothing is allocated and no printf is used. If
+   a flush function is given the buffer is handed to it whenever it fills up (e.g. to push the
+   bytes into a UART ring), otherwise text that does not fit is dropped and the writer reports
+   the message as truncated. */
+
+#define CJSON_WRITER_MAX_DEPTH      (32)
+
+/* cJSON_WriterFinish() result when the text did not fit, or the writer was misused. */
+#define CJSON_WRITER_TRUNCATED      (-1)
+
+typedef void (*cJSON_WriterFlush)(void *ctx,const char *data,int len);
+
+typedef struct cJSON_Writer {
+    char *buf;
+    int size;
+    int len;                    /* bytes in buf */
+    int total;                  /* bytes written, flushed ones included */
+    cJSON_WriterFlush flush;
+    void *ctx;
+    unsigned char depth;
+    unsigned char key;          /* a member name has been written, its value is next */
+    unsigned char error;
+    unsigned long objects;      /* bit n set: level n+1 is an object, clear: an array */
+    unsigned long members;      /* bit n set: level n+1 already has a member */
+} cJSON_Writer;
+
+/* Write into buf; cJSON_WriterFinish() null terminates the text, so at most size-1 bytes fit. */
+extern void cJSON_WriterInit(cJSON_Writer *writer,char *buf,int size);
+/* Write through buf, calling flush(ctx,...) each time it is full and once more from cJSON_WriterFinish(). */
+extern void cJSON_WriterInitFlush(cJSON_Writer *writer,char *buf,int size,cJSON_WriterFlush flush,void *ctx);
+
+extern void cJSON_WriterObject(cJSON_Writer *writer);
+extern void cJSON_WriterEndObject(cJSON_Writer *writer);
+extern void cJSON_WriterArray(cJSON_Writer *writer);
+extern void cJSON_WriterEndArray(cJSON_Writer *writer);
+/* Member name, must be followed by exactly one value. */
+extern void cJSON_WriterKey(cJSON_Writer *writer,const char *name);
+
+extern void cJSON_WriterInt(cJSON_Writer *writer,long value);
+extern void cJSON_WriterBool(cJSON_Writer *writer,int value);
+extern void cJSON_WriterNull(cJSON_Writer *writer);
+/* Escaped string value. */
+extern void cJSON_WriterString(cJSON_Writer *writer,const char *string);
+/* len bytes of data as a string of upper case hex digits. */
+extern void cJSON_WriterHex(cJSON_Writer *writer,const unsigned char *data,int len);
+
+/* Returns the length of the text, or CJSON_WRITER_TRUNCATED if some of it was lost or containers are left open. */
+extern int cJSON_WriterFinish(cJSON_Writer *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
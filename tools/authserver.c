@@ -0,0 +1,1007 @@
+/*
+ * @brief: stand-in for the authorization server, speaks the SWAuthDemo protocol over TCP (host tool, Linux)
+ *
+ * Build: gcc -O2 -pthread -DCRC16_IMPL=3 -ICRC16 -IChaskey -IAuthFrame -ILease -ITelemetry -o authserver tools/authserver.c CRC16/lib_crc16.c Chaskey/Chaskey.c AuthFrame/AuthFrame.c
+ * Build with a UID registry: add -DAUTH_REGISTRY -Itools tools/uidreg.c
+ * Usage: authserver [-p port] [-j threads] [-k keys.txt] [-r uids.reg] [-a] [-C] [-c] [-l lease_s] [-s stats_s] [-T telemetry.log]
+ *        -p  port, SERVER_PORT by default
+ *        -j  worker threads, all cores by default
+ *        -k  "UID KEY" lines of 32 hex digits each, the keys written with uidtool key
+ *        -r  license registry (uidreg.h): only UIDs active in it are authorized, leases end with the
+ *            license and carry its features, and the keys in it are used. It is looked up for every
+ *            request,so uidreg set takes effect at once
+ *        -a  refuse UIDs that are not in the key file
+ *        -C  challenge devices whose key is known instead of passing their request as it is
+ *        -c  JSON messages carry the CRC16 trailer both ways (SOCK_CRC_ENABLE)
+ *        -l  lease length for requests that ask for one, 0 issues none, default one day
+ *        -s  seconds between statistics lines, default 10
+ *        -T  append the telemetry records devices send to this file, one line each: the Unix time,
+ *            the UID and the fields of Telemetry.h by name
+ *
+ * Messages follow each other on the connection without separators: a JSON object, then its
+ * CRC16 trailer with -c, or an AuthFrame frame (first byte AUTH_FRAME_VERSION). Every reply
+ * is in the format of its request and echoes its "seq":
+ *   apiId 1   {"UID":..,"renew":true}    respCode 100 with a lease when renew and the key is
+ *                                        known, 101 with a nonce under -C, 4 if refused
+ *   apiId 2   {"UID":..,"ctr":..,"mac":..} answer to the nonce sent last on this connection
+ *   other     acknowledged with 100; an "authSeq" (AUTH_TAG_AUTH_SEQ) in it also gets the apiId 1
+ *             reply for that seq
+ *   apiId 3   {"UID":..,"tlm":".."}      telemetry records(AUTH_TAG_TELEMETRY), acknowledged like
+ *                                        any other message
+ * Leases are MACed with the device key like Lease_verify() checks them, times in Unix seconds.
+ *
+ * Every worker has its own SO_REUSEPORT listener and level-triggered epoll set, so the kernel
+ * spreads the connections and the workers share nothing but the read-only key table. All complete
+ * messages of one read are handled in a batch and their replies leave in one write. A connection
+ * costs CONN_IN_SIZE+CONN_OUT_SIZE bytes and a descriptor; 100k of them need about 150 MB and
+ * RLIMIT_NOFILE above 100k, which is raised to the hard limit at start, plus client port space
+ * (several client addresses on one host). The latency is the time from the read that completed a
+ * message to the write that sent its reply, kept in log-linear histograms (1/8 power of two
+ * buckets), and printed as p50/p99 of every period and of the whole run on exit (SIGINT).
+ */
+
+#define _GNU_SOURCE     /* accept4 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/random.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "lib_crc16.h"
+#include "Chaskey.h"
+#include "AuthFrame.h"
+#include "Lease.h"
+#include "Telemetry.h"
+#ifdef AUTH_REGISTRY
+#include "uidreg.h"
+#endif
+
+#define SERVER_PORT         (31318)     /* keep in step with SWAuthDemo.c */
+#define ATUH_API_ID         (1)
+#define AUTH_MAC_API_ID     (2)
+#define RESP_CODE_SUCCESS   (100)
+#define RESP_CODE_CHALLENGE (101)
+#define RESP_CODE_ERROR     (4)
+#define AUTH_NONCE_SIZE     (8)
+#define UID_SIZE            (16)        /* raw bytes,32 hex digits */
+#define SOCK_CRC_SIZE       (2)
+
+#define CONN_IN_SIZE        (512)       /* a firmware message is at most SOCK_OUT_BUF_SIZE plus the trailer */
+#define CONN_OUT_SIZE       (1024)
+#define REPLY_MAX           (256)       /* reading stops while less than this is free for replies */
+#define THREADS_MAX         (64)
+#define EVENTS_MAX          (256)
+#define HIST_SUB_BITS       (3)
+#define HIST_SIZE           (16+(64-4)*(1<<HIST_SUB_BITS))
+
+typedef struct KEY_ENTRY{
+	uint8_t uid[UID_SIZE];
+	CHASKEY_KEY_T key;
+}KEY_ENTRY_T;
+
+/* what the server knows of a device */
+typedef struct DEVICE{
+	int licensed;                   /* may be authorized */
+	int hasKey;
+	uint32_t expiry;                /* end of the license,0 none */
+	uint32_t features;              /* LEASE_FEATURE_* */
+	uint8_t uid[UID_SIZE];
+	CHASKEY_KEY_T key;
+}DEVICE_T;
+
+typedef struct CONN{
+	int fd;
+	int inLen;
+	int outLen;
+	int outPos;
+	int waiting;                    /* messages whose replies are not written yet */
+	long long readAt;               /* ns,read that completed the oldest of them */
+	int events;                     /* epoll events set */
+	int challenged;                 /* a nonce went to device */
+	DEVICE_T device;
+	uint8_t nonce[AUTH_NONCE_SIZE];
+	uint8_t in[CONN_IN_SIZE];
+	uint8_t out[CONN_OUT_SIZE];
+}CONN_T;
+
+/* a parsed message,fields absent are -1 or 0 */
+typedef struct REQ{
+	int binary;
+	int apiId;
+	int seq;
+	int authSeq;
+	int renew;
+	int hasUid;
+	int hasMac;
+	long ctr;
+	uint8_t uid[UID_SIZE];
+	uint8_t mac[CHASKEY_TAG_SIZE];
+	int tlmLen;
+	uint8_t tlm[255];               /* telemetry records */
+}REQ_T;
+
+typedef struct REPLY{
+	int apiId;
+	int seq;
+	int respCode;
+	const uint8_t *nonce;
+	const uint8_t *lease;           /* LEASE_WIRE_SIZE bytes */
+}REPLY_T;
+
+/* counters of one worker,written by it alone and read by the statistics thread */
+typedef struct STATS{
+	unsigned long conns;
+	unsigned long accepted;
+	unsigned long messages;
+	unsigned long passed;
+	unsigned long challenged;
+	unsigned long refused;
+	unsigned long errors;           /* connections dropped for a bad message */
+	unsigned long hist[HIST_SIZE];
+}STATS_T;
+
+typedef struct WORKER{
+	pthread_t tid;
+	int ep;
+	int listenFd;
+	int id;
+	uint8_t rand[256];              /* getrandom() pool for nonces */
+	int randPos;
+	STATS_T stats;
+}WORKER_T;
+
+static KEY_ENTRY_T *keys;
+static int keyCount;
+#ifdef AUTH_REGISTRY
+static UIDREG_T registry;
+static int registryOpen;
+#endif
+static int port = SERVER_PORT,threads,allowListed,challenge,sockCrc,leaseSeconds = 86400,statsPeriod = 10;
+static WORKER_T workers[THREADS_MAX];
+static volatile sig_atomic_t stopping;
+static FILE *tlmFile;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1000000000LL+ts.tv_nsec;
+}
+
+static void count(unsigned long *c,unsigned long n)
+{
+	__atomic_store_n(c,*c+n,__ATOMIC_RELAXED);  /* one writer,the reader only needs whole words */
+}
+
+/*****************************************************************************
+ * latency histogram
+ ****************************************************************************/
+
+static int hist_index(unsigned long long ns)
+{
+	int b;
+	if(ns < 16)
+		return (int)ns;
+	b = 63-__builtin_clzll(ns);
+	return 16+((b-4)<<HIST_SUB_BITS)+(int)((ns>>(b-HIST_SUB_BITS)) & ((1<<HIST_SUB_BITS)-1));
+}
+
+/* middle of bucket i in ns */
+static double hist_value(int i)
+{
+	int b,sub;
+	if(i < 16)
+		return i;
+	b = ((i-16)>>HIST_SUB_BITS)+4;
+	sub = (i-16) & ((1<<HIST_SUB_BITS)-1);
+	return (double)(((1ULL<<HIST_SUB_BITS)+sub)<<(b-HIST_SUB_BITS))+(double)(1ULL<<(b-HIST_SUB_BITS))/2;
+}
+
+static double hist_percentile(const unsigned long *hist,unsigned long total,double p)
+{
+	unsigned long want = (unsigned long)(total*p),seen = 0;
+	int i;
+	if(total == 0)
+		return 0;
+	for(i=0;i<HIST_SIZE;i++){
+		seen += hist[i];
+		if(seen > want)
+			return hist_value(i);
+	}
+	return hist_value(HIST_SIZE-1);
+}
+
+/*****************************************************************************
+ * keys
+ ****************************************************************************/
+
+static int hex_bytes(const char *hex,uint8_t *out,int n)
+{
+	int i,v,h;
+	for(i=0;i<2*n;i++){
+		h = hex[i];
+		if(h >= '0' && h <= '9') v = h-'0';
+		else if(h >= 'A' && h <= 'F') v = h-'A'+10;
+		else if(h >= 'a' && h <= 'f') v = h-'a'+10;
+		else return -1;
+		if(i & 1)
+			out[i/2] |= (uint8_t)v;
+		else
+			out[i/2] = (uint8_t)(v<<4);
+	}
+	return 0;
+}
+
+static char *put_hex(char *p,const uint8_t *data,int n)
+{
+	int i;
+	for(i=0;i<n;i++){
+		*p++ = "0123456789ABCDEF"[data[i]>>4];
+		*p++ = "0123456789ABCDEF"[data[i]&0x0F];
+	}
+	return p;
+}
+
+static int key_cmp(const void *a,const void *b)
+{
+	return memcmp(a,b,UID_SIZE);
+}
+
+static int load_keys(const char *path)
+{
+	char line[256],uid[64],key[64];
+	uint8_t raw[CHASKEY_KEY_SIZE];
+	FILE *fp = fopen(path,"r");
+	int size = 0,lineNo = 0;
+
+	if(fp == NULL){
+		perror(path);
+		return -1;
+	}
+	while(fgets(line,sizeof(line),fp) != NULL){
+		lineNo++;
+		if(line[0] == '#' || sscanf(line,"%63s %63s",uid,key) != 2)
+			continue;
+		if(keyCount == size){
+			size = size?2*size:1024;
+			keys = realloc(keys,size*sizeof(KEY_ENTRY_T));
+			if(keys == NULL){
+				fclose(fp);
+				return -1;
+			}
+		}
+		if(strlen(uid) != 2*UID_SIZE || strlen(key) != 2*CHASKEY_KEY_SIZE ||
+			hex_bytes(uid,keys[keyCount].uid,UID_SIZE) || hex_bytes(key,raw,CHASKEY_KEY_SIZE)){
+			fprintf(stderr,"%s:%d: expected UID and key,32 hex digits each\n",path,lineNo);
+			continue;
+		}
+		Chaskey_setKey(&keys[keyCount++].key,raw);
+	}
+	fclose(fp);
+	qsort(keys,keyCount,sizeof(KEY_ENTRY_T),key_cmp);
+	return 0;
+}
+
+static const KEY_ENTRY_T *find_key(const uint8_t *uid)
+{
+	return keyCount?bsearch(uid,keys,keyCount,sizeof(KEY_ENTRY_T),key_cmp):NULL;
+}
+
+/* look up a device in the registry,then the key file; without a registry or -a any UID is licensed */
+static void find_device(const uint8_t *uid,DEVICE_T *d)
+{
+	const KEY_ENTRY_T *k = find_key(uid);
+#ifdef AUTH_REGISTRY
+	const UIDREG_ENTRY_T *e;
+	uint8_t raw[UIDREG_KEY_SIZE];
+	uint64_t lic;
+#endif
+
+	memset(d,0,sizeof(DEVICE_T));
+	memcpy(d->uid,uid,UID_SIZE);
+	d->licensed = !allowListed || k != NULL;
+	d->features = LEASE_FEATURE_APP;
+	if(k != NULL){
+		d->hasKey = 1;
+		d->key = k->key;
+	}
+#ifdef AUTH_REGISTRY
+	if(!registryOpen)
+		return;
+	e = UidReg_find(&registry,uid);
+	d->licensed = 0;
+	if(e == NULL)
+		return;
+	lic = UidReg_license(e);
+	d->expiry = UIDREG_EXPIRY(lic);
+	d->features = UIDREG_FEATURES(lic);
+	d->licensed = UIDREG_STATE(lic) == UIDREG_ACTIVE && (d->expiry == 0 || d->expiry > (uint32_t)time(NULL));
+	if(!d->hasKey && !UidReg_key(e,raw)){
+		d->hasKey = 1;
+		Chaskey_setKey(&d->key,raw);
+	}
+#endif
+}
+
+/*****************************************************************************
+ * message framing and parsing
+ ****************************************************************************/
+
+/* size of the JSON object at p,0 if it is not complete yet,-1 if it is not a flat object */
+static int json_size(const uint8_t *p,int len)
+{
+	int i,depth = 0,inString = 0;
+	for(i=0;i<len;i++){
+		if(inString){
+			if(p[i] == '\\')
+				i++;
+			else if(p[i] == '"')
+				inString = 0;
+		}else if(p[i] == '"'){
+			inString = 1;
+		}else if(p[i] == '{' || p[i] == '['){
+			if(++depth > 8)
+				return -1;
+		}else if(p[i] == '}' || p[i] == ']'){
+			if(--depth == 0)
+				return i+1;
+		}
+	}
+	return 0;
+}
+
+/* read the members of a firmware request,nested values are skipped */
+static int json_parse(const uint8_t *p,int len,REQ_T *req)
+{
+	const uint8_t *end = p+len,*key,*value;
+	int keyLen,valueLen,depth;
+	long num;
+
+	if(*p++ != '{')
+		return -1;
+	for(;;){
+		while(p < end && (*p == ' ' || *p == ',' || *p == '\r' || *p == '\n' || *p == '\t'))
+			p++;
+		if(p >= end || *p == '}')
+			return 0;
+		if(*p++ != '"')
+			return -1;
+		key = p;
+		while(p < end && *p != '"')
+			p++;
+		keyLen = (int)(p-key);
+		p++;
+		while(p < end && (*p == ' ' || *p == ':'))
+			p++;
+		if(p >= end)
+			return -1;
+		value = p;
+		if(*p == '"'){
+			value = ++p;
+			while(p < end && *p != '"')
+				p += (*p == '\\')?2:1;
+			valueLen = (int)(p-value);
+			p++;
+		}else if(*p == '{' || *p == '['){
+			for(depth=0;p < end;p++){
+				if(*p == '{' || *p == '[')
+					depth++;
+				else if((*p == '}' || *p == ']') && --depth == 0)
+					break;
+			}
+			p++;
+			continue;
+		}else{
+			while(p < end && *p != ',' && *p != '}')
+				p++;
+			valueLen = (int)(p-value);
+		}
+		num = strtol((const char*)value,NULL,10);
+		if(keyLen == 5 && !memcmp(key,"apiId",5))
+			req->apiId = (int)num;
+		else if(keyLen == 3 && !memcmp(key,"seq",3))
+			req->seq = (int)num;
+		else if(keyLen == 7 && !memcmp(key,"authSeq",7))
+			req->authSeq = (int)num;
+		else if(keyLen == 3 && !memcmp(key,"ctr",3))
+			req->ctr = num;
+		else if(keyLen == 5 && !memcmp(key,"renew",5))
+			req->renew = (valueLen == 4 && !memcmp(value,"true",4));
+		else if(keyLen == 3 && !memcmp(key,"UID",3))
+			req->hasUid = (valueLen == 2*UID_SIZE && !hex_bytes((const char*)value,req->uid,UID_SIZE));
+		else if(keyLen == 3 && !memcmp(key,"mac",3))
+			req->hasMac = (valueLen == 2*CHASKEY_TAG_SIZE && !hex_bytes((const char*)value,req->mac,CHASKEY_TAG_SIZE));
+		else if(keyLen == 3 && !memcmp(key,"tlm",3) && valueLen <= 2*(int)sizeof(req->tlm) &&
+			!hex_bytes((const char*)value,req->tlm,valueLen/2))
+			req->tlmLen = valueLen/2;
+	}
+}
+
+static int frame_parse(const uint8_t *p,int len,REQ_T *req)
+{
+	AUTH_FRAME_READER_T reader;
+	const uint8_t *value;
+	uint8_t tag;
+	int n,ret;
+
+	if(AuthFrame_open(&reader,p,len))
+		return -1;
+	req->binary = 1;
+	while((ret = AuthFrame_next(&reader,&tag,&value,&n)) > 0){
+		if(tag == AUTH_TAG_API_ID)
+			req->apiId = (int)AuthFrame_getInt(value,n);
+		else if(tag == AUTH_TAG_SEQ)
+			req->seq = (int)AuthFrame_getInt(value,n);
+		else if(tag == AUTH_TAG_AUTH_SEQ)
+			req->authSeq = (int)AuthFrame_getInt(value,n);
+		else if(tag == AUTH_TAG_COUNTER)
+			req->ctr = (long)(uint32_t)AuthFrame_getInt(value,n);
+		else if(tag == AUTH_TAG_LEASE)
+			req->renew = 1;
+		else if(tag == AUTH_TAG_UID && n == UID_SIZE){
+			memcpy(req->uid,value,UID_SIZE);
+			req->hasUid = 1;
+		}else if(tag == AUTH_TAG_MAC && n == CHASKEY_TAG_SIZE){
+			memcpy(req->mac,value,CHASKEY_TAG_SIZE);
+			req->hasMac = 1;
+		}else if(tag == AUTH_TAG_TELEMETRY){
+			memcpy(req->tlm,value,(size_t)n);
+			req->tlmLen = n;
+		}
+	}
+	return ret;
+}
+
+/*****************************************************************************
+ * replies
+ ****************************************************************************/
+
+static void put_reply(CONN_T *c,const REQ_T *req,const REPLY_T *r)
+{
+	AUTH_FRAME_WRITER_T w;
+	char *start = (char*)c->out+c->outLen,*p = start;
+	uint16_t crc;
+	int size;
+
+	if(req->binary){
+		AuthFrame_begin(&w,c->out+c->outLen,CONN_OUT_SIZE-c->outLen);
+		AuthFrame_putInt(&w,AUTH_TAG_API_ID,r->apiId);
+		if(r->seq >= 0)
+			AuthFrame_putInt(&w,AUTH_TAG_SEQ,r->seq);
+		AuthFrame_putInt(&w,AUTH_TAG_RESP_CODE,r->respCode);
+		if(r->nonce != NULL)
+			AuthFrame_putBytes(&w,AUTH_TAG_NONCE,r->nonce,AUTH_NONCE_SIZE);
+		if(r->lease != NULL)
+			AuthFrame_putBytes(&w,AUTH_TAG_LEASE,r->lease,LEASE_WIRE_SIZE);
+		size = AuthFrame_end(&w);
+		if(size > 0)
+			c->outLen += size;
+		return;
+	}
+	p += sprintf(p,"{\"apiId\":%d,",r->apiId);
+	if(r->seq >= 0)
+		p += sprintf(p,"\"seq\":%d,",r->seq);
+	p += sprintf(p,"\"respCode\":%d",r->respCode);
+	if(r->nonce != NULL){
+		p += sprintf(p,",\"nonce\":\"");
+		p = put_hex(p,r->nonce,AUTH_NONCE_SIZE);
+		*p++ = '"';
+	}
+	if(r->lease != NULL){
+		p += sprintf(p,",\"lease\":\"");
+		p = put_hex(p,r->lease,LEASE_WIRE_SIZE);
+		*p++ = '"';
+	}
+	*p++ = '}';
+	if(sockCrc){
+		crc = calculate_crc16(start,(unsigned int)(p-start));
+		*p++ = (char)(crc>>8);
+		*p++ = (char)crc;
+	}
+	c->outLen += (int)(p-start);
+}
+
+static void put_be32(uint8_t *p,uint32_t v)
+{
+	p[0] = (uint8_t)(v>>24);
+	p[1] = (uint8_t)(v>>16);
+	p[2] = (uint8_t)(v>>8);
+	p[3] = (uint8_t)v;
+}
+
+/* issue a lease in wire format,see Lease.h,it ends no later than the license
+   return 0,or nagative value if the device gets none */
+static int make_lease(const DEVICE_T *d,uint8_t *wire)
+{
+	uint8_t msg[1+UID_SIZE+12];
+	uint32_t now = (uint32_t)time(NULL),expiry = now+(uint32_t)leaseSeconds;
+
+	if(!d->hasKey || leaseSeconds <= 0)
+		return -1;
+	if(d->expiry && d->expiry < expiry)
+		expiry = d->expiry;
+	put_be32(wire,now);
+	put_be32(wire+4,expiry);
+	put_be32(wire+8,d->features);
+	msg[0] = 'L';
+	memcpy(msg+1,d->uid,UID_SIZE);
+	memcpy(msg+1+UID_SIZE,wire,12);
+	Chaskey_mac(&d->key,msg,sizeof(msg),wire+12,CHASKEY_TAG_SIZE);
+	return 0;
+}
+
+static void next_nonce(WORKER_T *w,uint8_t *nonce)
+{
+	if(w->randPos+AUTH_NONCE_SIZE > (int)sizeof(w->rand)){
+		if(getrandom(w->rand,sizeof(w->rand),0) != (ssize_t)sizeof(w->rand)){
+			perror("getrandom");
+			exit(1);
+		}
+		w->randPos = 0;
+	}
+	memcpy(nonce,w->rand+w->randPos,AUTH_NONCE_SIZE);
+	w->randPos += AUTH_NONCE_SIZE;
+}
+
+/* authorize the device of req,the reply goes out as apiId 1 with seq */
+static void authorize(WORKER_T *w,CONN_T *c,const REQ_T *req,int seq)
+{
+	uint8_t lease[LEASE_WIRE_SIZE];
+	DEVICE_T d;
+	REPLY_T r;
+
+	memset(&r,0,sizeof(r));
+	r.apiId = ATUH_API_ID;
+	r.seq = seq;
+	if(req->hasUid)
+		find_device(req->uid,&d);
+	if(!req->hasUid || !d.licensed){
+		r.respCode = RESP_CODE_ERROR;
+		count(&w->stats.refused,1);
+	}else if(challenge && d.hasKey){
+		next_nonce(w,c->nonce);
+		c->device = d;
+		c->challenged = 1;
+		r.respCode = RESP_CODE_CHALLENGE;
+		r.nonce = c->nonce;
+		count(&w->stats.challenged,1);
+	}else{
+		r.respCode = RESP_CODE_SUCCESS;
+		if(req->renew && !make_lease(&d,lease))
+			r.lease = lease;
+		count(&w->stats.passed,1);
+	}
+	put_reply(c,req,&r);
+}
+
+/* check the answer to the nonce,MAC over nonce,raw UID and counter as authMac() makes it */
+static void check_answer(WORKER_T *w,CONN_T *c,const REQ_T *req)
+{
+	const DEVICE_T *d = &c->device;
+	uint8_t msg[AUTH_NONCE_SIZE+UID_SIZE+4],lease[LEASE_WIRE_SIZE];
+	REPLY_T r;
+
+	memset(&r,0,sizeof(r));
+	r.apiId = AUTH_MAC_API_ID;
+	r.seq = req->seq;
+	r.respCode = RESP_CODE_ERROR;
+	if(c->challenged && req->hasUid && req->hasMac && !memcmp(d->uid,req->uid,UID_SIZE)){
+		memcpy(msg,c->nonce,AUTH_NONCE_SIZE);
+		memcpy(msg+AUTH_NONCE_SIZE,req->uid,UID_SIZE);
+		put_be32(msg+AUTH_NONCE_SIZE+UID_SIZE,(uint32_t)req->ctr);
+		if(!Chaskey_verify(&d->key,msg,sizeof(msg),req->mac,CHASKEY_TAG_SIZE)){
+			r.respCode = RESP_CODE_SUCCESS;
+			if(req->renew && !make_lease(d,lease))
+				r.lease = lease;
+		}
+	}
+	c->challenged = 0;  /* one answer per nonce */
+	count((r.respCode == RESP_CODE_SUCCESS)?&w->stats.passed:&w->stats.refused,1);
+	put_reply(c,req,&r);
+}
+
+/* the telemetry records of req as lines of the -T file,written at once so the workers do not mix them */
+static void log_telemetry(const REQ_T *req)
+{
+	char uid[2*UID_SIZE+1],buf[4096];
+	const uint8_t *r;
+	int i,n = 0;
+	long t = (long)time(NULL);
+
+	if(tlmFile == NULL || !req->hasUid)
+		return;
+	for(i=0;i<UID_SIZE;i++)
+		sprintf(uid+2*i,"%02X",req->uid[i]);
+	for(r=req->tlm;r+TELEMETRY_RECORD_SIZE <= req->tlm+req->tlmLen;r += TELEMETRY_RECORD_SIZE)
+		n += snprintf(buf+n,sizeof(buf)-(size_t)n,"%ld %s start %u rssi %u/%u/%u samples %u unreg %u auth %u "
+			"rtt %u/%u timeout %u connect %u retry %u sendfail %u uart %u dropped %u stack %u pool %u\n",t,uid,
+			r[0]<<8|r[1],r[2],r[3],r[4],r[5],r[6],r[7],r[8]<<8|r[9],r[10]<<8|r[11],r[12],r[13],r[14],r[15],r[16],
+			r[17],r[18]<<8|r[19],r[20]);
+	fputs(buf,tlmFile);
+	fflush(tlmFile);
+}
+
+static void handle(WORKER_T *w,CONN_T *c,const REQ_T *req)
+{
+	REPLY_T r;
+
+	if(req->apiId == ATUH_API_ID){
+		authorize(w,c,req,req->seq);
+		return;
+	}
+	if(req->apiId == AUTH_MAC_API_ID){
+		check_answer(w,c,req);
+		return;
+	}
+	memset(&r,0,sizeof(r));
+	r.apiId = req->apiId;
+	r.seq = req->seq;
+	r.respCode = RESP_CODE_SUCCESS;
+	put_reply(c,req,&r);
+	if(req->tlmLen > 0)
+		log_telemetry(req);
+	if(req->authSeq >= 0)
+		authorize(w,c,req,req->authSeq);
+}
+
+/* handle every complete message in the input buffer that there is reply space for
+   return the number handled,or nagative value if the connection has to be dropped */
+static int handle_input(WORKER_T *w,CONN_T *c)
+{
+	REQ_T req;
+	int pos = 0,size,body,handled = 0;
+
+	while(pos < c->inLen && c->outLen <= CONN_OUT_SIZE-REPLY_MAX){
+		if(c->in[pos] == ' ' || c->in[pos] == '\r' || c->in[pos] == '\n'){
+			pos++;
+			continue;
+		}
+		memset(&req,0,sizeof(req));
+		req.apiId = req.seq = req.authSeq = -1;
+		if(c->in[pos] == AUTH_FRAME_VERSION){
+			if(c->inLen-pos < AUTH_FRAME_OVERHEAD)
+				break;
+			size = c->in[pos+1]+AUTH_FRAME_OVERHEAD;
+			if(c->inLen-pos < size)
+				break;
+			if(frame_parse(c->in+pos,size,&req))
+				return -1;
+		}else if(c->in[pos] == '{'){
+			body = json_size(c->in+pos,c->inLen-pos);
+			if(body < 0)
+				return -1;
+			size = body+(sockCrc?SOCK_CRC_SIZE:0);
+			if(body == 0 || c->inLen-pos < size)
+				break;
+			if(sockCrc && calculate_crc16((char*)c->in+pos,(unsigned int)body) !=
+				(c->in[pos+body]<<8 | c->in[pos+body+1]))
+				return -1;
+			if(json_parse(c->in+pos,body,&req))
+				return -1;
+		}else{
+			return -1;
+		}
+		pos += size;
+		handle(w,c,&req);
+		handled++;
+	}
+	if(pos == 0 && c->inLen == CONN_IN_SIZE && c->outLen <= CONN_OUT_SIZE-REPLY_MAX)
+		return -1;  /* a message longer than the buffer */
+	memmove(c->in,c->in+pos,c->inLen-pos);
+	c->inLen -= pos;
+	c->waiting += handled;
+	count(&w->stats.messages,handled);
+	return handled;
+}
+
+/*****************************************************************************
+ * event loop
+ ****************************************************************************/
+
+static void conn_close(WORKER_T *w,CONN_T *c)
+{
+	epoll_ctl(w->ep,EPOLL_CTL_DEL,c->fd,NULL);
+	close(c->fd);
+	free(c);
+	count(&w->stats.conns,(unsigned long)-1);
+}
+
+static void conn_events(WORKER_T *w,CONN_T *c,int events)
+{
+	struct epoll_event ev;
+	if(c->events == events)
+		return;
+	ev.events = events;
+	ev.data.ptr = c;
+	epoll_ctl(w->ep,EPOLL_CTL_MOD,c->fd,&ev);
+	c->events = events;
+}
+
+/* write what is queued,record the latency once everything is out
+   return 0,or nagative value if the connection failed */
+static int conn_flush(WORKER_T *w,CONN_T *c)
+{
+	ssize_t n;
+	while(c->outPos < c->outLen){
+		n = send(c->fd,c->out+c->outPos,c->outLen-c->outPos,MSG_NOSIGNAL);
+		if(n < 0)
+			return (errno == EAGAIN || errno == EWOULDBLOCK)?0:-1;
+		c->outPos += (int)n;
+	}
+	c->outPos = c->outLen = 0;
+	if(c->waiting){
+		count(&w->stats.hist[hist_index((unsigned long long)(now_ns()-c->readAt))],(unsigned long)c->waiting);
+		c->waiting = 0;
+	}
+	return 0;
+}
+
+/* handle and answer buffered messages until the input is used up or the socket is full
+   return 0,or nagative value if the connection has to be dropped */
+static int conn_work(WORKER_T *w,CONN_T *c)
+{
+	int handled;
+	do{
+		handled = handle_input(w,c);
+		if(handled < 0){
+			count(&w->stats.errors,1);
+			return -1;
+		}
+		if(conn_flush(w,c))
+			return -1;
+	}while(handled > 0 && c->inLen > 0 && c->outLen == 0);
+	return 0;
+}
+
+static void conn_ready(WORKER_T *w,CONN_T *c,int events)
+{
+	ssize_t n;
+
+	if((events & EPOLLOUT) && (conn_flush(w,c) || (c->outLen == 0 && c->inLen > 0 && conn_work(w,c)))){
+		conn_close(w,c);
+		return;
+	}
+	if((events & (EPOLLIN|EPOLLERR|EPOLLHUP)) && c->outLen <= CONN_OUT_SIZE-REPLY_MAX){
+		n = recv(c->fd,c->in+c->inLen,CONN_IN_SIZE-c->inLen,0);
+		if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)){
+			conn_close(w,c);
+			return;
+		}
+		if(n > 0){
+			if(!c->waiting)
+				c->readAt = now_ns();
+			c->inLen += (int)n;
+			if(conn_work(w,c)){
+				conn_close(w,c);
+				return;
+			}
+		}
+	}
+	/* stop reading while replies are stuck,wait for the socket to drain */
+	conn_events(w,c,(c->outLen > CONN_OUT_SIZE-REPLY_MAX)?EPOLLOUT:(c->outLen?EPOLLIN|EPOLLOUT:EPOLLIN));
+}
+
+static void accept_all(WORKER_T *w)
+{
+	struct epoll_event ev;
+	CONN_T *c;
+	int fd,one = 1;
+
+	while((fd = accept4(w->listenFd,NULL,NULL,SOCK_NONBLOCK|SOCK_CLOEXEC)) >= 0){
+		c = malloc(sizeof(CONN_T));
+		if(c == NULL){
+			close(fd);
+			continue;
+		}
+		memset(c,0,offsetof(CONN_T,in));
+		c->fd = fd;
+		c->events = EPOLLIN;
+		setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+		if(epoll_ctl(w->ep,EPOLL_CTL_ADD,fd,&ev)){
+			close(fd);
+			free(c);
+			continue;
+		}
+		count(&w->stats.conns,1);
+		count(&w->stats.accepted,1);
+	}
+	if(errno == EMFILE || errno == ENFILE)
+		fprintf(stderr,"worker %d: out of descriptors\n",w->id);
+}
+
+static void *worker_main(void *arg)
+{
+	WORKER_T *w = (WORKER_T*)arg;
+	struct epoll_event ev[EVENTS_MAX];
+	int n,i;
+
+	while(!stopping){
+		n = epoll_wait(w->ep,ev,EVENTS_MAX,200);
+		for(i=0;i<n;i++){
+			if(ev[i].data.ptr == NULL)
+				accept_all(w);
+			else
+				conn_ready(w,(CONN_T*)ev[i].data.ptr,(int)ev[i].events);
+		}
+	}
+	return NULL;
+}
+
+static int worker_start(WORKER_T *w)
+{
+	struct sockaddr_in addr;
+	struct epoll_event ev;
+	int one = 1;
+
+	w->randPos = sizeof(w->rand);
+	w->listenFd = socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+	w->ep = epoll_create1(EPOLL_CLOEXEC);
+	if(w->listenFd < 0 || w->ep < 0)
+		return -1;
+	setsockopt(w->listenFd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+	if(setsockopt(w->listenFd,SOL_SOCKET,SO_REUSEPORT,&one,sizeof(one)))
+		return -1;
+	memset(&addr,0,sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if(bind(w->listenFd,(struct sockaddr*)&addr,sizeof(addr)) || listen(w->listenFd,4096))
+		return -1;
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if(epoll_ctl(w->ep,EPOLL_CTL_ADD,w->listenFd,&ev))
+		return -1;
+	return pthread_create(&w->tid,NULL,worker_main,w)?-1:0;
+}
+
+/*****************************************************************************
+ * statistics
+ ****************************************************************************/
+
+static void stats_sum(STATS_T *sum)
+{
+	int i,j;
+	memset(sum,0,sizeof(STATS_T));
+	for(i=0;i<threads;i++){
+		const STATS_T *s = &workers[i].stats;
+		sum->conns += __atomic_load_n(&s->conns,__ATOMIC_RELAXED);
+		sum->accepted += __atomic_load_n(&s->accepted,__ATOMIC_RELAXED);
+		sum->messages += __atomic_load_n(&s->messages,__ATOMIC_RELAXED);
+		sum->passed += __atomic_load_n(&s->passed,__ATOMIC_RELAXED);
+		sum->challenged += __atomic_load_n(&s->challenged,__ATOMIC_RELAXED);
+		sum->refused += __atomic_load_n(&s->refused,__ATOMIC_RELAXED);
+		sum->errors += __atomic_load_n(&s->errors,__ATOMIC_RELAXED);
+		for(j=0;j<HIST_SIZE;j++)
+			sum->hist[j] += __atomic_load_n(&s->hist[j],__ATOMIC_RELAXED);
+	}
+}
+
+static void stats_print(const STATS_T *now,const STATS_T *before,double seconds,const char *label)
+{
+	static unsigned long hist[HIST_SIZE];
+	unsigned long total = 0;
+	int i,top = 0;
+
+	for(i=0;i<HIST_SIZE;i++){
+		hist[i] = now->hist[i]-before->hist[i];
+		total += hist[i];
+		if(hist[i])
+			top = i;
+	}
+	printf("%s conns %lu accepted %lu msgs %lu(%.0f/s) pass %lu challenge %lu refuse %lu drop %lu "
+		"p50 %.1fus p99 %.1fus max %.1fus\n",label,now->conns,now->accepted-before->accepted,
+		total,seconds > 0?total/seconds:0.0,now->passed-before->passed,now->challenged-before->challenged,
+		now->refused-before->refused,now->errors-before->errors,hist_percentile(hist,total,0.5)/1e3,
+		hist_percentile(hist,total,0.99)/1e3,total?hist_value(top)/1e3:0.0);
+	fflush(stdout);
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stopping = 1;
+}
+
+static void raise_nofile(void)
+{
+	struct rlimit rl;
+	if(getrlimit(RLIMIT_NOFILE,&rl))
+		return;
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE,&rl);
+	if(rl.rlim_cur < 100000)
+		fprintf(stderr,"descriptor limit %lu,raise the hard limit for 100k connections\n",(unsigned long)rl.rlim_cur);
+}
+
+int main(int argc,char **argv)
+{
+	static STATS_T first,last,now;
+	const char *keyFile = NULL,*registryFile = NULL,*tlmName = NULL;
+	long long start,lastAt,t;
+	int opt,i;
+
+	threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	while((opt = getopt(argc,argv,"p:j:k:r:aCcl:s:T:")) != -1){
+		switch(opt){
+		case 'p': port = atoi(optarg); break;
+		case 'j': threads = atoi(optarg); break;
+		case 'k': keyFile = optarg; break;
+		case 'r': registryFile = optarg; break;
+		case 'a': allowListed = 1; break;
+		case 'C': challenge = 1; break;
+		case 'c': sockCrc = 1; break;
+		case 'l': leaseSeconds = atoi(optarg); break;
+		case 's': statsPeriod = atoi(optarg); break;
+		case 'T': tlmName = optarg; break;
+		default:
+			fprintf(stderr,"usage: %s [-p port] [-j threads] [-k keys.txt] [-r uids.reg] [-a] [-C] [-c] [-l lease_s] [-s stats_s] [-T telemetry.log]\n",argv[0]);
+			return 2;
+		}
+	}
+	if(threads < 1)
+		threads = 1;
+	if(threads > THREADS_MAX)
+		threads = THREADS_MAX;
+	if(statsPeriod < 1)
+		statsPeriod = 1;
+	if(keyFile != NULL && load_keys(keyFile))
+		return 1;
+	if(tlmName != NULL && (tlmFile = fopen(tlmName,"a")) == NULL){
+		perror(tlmName);
+		return 1;
+	}
+	if(registryFile != NULL){
+#ifdef AUTH_REGISTRY
+		if(UidReg_open(&registry,registryFile,0)){
+			fprintf(stderr,"%s: not a UID registry\n",registryFile);
+			return 1;
+		}
+		registryOpen = 1;
+		fprintf(stderr,"%s: %llu UIDs\n",registryFile,(unsigned long long)registry.header->count);
+#else
+		fprintf(stderr,"built without AUTH_REGISTRY\n");
+		return 1;
+#endif
+	}
+	raise_nofile();
+	signal(SIGINT,on_signal);
+	signal(SIGTERM,on_signal);
+	signal(SIGPIPE,SIG_IGN);
+
+	for(i=0;i<threads;i++){
+		workers[i].id = i;
+		if(worker_start(&workers[i])){
+			perror("listen");
+			return 1;
+		}
+	}
+	fprintf(stderr,"port %d,%d workers,%d keys%s%s%s\n",port,threads,keyCount,allowListed?",listed only":"",
+		challenge?",challenge":"",sockCrc?",CRC trailer":"");
+	start = lastAt = now_ns();
+	while(!stopping){
+		for(i=0;i<statsPeriod*10 && !stopping;i++)
+			usleep(100000);
+		t = now_ns();
+		stats_sum(&now);
+		stats_print(&now,&last,(t-lastAt)/1e9,"period");
+		last = now;
+		lastAt = t;
+	}
+	for(i=0;i<threads;i++)
+		pthread_join(workers[i].tid,NULL);
+	stats_sum(&now);
+	stats_print(&now,&first,(now_ns()-start)/1e9,"total ");
+	return 0;
+}
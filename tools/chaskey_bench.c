@@ -0,0 +1,196 @@
+/*
+ * @brief: cycles of Chaskey/Chaskey.c for the challenge MAC (host tool)
+ *
+ * Build: gcc -O2 -IChaskey -o chaskey_bench tools/chaskey_bench.c Chaskey/Chaskey.c
+ *        (-DCHASKEY_ROUNDS=8 for the original round count)
+ * Usage: chaskey_bench
+ *
+ * Checks the MAC against the known answers for the empty message and 1..16 bytes of 00 01 02..
+ * under the key of the Chaskey reference code, and a few properties of it (a flipped message bit
+ * or key bit changes the tag, Chaskey_verify accepts the tag and refuses a forged one), any
+ * failure exits with 1. Then it prints the cycles of the key schedule, of one challenge MAC
+ * (28 bytes: nonce, raw UID, counter) and per byte of a long message, as TSC cycles on x86 and
+ * as ns elsewhere.
+ *
+ * On the board set MAC_BENCH_ENABLE in SWAuthDemo.c, it prints the core cycles of one challenge
+ * MAC counted with SysTick. Flash: the Chaskey.o line of the Keil map file, or
+ *   arm-none-eabi-gcc -mcpu=cortex-m0 -mthumb -Os -c Chaskey/Chaskey.c && arm-none-eabi-size Chaskey.o
+ * RAM: sizeof(CHASKEY_KEY_T) bytes for the key schedule plus a few dozen bytes of stack, no heap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Chaskey.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UNIT            "cycles"
+#define TICKS()         ((double)__rdtsc())
+#else
+#define UNIT            "ns"
+static double TICKS(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1e9+ts.tv_nsec;
+}
+#endif
+
+#define CHALLENGE_SIZE  (8+16+4)
+#define LONG_SIZE       (1024)
+#define REPEAT          (200000)
+
+/* key and 128 bit tags of the known answers,in little-endian words as the reference code has them */
+#if CHASKEY_ROUNDS == 8 || CHASKEY_ROUNDS == 12
+static const uint32_t katKey[4] = {0x833D3433,0x009F389F,0x2398E64F,0x417ACF39};
+#endif
+#if CHASKEY_ROUNDS == 8
+static const uint32_t katTags[17][4] = {   /* Chaskey,the reference code */
+	{0x792E8FE5,0x75CE87AA,0x2D1450B5,0x1191970B},
+	{0x13A9307B,0x50E62C89,0x4577BD88,0xC0BBDC18},
+	{0x55DF8922,0x2C7FF577,0x73809EF4,0x4E5084C0},
+	{0x1BDBB264,0xA07680D8,0x8E5B2AB8,0x20660413},
+	{0x30B2D171,0xE38532FB,0x16707C16,0x73ED45F0},
+	{0xBC983D0C,0x31B14064,0x234CD7A2,0x0C92BBF9},
+	{0x0DD0688A,0xE131756C,0x94C5E6DE,0x84942131},
+	{0x7F670454,0xF25B03E0,0x19D68362,0x9F4D24D8},
+	{0x09330F69,0x62B5DCE0,0xA4FBA462,0xF20D3C12},
+	{0x89B3B1BE,0x95B97392,0xF8444ABF,0x755DADFE},
+	{0xAC5B9DAE,0x6CF8C0AC,0x56E7B945,0xD7ECF8F0},
+	{0xD5B0DBEC,0xC1692530,0xD13B368A,0xC0AE6A59},
+	{0xFC2C3391,0x285C8CD5,0x456508EE,0xC789E206},
+	{0x29496F33,0xAC62D558,0xE0BAD605,0xC5A538C6},
+	{0xBF668497,0x275217A1,0x40C17AD4,0x2ED877C0},
+	{0x51B94DA4,0xEFCC4DE8,0x192412EA,0xBBC170DD},
+	{0x79271CA9,0xD66A1C71,0x81CA474E,0x49831CAD}
+};
+#elif CHASKEY_ROUNDS == 12
+static const uint32_t katTags[17][4] = {   /* Chaskey-12,the same messages and key */
+	{0x43CB1F41,0x51EBA0C2,0xFF0A8AC3,0x7EE3F642},
+	{0xF9AC2067,0x9C35A846,0x441AAD3D,0x777B7330},
+	{0x57DA70C5,0x2A873CB0,0x19EE8B2A,0x165CD82E},
+	{0x8C5E6AB9,0x5035ADFB,0xBFF69F98,0x965516D9},
+	{0x0B2B62DB,0x1E9E3F50,0xA1B8DCAD,0xB4279AE0},
+	{0x39FA92B9,0x1B655E4F,0x5E4A4667,0x0FE13365},
+	{0x7C814DEC,0x149F38A0,0x270046B9,0xFB954C27},
+	{0xB7D29CB8,0x40A2819D,0xAE403CDB,0x6FBEFA95},
+	{0x9FAF57D6,0xF4BC02CF,0x6AF6D831,0xD2930D90},
+	{0x8417124D,0x552889A7,0x35D716F0,0xE04632A6},
+	{0xDEA5BA76,0x741D87ED,0x72CFEF1A,0x91749FC9},
+	{0x6A888831,0x8679ED53,0x8A192E58,0x58B23BD1},
+	{0xC040258C,0xF25392C0,0x9F6B5DC0,0x35C3D638},
+	{0x7FEBA9C3,0x585DA8E9,0x7680BE51,0x9FB8FC6E},
+	{0xC133C9C0,0x55DF75B5,0x0F18F729,0x99B9837E},
+	{0x03CFB44B,0x283C8163,0xFCA71448,0xC40A0AEA},
+	{0x5DD0E2A9,0xFB5EAC8C,0x633A392E,0x500C36F3}
+};
+#endif
+
+static void check(int cond,const char *what)
+{
+	if(!cond){
+		fprintf(stderr,"check failed: %s\n",what);
+		exit(1);
+	}
+}
+
+#if CHASKEY_ROUNDS == 8 || CHASKEY_ROUNDS == 12
+static void known_answers(void)
+{
+	CHASKEY_KEY_T key;
+	uint8_t raw[CHASKEY_KEY_SIZE],msg[16],tag[16];
+	char what[32];
+	int i,len;
+
+	for(i=0;i<CHASKEY_KEY_SIZE;i++)
+		raw[i] = (uint8_t)(katKey[i/4] >> (8*(i%4)));
+	for(i=0;i<16;i++)
+		msg[i] = (uint8_t)i;
+	Chaskey_setKey(&key,raw);
+	for(len=0;len<=16;len++){
+		Chaskey_mac(&key,msg,len,tag,sizeof(tag));
+		for(i=0;i<16 && tag[i] == (uint8_t)(katTags[len][i/4] >> (8*(i%4)));i++){}
+		snprintf(what,sizeof(what),"known answer,%d bytes",len);
+		check(i == 16,what);
+	}
+}
+#endif
+
+static double best_of(int op,const uint8_t *raw,const uint8_t *msg,int len)
+{
+	CHASKEY_KEY_T key;
+	uint8_t tag[CHASKEY_TAG_SIZE];
+	double start,t,best = 0;
+	unsigned int sink = 0;
+	int round,i;
+
+	Chaskey_setKey(&key,raw);
+	for(round=0;round<5;round++){
+		start = TICKS();
+		for(i=0;i<REPEAT;i++){
+			if(op){
+				Chaskey_mac(&key,msg,len,tag,sizeof(tag));
+			}else{
+				Chaskey_setKey(&key,raw);
+				tag[0] = (uint8_t)key.k2[i&3];
+			}
+			sink += tag[0];
+		}
+		t = (TICKS()-start)/REPEAT;
+		if(round == 0 || t < best)
+			best = t;
+	}
+	if(sink == 1)
+		printf(" ");    /* keep the results alive */
+	return best;
+}
+
+int main(void)
+{
+	static uint8_t msg[LONG_SIZE];
+	uint8_t raw[CHASKEY_KEY_SIZE],tag[CHASKEY_TAG_SIZE],tag2[CHASKEY_TAG_SIZE];
+	CHASKEY_KEY_T key;
+	double t;
+	int i,len;
+
+	for(i=0;i<CHASKEY_KEY_SIZE;i++)
+		raw[i] = (uint8_t)i;
+	for(i=0;i<LONG_SIZE;i++)
+		msg[i] = (uint8_t)rand();
+	#if CHASKEY_ROUNDS == 8 || CHASKEY_ROUNDS == 12
+	known_answers();
+	#else
+	printf("no known answers for %d rounds\n",CHASKEY_ROUNDS);
+	#endif
+	Chaskey_setKey(&key,raw);
+	for(len=0;len<=48;len++){   /* every padding case,full and partial last blocks */
+		Chaskey_mac(&key,msg,len,tag,sizeof(tag));
+		check(!Chaskey_verify(&key,msg,len,tag,sizeof(tag)),"verify accepts the tag");
+		tag[len%sizeof(tag)] ^= 0x01;
+		check(Chaskey_verify(&key,msg,len,tag,sizeof(tag)) != 0,"verify refuses a changed tag");
+		if(len > 0){
+			Chaskey_mac(&key,msg,len,tag,sizeof(tag));
+			msg[len-1] ^= 0x80;
+			Chaskey_mac(&key,msg,len,tag2,sizeof(tag2));
+			msg[len-1] ^= 0x80;
+			check(memcmp(tag,tag2,sizeof(tag)) != 0,"a message bit changes the tag");
+			Chaskey_mac(&key,msg,len-1,tag2,sizeof(tag2));
+			check(memcmp(tag,tag2,sizeof(tag)) != 0,"the length changes the tag");
+		}
+	}
+	Chaskey_mac(&key,msg,CHALLENGE_SIZE,tag,sizeof(tag));
+	raw[15] ^= 0x80;
+	Chaskey_setKey(&key,raw);
+	raw[15] ^= 0x80;
+	Chaskey_mac(&key,msg,CHALLENGE_SIZE,tag2,sizeof(tag2));
+	check(memcmp(tag,tag2,sizeof(tag)) != 0,"a key bit changes the tag");
+
+	printf("Chaskey, %d rounds, %d byte tag, %d bytes of key schedule\n",CHASKEY_ROUNDS,CHASKEY_TAG_SIZE,(int)sizeof(CHASKEY_KEY_T));
+	printf("key schedule       %8.1f " UNIT "\n",best_of(0,raw,msg,0));
+	printf("challenge MAC (%d) %8.1f " UNIT "\n",CHALLENGE_SIZE,best_of(1,raw,msg,CHALLENGE_SIZE));
+	t = best_of(1,raw,msg,LONG_SIZE);
+	printf("MAC of %d bytes  %8.1f " UNIT ", %.2f " UNIT "/byte\n",LONG_SIZE,t,t/LONG_SIZE);
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * @brief: memory per parsed document for the cJSON node layouts (host tool)
+ *
+ * Build: gcc -O2 -IcJSON -DCJSON_NO_FLOAT -o membench tools/cjson_membench.c cJSON/cJSON.c cJSON/cJSON_Pool.c
+ *        gcc -O2 -IcJSON -DCJSON_NO_FLOAT -DCJSON_COMPACT -o membench_compact tools/cjson_membench.c cJSON/cJSON.c cJSON/cJSON_Pool.c
+ * Usage: membench [file.json...]
+ *
+ * Parses each document through cJSON_Pool and prints the items and string bytes it took. Host
+ * pointers are 8 bytes, so the "target" column scales the item count by the size of the same
+ * layout on the 32-bit MCU instead of reusing sizeof(cJSON).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cJSON.h"
+#include "cJSON_Pool.h"
+
+/* sizeof(cJSON) with 4-byte pointers and ints, 8-byte aligned doubles */
+#if defined(CJSON_COMPACT) && defined(CJSON_NO_FLOAT)
+#define TARGET_NODE_SIZE    (12)
+#elif defined(CJSON_COMPACT)
+#define TARGET_NODE_SIZE    (24)
+#elif defined(CJSON_NO_FLOAT)
+#define TARGET_NODE_SIZE    (28)
+#else
+#define TARGET_NODE_SIZE    (40)
+#endif
+
+static const char *samples[] = {
+	"{\"apiId\":101,\"respCode\":100}",
+	"{\"apiId\":100,\"UID\":\"0123456789ABCDEF0123456789ABCDEF\"}",
+	"{\"apiId\":101,\"respCode\":100,\"msg\":\"ok\",\"lease\":{\"expire\":86400,\"renew\":[3600,7200]},\"flags\":[true,false,null]}",
+	"{\"elevenChars\":\"elevenChars\"}",    /* 12 bytes with the NUL,a compact item's size: 2 items */
+};
+
+static int measure(const char *name,const char *text)
+{
+	cJSON *json;
+	cJSON_PoolStats stats;
+
+	cJSON_PoolInit();
+	json = cJSON_Parse(text);
+	cJSON_PoolGetStats(&stats);
+	if(json == NULL || stats.failures){
+		printf("%-24.24s parse failed (pool too small?)\n",name);
+		return 1;
+	}
+	printf("%-24.24s %5d %6d %8d %8d\n",name,stats.nodesPeak,stats.arenaPeak,
+		(int)(stats.nodesPeak*sizeof(cJSON))+stats.arenaPeak,stats.nodesPeak*TARGET_NODE_SIZE+stats.arenaPeak);
+	cJSON_Delete(json);
+	return 0;
+}
+
+int main(int argc,char **argv)
+{
+	char name[16],*text;
+	FILE *fp;
+	long len;
+	int i,err = 0;
+
+	printf("layout: %s%s, sizeof(cJSON) %d here, %d on the target\n",
+#ifdef CJSON_COMPACT
+		"compact",
+#else
+		"default",
+#endif
+#ifdef CJSON_NO_FLOAT
+		" no float",
+#else
+		"",
+#endif
+		(int)sizeof(cJSON),TARGET_NODE_SIZE);
+	printf("%-24s %5s %6s %8s %8s\n","document","items","arena","bytes","target");
+	if(argc < 2){
+		for(i=0;i<(int)(sizeof(samples)/sizeof(samples[0]));i++){
+			sprintf(name,"sample %d",i);
+			err |= measure(name,samples[i]);
+		}
+		return err;
+	}
+	for(i=1;i<argc;i++){
+		fp = fopen(argv[i],"rb");
+		if(fp == NULL){
+			perror(argv[i]);
+			err = 1;
+			continue;
+		}
+		fseek(fp,0,SEEK_END);
+		len = ftell(fp);
+		fseek(fp,0,SEEK_SET);
+		text = (char*)malloc(len+1);
+		if(text == NULL || fread(text,1,len,fp) != (size_t)len){
+			fclose(fp);
+			free(text);
+			err = 1;
+			continue;
+		}
+		text[len] = '\0';
+		fclose(fp);
+		err |= measure(argv[i],text);
+		free(text);
+	}
+	return err;
+}
@@ -0,0 +1,91 @@
+/*
+ * @brief: cycles per byte of calculate_crc16 for one CRC16_IMPL variant (host tool)
+ *
+ * Build: gcc -O2 -DCRC16_IMPL=1 -ICRC16 -o crc16_bench tools/crc16_bench.c CRC16/lib_crc16.c
+ *        (CRC16_IMPL 1 nibble, 2 byte table, 3 slicing-by-4, see lib_crc16.h)
+ * Usage: crc16_bench [bytes]...   (default: the frame sizes the firmware sends, 25 50 259 1024)
+ *
+ * Prints time per call and per byte for every buffer size, as TSC cycles on x86 and as ns
+ * elsewhere, and the flash taken by the variant's tables. Host figures only rank the variants;
+ * for the Cortex-M0 count SysTick ticks around the same loop on the board.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lib_crc16.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UNIT            "cycles"
+#define TICKS()         ((double)__rdtsc())
+#else
+#define UNIT            "ns"
+static double TICKS(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1e9+ts.tv_nsec;
+}
+#endif
+
+#if CRC16_IMPL == CRC16_IMPL_NIBBLE
+#define IMPL_NAME       "nibble"
+#define TABLE_BYTES     (16*2)
+#elif CRC16_IMPL == CRC16_IMPL_SLICE4
+#define IMPL_NAME       "slice4"
+#define TABLE_BYTES     (4*256*2)
+#else
+#define IMPL_NAME       "byte"
+#define TABLE_BYTES     (256*2)
+#endif
+
+#define BENCH_BYTES     (64L<<20)   /* bytes checksummed per buffer size */
+
+static unsigned int benchOne(char *buf,unsigned int len,double *perCall)
+{
+	double start,best = 0,t;
+	long n,calls = BENCH_BYTES/len+1;
+	unsigned int sink = 0;
+	int round;
+
+	for(round=0;round<3;round++){   /* best of three against scheduler noise */
+		start = TICKS();
+		for(n=0;n<calls;n++){
+			buf[0] = (char)n;
+			sink += calculate_crc16(buf,len);
+		}
+		t = (TICKS()-start)/calls;
+		if(round == 0 || t < best)
+			best = t;
+	}
+	*perCall = best;
+	return sink;
+}
+
+int main(int argc,char **argv)
+{
+	static const unsigned int defaults[] = {25,50,259,1024};
+	unsigned int len,n,sink = 0;
+	double perCall;
+	char *buf;
+	int i,count;
+
+	count = (argc > 1)?argc-1:(int)(sizeof(defaults)/sizeof(defaults[0]));
+	printf("CRC16_IMPL %s, %d bytes of tables\n",IMPL_NAME,TABLE_BYTES);
+	printf("%8s %12s %12s\n","bytes",UNIT "/call",UNIT "/byte");
+	for(i=0;i<count;i++){
+		len = (argc > 1)?(unsigned int)atoi(argv[i+1]):defaults[i];
+		if(len == 0)
+			continue;
+		buf = (char*)malloc(len);
+		if(buf == NULL)
+			return 1;
+		for(n=0;n<len;n++)
+			buf[n] = (char)rand();
+		sink += benchOne(buf,len,&perCall);
+		printf("%8u %12.1f %12.2f\n",len,perCall,perCall/len);
+		free(buf);
+	}
+	return sink == 1;   /* keep the results alive */
+}
@@ -0,0 +1,63 @@
+/*
+ * @brief: table generator for CRC16/lib_crc16.c (host tool)
+ *
+ * Build: gcc -O2 -o crc16_gentab tools/crc16_gentab.c
+ * Usage: crc16_gentab > CRC16/crc16_tab.h
+ *
+ * Writes the lookup tables of every CRC16_IMPL variant for the reflected polynomial 0xA001
+ * (0x8005 bit reversed): the 16 entry nibble table, the 256 entry byte table and the three
+ * extra tables slicing-by-4 needs. Each table is guarded by the variants that use it, so a
+ * build only links the one it selected.
+ */
+
+#include <stdio.h>
+
+#define POLY    (0xA001u)
+
+static unsigned short tab[4][256];
+
+static void print_table(const char *name,const unsigned short *t,int n)
+{
+	int i;
+	printf("static const uint16_t %s[%d] = {",name,n);
+	for(i=0;i<n;i++)
+		printf("%s0x%04X%s",(i%8)?" ":"\n    ",t[i],(i<n-1)?",":"");
+	printf("\n};\n");
+}
+
+int main(void)
+{
+	unsigned short nibble[16],crc;
+	char name[32];
+	int i,j,k;
+
+	for(i=0;i<256;i++){
+		crc = (unsigned short)i;
+		for(j=0;j<8;j++)
+			crc = (crc&1)?(unsigned short)((crc>>1)^POLY):(unsigned short)(crc>>1);
+		tab[0][i] = crc;
+	}
+	for(k=1;k<4;k++)
+		for(i=0;i<256;i++)
+			tab[k][i] = (unsigned short)((tab[k-1][i]>>8)^tab[0][tab[k-1][i]&0xFF]);
+	for(i=0;i<16;i++){
+		crc = (unsigned short)i;
+		for(j=0;j<4;j++)
+			crc = (crc&1)?(unsigned short)((crc>>1)^POLY):(unsigned short)(crc>>1);
+		nibble[i] = crc;
+	}
+
+	printf("/* generated by tools/crc16_gentab, do not edit */\n");
+	printf("#ifndef _CRC16_TAB_H_\n#define _CRC16_TAB_H_\n\n");
+	printf("#if CRC16_IMPL == CRC16_IMPL_NIBBLE\n");
+	print_table("crc_tab_8005_reflected_nibble",nibble,16);
+	printf("#else\n");
+	print_table("crc_tab_8005_reflected",tab[0],256);
+	printf("#endif\n\n#if CRC16_IMPL == CRC16_IMPL_SLICE4\n");
+	for(k=1;k<4;k++){
+		sprintf(name,"crc_tab_8005_reflected_%d",k);
+		print_table(name,tab[k],256);
+	}
+	printf("#endif\n\n#endif /* _CRC16_TAB_H_ */\n");
+	return 0;
+}
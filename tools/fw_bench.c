@@ -0,0 +1,349 @@
+/*
+ * @brief: benchmark of the firmware hot paths, the real sources built for the host (host tool)
+ *
+ * Build: the firmware library fwsim.so as in tools/sim/fleetsim.c, then
+ *        gcc -O2 -rdynamic -DCJSON_NO_FLOAT -DCJSON_COMPACT -Itools/sim/include -ICRC16 -IcJSON -IAir202 -IHistogram -o fw_bench tools/fw_bench.c ./fwsim.so -Wl,-rpath,.
+ *        (the cJSON defines must be those of fwsim.so,they change the layout of cJSON)
+ * Usage: fw_bench [-r repeats] [-m min_ms] [-l label] [-t]
+ *        -r  runs of every benchmark, the median is reported, 5 by default
+ *        -m  milliseconds one run takes at least, 50 by default
+ *        -l  label written into the output, e.g. the commit measured
+ *        -t  a table instead of JSON
+ *
+ * Runs calculate_crc16, cJSON_Parse with cJSON_Delete, the +IPD extraction of checkSockRecvData
+ * for a JSON message and a binary frame, the response matching of sendAndGet(through
+ * Air202_ATInit, sendAndGet itself is static) and the reply parsing of Air202_checkIPAddress.
+ * The modem is a script: before every call the reply is put in the receive ring, delay_ms does
+ * not wait and what is sent goes nowhere, so the figures are the CPU work of the firmware alone.
+ * The AT command functions poll the UART for TIMEOUT_MS_1000 ms of silence after the reply, a
+ * thousand reads that are part of their cost on the device too.
+ *
+ * Every benchmark is calibrated to -m, run -r times and the median and the fastest run are
+ * reported in ns per call, with the bytes it handles per call and the allocations(cJSON hooks,
+ * the firmware has no other heap use) per call. A CJSON_COMPACT build allocates from cJSON_Pool
+ * like the firmware, reset before every parse; its allocations are the nodes of one call and
+ * the bytes those nodes and the arena took. The JSON output keeps its keys, their order and
+ * the benchmark names from run to run so results of two commits can be compared line by line.
+ * A call that fails(a changed reply format, say) stops the suite with exit status 1 rather than
+ * timing an error path.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "board.h"
+#include "lib_crc16.h"
+#include "cJSON.h"
+#include "cJSON_Pool.h"
+#include "Air202.h"
+
+#define RUNS_MAX        (31)
+#define RX_SIZE         (1024)      /* the bench's receive ring,a power of two */
+#define OUTPUT_FORMAT   (1)         /* raise when the JSON layout changes */
+
+/* from the firmware library,SWAuthDemo.c */
+extern RINGBUFF_T rxring;
+extern int checkSockRecvData(void);
+
+typedef struct BENCH{
+	const char *name;
+	int (*run)(const struct BENCH *b);    /* nagative if the call failed */
+	const char *data;       /* what one call handles */
+	int size;
+}BENCH_T;
+
+typedef struct RESULT{
+	long long iterations;
+	double nsMedian;
+	double nsMin;
+	double allocs;          /* per call */
+	double allocBytes;
+}RESULT_T;
+
+static char rxStore[RX_SIZE];
+static uint8_t flash[0x2000];
+static long allocCount,allocBytes;
+static volatile long sink;
+
+/*****************************************************************************
+ * what the firmware library calls,see tools/sim/include
+ ****************************************************************************/
+
+LPC_UART_T Sim_uart[3] = {{0},{1},{2}};
+SysTick_Type Sim_sysTick;
+uint32_t SystemCoreClock = 50000000;
+
+void delay_ms(uint32_t t)
+{
+	(void)t;
+}
+
+void userIdle(void)
+{
+}
+
+uint32_t Chip_UART_SendRB(LPC_UART_T *pUART,RINGBUFF_T *pRB,const void *data,int bytes)
+{
+	(void)pUART;
+	(void)pRB;
+	(void)data;
+	return (uint32_t)bytes;
+}
+
+int Chip_UART_ReadRB(LPC_UART_T *pUART,RINGBUFF_T *pRB,void *data,int bytes)
+{
+	char *p = (char*)data;
+	int n = 0;
+	(void)pUART;
+	while(n < bytes && RingBuffer_GetCount(pRB) > 0){
+		p[n++] = ((char*)pRB->data)[pRB->tail & (uint32_t)(pRB->count-1)];
+		pRB->tail++;
+	}
+	return n;
+}
+
+void Chip_UART_IRQRBHandler(LPC_UART_T *pUART,RINGBUFF_T *pRXRB,RINGBUFF_T *pTXRB)
+{
+	(void)pUART;
+	(void)pRXRB;
+	(void)pTXRB;
+}
+
+uintptr_t Sim_flashAddr(void)
+{
+	return (uintptr_t)flash;
+}
+
+uintptr_t Sim_stackTop(void)     /* main() is not run,nothing is painted */
+{
+	return 0;
+}
+
+int Sim_debug(const char *format,...)
+{
+	(void)format;
+	return 0;
+}
+
+int Sim_debugIn(void)
+{
+	return EOF;
+}
+
+int IAP_eraseSector(uintptr_t sector)
+{
+	(void)sector;
+	return 0;
+}
+
+int IAP_write(uintptr_t dst,const uint32_t *src,uint32_t size)
+{
+	(void)dst;
+	(void)src;
+	(void)size;
+	return 0;
+}
+
+/*****************************************************************************
+ * benchmarks
+ ****************************************************************************/
+
+#ifndef CJSON_COMPACT
+static void *count_malloc(size_t size)
+{
+	allocCount++;
+	allocBytes += (long)size;
+	return malloc(size);
+}
+#endif
+
+/* the reply of the modem,as the UART interrupt would have stored it */
+static void receive(const char *data,int size)
+{
+	int i;
+	for(i=0;i<size;i++){
+		rxStore[rxring.head & (RX_SIZE-1)] = data[i];
+		rxring.head++;
+	}
+}
+
+static int run_crc16(const BENCH_T *b)
+{
+	sink += calculate_crc16((char*)b->data,(unsigned int)b->size);
+	return 0;
+}
+
+static int run_parse(const BENCH_T *b)
+{
+	cJSON *json;
+	
+	#ifdef CJSON_COMPACT
+	cJSON_PoolReset();  //every message starts with an empty pool
+	#endif
+	json = cJSON_Parse(b->data);
+	if(json == NULL)
+		return -1;
+	cJSON_Delete(json);
+	return 0;
+}
+
+static int run_recv(const BENCH_T *b)
+{
+	receive(b->data,b->size);
+	return checkSockRecvData();
+}
+
+static int run_at(const BENCH_T *b)
+{
+	receive(b->data,b->size);
+	return Air202_ATInit();
+}
+
+static int run_ip(const BENCH_T *b)
+{
+	char ip[32];
+	receive(b->data,b->size);
+	return Air202_checkIPAddress(ip);
+}
+
+static const char uidRecord[] = "0123456789ABCDEF0123456789ABCDEF\x12\x34";
+static const char frame[259] = {0};
+static const char challenge[] = "{\"apiId\":1,\"respCode\":101,\"seq\":7,\"nonce\":\"0123456789ABCDEF\"}";
+static const char leaseResp[] = "{\"apiId\":2,\"respCode\":100,\"seq\":8,"
+	"\"lease\":\"0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF\"}";
+static const char ipdJson[] = "\r\n+IPD,61:{\"apiId\":1,\"respCode\":101,\"seq\":7,\"nonce\":\"0123456789ABCDEF\"}";
+static const char ipdFrame[] = "\r\n+IPD,23:\xB1\x13\x01\x01\x01\x08\x01\x01\x03\x01\x65\x04\x08\x02\x22\x34\x9A\xFF\xC9\x40\xB8\x2E\xF8";
+static const char atOk[] = "\r\nOK\r\n";
+static const char cifsr[] = "\r\n10.64.213.7\r\n";
+
+static const BENCH_T benches[] = {
+	{"calculate_crc16/uid",run_crc16,uidRecord,32},
+	{"calculate_crc16/259",run_crc16,frame,sizeof(frame)},
+	{"cJSON_Parse+Delete/challenge",run_parse,challenge,sizeof(challenge)-1},
+	{"cJSON_Parse+Delete/lease",run_parse,leaseResp,sizeof(leaseResp)-1},
+	{"checkSockRecvData/json",run_recv,ipdJson,sizeof(ipdJson)-1},
+	{"checkSockRecvData/frame",run_recv,ipdFrame,sizeof(ipdFrame)-1},
+	{"sendAndGet/OK",run_at,atOk,sizeof(atOk)-1},
+	{"Air202_checkIPAddress",run_ip,cifsr,sizeof(cifsr)-1},
+};
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+static double time_calls(const BENCH_T *b,long long n)
+{
+	double start = now_ns();
+	long long i;
+	for(i=0;i<n;i++)
+		sink += b->run(b);
+	return now_ns()-start;
+}
+
+static int cmp_double(const void *a,const void *b)
+{
+	double x = *(const double*)a,y = *(const double*)b;
+	return (x > y)-(x < y);
+}
+
+/**
+ * @brief	  time b,the call must succeed so that no error path is measured
+ * @return	return 0 if measured successfully ,otherwise, return nagative value
+ */
+static int measure(const BENCH_T *b,int runs,double minNs,RESULT_T *r)
+{
+	double ns[RUNS_MAX];
+	long long n = 1;
+	int i,ret;
+	#ifdef CJSON_COMPACT
+	cJSON_PoolStats stats;
+	
+	cJSON_PoolInit();   //the peaks from zero
+	#endif
+
+	allocCount = allocBytes = 0;
+	ret = b->run(b);    //warm up,and the allocations of one call
+	if(ret < 0){
+		fprintf(stderr,"%s failed: %d\n",b->name,ret);
+		return -1;
+	}
+	#ifdef CJSON_COMPACT
+	cJSON_PoolGetStats(&stats);
+	allocCount = stats.nodesPeak;
+	allocBytes = (long)(stats.nodesPeak*sizeof(cJSON))+stats.arenaPeak;
+	#endif
+	r->allocs = (double)allocCount;
+	r->allocBytes = (double)allocBytes;
+	while(time_calls(b,n) < minNs)
+		n *= 2;
+	for(i=0;i<runs;i++)
+		ns[i] = time_calls(b,n)/(double)n;
+	qsort(ns,(size_t)runs,sizeof(double),cmp_double);
+	r->iterations = n;
+	r->nsMedian = ns[runs/2];
+	r->nsMin = ns[0];
+	return 0;
+}
+
+int main(int argc,char **argv)
+{
+	static RESULT_T results[sizeof(benches)/sizeof(benches[0])];
+	const char *label = "";
+	#ifndef CJSON_COMPACT
+	cJSON_Hooks hooks;
+	#endif
+	int opt,i,runs = 5,minMs = 50,table = 0,count = (int)(sizeof(benches)/sizeof(benches[0]));
+
+	while((opt = getopt(argc,argv,"r:m:l:t")) != -1){
+		switch(opt){
+		case 'r': runs = atoi(optarg); break;
+		case 'm': minMs = atoi(optarg); break;
+		case 'l': label = optarg; break;
+		case 't': table = 1; break;
+		default:
+			fprintf(stderr,"usage: %s [-r repeats] [-m min_ms] [-l label] [-t]\n",argv[0]);
+			return 2;
+		}
+	}
+	if(runs < 1)
+		runs = 1;
+	if(runs > RUNS_MAX)
+		runs = RUNS_MAX;
+	if(minMs < 1)
+		minMs = 1;
+	RingBuffer_Init(&rxring,rxStore,1,RX_SIZE);
+	#ifndef CJSON_COMPACT
+	hooks.malloc_fn = count_malloc;
+	hooks.free_fn = free;
+	cJSON_InitHooks(&hooks);
+	#endif
+
+	for(i=0;i<count;i++){
+		if(measure(&benches[i],runs,minMs*1e6,&results[i]))
+			return 1;
+	}
+
+	if(table){
+		printf("%-30s %10s %10s %8s %10s %7s %11s\n","benchmark","ns/op","min","bytes","MB/s","allocs","alloc bytes");
+		for(i=0;i<count;i++)
+			printf("%-30s %10.1f %10.1f %8d %10.1f %7.0f %11.0f\n",benches[i].name,results[i].nsMedian,results[i].nsMin,
+				benches[i].size,benches[i].size/results[i].nsMedian*1e3,results[i].allocs,results[i].allocBytes);
+		return 0;
+	}
+	printf("{\n\t\"suite\":\"fw_bench\",\n\t\"format\":%d,\n\t\"label\":\"",OUTPUT_FORMAT);
+	for(i=0;label[i];i++)  //a commit id or a branch name,nothing to escape beyond quotes
+		printf(label[i] == '"' || label[i] == '\\'?"\\%c":"%c",label[i]);
+	printf("\",\n\t\"runs\":%d,\n\t\"results\":[\n",runs);
+	for(i=0;i<count;i++)
+		printf("\t\t{\"name\":\"%s\",\"iterations\":%lld,\"ns_per_op\":%.1f,\"ns_min\":%.1f,\"bytes_per_op\":%d,"
+			"\"mb_per_s\":%.1f,\"allocs_per_op\":%.0f,\"alloc_bytes_per_op\":%.0f}%s\n",benches[i].name,
+			results[i].iterations,results[i].nsMedian,results[i].nsMin,benches[i].size,
+			benches[i].size/results[i].nsMedian*1e3,results[i].allocs,results[i].allocBytes,i+1 < count?",":"");
+	printf("\t]\n}\n");
+	return 0;
+}
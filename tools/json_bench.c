@@ -0,0 +1,187 @@
+/*
+ * @brief: cJSON benchmark over a message corpus (host tool)
+ *
+ * Build: gcc -O2 -IcJSON -o json_bench tools/json_bench.c cJSON/cJSON.c cJSON/cJSON_Stream.c cJSON/cJSON_Schema.c -lm
+ *        (add -DCJSON_NO_FLOAT to match the firmware's number handling)
+ * Usage: json_bench <message.json>...   (e.g. every file in tools/corpus)
+ *
+ * For every message prints the time per call of cJSON_Parse, cJSON_GetObjectItem (the two
+ * members the firmware reads plus one that is missing), cJSON_PrintUnformatted, cJSON_Delete and
+ * the streaming schema decoder, the parse throughput, and the allocations and peak heap of one
+ * parse. Messages that do not parse are listed as invalid and skipped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+#include "cJSON_Schema.h"
+
+#ifdef CJSON_COMPACT
+#error "the compact layout needs cJSON_Pool, measure it with tools/cjson_membench.c"
+#endif
+
+#define MIN_BENCH_NS    (200000000.0)   /* run every measurement for at least 0.2s */
+
+typedef struct { int apiId; int respCode; } RESP;
+
+static const cJSON_SchemaField respFields[] = {
+	CJSON_SCHEMA_INT(RESP,apiId,"apiId",CJSON_SCHEMA_REQUIRED),
+	CJSON_SCHEMA_INT(RESP,respCode,"respCode",0),
+};
+static const unsigned char respHash[2] = {1,2};
+static const cJSON_Schema respSchema = {respFields,2,CJSON_SCHEMA_ALLOW_UNKNOWN,0,1,respHash};
+
+/* allocation accounting through cJSON_InitHooks */
+typedef union { size_t size; double align; } ALLOC_HEAD;
+static long allocCount,heapUsed,heapPeak;
+
+static void *count_malloc(size_t sz)
+{
+	ALLOC_HEAD *h = (ALLOC_HEAD*)malloc(sizeof(ALLOC_HEAD)+sz);
+	if(h == NULL)
+		return NULL;
+	h->size = sz;
+	allocCount++;
+	heapUsed += (long)sz;
+	if(heapUsed > heapPeak)
+		heapPeak = heapUsed;
+	return h+1;
+}
+
+static void count_free(void *ptr)
+{
+	ALLOC_HEAD *h;
+	if(ptr == NULL)
+		return;
+	h = (ALLOC_HEAD*)ptr-1;
+	heapUsed -= (long)h->size;
+	free(h);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+static char *load(const char *path,long *len)
+{
+	FILE *fp = fopen(path,"rb");
+	char *text;
+	if(fp == NULL)
+		return NULL;
+	fseek(fp,0,SEEK_END);
+	*len = ftell(fp);
+	fseek(fp,0,SEEK_SET);
+	text = (char*)malloc(*len+1);
+	if(text != NULL && fread(text,1,*len,fp) != (size_t)*len){
+		free(text);
+		text = NULL;
+	}
+	if(text != NULL)
+		text[*len] = '\0';
+	fclose(fp);
+	return text;
+}
+
+enum { OP_PARSE, OP_GET, OP_PRINT, OP_DELETE, OP_STREAM, OP_COUNT };
+
+/* ns per call of one operation, repeated until MIN_BENCH_NS has passed */
+static double bench(int op,const char *text,long len)
+{
+	double start,spent = 0,sink = 0;
+	long n = 0,i,batch = 64;
+	cJSON *json[64];
+	char *out;
+	RESP resp;
+
+	for(i=0;op != OP_PARSE && op != OP_STREAM && i<batch;i++)
+		json[i] = cJSON_Parse(text);
+	while(spent < MIN_BENCH_NS){
+		if(op == OP_DELETE && n)
+			for(i=0;i<batch;i++)
+				json[i] = cJSON_Parse(text);
+		start = now_ns();
+		for(i=0;i<batch;i++){
+			switch(op){
+			case OP_PARSE:
+				cJSON_Delete(json[0] = cJSON_Parse(text));
+				break;
+			case OP_GET:
+				sink += (cJSON_GetObjectItem(json[i],"apiId") != NULL)+(cJSON_GetObjectItem(json[i],"respCode") != NULL)
+					+(cJSON_GetObjectItem(json[i],"noSuchMember") != NULL);
+				break;
+			case OP_PRINT:
+				out = cJSON_PrintUnformatted(json[i]);
+				sink += out[0];
+				count_free(out);
+				break;
+			case OP_DELETE:
+				cJSON_Delete(json[i]);
+				break;
+			default:
+				sink += cJSON_SchemaDecode(&respSchema,text,(int)len,&resp);
+				break;
+			}
+		}
+		spent += now_ns()-start;
+		n += batch;
+	}
+	if(op == OP_GET || op == OP_PRINT)
+		for(i=0;i<batch;i++)
+			cJSON_Delete(json[i]);
+	if(sink == 0.5)
+		printf(" ");    /* keep the results alive */
+	if(op == OP_PARSE)  /* the parse loop also deletes, take that out */
+		return spent/n-bench(OP_DELETE,text,len);
+	return spent/n;
+}
+
+int main(int argc,char **argv)
+{
+	cJSON_Hooks hooks;
+	cJSON *json;
+	char *text,*name;
+	long len,allocs,peak;
+	double t[OP_COUNT];
+	int i,op;
+
+	if(argc < 2){
+		fprintf(stderr,"usage: %s <message.json>...\n",argv[0]);
+		return 1;
+	}
+	hooks.malloc_fn = count_malloc;
+	hooks.free_fn = count_free;
+	cJSON_InitHooks(&hooks);
+
+	printf("%-20s %6s %8s %8s %8s %8s %8s %8s %7s %6s %6s\n","message","bytes","parse","get","print","delete","stream","MB/s","allocs","peak","leak");
+	for(i=1;i<argc;i++){
+		name = strrchr(argv[i],'/');
+		name = name ? name+1 : argv[i];
+		text = load(argv[i],&len);
+		if(text == NULL){
+			perror(argv[i]);
+			continue;
+		}
+		allocCount = heapUsed = heapPeak = 0;
+		json = cJSON_Parse(text);
+		allocs = allocCount;
+		peak = heapPeak;
+		if(json == NULL){
+			printf("%-20.20s %6ld invalid\n",name,len);
+			free(text);
+			continue;
+		}
+		cJSON_Delete(json);
+		for(op=0;op<OP_COUNT;op++)
+			t[op] = bench(op,text,len);
+		printf("%-20.20s %6ld %8.0f %8.0f %8.0f %8.0f %8.0f %8.1f %7ld %6ld %6ld\n",name,len,
+			t[OP_PARSE],t[OP_GET],t[OP_PRINT],t[OP_DELETE],t[OP_STREAM],len/t[OP_PARSE]*1e3,allocs,peak,heapUsed);
+		free(text);
+	}
+	printf("times in ns per call; allocs and peak heap bytes are for one cJSON_Parse\n");
+	return 0;
+}
@@ -0,0 +1,353 @@
+/*
+ * @brief: fuzz harness for cJSON_ParseWithOpts and the streaming schema decoder (host tool)
+ *
+ * libFuzzer: clang -g -O1 -fsanitize=fuzzer,address -DCJSON_NO_FLOAT -IcJSON -o json_fuzz tools/json_fuzz.c cJSON/cJSON.c cJSON/cJSON_Stream.c cJSON/cJSON_Schema.c cJSON/cJSON_Writer.c -lm
+ *            ./json_fuzz tools/corpus
+ * AFL:       afl-gcc -O1 -DJSON_FUZZ_MAIN -DCJSON_NO_FLOAT -IcJSON -o json_fuzz tools/json_fuzz.c cJSON/cJSON.c cJSON/cJSON_Stream.c cJSON/cJSON_Schema.c cJSON/cJSON_Writer.c -lm
+ *            afl-fuzz -i tools/corpus -o findings ./json_fuzz @@
+ * Replay:    gcc -g -fsanitize=address,undefined -DJSON_FUZZ_MAIN -DCJSON_NO_FLOAT -IcJSON -o json_fuzz tools/json_fuzz.c cJSON/cJSON.c cJSON/cJSON_Stream.c cJSON/cJSON_Schema.c cJSON/cJSON_Writer.c -lm
+ *            ./json_fuzz <file>...     (reads stdin without arguments)
+ * Compact:   add -DCJSON_COMPACT -DCJSON_POOL_NODES=1536 -DCJSON_POOL_ARENA_SIZE=24576 cJSON/cJSON_Pool.c to
+ *            any of the above for the firmware's layout
+ *
+ * Every input is parsed, printed, re-parsed, duplicated and decoded with the firmware's response
+ * schema, both from the tree and fed byte by byte to cJSON_Stream. All allocations go through
+ * counting hooks and the harness aborts on a leak, on a free of memory it never handed out, or
+ * when a printed document does not parse back to the same text. Build with CJSON_NO_FLOAT like
+ * the firmware: the float build parses big numbers digit by digit in double arithmetic, so their
+ * printed text drifts between rounds and only the re-parse itself is checked there. A few inputs
+ * with a known decoding, two texts back to back and the escapes of cJSON_Writer against those
+ * of the printer are checked once before the first one.
+ * A CJSON_COMPACT build allocates from cJSON_Pool instead, reset before every input like before
+ * every message in the firmware; leaks are nodes still in use, and an input too big for the
+ * pool skips the round trip checks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdbool.h>
+#include "cJSON.h"
+#include "cJSON_Schema.h"
+#include "cJSON_Writer.h"
+#ifdef CJSON_COMPACT
+#include "cJSON_Pool.h"
+#endif
+
+#define ALLOC_MAGIC     (0x4A534F4EUL)
+
+typedef struct { int apiId; int respCode; char msg[16]; } RESP;
+
+static const cJSON_SchemaField respFields[] = {
+	CJSON_SCHEMA_INT(RESP,apiId,"apiId",CJSON_SCHEMA_REQUIRED),
+	CJSON_SCHEMA_INT(RESP,respCode,"respCode",CJSON_SCHEMA_REQUIRED),
+	CJSON_SCHEMA_STRING(RESP,msg,"msg",0),
+};
+/* generated by tools/schema_gen resp apiId respCode msg */
+static const unsigned char respHash[4] = {1,2,3,0};
+static const cJSON_Schema respSchema = {respFields,3,CJSON_SCHEMA_ALLOW_UNKNOWN,0,2,respHash};
+
+#ifdef CJSON_COMPACT
+static unsigned long poolFailures;  /* at the latest cJSON_PoolReset() */
+
+/* every input starts with an empty pool,like every message in the firmware */
+static void start_input(void)
+{
+	cJSON_PoolStats stats;
+	cJSON_PoolReset();
+	cJSON_PoolGetStats(&stats);
+	poolFailures = stats.failures;
+}
+
+/* nodes cJSON holds */
+static long in_use(void)
+{
+	cJSON_PoolStats stats;
+	cJSON_PoolGetStats(&stats);
+	return stats.nodesUsed;
+}
+
+/* the pool ran out since the reset,the input is bigger than it holds rather than wrong */
+static int pool_full(void)
+{
+	cJSON_PoolStats stats;
+	cJSON_PoolGetStats(&stats);
+	return stats.failures != poolFailures;
+}
+
+/* printed text stays in the arena until the next reset */
+static void release(void *ptr)
+{
+	(void)ptr;
+}
+#else
+typedef union { struct { size_t size; unsigned long magic; } h; double align; } ALLOC_HEAD;
+static long allocCount,heapUsed,heapPeak;
+
+static void *count_malloc(size_t sz)
+{
+	ALLOC_HEAD *h = (ALLOC_HEAD*)malloc(sizeof(ALLOC_HEAD)+sz);
+	if(h == NULL)
+		return NULL;
+	h->h.size = sz;
+	h->h.magic = ALLOC_MAGIC;
+	allocCount++;
+	heapUsed += (long)sz;
+	if(heapUsed > heapPeak)
+		heapPeak = heapUsed;
+	return h+1;
+}
+
+static void count_free(void *ptr)
+{
+	ALLOC_HEAD *h;
+	if(ptr == NULL)
+		return;
+	h = (ALLOC_HEAD*)ptr-1;
+	if(h->h.magic != ALLOC_MAGIC){
+		fprintf(stderr,"free of a block cJSON did not allocate\n");
+		abort();
+	}
+	h->h.magic = 0;
+	heapUsed -= (long)h->h.size;
+	free(h);
+}
+
+#define start_input()   (heapUsed = 0)
+#define in_use()        heapUsed
+#define pool_full()     0
+#define release(ptr)    count_free(ptr)
+#endif
+
+static void check(int cond,const char *what)
+{
+	if(!cond){
+		fprintf(stderr,"check failed: %s\n",what);
+		abort();
+	}
+}
+
+#ifdef CJSON_NO_FLOAT
+/* integers beyond int are clamped to its limits,with a 32-bit unsigned long(the firmware's) they
+   wrapped around to small values once; only the final value is clamped */
+static const struct { const char *text; int value; } numbers[] = {
+	{"2147483647",INT_MAX},{"-2147483648",INT_MIN},{"2147483648",INT_MAX},{"4294967296",INT_MAX},
+	{"4294967297",INT_MAX},{"-4294967296",INT_MIN},{"-21474836480",INT_MIN},{"99999999999",INT_MAX},
+	{"1e10",INT_MAX},{"-1e10",INT_MIN},{"4.294967296e9",INT_MAX},{"4.2e1",42},
+	/* a mantissa longer than int scaled back by the exponent */
+	{"99999999999e-5",999999},{"12345678901e-2",123456789},{"-99999999999e-5",-999999},
+	{"100000000000000000000e-19",10},{"12345678901.9e-1",1234567890},{"99999999999e-1",INT_MAX},
+};
+#endif
+
+/* streamed into the response schema: members nobody reads may be longer than the stream's buffers */
+static const struct { const char *text; long items; int apiId; int respCode; } streamed[] = {
+	{"{\"apiId\":4294967296,\"respCode\":-21474836480}",3,INT_MAX,INT_MIN},
+	{"{\"apiId\":1,\"aMemberNameLongerThanTheKeyBuffer\":[1,2],\"respCode\":2}",3,1,2},
+	{"{\"apiId\":1,\"note\":\"a value longer than the forty-seven bytes of the token buffer\",\"respCode\":3}",3,1,3},
+	{"{\"apiId\":1,\"n\":123456789012345678901234567890123456789012345678901234567890e-5,\"respCode\":4}",3,1,4},
+	{"{\"apiId\":1,\"respCode\":5,\"msg\":\"a message that does not fit into the token buffer,nor msg\"}",CJSON_SCHEMA_ERR_SIZE,1,5},
+};
+
+/* a bool slot right before a char array,a bool takes its own byte only */
+typedef struct { bool on; char tag[3]; } FLAG;
+
+static const cJSON_SchemaField flagFields[] = {
+	CJSON_SCHEMA_BOOL(FLAG,on,"on",CJSON_SCHEMA_REQUIRED),
+	CJSON_SCHEMA_STRING(FLAG,tag,"tag",0),
+};
+/* generated by tools/schema_gen flag on tag */
+static const unsigned char flagHash[2] = {2,1};
+static const cJSON_Schema flagSchema = {flagFields,2,0,1,1,flagHash};
+
+static void check_flag(const char *how,long items,const FLAG *flag,bool on)
+{
+	char what[64];
+
+	snprintf(what,sizeof(what),"bool before a char array,%s",how);
+	check(items == 3 && flag->on == on && !strcmp(flag->tag,"ab"),what);
+}
+
+static void check_known(void)
+{
+	static const char twoTexts[] = "{\"apiId\":3,\"respCode\":100}{\"apiId\":1,\"respCode\":4}";
+	cJSON_Stream stream;
+	cJSON_SchemaDecoder decoder;
+	cJSON *json;
+	RESP resp;
+	FLAG flag;
+	long items;
+	cJSON_Writer writer;
+	char what[64],written[32],*printed;
+	size_t i;
+	int used;
+#ifdef CJSON_NO_FLOAT
+
+	for(i=0;i<sizeof(numbers)/sizeof(numbers[0]);i++){
+		json = cJSON_Parse(numbers[i].text);
+		snprintf(what,sizeof(what),"%s parses to %d",numbers[i].text,numbers[i].value);
+		check(json != NULL && json->type == cJSON_Number && cJSON_ValueInt(json) == numbers[i].value,what);
+		cJSON_Delete(json);
+	}
+#endif
+	for(i=0;i<sizeof(streamed)/sizeof(streamed[0]);i++){
+		memset(&resp,0,sizeof(resp));
+		items = cJSON_SchemaDecode(&respSchema,streamed[i].text,(int)strlen(streamed[i].text),&resp);
+		snprintf(what,sizeof(what),"streamed input %d decodes",(int)i);
+		check(items == streamed[i].items && resp.apiId == streamed[i].apiId && resp.respCode == streamed[i].respCode,what);
+	}
+	check(!cJSON_SchemaCheck(&flagSchema),"flag schema hash up to date");
+	memset(&flag,0x55,sizeof(flag));
+	check_flag("streamed",cJSON_SchemaDecode(&flagSchema,"{\"tag\":\"ab\",\"on\":true}",22,&flag),&flag,true);
+	memset(&flag,0x55,sizeof(flag));
+	check_flag("false",cJSON_SchemaDecode(&flagSchema,"{\"tag\":\"ab\",\"on\":false}",23,&flag),&flag,false);
+	json = cJSON_CreateObject();
+	cJSON_AddStringToObject(json,"tag","ab");
+	cJSON_AddTrueToObject(json,"on");
+	memset(&flag,0x55,sizeof(flag));
+	check_flag("created tree",cJSON_SchemaDecodeItem(&flagSchema,json,&flag),&flag,true);
+	cJSON_Delete(json);
+#ifdef CJSON_COMPACT
+	/* eleven characters and the NUL take as many bytes as a compact item,they are still a string */
+	json = cJSON_Parse("{\"elevenChars\":\"elevenChars\"}");
+	check(json != NULL && in_use() == 2,"strings the size of an item come from the arena");
+	cJSON_Delete(json);
+#endif
+	/* the writer escapes like the printer */
+	json = cJSON_CreateString("\x01\x1f\"\\\n");
+	printed = cJSON_PrintUnformatted(json);
+	cJSON_WriterInit(&writer,written,sizeof(written));
+	cJSON_WriterString(&writer,"\x01\x1f\"\\\n");
+	check(cJSON_WriterFinish(&writer) > 0 && printed != NULL && !strcmp(written,printed),"writer escapes match the printer");
+	release(printed);
+	cJSON_Delete(json);
+	/* texts back to back,as the firmware finds them in one +IPD */
+	memset(&resp,0,sizeof(resp));
+	cJSON_SchemaBegin(&decoder,&respSchema,&resp);
+	cJSON_StreamInit(&stream,cJSON_SchemaHandler,&decoder);
+	check(cJSON_StreamConsume(&stream,twoTexts,(int)strlen(twoTexts),&used) == CJSON_STREAM_DONE && used == 26 &&
+		cJSON_SchemaEnd(&decoder) >= 0 && resp.apiId == 3,"back to back texts end after the first");
+	check(in_use() == 0,"no leak in the known inputs");
+}
+
+static void fuzz_one(const unsigned char *data,size_t size)
+{
+	static int hooked;
+#ifndef CJSON_COMPACT
+	cJSON_Hooks hooks;
+#endif
+	cJSON_Stream stream;
+	cJSON_SchemaDecoder decoder;
+	cJSON *json,*again,*copy;
+	const char *end;
+	char *text,*out,*out2,*formatted;
+	RESP resp;
+	size_t i;
+
+	if(!hooked){
+#ifdef CJSON_COMPACT
+		cJSON_PoolInit();
+#else
+		hooks.malloc_fn = count_malloc;
+		hooks.free_fn = count_free;
+		cJSON_InitHooks(&hooks);
+#endif
+		hooked = 1;
+		check(!cJSON_SchemaCheck(&respSchema),"schema hash up to date");
+		check_known();
+	}
+	text = (char*)malloc(size+1);
+	if(text == NULL)
+		return;
+	memcpy(text,data,size);
+	text[size] = '\0';
+	start_input();
+
+	json = cJSON_ParseWithOpts(text,&end,0);
+	if(json != NULL){
+		check(end >= text && end <= text+size,"parse end inside the input");
+		out = cJSON_PrintUnformatted(json);
+		again = (out != NULL)?cJSON_Parse(out):NULL;
+		out2 = (again != NULL)?cJSON_PrintUnformatted(again):NULL;
+		copy = cJSON_Duplicate(json,1);
+		formatted = (copy != NULL)?cJSON_Print(copy):NULL;
+		if(!pool_full()){
+			check(out != NULL,"print");
+			check(again != NULL,"printed text parses");
+			check(out2 != NULL,"print again");
+#ifdef CJSON_NO_FLOAT
+			check(!strcmp(out,out2),"print is stable");
+#endif
+			check(copy != NULL,"duplicate");
+			check(formatted != NULL,"formatted print");
+		}
+		memset(&resp,0,sizeof(resp));
+		cJSON_SchemaDecodeItem(&respSchema,json,&resp);
+		check(memchr(resp.msg,0,sizeof(resp.msg)) != NULL,"decoded string terminated");
+		release(out);
+		release(out2);
+		release(formatted);
+		cJSON_Delete(again);
+		cJSON_Delete(copy);
+		cJSON_Delete(json);
+	}
+	check(in_use() == 0,"no leak");
+
+	/* the firmware's path: the payload arrives in pieces */
+	memset(&resp,0,sizeof(resp));
+	cJSON_SchemaBegin(&decoder,&respSchema,&resp);
+	cJSON_StreamInit(&stream,cJSON_SchemaHandler,&decoder);
+	for(i=0;i<size;i++)
+		if(cJSON_StreamFeed(&stream,(const char*)data+i,1) == CJSON_STREAM_ERROR)
+			break;
+	cJSON_StreamFinish(&stream);
+	cJSON_SchemaEnd(&decoder);
+	check(memchr(resp.msg,0,sizeof(resp.msg)) != NULL,"streamed string terminated");
+	free(text);
+}
+
+int LLVMFuzzerTestOneInput(const unsigned char *data,size_t size)
+{
+	fuzz_one(data,size);
+	return 0;
+}
+
+#ifdef JSON_FUZZ_MAIN
+static void run_file(FILE *fp)
+{
+	static unsigned char buf[1<<16];
+	size_t n = fread(buf,1,sizeof(buf),fp);
+	fuzz_one(buf,n);
+}
+
+int main(int argc,char **argv)
+{
+	FILE *fp;
+	int i;
+#ifdef CJSON_COMPACT
+	cJSON_PoolStats stats;
+#endif
+
+	if(argc < 2){
+		run_file(stdin);
+		return 0;
+	}
+	for(i=1;i<argc;i++){
+		fp = fopen(argv[i],"rb");
+		if(fp == NULL){
+			perror(argv[i]);
+			return 1;
+		}
+		run_file(fp);
+		fclose(fp);
+#ifdef CJSON_COMPACT
+		cJSON_PoolGetStats(&stats);
+		printf("%s: ok, pool peak %u nodes %u arena bytes so far\n",argv[i],stats.nodesPeak,stats.arenaPeak);
+#else
+		printf("%s: ok, heap peak %ld bytes in %ld allocations so far\n",argv[i],heapPeak,allocCount);
+#endif
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,59 @@
+/*
+ * @brief: perfect hash generator for cJSON_Schema tables (host tool)
+ *
+ * Build: gcc -O2 -IcJSON -o schema_gen tools/schema_gen.c cJSON/cJSON_Schema.c cJSON/cJSON_Stream.c
+ * Usage: schema_gen <prefix> <member> [<member>...]
+ *
+ * Members are listed in the order of the cJSON_SchemaField array. Prints the seed, table size
+ * and hash table to paste next to the schema declaration, e.g. "schema_gen resp apiId respCode"
+ * gives RESP_SCHEMA_SEED, RESP_SCHEMA_BITS and respSchemaHash[].
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "cJSON_Schema.h"
+
+int main(int argc,char **argv)
+{
+	unsigned char table[256];
+	char upper[32];
+	unsigned seed,bits,h;
+	int i,count,ok;
+
+	if(argc < 3 || argc-2 > 31){
+		fprintf(stderr,"usage: %s <prefix> <member> [<member>...] (at most 31 members)\n",argv[0]);
+		return 1;
+	}
+	for(i=0;argv[1][i] && i<(int)sizeof(upper)-1;i++)
+		upper[i] = (char)toupper((unsigned char)argv[1][i]);
+	upper[i] = '\0';
+	count = argc-2;
+	for(bits=0;(1u<<bits)<(unsigned)count;bits++){}
+	for(;bits<=8;bits++){
+		for(seed=0;seed<256;seed++){
+			memset(table,0,sizeof(table));
+			ok = 1;
+			for(i=0;i<count && ok;i++){
+				h = cJSON_SchemaHash(argv[i+2],seed)&((1u<<bits)-1);
+				if(table[h])
+					ok = 0;
+				else
+					table[h] = (unsigned char)(i+1);
+			}
+			if(!ok)
+				continue;
+			printf("/* generated by tools/schema_gen %s",argv[1]);
+			for(i=0;i<count;i++)
+				printf(" %s",argv[i+2]);
+			printf(" */\n#define %s_SCHEMA_SEED (%u)\n#define %s_SCHEMA_BITS (%u)\n",upper,seed,upper,bits);
+			printf("static const unsigned char %sSchemaHash[%u] = {",argv[1],1u<<bits);
+			for(h=0;h<(1u<<bits);h++)
+				printf("%s%d",h?",":"",table[h]);
+			printf("};\n");
+			return 0;
+		}
+	}
+	fprintf(stderr,"no perfect hash found\n");
+	return 1;
+}
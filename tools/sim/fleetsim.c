@@ -0,0 +1,957 @@
+/*
+ * @brief: fleet of virtual SWAuthDemo devices, the real firmware sources run on Linux against a server (host tool)
+ *
+ * Build: gcc -O2 -shared -fPIC -funsigned-char -Dmain=fw_main -DCJSON_NO_FLOAT -DCJSON_COMPACT -Itools/sim/include -IAir202 -IcJSON -ICRC16 -IAuthFrame -IChaskey -ILease -IIAP -IPending -ICadence -ICapture -IHistogram -ITrace -IStack -ITelemetry -o fwsim.so SWAuthDemo.c Air202/Air202.c cJSON/cJSON.c cJSON/cJSON_Pool.c cJSON/cJSON_Schema.c cJSON/cJSON_Stream.c cJSON/cJSON_Writer.c CRC16/lib_crc16.c AuthFrame/AuthFrame.c Chaskey/Chaskey.c Lease/Lease.c Pending/Pending.c Cadence/Cadence.c Capture/Capture.c Histogram/Histogram.c Trace/Trace.c Stack/Stack.c Telemetry/Telemetry.c -lm
+ *        gcc -O2 -pthread -rdynamic -Itools/sim/include -IIAP -ITelemetry -o fleetsim tools/sim/fleetsim.c tools/sim/hal.c tools/sim/modem.c tools/sim/replay.c -ldl
+ * Usage: fleetsim [-n devices] [-j threads] [-f fwsim.so] [-s host:port] [-r boots_per_s] [-R reset_s]
+ *                 [-b baud] [-p poll_ms] [-u seed] [-K keys.txt] [-t seconds] [-i stats_s] [-v count]
+ *                 [-V latency_ms] [-c console_s [-k keys]] [-P capture.log [-x scale]]
+ *        -n  devices, 1000 by default
+ *        -j  worker threads, 1 by default
+ *        -f  the firmware built as above, ./fwsim.so by default
+ *        -s  server every AT+CIPSTART connects to, 127.0.0.1 and SERVER_PORT by default
+ *        -r  devices powered on per second, all at once by default
+ *        -R  power a device off and on that many seconds after its connection is lost or fails,
+ *            the firmware does not connect again by itself; 0(default) leaves it offline
+ *        -b  UART baud rate, 115200 by default, 0 moves the modem output at once
+ *        -p  milliseconds an idle main loop sleeps when the modem has nothing, 20 by default
+ *        -u  seed of the UIDs and MAC keys, and of the latencies of -V, 1 by default
+ *        -K  write "UID KEY" lines of every device for authserver -k
+ *        -t  seconds to run, of device time with -V, until SIGINT by default
+ *        -i  seconds between statistics lines, 1 by default
+ *        -v  print the DEBUGOUT output of the devices below count, pipe it through tools/trace_decode
+ *            for the text of the trace records
+ *        -V  virtual clock, the network answers in latency_ms give or take half
+ *        -c  type 'c' on the debug console of the devices of -v every console_s seconds, they dump
+ *            their UART capture into the output
+ *        -k  type keys instead, e.g. "h" prints the latency histograms, "ch" both
+ *        -P  replay the last UART capture dump in a log into the receive path of one device(replay.c)
+ *        -x  replay with the times between the records multiplied by scale, 0 all at once
+ *
+ * Each device runs SWAuthDemo.c main() unchanged with Air202.c, cJSON and lib_crc16 as they are
+ * in the image(built with the defines of the Keil project, SWAuthDemo.uvprojx), on an emulated
+ * Air202 (modem.c) that has a real TCP connection to the server, with its own UID and key record
+ * in its own flash and a lease sector that outlives restarts.
+ * Their globals (authInfo, rxring, ATRXBuffer, socketBuffer...) become per-device by swapping:
+ * the firmware is a shared library and the writable part of it, .data and .bss, is copied out
+ * and the next device's copied in whenever a worker switches device. That is the firmware's
+ * RAM, a few KB. Every worker loads its own copy of the library (from a memfd, so it is a
+ * separate object) and runs its share of the devices as ucontext coroutines from one epoll
+ * loop, so workers run in parallel and share nothing. Devices only switch where the firmware
+ * waits, in delay_ms and userIdle (hal.c).
+ *
+ * With -V time is a virtual clock each worker moves on to the next device that wakes once none can
+ * run, so a 15s request timeout or an hour of authorization periods pass as fast as the CPU runs
+ * the firmware. The server is still real but its answers are held back until a latency drawn from
+ * the seed has passed, and the clock waits(in real time) for answers still on their way, so what a
+ * device does and when is the same on every run with the same -n -j -u -r -p -V, and the -v output
+ * can be compared between runs. -t, -i and the rates printed are then in device time.
+ *
+ * Printed every period: devices online, connects per second (a reconnect storm shows there),
+ * connect failures, connections lost, messages sent and authorizations completed per second,
+ * and p50/p99 of the round trip from a send to the first bytes of its reply and of how late the
+ * devices ran. On exit the totals, the distribution of the time from CONNECT OK to the first
+ * authorization, and what one device costs in memory. The first telemetry record a device closes
+ * after CONNECT OK must have samples of the link that all found it registered, as the emulated
+ * network always does; the devices whose record did not are counted and fleetsim exits with 1.
+ */
+
+#define _GNU_SOURCE     /* memfd_create,dlinfo */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "board.h"
+#include "sim.h"
+
+#define SERVER_PORT         (31318)     /* keep in step with SWAuthDemo.c */
+#define THREADS_MAX         (64)
+#define EVENTS_MAX          (256)
+#define VIRTUAL_WAIT_MS     (2000)      /* real time the virtual clock waits for an answer of the server */
+
+SIM_CONFIG_T simConfig;
+__thread WORKER_T *simWorker;
+
+static WORKER_T workers[THREADS_MAX];
+static int threads = 1,devices = 1000,bootRate;
+static uint64_t seed = 1;
+static uint8_t *fwFile;
+static size_t fwFileSize;
+static long long startUs;
+static volatile sig_atomic_t stopping;
+
+long long Sim_realUs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1000000LL+ts.tv_nsec/1000;
+}
+
+/* us of the worker clock,the wall clock or the virtual one */
+long long Sim_nowUs(void)
+{
+	if(simConfig.virtualClock && simWorker != NULL)
+		return simWorker->now*1000;
+	return Sim_realUs();
+}
+
+/* ms since the start,the clock of every worker */
+long long Sim_nowMs(void)
+{
+	if(simConfig.virtualClock && simWorker != NULL)
+		return simWorker->now;
+	return (Sim_realUs()-startUs)/1000;
+}
+
+void Sim_count(unsigned long *c,unsigned long n)
+{
+	__atomic_store_n(c,*c+n,__ATOMIC_RELAXED);  /* one writer,the reader only needs whole words */
+}
+
+/*****************************************************************************
+ * histograms,log-linear with 1/8 power of two buckets
+ ****************************************************************************/
+
+static int hist_index(unsigned long long v)
+{
+	int b;
+	if(v < 16)
+		return (int)v;
+	b = 63-__builtin_clzll(v);
+	return 16+((b-4)<<HIST_SUB_BITS)+(int)((v>>(b-HIST_SUB_BITS)) & ((1<<HIST_SUB_BITS)-1));
+}
+
+/* middle of bucket i */
+static double hist_value(int i)
+{
+	int b,sub;
+	if(i < 16)
+		return i;
+	b = ((i-16)>>HIST_SUB_BITS)+4;
+	sub = (i-16) & ((1<<HIST_SUB_BITS)-1);
+	return (double)(((1ULL<<HIST_SUB_BITS)+sub)<<(b-HIST_SUB_BITS))+(double)(1ULL<<(b-HIST_SUB_BITS))/2;
+}
+
+static double hist_percentile(const unsigned long *hist,unsigned long total,double p)
+{
+	unsigned long want = (unsigned long)(total*p),seen = 0;
+	int i;
+	if(total == 0)
+		return 0;
+	for(i=0;i<HIST_SIZE;i++){
+		seen += hist[i];
+		if(seen > want)
+			return hist_value(i);
+	}
+	return hist_value(HIST_SIZE-1);
+}
+
+void Sim_hist(unsigned long *hist,unsigned long long us)
+{
+	Sim_count(&hist[hist_index(us)],1);
+}
+
+/*****************************************************************************
+ * device identities
+ ****************************************************************************/
+
+static uint64_t mix64(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x^(x>>30))*0xBF58476D1CE4E5B9ULL;
+	x = (x^(x>>27))*0x94D049BB133111EBULL;
+	return x^(x>>31);
+}
+
+/**
+ * @brief	  virtual clock: ms the network takes to answer the instance,simConfig.latencyMs give or take
+                half,the same every run with the same seed
+ * @return	the latency
+ */
+int Sim_latency(INSTANCE_T *inst)
+{
+	uint64_t r = mix64(seed^mix64(((uint64_t)inst->id<<32) | inst->draws++));
+	return simConfig.latencyMs/2+(int)(r%(uint64_t)(simConfig.latencyMs+1));
+}
+
+/* UID: 8 bytes of the seed,then the device number,both big-endian; the key is random-looking */
+static void identity(int id,uint8_t *uid,uint8_t *key)
+{
+	uint64_t prefix = mix64(seed),k0 = mix64(seed^mix64(2*(uint64_t)id+1)),k1 = mix64(seed^mix64(2*(uint64_t)id+2));
+	int i;
+	for(i=0;i<8;i++){
+		uid[i] = (uint8_t)(prefix>>(56-8*i));
+		uid[8+i] = (uint8_t)((uint64_t)id>>(56-8*i));
+		key[i] = (uint8_t)(k0>>(56-8*i));
+		key[8+i] = (uint8_t)(k1>>(56-8*i));
+	}
+}
+
+static char *put_hex(char *p,const uint8_t *data,int n)
+{
+	int i;
+	for(i=0;i<n;i++){
+		*p++ = "0123456789ABCDEF"[data[i]>>4];
+		*p++ = "0123456789ABCDEF"[data[i]&0x0F];
+	}
+	return p;
+}
+
+/* the UID and key records getUID() and getKey() read,the lease sector blank */
+static void provision(WORKER_T *w,INSTANCE_T *inst)
+{
+	uint8_t uid[16],key[16],*flash = inst->flash;
+	char hex[32];
+	uint16_t crc;
+
+	memset(flash,0xFF,SIM_FLASH_SIZE);
+	identity(inst->id,uid,key);
+	put_hex(hex,uid,16);
+	memcpy(flash+SIM_FLASH_UID,hex,32);
+	crc = w->fw.crc16(hex,32);
+	flash[SIM_FLASH_UID+32] = (uint8_t)(crc>>8);
+	flash[SIM_FLASH_UID+33] = (uint8_t)crc;
+	memcpy(flash+SIM_FLASH_KEY,key,16);
+	crc = w->fw.crc16((char*)key,16);
+	flash[SIM_FLASH_KEY+16] = (uint8_t)(crc>>8);
+	flash[SIM_FLASH_KEY+17] = (uint8_t)crc;
+}
+
+static int write_keys(const char *path)
+{
+	FILE *fp = fopen(path,"w");
+	uint8_t uid[16],key[16];
+	char line[80],*p;
+	int i;
+
+	if(fp == NULL){
+		perror(path);
+		return -1;
+	}
+	for(i=0;i<devices;i++){
+		identity(i,uid,key);
+		p = put_hex(line,uid,16);
+		*p++ = ' ';
+		p = put_hex(p,key,16);
+		*p++ = '\n';
+		fwrite(line,1,(size_t)(p-line),fp);
+	}
+	return fclose(fp)?-1:0;
+}
+
+/*****************************************************************************
+ * firmware
+ ****************************************************************************/
+
+typedef struct RAM_FIND{
+	uintptr_t base;
+	FIRMWARE_T *fw;
+}RAM_FIND_T;
+
+/* the writable PT_LOAD of the library past its RELRO part: .data and .bss */
+static int find_ram(struct dl_phdr_info *info,size_t size,void *arg)
+{
+	RAM_FIND_T *find = (RAM_FIND_T*)arg;
+	uintptr_t start = 0,end = 0,relro = 0;
+	int i;
+	(void)size;
+
+	if(info->dlpi_addr != find->base)
+		return 0;
+	for(i=0;i<info->dlpi_phnum;i++){
+		const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+		if(ph->p_type == PT_LOAD && (ph->p_flags & PF_W)){
+			start = info->dlpi_addr+ph->p_vaddr;
+			end = start+ph->p_memsz;
+		}else if(ph->p_type == PT_GNU_RELRO){
+			relro = info->dlpi_addr+ph->p_vaddr+ph->p_memsz;
+		}
+	}
+	if(relro > start)
+		start = relro;
+	find->fw->ram = (uint8_t*)start;
+	find->fw->ramSize = end > start?end-start:0;
+	return 1;
+}
+
+static int firmware_load(FIRMWARE_T *fw)
+{
+	struct link_map *lm;
+	const ElfW(Sym) *sym = NULL;
+	Dl_info info;
+	RAM_FIND_T find;
+	char path[64];
+	int fd = memfd_create("fwsim",MFD_CLOEXEC);
+
+	if(fd < 0 || write(fd,fwFile,fwFileSize) != (ssize_t)fwFileSize){
+		perror("memfd");
+		return -1;
+	}
+	snprintf(path,sizeof(path),"/proc/self/fd/%d",fd);
+	fw->handle = dlopen(path,RTLD_NOW|RTLD_LOCAL);
+	close(fd);
+	if(fw->handle == NULL){
+		fprintf(stderr,"%s\n",dlerror());
+		return -1;
+	}
+	fw->main = (int(*)(void))dlsym(fw->handle,"fw_main");
+	fw->sysTick = (void(*)(void))dlsym(fw->handle,"SysTick_Handler");
+	fw->uartIrq = (void(*)(void))dlsym(fw->handle,"UART2_IRQHandler");
+	fw->userIdle = (void(*)(void))dlsym(fw->handle,"userIdle");
+	fw->crc16 = (uint16_t(*)(char*,unsigned int))dlsym(fw->handle,"calculate_crc16");
+	fw->authStatus = (const volatile int*)dlsym(fw->handle,"authInfo");
+	fw->rxRing = (RINGBUFF_T*)dlsym(fw->handle,"rxring");
+	fw->rxUnread = (const int*)dlsym(fw->handle,"rxUnreadCount");
+	fw->rxBuff = (char*)dlsym(fw->handle,"rxbuff");
+	fw->recv = (int(*)(void))dlsym(fw->handle,"checkSockRecvData");
+	fw->poolInit = (void(*)(void))dlsym(fw->handle,"cJSON_PoolInit");
+	fw->inBuffer = (const char*)dlsym(fw->handle,"socketBuffer");
+	fw->telemetry = (const TELEMETRY_T*)dlsym(fw->handle,"telemetry");
+	if(fw->rxBuff != NULL && dladdr1(fw->rxBuff,&info,(void**)&sym,RTLD_DL_SYMENT) && sym != NULL)
+		fw->rxBuffSize = (int)sym->st_size;
+	if(fw->main == NULL || fw->sysTick == NULL || fw->uartIrq == NULL || fw->userIdle == NULL ||
+		fw->crc16 == NULL || fw->authStatus == NULL){
+		fprintf(stderr,"not SWAuthDemo built with -Dmain=fw_main\n");
+		return -1;
+	}
+	if(dlinfo(fw->handle,RTLD_DI_LINKMAP,&lm))
+		return -1;
+	find.base = lm->l_addr;
+	find.fw = fw;
+	if(!dl_iterate_phdr(find_ram,&find) || fw->ramSize == 0){
+		fprintf(stderr,"no writable segment in the firmware\n");
+		return -1;
+	}
+	fw->image = (uint8_t*)malloc(fw->ramSize);
+	if(fw->image == NULL)
+		return -1;
+	memcpy(fw->image,fw->ram,fw->ramSize);
+	return 0;
+}
+
+static int read_file(const char *path)
+{
+	struct stat st;
+	int fd = open(path,O_RDONLY);
+	if(fd < 0 || fstat(fd,&st)){
+		perror(path);
+		return -1;
+	}
+	fwFileSize = (size_t)st.st_size;
+	fwFile = (uint8_t*)malloc(fwFileSize);
+	if(fwFile == NULL || read(fd,fwFile,fwFileSize) != (ssize_t)fwFileSize){
+		perror(path);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+/*****************************************************************************
+ * scheduler
+ ****************************************************************************/
+
+static void heap_set(WORKER_T *w,int i,INSTANCE_T *inst)
+{
+	w->heap[i] = inst;
+	inst->heapPos = i;
+}
+
+static void heap_up(WORKER_T *w,int i)
+{
+	INSTANCE_T *inst = w->heap[i];
+	while(i > 0 && w->heap[(i-1)/2]->wakeAt > inst->wakeAt){
+		heap_set(w,i,w->heap[(i-1)/2]);
+		i = (i-1)/2;
+	}
+	heap_set(w,i,inst);
+}
+
+static void heap_down(WORKER_T *w,int i)
+{
+	INSTANCE_T *inst = w->heap[i];
+	int c;
+	while((c = 2*i+1) < w->heapCount){
+		if(c+1 < w->heapCount && w->heap[c+1]->wakeAt < w->heap[c]->wakeAt)
+			c++;
+		if(w->heap[c]->wakeAt >= inst->wakeAt)
+			break;
+		heap_set(w,i,w->heap[c]);
+		i = c;
+	}
+	heap_set(w,i,inst);
+}
+
+static void heap_remove(WORKER_T *w,INSTANCE_T *inst)
+{
+	int i = inst->heapPos;
+	INSTANCE_T *last = w->heap[--w->heapCount];
+	inst->heapPos = -1;
+	if(last == inst)
+		return;
+	heap_set(w,i,last);
+	heap_up(w,i);
+	heap_down(w,last->heapPos);
+}
+
+static void enqueue(WORKER_T *w,INSTANCE_T *inst)
+{
+	if(inst->queued)
+		return;
+	inst->queued = 1;
+	w->runq[(w->runHead+w->runCount++)%w->count] = inst;
+}
+
+static INSTANCE_T *dequeue(WORKER_T *w)
+{
+	INSTANCE_T *inst = w->runq[w->runHead];
+	w->runHead = (w->runHead+1)%w->count;
+	w->runCount--;
+	inst->queued = 0;
+	return inst;
+}
+
+/**
+ * @brief	  give up the worker until the clock reaches until(ms),or the modem has news with wakeOnData
+ * @return	Nothing
+ */
+void Sim_sleep(INSTANCE_T *inst,long long until,int wakeOnData)
+{
+	WORKER_T *w = inst->worker;
+	if(wakeOnData && inst->dataAt && inst->dataAt < until)
+		until = inst->dataAt;
+	inst->wakeAt = until;
+	inst->wakeOnData = wakeOnData;
+	heap_set(w,w->heapCount++,inst);
+	heap_up(w,inst->heapPos);
+	swapcontext(&inst->ctx,&w->sched);
+}
+
+void Sim_wake(INSTANCE_T *inst)
+{
+	if(inst->heapPos >= 0 && inst->wakeOnData){
+		heap_remove(inst->worker,inst);
+		enqueue(inst->worker,inst);
+	}
+}
+
+/* wake a sleeping inst that waits for the modem by at(ms) at the latest */
+void Sim_wakeAt(INSTANCE_T *inst,long long at)
+{
+	if(inst->heapPos < 0 || !inst->wakeOnData || inst->wakeAt <= at)
+		return;
+	inst->wakeAt = at;
+	heap_up(inst->worker,inst->heapPos);
+}
+
+static void instance_entry(void)
+{
+	if(simConfig.replay)
+		Replay_run();
+	else
+		simWorker->fw.main();   //does not return on the device,stays stopped if it does
+}
+
+void Sim_stop(void)
+{
+	stopping = 1;
+}
+
+/* power on: the RAM as loaded,a fresh stack and modem,the flash kept */
+static void boot(WORKER_T *w,INSTANCE_T *inst)
+{
+	Modem_reset(inst);
+	memcpy(w->resident == inst?w->fw.ram:inst->ram,w->fw.image,w->fw.ramSize);
+	getcontext(&inst->ctx);
+	inst->ctx.uc_stack.ss_sp = inst->stack;
+	inst->ctx.uc_stack.ss_size = SIM_STACK_SIZE;
+	inst->ctx.uc_link = &w->sched;
+	makecontext(&inst->ctx,instance_entry,0);
+	inst->booted = 1;
+	inst->ms = 0;
+	inst->uartBytes = 0;
+	inst->consoleAt = 0;
+	inst->consoleKey = 0;
+	inst->bootAt = w->now;
+	inst->resetAt = 0;
+	inst->authStatus = -1;
+	inst->tlmCheck = 0;
+	inst->tlmStart = 0;
+	Sim_count(&w->stats.boots,1);
+}
+
+/* the first telemetry record closed after CONNECT OK,its samples(offset 5) and those not registered(6) */
+static void check_telemetry(WORKER_T *w,INSTANCE_T *inst)
+{
+	const TELEMETRY_T *t = w->fw.telemetry;
+	const uint8_t *record;
+
+	if(t->win.start == inst->tlmStart)
+		return;
+	inst->tlmStart = t->win.start;  //a window closed
+	if(!inst->tlmCheck || t->queued == 0)
+		return;
+	inst->tlmCheck = 0;
+	record = t->queue[t->queued-1];
+	Sim_count(&w->stats.tlmFirst,1);
+	if(record[5] == 0 || record[6] != 0)
+		Sim_count(&w->stats.tlmUnregistered,1);
+}
+
+static void run(WORKER_T *w,INSTANCE_T *inst)
+{
+	int status;
+
+	if(w->now > inst->wakeAt)
+		Sim_hist(w->stats.lag,(unsigned long long)(w->now-inst->wakeAt)*1000);
+	if(!inst->booted || (inst->resetAt && w->now >= inst->resetAt))
+		boot(w,inst);
+	if(w->resident != inst){
+		if(w->resident != NULL)
+			memcpy(w->resident->ram,w->fw.ram,w->fw.ramSize);
+		memcpy(w->fw.ram,inst->ram,w->fw.ramSize);
+		w->resident = inst;
+	}
+	w->cur = inst;
+	swapcontext(&w->sched,&inst->ctx);
+	w->cur = NULL;
+	status = *w->fw.authStatus;
+	if(status == SIM_AUTH_SUCCESS && inst->authStatus != SIM_AUTH_SUCCESS){
+		Sim_count(&w->stats.authorized,1);
+		if(inst->connectedAt){
+			Sim_hist(w->stats.auth,(unsigned long long)(Sim_nowUs()-inst->connectedAt));
+			inst->connectedAt = 0;
+		}
+	}
+	inst->authStatus = status;
+	if(w->fw.telemetry != NULL)
+		check_telemetry(w,inst);
+}
+
+/* bytes of the device stacks that were ever touched */
+static void stack_usage(WORKER_T *w)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	unsigned char vec[SIM_STACK_SIZE/4096];
+	unsigned long bytes;
+	int i,j;
+
+	for(i=0;i<w->count;i++){
+		if(mincore(w->inst[i].stack,SIM_STACK_SIZE,vec))
+			return;
+		bytes = 0;
+		for(j=0;j<(int)(SIM_STACK_SIZE/page);j++)
+			bytes += (vec[j] & 1)?(unsigned long)page:0;
+		w->stats.stackSum += bytes;
+		if(bytes > w->stats.stackMax)
+			w->stats.stackMax = bytes;
+	}
+}
+
+/* virtual clock: stop waiting for answers the server did not give in VIRTUAL_WAIT_MS */
+static void give_up(WORKER_T *w)
+{
+	long long now = Sim_realUs();
+	int i;
+	for(i=0;i<w->count;i++){
+		MODEM_T *m = &w->inst[i].modem;
+		if(m->awaiting && now-m->awaitSince > VIRTUAL_WAIT_MS*1000LL){
+			m->awaiting = 0;
+			w->awaiting--;
+		}
+	}
+}
+
+/**
+ * @brief	  virtual clock: move to the next wake-up,unless an answer is on its way from the server,
+                which is waited for in real time as the clock cannot pass its delivery without it
+ * @return	ms epoll may wait
+ */
+static long long clock_advance(WORKER_T *w)
+{
+	if(w->runCount > 0)
+		return 0;
+	if(w->awaiting > 0){
+		give_up(w);
+		return 10;
+	}
+	if(w->heapCount > 0 && (simConfig.stopMs == 0 || w->heap[0]->wakeAt < simConfig.stopMs)){
+		if(w->heap[0]->wakeAt > w->now)
+			__atomic_store_n(&w->now,w->heap[0]->wakeAt,__ATOMIC_RELAXED);
+		return 0;
+	}
+	if(simConfig.stopMs){
+		__atomic_store_n(&w->now,simConfig.stopMs,__ATOMIC_RELAXED);
+		return 0;
+	}
+	return 100;     //every instance stopped,only the server can still do something
+}
+
+static void *worker_main(void *arg)
+{
+	WORKER_T *w = (WORKER_T*)arg;
+	struct epoll_event events[EVENTS_MAX];
+	long long timeout = 0;
+	int i,n;
+
+	simWorker = w;
+	while(!stopping && !(simConfig.stopMs && w->now >= simConfig.stopMs)){
+		if(simConfig.virtualClock)
+			timeout = clock_advance(w);
+		else
+			w->now = Sim_nowMs();
+		while(w->heapCount > 0 && w->heap[0]->wakeAt <= w->now){
+			INSTANCE_T *inst = w->heap[0];
+			heap_remove(w,inst);
+			enqueue(w,inst);
+		}
+		if(!simConfig.virtualClock){
+			timeout = 100;
+			if(w->runCount > 0)
+				timeout = 0;
+			else if(w->heapCount > 0 && w->heap[0]->wakeAt-w->now < timeout)
+				timeout = w->heap[0]->wakeAt-w->now;
+		}
+		n = epoll_wait(w->ep,events,EVENTS_MAX,(int)timeout);
+		for(i=0;i<n;i++)
+			Modem_event((INSTANCE_T*)events[i].data.ptr,events[i].events);
+		for(n=w->runCount;n>0 && !stopping;n--){
+			w->now = Sim_nowMs();
+			run(w,dequeue(w));
+		}
+	}
+	stack_usage(w);
+	return NULL;
+}
+
+static int worker_init(WORKER_T *w,int first,int count)
+{
+	uint8_t *flash,*stacks,*ram;
+	int i;
+
+	w->count = count;
+	if(firmware_load(&w->fw))
+		return -1;
+	w->ep = epoll_create1(EPOLL_CLOEXEC);
+	w->inst = (INSTANCE_T*)calloc((size_t)count,sizeof(INSTANCE_T));
+	w->runq = (INSTANCE_T**)malloc((size_t)count*sizeof(INSTANCE_T*));
+	w->heap = (INSTANCE_T**)malloc((size_t)count*sizeof(INSTANCE_T*));
+	ram = (uint8_t*)malloc((size_t)count*w->fw.ramSize);
+	flash = (uint8_t*)mmap(NULL,(size_t)count*SIM_FLASH_SIZE,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	stacks = (uint8_t*)mmap(NULL,(size_t)count*SIM_STACK_SIZE,PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_STACK,-1,0);
+	if(w->ep < 0 || w->inst == NULL || w->runq == NULL || w->heap == NULL || ram == NULL || flash == MAP_FAILED ||
+		stacks == MAP_FAILED){
+		perror("worker");
+		return -1;
+	}
+	for(i=0;i<count;i++){
+		INSTANCE_T *inst = &w->inst[i];
+		inst->id = first+i;
+		inst->worker = w;
+		inst->ram = ram+(size_t)i*w->fw.ramSize;
+		inst->flash = flash+(size_t)i*SIM_FLASH_SIZE;
+		inst->stack = stacks+(size_t)i*SIM_STACK_SIZE;
+		Modem_init(&inst->modem);
+		provision(w,inst);
+		inst->wakeAt = bootRate?(long long)inst->id*1000/bootRate:0;
+		heap_set(w,w->heapCount++,inst);
+		heap_up(w,inst->heapPos);
+	}
+	return 0;
+}
+
+/*****************************************************************************
+ * statistics
+ ****************************************************************************/
+
+static void stats_sum(SIM_STATS_T *sum)
+{
+	int i,j;
+	memset(sum,0,sizeof(SIM_STATS_T));
+	for(i=0;i<threads;i++){
+		const SIM_STATS_T *s = &workers[i].stats;
+		sum->boots += __atomic_load_n(&s->boots,__ATOMIC_RELAXED);
+		sum->connects += __atomic_load_n(&s->connects,__ATOMIC_RELAXED);
+		sum->connected += __atomic_load_n(&s->connected,__ATOMIC_RELAXED);
+		sum->failed += __atomic_load_n(&s->failed,__ATOMIC_RELAXED);
+		sum->closed += __atomic_load_n(&s->closed,__ATOMIC_RELAXED);
+		sum->down += __atomic_load_n(&s->down,__ATOMIC_RELAXED);
+		sum->sent += __atomic_load_n(&s->sent,__ATOMIC_RELAXED);
+		sum->authorized += __atomic_load_n(&s->authorized,__ATOMIC_RELAXED);
+		sum->tlmFirst += __atomic_load_n(&s->tlmFirst,__ATOMIC_RELAXED);
+		sum->tlmUnregistered += __atomic_load_n(&s->tlmUnregistered,__ATOMIC_RELAXED);
+		sum->stackSum += s->stackSum;
+		if(s->stackMax > sum->stackMax)
+			sum->stackMax = s->stackMax;
+		for(j=0;j<HIST_SIZE;j++){
+			sum->rtt[j] += __atomic_load_n(&s->rtt[j],__ATOMIC_RELAXED);
+			sum->auth[j] += __atomic_load_n(&s->auth[j],__ATOMIC_RELAXED);
+			sum->lag[j] += __atomic_load_n(&s->lag[j],__ATOMIC_RELAXED);
+		}
+	}
+}
+
+/* count,p50,p90,p99 and max of now-before in ms */
+static void hist_print(const char *label,const unsigned long *now,const unsigned long *before)
+{
+	static unsigned long hist[HIST_SIZE];
+	unsigned long total = 0;
+	int i,top = 0;
+	for(i=0;i<HIST_SIZE;i++){
+		hist[i] = now[i]-before[i];
+		total += hist[i];
+		if(hist[i])
+			top = i;
+	}
+	printf("%s %lu p50 %.1fms p90 %.1fms p99 %.1fms max %.1fms\n",label,total,hist_percentile(hist,total,0.5)/1e3,
+		hist_percentile(hist,total,0.9)/1e3,hist_percentile(hist,total,0.99)/1e3,total?hist_value(top)/1e3:0.0);
+}
+
+static double hist_delta_percentile(const unsigned long *now,const unsigned long *before,double p)
+{
+	static unsigned long hist[HIST_SIZE];
+	unsigned long total = 0;
+	int i;
+	for(i=0;i<HIST_SIZE;i++){
+		hist[i] = now[i]-before[i];
+		total += hist[i];
+	}
+	return hist_percentile(hist,total,p);
+}
+
+static void stats_print(const SIM_STATS_T *now,const SIM_STATS_T *before,double seconds,double at)
+{
+	printf("%7.1fs online %lu connect %lu(%.0f/s) fail %lu lost %lu sent %.0f/s auth %.0f/s rtt p50 %.1fms p99 %.1fms "
+		"late p99 %.1fms\n",at,now->connected-now->down,now->connects-before->connects,
+		(now->connects-before->connects)/seconds,now->failed-before->failed,now->closed-before->closed,
+		(now->sent-before->sent)/seconds,(now->authorized-before->authorized)/seconds,
+		hist_delta_percentile(now->rtt,before->rtt,0.5)/1e3,hist_delta_percentile(now->rtt,before->rtt,0.99)/1e3,
+		hist_delta_percentile(now->lag,before->lag,0.99)/1e3);
+	fflush(stdout);
+}
+
+static long resident_bytes(void)
+{
+	long pages = 0,rss = 0;
+	FILE *fp = fopen("/proc/self/statm","r");
+	if(fp == NULL)
+		return 0;
+	if(fscanf(fp,"%ld %ld",&pages,&rss) != 2)
+		rss = 0;
+	fclose(fp);
+	return rss*sysconf(_SC_PAGESIZE);
+}
+
+/* virtual clock: where the slowest worker is,in us */
+static long long virtual_us(void)
+{
+	long long t,min = -1;
+	int i;
+	for(i=0;i<threads;i++){
+		t = __atomic_load_n(&workers[i].now,__ATOMIC_RELAXED);
+		if(min < 0 || t < min)
+			min = t;
+	}
+	return min*1000;
+}
+
+/*****************************************************************************
+ * main
+ ****************************************************************************/
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stopping = 1;
+}
+
+static void raise_nofile(void)
+{
+	struct rlimit rl;
+	if(getrlimit(RLIMIT_NOFILE,&rl))
+		return;
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE,&rl);
+	if(rl.rlim_cur < (rlim_t)devices+100)
+		fprintf(stderr,"descriptor limit %lu,raise the hard limit for %d devices\n",(unsigned long)rl.rlim_cur,devices);
+}
+
+static int parse_server(const char *arg)
+{
+	struct addrinfo hints,*res;
+	char host[256],*colon;
+	const char *port = "31318";
+
+	snprintf(host,sizeof(host),"%s",arg);
+	colon = strrchr(host,':');
+	if(colon != NULL){
+		*colon = '\0';
+		port = colon+1;
+	}
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if(getaddrinfo(host,port,&hints,&res)){
+		fprintf(stderr,"%s: unknown server\n",arg);
+		return -1;
+	}
+	memcpy(&simConfig.server,res->ai_addr,sizeof(simConfig.server));
+	freeaddrinfo(res);
+	return 0;
+}
+
+int main(int argc,char **argv)
+{
+	static SIM_STATS_T zero,last,now;
+	const char *fwPath = "./fwsim.so",*keyFile = NULL,*replayFile = NULL;
+	long long lastAt,t;
+	double rate,peak = 0;
+	int opt,i,seconds = 0,statsPeriod = 1,first = 0,share;
+	long rss;
+
+	simConfig.server.sin_family = AF_INET;
+	simConfig.server.sin_port = htons(SERVER_PORT);
+	simConfig.server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	simConfig.baud = 115200;
+	simConfig.pollMs = 20;
+	simConfig.replayScale = 1;
+	simConfig.consoleKeys = CONSOLE_KEYS;
+	while((opt = getopt(argc,argv,"n:j:f:s:r:R:b:p:u:K:t:i:v:V:c:k:P:x:")) != -1){
+		switch(opt){
+		case 'n': devices = atoi(optarg); break;
+		case 'j': threads = atoi(optarg); break;
+		case 'f': fwPath = optarg; break;
+		case 's': if(parse_server(optarg)) return 1; break;
+		case 'r': bootRate = atoi(optarg); break;
+		case 'R': simConfig.resetS = atoi(optarg); break;
+		case 'b': simConfig.baud = atoi(optarg); break;
+		case 'p': simConfig.pollMs = atoi(optarg); break;
+		case 'u': seed = strtoull(optarg,NULL,0); break;
+		case 'K': keyFile = optarg; break;
+		case 't': seconds = atoi(optarg); break;
+		case 'i': statsPeriod = atoi(optarg); break;
+		case 'v': simConfig.trace = atoi(optarg); break;
+		case 'V': simConfig.virtualClock = 1; simConfig.latencyMs = atoi(optarg); break;
+		case 'c': simConfig.consoleS = atoi(optarg); break;
+		case 'k': simConfig.consoleKeys = optarg; break;
+		case 'P': replayFile = optarg; break;
+		case 'x': simConfig.replayScale = atof(optarg); break;
+		default:
+			fprintf(stderr,"usage: %s [-n devices] [-j threads] [-f fwsim.so] [-s host:port] [-r boots_per_s] [-R reset_s] "
+				"[-b baud] [-p poll_ms] [-u seed] [-K keys.txt] [-t seconds] [-i stats_s] [-v count] [-V latency_ms] "
+				"[-c console_s [-k keys]] [-P capture.log [-x scale]]\n",argv[0]);
+			return 2;
+		}
+	}
+	if(replayFile != NULL){
+		simConfig.replay = 1;
+		devices = 1;
+	}
+	if(simConfig.consoleKeys[0] == '\0')
+		simConfig.consoleS = 0;
+	if(devices < 1)
+		devices = 1;
+	if(threads < 1)
+		threads = 1;
+	if(threads > THREADS_MAX)
+		threads = THREADS_MAX;
+	if(threads > devices)
+		threads = devices;
+	if(statsPeriod < 1)
+		statsPeriod = 1;
+	if(simConfig.pollMs < 1)
+		simConfig.pollMs = 1;
+	if(simConfig.latencyMs < 0)
+		simConfig.latencyMs = 0;
+	if(simConfig.virtualClock)
+		simConfig.stopMs = seconds*1000LL;
+	if(keyFile != NULL && write_keys(keyFile))
+		return 1;
+	if(read_file(fwPath))
+		return 1;
+	raise_nofile();
+	signal(SIGINT,on_signal);
+	signal(SIGTERM,on_signal);
+	signal(SIGPIPE,SIG_IGN);
+
+	startUs = Sim_realUs();
+	for(i=0;i<threads;i++){
+		share = devices/threads+(i < devices%threads);
+		workers[i].id = i;
+		if(worker_init(&workers[i],first,share))
+			return 1;
+		first += share;
+	}
+	if(replayFile != NULL && Replay_load(replayFile,&workers[0].fw))
+		return 1;
+	fprintf(stderr,"%d devices,%d workers,firmware RAM %zu bytes,server %s:%d",devices,threads,workers[0].fw.ramSize,
+		inet_ntoa(simConfig.server.sin_addr),ntohs(simConfig.server.sin_port));
+	if(simConfig.virtualClock)
+		fprintf(stderr,",virtual clock,latency %dms",simConfig.latencyMs);
+	fprintf(stderr,"\n");
+	startUs = Sim_realUs();
+	for(i=0;i<threads;i++){
+		if(pthread_create(&workers[i].tid,NULL,worker_main,&workers[i])){
+			perror("thread");
+			return 1;
+		}
+	}
+	if(replayFile != NULL){
+		pthread_join(workers[0].tid,NULL);
+		Replay_report();
+		return 0;
+	}
+	lastAt = 0;
+	while(!stopping){
+		if(simConfig.virtualClock){    //a line every statsPeriod of virtual time
+			do{
+				usleep(1000);
+				t = virtual_us();
+			}while(!stopping && t-lastAt < statsPeriod*1000000LL && (seconds == 0 || t < seconds*1000000LL));
+		}else{
+			for(i=0;i<statsPeriod*10 && !stopping;i++)
+				usleep(100000);
+			t = Sim_realUs()-startUs;
+		}
+		if(t <= lastAt)
+			continue;
+		stats_sum(&now);
+		stats_print(&now,&last,(t-lastAt)/1e6,t/1e6);
+		rate = (now.connects-last.connects)/((t-lastAt)/1e6);
+		if(rate > peak)
+			peak = rate;
+		last = now;
+		lastAt = t;
+		if(seconds > 0 && t >= seconds*1000000LL)
+			stopping = 1;
+	}
+	if(simConfig.virtualClock)
+		fprintf(stderr,"%.1fs of device time in %.3fs\n",virtual_us()/1e6,(Sim_realUs()-startUs)/1e6);
+	for(i=0;i<threads;i++)
+		pthread_join(workers[i].tid,NULL);
+	rss = resident_bytes();
+	stats_sum(&now);
+	printf("total   boots %lu connects %lu(peak %.0f/s) fail %lu lost %lu sent %lu authorized %lu\n",now.boots,now.connects,
+		peak,now.failed,now.closed,now.sent,now.authorized);
+	hist_print("rtt    ",now.rtt,zero.rtt);
+	hist_print("auth   ",now.auth,zero.auth);
+	hist_print("late   ",now.lag,zero.lag);
+	printf("memory  per device: firmware RAM %zu, context %zu, flash %d, stack %lu(max %lu) of %d, process RSS %ld bytes\n",
+		workers[0].fw.ramSize,sizeof(INSTANCE_T),SIM_FLASH_SIZE,now.stackSum/devices,now.stackMax,SIM_STACK_SIZE,rss/devices);
+	if(now.tlmFirst)
+		printf("telemetry first records after CONNECT OK %lu,not registered %lu\n",now.tlmFirst,now.tlmUnregistered);
+	return now.tlmUnregistered?1:0;
+}
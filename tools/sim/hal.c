@@ -0,0 +1,265 @@
+/*
+ * @brief: chip and board layer of the fleet simulator, what the firmware calls on the host
+ *
+ * Every call runs on the instance the calling worker switched to. Time only passes for an instance
+ * in the two places the firmware waits: delay_ms and userIdle, both defined here again so they take
+ * the place of the firmware's own(the executable is searched before the firmware library). There
+ * the instance runs the SysTick interrupts of the milliseconds that have passed, with the UART
+ * interrupt of each one moving what the line carries in a millisecond, and sleeps when it is ahead
+ * of the clock. An instance that fell behind catches up without sleeping, so a busy worker runs its
+ * instances late rather than slower. With the virtual clock(-V) the worker moves the clock itself,
+ * straight to the next instance that wakes, so the same code runs as fast as the CPU allows.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include "board.h"
+#include "IAP.h"
+#include "sim.h"
+
+LPC_UART_T Sim_uart[3] = {{0},{1},{2}};
+SysTick_Type Sim_sysTick;
+uint32_t SystemCoreClock = 50000000;
+
+/* bytes the UART may have carried by the current millisecond,10 bits a byte */
+static uint64_t uart_limit(const INSTANCE_T *inst)
+{
+	return (uint64_t)inst->ms*(uint64_t)simConfig.baud/10000;
+}
+
+/* one SysTick interrupt,and the UART interrupt when the modem has bytes on the line */
+static void tick(INSTANCE_T *inst)
+{
+	WORKER_T *w = inst->worker;
+	inst->ms++;
+	w->fw.sysTick();
+	if(simConfig.replay)
+		Replay_poll(inst);
+	else
+		Modem_poll(inst);
+	if(Modem_pending(&inst->modem))
+		w->fw.uartIrq();
+	else
+		inst->uartBytes = uart_limit(inst);  //an idle line saves up nothing
+}
+
+/* run the interrupts the instance missed while it was not running */
+static void catch_up(INSTANCE_T *inst)
+{
+	WORKER_T *w = inst->worker;
+	w->now = Sim_nowMs();
+	while(inst->bootAt+inst->ms < w->now)
+		tick(inst);
+}
+
+/**
+ * @brief	  check if the firmware has recieved bytes it has not looked at yet
+ * @return	true if it has
+ */
+int Sim_rxWaiting(const INSTANCE_T *inst)
+{
+	const WORKER_T *w = inst->worker;
+	return (w->fw.rxRing != NULL && RingBuffer_GetCount(w->fw.rxRing) > 0) ||
+		(w->fw.rxUnread != NULL && *w->fw.rxUnread > 0);
+}
+
+/**
+ * @brief	  wait t milliseconds,calling userIdle every one like Air202.c does
+ * @return	Nothing
+ */
+void delay_ms(uint32_t t)
+{
+	INSTANCE_T *inst = simWorker->cur;
+	WORKER_T *w = inst->worker;
+	uint32_t end = inst->ms+t;
+
+	while((int32_t)(end-inst->ms) > 0){
+		if(inst->bootAt+inst->ms >= w->now){
+			if(Modem_pending(&inst->modem))     //bytes on the line,a millisecond at a time
+				Sim_sleep(inst,inst->bootAt+inst->ms+1,0);
+			else
+				Sim_sleep(inst,inst->bootAt+end,1);
+			w->now = Sim_nowMs();
+			continue;
+		}
+		tick(inst);
+		w->fw.userIdle();
+	}
+}
+
+/**
+ * @brief	  the firmware's userIdle,then sleep until the modem has something or simConfig.pollMs,
+                the main loop and the offline loops call it once a pass and do nothing else that waits
+ * @return	Nothing
+ */
+void userIdle(void)
+{
+	INSTANCE_T *inst = simWorker->cur;
+	WORKER_T *w = inst->worker;
+
+	w->fw.userIdle();
+	catch_up(inst);
+	if(Sim_rxWaiting(inst))
+		return;
+	if(Modem_pending(&inst->modem))
+		Sim_sleep(inst,inst->bootAt+inst->ms+1,0);
+	else
+		Sim_sleep(inst,w->now+simConfig.pollMs,1);
+	catch_up(inst);
+}
+
+/*****************************************************************************
+ * UART
+ ****************************************************************************/
+
+uint32_t Chip_UART_SendRB(LPC_UART_T *pUART,RINGBUFF_T *pRB,const void *data,int bytes)
+{
+	(void)pUART;
+	(void)pRB;
+	Modem_input(simWorker->cur,(const char*)data,bytes);
+	return (uint32_t)bytes;
+}
+
+int Chip_UART_ReadRB(LPC_UART_T *pUART,RINGBUFF_T *pRB,void *data,int bytes)
+{
+	char *p = (char*)data;
+	int n = 0;
+	(void)pUART;
+	while(n < bytes && RingBuffer_GetCount(pRB) > 0){
+		p[n++] = ((char*)pRB->data)[pRB->tail & (uint32_t)(pRB->count-1)];
+		pRB->tail++;
+	}
+	return n;
+}
+
+void Chip_UART_IRQRBHandler(LPC_UART_T *pUART,RINGBUFF_T *pRXRB,RINGBUFF_T *pTXRB)
+{
+	INSTANCE_T *inst = simWorker->cur;
+	char buf[MODEM_OUT_SIZE];
+	uint64_t limit;
+	int i,n = RingBuffer_GetFree(pRXRB);
+	(void)pUART;
+	(void)pTXRB;
+
+	if(simConfig.baud){
+		limit = uart_limit(inst);
+		if((uint64_t)n > limit-inst->uartBytes)
+			n = (int)(limit-inst->uartBytes);
+	}
+	if(n > (int)sizeof(buf))
+		n = (int)sizeof(buf);
+	n = Modem_read(inst,buf,n);
+	for(i=0;i<n;i++){
+		((char*)pRXRB->data)[pRXRB->head & (uint32_t)(pRXRB->count-1)] = buf[i];
+		pRXRB->head++;
+	}
+	inst->uartBytes += (uint64_t)n;
+}
+
+/*****************************************************************************
+ * stack
+ ****************************************************************************/
+
+uintptr_t Sim_stackTop(void)
+{
+	return (uintptr_t)(simWorker->cur->stack+SIM_STACK_SIZE);
+}
+
+/*****************************************************************************
+ * flash
+ ****************************************************************************/
+
+uintptr_t Sim_flashAddr(void)
+{
+	return (uintptr_t)simWorker->cur->flash;
+}
+
+static uint8_t *flash_range(uintptr_t addr,uint32_t size)
+{
+	uint8_t *flash = simWorker->cur->flash;
+	uintptr_t base = (uintptr_t)flash;
+	if(addr < base || addr+size > base+SIM_FLASH_SIZE)
+		return NULL;
+	return flash+(addr-base);
+}
+
+/**
+ * @brief	  erase one IAP_SECTOR_SIZE sector of the instance flash
+ * @return  return 0 if erased successfully ,otherwise, return nagative value(IAP_STATUS)
+ */
+int IAP_eraseSector(uintptr_t sector)
+{
+	uint8_t *p = flash_range(sector*IAP_SECTOR_SIZE,IAP_SECTOR_SIZE);
+	if(p == NULL)
+		return -IAP_INVALID_SECTOR;
+	memset(p,0xFF,IAP_SECTOR_SIZE);
+	return 0;
+}
+
+/**
+ * @brief	  program size bytes,like the boot ROM only bits that are 1 can be cleared
+ * @return  return 0 if written successfully ,otherwise, return nagative value(IAP_STATUS)
+ */
+int IAP_write(uintptr_t dst,const uint32_t *src,uint32_t size)
+{
+	uint32_t *p,i;
+	int ret = 0;
+	if(dst % IAP_PAGE_SIZE)
+		return -IAP_DST_ADDR_ERROR;
+	if(size != 256 && size != 512 && size != 1024 && size != 4096)
+		return -IAP_COUNT_ERROR;
+	p = (uint32_t*)flash_range(dst,size);
+	if(p == NULL)
+		return -IAP_DST_ADDR_NOT_MAPPED;
+	for(i=0;i<size/4;i++){
+		p[i] &= src[i];
+		if(p[i] != src[i])
+			ret = -IAP_COMPARE_ERROR;
+	}
+	return ret;
+}
+
+/*****************************************************************************
+ * debug output
+ ****************************************************************************/
+
+/**
+ * @brief	  the debug console,simConfig.consoleKeys are typed on the traced instances every
+                simConfig.consoleS,one key a call
+ * @return	the character,or EOF if none
+ */
+int Sim_debugIn(void)
+{
+	INSTANCE_T *inst = simWorker->cur;
+	int c;
+	if(simConfig.consoleS == 0 || inst->id >= simConfig.trace || (inst->consoleKey == 0 && inst->ms/1000 < inst->consoleAt))
+		return EOF;
+	inst->consoleAt = inst->ms/1000+simConfig.consoleS;
+	c = simConfig.consoleKeys[inst->consoleKey++];
+	if(simConfig.consoleKeys[inst->consoleKey] == '\0')
+		inst->consoleKey = 0;
+	return c;
+}
+
+int Sim_debug(const char *format,...)
+{
+	INSTANCE_T *inst = simWorker != NULL?simWorker->cur:NULL;
+	char text[512],line[600];
+	va_list ap;
+	int i,n = 0;
+
+	if(inst == NULL || inst->id >= simConfig.trace)
+		return 0;
+	va_start(ap,format);
+	vsnprintf(text,sizeof(text),format,ap);
+	va_end(ap);
+	n = snprintf(line,sizeof(line),"%9.3f %5d ",inst->ms/1000.0,inst->id);
+	for(i=0;text[i] && n < (int)sizeof(line)-2;i++){
+		if(text[i] != '\r')
+			line[n++] = text[i];
+	}
+	if(n > 0 && line[n-1] != '\n')
+		line[n++] = '\n';
+	fwrite(line,1,(size_t)n,stderr);
+	return i;
+}
@@ -0,0 +1,49 @@
+#ifndef __BOARD_H_
+#define __BOARD_H_
+
+#include <stdio.h>
+#include "chip.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Host stand-in for the board layer, see chip.h. Every instance has its own flash: the lease
+ * sector, then the sector holding the UID and key records at the offsets they have in 0xF000.
+ */
+
+#define LED_GREEN           (0)
+
+#define SIM_FLASH_LEASE     (0x0000)
+#define SIM_FLASH_UID       (0x1000)
+#define SIM_FLASH_KEY       (0x1040)
+#define SIM_FLASH_SIZE      (0x2000)
+
+#define UID_ADDR            (Sim_flashAddr()+SIM_FLASH_UID)
+#define KEY_ADDR            (Sim_flashAddr()+SIM_FLASH_KEY)
+#define LEASE_ADDR          (Sim_flashAddr()+SIM_FLASH_LEASE)
+
+/* the top of the instance stack stands in for the STACK section,as much as the device has RAM;
+   the painted pages are resident,the stack fleetsim reports is at least this much and the "mem
+   stack" line of the firmware(printMemory() in SWAuthDemo.c) tells the real use */
+#define SIM_STACK_PAINT     (8*1024)
+#define STACK_LIMIT         ((uint32_t*)Sim_stackTop())
+#define STACK_BASE          (STACK_LIMIT-SIM_STACK_PAINT/4)
+
+#define DEBUGOUT(...)       Sim_debug(__VA_ARGS__)
+#define DEBUGIN()           Sim_debugIn()
+
+static inline void Board_Init(void){}
+static inline void Board_LED_Toggle(uint8_t LEDNumber){ (void)LEDNumber; }
+
+uintptr_t Sim_flashAddr(void);
+uintptr_t Sim_stackTop(void);
+int Sim_debug(const char *format,...);
+int Sim_debugIn(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef __CHIP_H_
+#define __CHIP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Host stand-in for the LPCOpen chip layer of the LPC1125, only what SWAuthDemo.c and Air202.c
+ * use. Pin muxing, clocks and interrupt setup do nothing. The AT UART is the emulated modem of
+ * the instance running on the calling worker (tools/sim/hal.c): Chip_UART_SendRB hands the bytes
+ * to it at once and Chip_UART_IRQRBHandler moves what it answered into the receive ring.
+ */
+
+/* ring buffer, the LPCOpen layout: head and tail run freely, count is a power of two */
+typedef struct {
+	void *data;
+	int count;
+	int itemSz;
+	uint32_t head;
+	uint32_t tail;
+} RINGBUFF_T;
+
+typedef struct {
+	int id;
+} LPC_UART_T;
+
+typedef struct {
+	int unused;
+} LPC_IOCON_T,LPC_GPIO_T;
+
+typedef struct {
+	volatile uint32_t CTRL;
+	volatile uint32_t LOAD;
+	volatile uint32_t VAL;
+	volatile uint32_t CALIB;
+} SysTick_Type;
+
+typedef enum {
+	UART0_IRQn = 21,
+	UART1_IRQn = 22,
+	UART2_IRQn = 23,
+} LPC1125_IRQn_Type;
+
+extern LPC_UART_T Sim_uart[3];
+extern SysTick_Type Sim_sysTick;
+extern uint32_t SystemCoreClock;
+
+#define LPC_UART0           (&Sim_uart[0])
+#define LPC_UART1           (&Sim_uart[1])
+#define LPC_UART2           (&Sim_uart[2])
+#define LPC_IOCON           ((LPC_IOCON_T*)0)
+#define LPC_GPIO            ((LPC_GPIO_T*)0)
+#define SysTick             (&Sim_sysTick)
+
+#define IOCON_PIO0_3        (0)
+#define IOCON_PIO0_6        (0)
+#define IOCON_PIO0_7        (0)
+#define IOCON_PIO1_6        (0)
+#define IOCON_PIO1_7        (0)
+#define IOCON_PIO1_8        (0)
+#define IOCON_FUNC1         (0x1)
+#define IOCON_FUNC3         (0x3)
+#define IOCON_MODE_PULLUP   (0x2<<3)
+
+#define UART_LCR_WLEN8      (3<<0)
+#define UART_LCR_SBS_1BIT   (0<<2)
+#define UART_LCR_PARITY_DIS (0<<3)
+#define UART_FCR_FIFO_EN    (1<<0)
+#define UART_FCR_TRG_LEV2   (2<<6)
+#define UART_IER_RBRINT     (1<<0)
+#define UART_IER_RLSINT     (1<<2)
+
+#define __NOP()             do{}while(0)
+#define __disable_irq()     do{}while(0)
+#define __enable_irq()      do{}while(0)
+
+static inline void SystemCoreClockUpdate(void){}
+static inline uint32_t SysTick_Config(uint32_t ticks){ Sim_sysTick.LOAD = ticks-1; return 0; }
+static inline void NVIC_SetPriority(LPC1125_IRQn_Type IRQn,uint32_t priority){ (void)IRQn; (void)priority; }
+static inline void NVIC_EnableIRQ(LPC1125_IRQn_Type IRQn){ (void)IRQn; }
+static inline void Chip_IOCON_PinMuxSet(LPC_IOCON_T *pIOCON,int pin,uint32_t modefunc){ (void)pIOCON; (void)pin; (void)modefunc; }
+static inline void Chip_GPIO_SetPinDIROutput(LPC_GPIO_T *pGPIO,uint8_t port,uint8_t pin){ (void)pGPIO; (void)port; (void)pin; }
+static inline void Chip_GPIO_SetPinState(LPC_GPIO_T *pGPIO,uint8_t port,uint8_t pin,bool setting){ (void)pGPIO; (void)port; (void)pin; (void)setting; }
+static inline void Chip_UART_Init(LPC_UART_T *pUART){ (void)pUART; }
+static inline void Chip_UART_SetBaud(LPC_UART_T *pUART,uint32_t baudrate){ (void)pUART; (void)baudrate; }
+static inline void Chip_UART_ConfigData(LPC_UART_T *pUART,uint32_t config){ (void)pUART; (void)config; }
+static inline void Chip_UART_SetupFIFOS(LPC_UART_T *pUART,uint32_t fcr){ (void)pUART; (void)fcr; }
+static inline void Chip_UART_TXEnable(LPC_UART_T *pUART){ (void)pUART; }
+static inline void Chip_UART_IntEnable(LPC_UART_T *pUART,uint32_t intMask){ (void)pUART; (void)intMask; }
+
+static inline int RingBuffer_Init(RINGBUFF_T *RingBuff,void *buffer,int itemSize,int count)
+{
+	RingBuff->data = buffer;
+	RingBuff->count = count;
+	RingBuff->itemSz = itemSize;
+	RingBuff->head = RingBuff->tail = 0;
+	return 1;
+}
+
+static inline int RingBuffer_GetCount(RINGBUFF_T *RingBuff)
+{
+	return (int)(RingBuff->head-RingBuff->tail);
+}
+
+static inline int RingBuffer_GetFree(RINGBUFF_T *RingBuff)
+{
+	return RingBuff->count-RingBuffer_GetCount(RingBuff);
+}
+
+uint32_t Chip_UART_SendRB(LPC_UART_T *pUART,RINGBUFF_T *pRB,const void *data,int bytes);
+int Chip_UART_ReadRB(LPC_UART_T *pUART,RINGBUFF_T *pRB,void *data,int bytes);
+void Chip_UART_IRQRBHandler(LPC_UART_T *pUART,RINGBUFF_T *pRXRB,RINGBUFF_T *pTXRB);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
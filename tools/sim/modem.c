@@ -0,0 +1,385 @@
+/*
+ * @brief: emulated Air202 GPRS modem of the fleet simulator, the AT commands Air202.c sends
+ *
+ * Commands are answered at once with what the module answers, echoed while ATE1 is on(the
+ * power-on default). AT+CIPSTART ignores the address given and connects a nonblocking TCP socket
+ * to simConfig.server, CONNECT OK or CONNECT FAIL follows when the connect completes. AT+CIPSEND
+ * gives the "> " prompt and sends what comes up to 0x1A, AT+CIPSEND=n the next n bytes, in one
+ * write. Bytes from the server are put out as "+IPD,n:" and the data, as AT+CIPHEAD=1 asks, and
+ * a closed connection as CLOSED. The socket is read by the worker from its epoll set and only
+ * while MODEM_OUT_SIZE has room for a whole +IPD, so a firmware that does not keep up pushes
+ * back on the server like the module's flow control would. With the virtual clock an answer is
+ * held back until Sim_latency() after the connect or send it answers, so the network takes the
+ * same virtual time on every run whatever the server really took.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include "sim.h"
+
+#define IPD_HEAD_MAX    (20)    /* longest "\r\n+IPD,n:" and its terminator */
+
+static int out_free(const MODEM_T *m)
+{
+	return MODEM_OUT_SIZE-(int)(m->outHead-m->outTail);
+}
+
+static void put_bytes(MODEM_T *m,const char *data,int size)
+{
+	int i;
+	if(size > out_free(m))  //the module drops what the UART cannot take
+		size = out_free(m);
+	for(i=0;i<size;i++)
+		m->out[(m->outHead++) & (MODEM_OUT_SIZE-1)] = data[i];
+}
+
+static void put(MODEM_T *m,const char *str)
+{
+	put_bytes(m,str,(int)strlen(str));
+}
+
+static void set_events(INSTANCE_T *inst,int events)
+{
+	MODEM_T *m = &inst->modem;
+	struct epoll_event ev;
+	if(m->fd < 0 || m->events == events)
+		return;
+	ev.events = (uint32_t)events;
+	ev.data.ptr = inst;
+	epoll_ctl(inst->worker->ep,EPOLL_CTL_MOD,m->fd,&ev);
+	m->events = events;
+}
+
+/* virtual clock: the server owes an answer,the clock does not pass its delivery until it came */
+static void await_answer(INSTANCE_T *inst)
+{
+	MODEM_T *m = &inst->modem;
+	if(!simConfig.virtualClock || m->awaiting)
+		return;
+	m->awaiting = 1;
+	m->dueAt = inst->worker->now+Sim_latency(inst);
+	m->awaitSince = Sim_realUs();
+	inst->worker->awaiting++;
+}
+
+static void answered(INSTANCE_T *inst)
+{
+	MODEM_T *m = &inst->modem;
+	if(!m->awaiting)
+		return;
+	m->awaiting = 0;
+	inst->worker->awaiting--;
+}
+
+/* close the socket,lost tells the server did it rather than a command */
+static void drop(INSTANCE_T *inst,int lost)
+{
+	MODEM_T *m = &inst->modem;
+	answered(inst);
+	m->held = 0;
+	inst->dataAt = 0;
+	if(m->state == MODEM_CONNECTED)
+		Sim_count(&inst->worker->stats.down,1);
+	if(m->fd >= 0){
+		close(m->fd);   //also leaves the epoll set
+		m->fd = -1;
+	}
+	m->events = 0;
+	m->sentAt = 0;
+	m->state = lost?MODEM_CLOSED:MODEM_IDLE;
+	inst->connectedAt = 0;
+	if(lost && simConfig.resetS > 0)
+		inst->resetAt = inst->worker->now+simConfig.resetS*1000LL;
+}
+
+static void ip_start(INSTANCE_T *inst)
+{
+	MODEM_T *m = &inst->modem;
+	struct epoll_event ev;
+	int one = 1;
+
+	Sim_count(&inst->worker->stats.connects,1);
+	if(m->fd >= 0){
+		put(m,"\r\nERROR\r\n\r\nALREADY CONNECT\r\n");
+		return;
+	}
+	put(m,"\r\nOK\r\n");
+	m->fd = socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+	if(m->fd < 0){
+		drop(inst,1);
+		put(m,"\r\nCONNECT FAIL\r\n");
+		Sim_count(&inst->worker->stats.failed,1);
+		return;
+	}
+	setsockopt(m->fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+	if(connect(m->fd,(const struct sockaddr*)&simConfig.server,sizeof(simConfig.server)) && errno != EINPROGRESS){
+		drop(inst,1);
+		put(m,"\r\nCONNECT FAIL\r\n");
+		Sim_count(&inst->worker->stats.failed,1);
+		return;
+	}
+	ev.events = EPOLLOUT;
+	ev.data.ptr = inst;
+	epoll_ctl(inst->worker->ep,EPOLL_CTL_ADD,m->fd,&ev);
+	m->events = EPOLLOUT;
+	m->state = MODEM_CONNECTING;
+	await_answer(inst);
+}
+
+static void ip_send(INSTANCE_T *inst)
+{
+	MODEM_T *m = &inst->modem;
+	if(m->state != MODEM_CONNECTED || write(m->fd,m->in,(size_t)m->inLen) != m->inLen){
+		put(m,"\r\nSEND FAIL\r\n");
+		return;
+	}
+	put(m,"\r\nSEND OK\r\n");
+	Sim_count(&inst->worker->stats.sent,1);
+	if(m->sentAt == 0)
+		m->sentAt = Sim_nowUs();
+	await_answer(inst);
+}
+
+static void command(INSTANCE_T *inst,const char *line)
+{
+	MODEM_T *m = &inst->modem;
+	char resp[64];
+	int n;
+
+	if(strcmp(line,"AT") == 0 || strncmp(line,"AT+CSTT=",8) == 0 || strcmp(line,"AT+CIICR") == 0 ||
+		strncmp(line,"AT+CIPHEAD=",11) == 0){
+		put(m,"\r\nOK\r\n");
+	}else if(strncmp(line,"ATE",3) == 0){
+		m->echo = (line[3] == '1');
+		put(m,"\r\nOK\r\n");
+	}else if(strcmp(line,"AT+CSQ") == 0){
+		put(m,"\r\n+CSQ: 25,0\r\n\r\nOK\r\n");
+	}else if(strcmp(line,"AT+CPIN?") == 0){
+		put(m,"\r\n+CPIN: READY\r\n\r\nOK\r\n");
+	}else if(strcmp(line,"AT+CGREG?") == 0){
+		put(m,"\r\n+CGREG: 0,1\r\n\r\nOK\r\n");
+	}else if(strcmp(line,"AT+CGATT?") == 0){
+		put(m,"\r\n+CGATT: 1\r\n\r\nOK\r\n");
+	}else if(strcmp(line,"AT+CIFSR") == 0){
+		snprintf(resp,sizeof(resp),"\r\n10.%d.%d.%d\r\n",(inst->id>>16) & 0xFF,(inst->id>>8) & 0xFF,inst->id & 0xFF);
+		put(m,resp);
+	}else if(strcmp(line,"AT+CIPSEND?") == 0){
+		put(m,"\r\n+CIPSEND: 1460\r\n\r\nOK\r\n");
+	}else if(strcmp(line,"AT+CIPSTATUS") == 0){
+		snprintf(resp,sizeof(resp),"\r\nOK\r\n\r\nSTATE: %s\r\n",m->state == MODEM_CONNECTED?"CONNECT OK":
+			m->state == MODEM_CONNECTING?"TCP CONNECTING":m->state == MODEM_CLOSED?"TCP CLOSED":"IP STATUS");
+		put(m,resp);
+	}else if(strncmp(line,"AT+CIPSTART=",12) == 0){
+		ip_start(inst);
+	}else if(strcmp(line,"AT+CIPSEND") == 0){
+		if(m->state != MODEM_CONNECTED){
+			put(m,"\r\nERROR\r\n");
+			return;
+		}
+		m->mode = MODEM_DATA_CTRLZ;
+		put(m,"\r\n> ");
+	}else if(strncmp(line,"AT+CIPSEND=",11) == 0){
+		n = atoi(line+11);
+		if(m->state != MODEM_CONNECTED || n <= 0 || n > MODEM_IN_SIZE){
+			put(m,"\r\nERROR\r\n");
+			return;
+		}
+		m->mode = MODEM_DATA_LEN;
+		m->sendLen = n;
+		put(m,"\r\n> ");
+	}else if(strcmp(line,"AT+CIPCLOSE") == 0 || strcmp(line,"AT+IPCLOSE") == 0){
+		if(m->fd < 0){
+			put(m,"\r\nERROR\r\n");
+			return;
+		}
+		drop(inst,0);
+		put(m,"\r\nCLOSE OK\r\n");
+	}else if(strcmp(line,"AT+CIPSHUT") == 0){
+		drop(inst,0);
+		put(m,"\r\nSHUT OK\r\n");
+	}else if(strcmp(line,"AT+CPOWD=1") == 0){
+		drop(inst,0);
+		put(m,"\r\nNORMAL POWER DOWN\r\n");
+	}else{
+		put(m,"\r\nERROR\r\n");
+	}
+}
+
+void Modem_init(MODEM_T *m)
+{
+	memset(m,0,sizeof(MODEM_T));
+	m->fd = -1;
+	m->echo = 1;
+}
+
+/**
+ * @brief	  power the module off and on,the connection is closed
+ * @return	Nothing
+ */
+void Modem_reset(INSTANCE_T *inst)
+{
+	drop(inst,0);
+	Modem_init(&inst->modem);
+}
+
+/**
+ * @brief	  bytes the firmware wrote to the UART
+ * @return	Nothing
+ */
+void Modem_input(INSTANCE_T *inst,const char *data,int size)
+{
+	MODEM_T *m = &inst->modem;
+	int i;
+	char c;
+
+	for(i=0;i<size;i++){
+		c = data[i];
+		if(m->mode == MODEM_DATA_LEN){
+			m->in[m->inLen++] = c;
+			if(m->inLen == m->sendLen){
+				ip_send(inst);
+				m->mode = MODEM_COMMAND;
+				m->inLen = 0;
+			}
+		}else if(m->mode == MODEM_DATA_CTRLZ){
+			if(c == 0x1A || c == 0x1B){  //Ctrl-Z sends,ESC cancels
+				if(c == 0x1A)
+					ip_send(inst);
+				m->mode = MODEM_COMMAND;
+				m->inLen = 0;
+			}else if(m->inLen < MODEM_IN_SIZE){
+				m->in[m->inLen++] = c;
+			}
+		}else{
+			if(m->echo)
+				put_bytes(m,&c,1);
+			if(c == '\r'){
+				m->in[m->inLen] = '\0';
+				if(m->inLen > 0)
+					command(inst,m->in);
+				m->inLen = 0;
+			}else if(c != '\n' && m->inLen < MODEM_IN_SIZE-1){
+				m->in[m->inLen++] = c;
+			}
+		}
+	}
+}
+
+/**
+ * @brief	  bytes for the UART that did not come from the socket,a replayed capture
+ * @return	Nothing
+ */
+void Modem_feed(INSTANCE_T *inst,const char *data,int size)
+{
+	put_bytes(&inst->modem,data,size);
+}
+
+/**
+ * @brief	  bytes waiting to go out on the UART
+ * @return	their count
+ */
+int Modem_pending(const MODEM_T *m)
+{
+	return (int)(m->outHead-m->outTail);
+}
+
+/**
+ * @brief	  take up to size bytes for the UART,the socket is read again once there is room
+ * @return	bytes taken
+ */
+int Modem_read(INSTANCE_T *inst,char *buf,int size)
+{
+	MODEM_T *m = &inst->modem;
+	int n = 0;
+	while(n < size && m->outTail != m->outHead)
+		buf[n++] = m->out[(m->outTail++) & (MODEM_OUT_SIZE-1)];
+	if(m->state == MODEM_CONNECTED && m->events == 0 && !m->held && out_free(m) >= MODEM_IPD_MAX+IPD_HEAD_MAX)
+		set_events(inst,EPOLLIN);
+	return n;
+}
+
+/**
+ * @brief	  epoll events of the socket,on the worker outside the instance
+ * @return	Nothing
+ */
+void Modem_event(INSTANCE_T *inst,uint32_t events)
+{
+	MODEM_T *m = &inst->modem;
+	WORKER_T *w = inst->worker;
+	char data[MODEM_IPD_MAX],head[IPD_HEAD_MAX+1];
+	socklen_t len = sizeof(int);
+	int err = 0,n,room;
+
+	answered(inst);
+	if(simConfig.virtualClock && w->now < m->dueAt){   //still on its way,Modem_poll takes it then
+		m->held = 1;
+		inst->dataAt = m->dueAt;
+		set_events(inst,0);
+		Sim_wakeAt(inst,m->dueAt);
+		return;
+	}
+	if(m->state == MODEM_CONNECTING){
+		if(getsockopt(m->fd,SOL_SOCKET,SO_ERROR,&err,&len) || err){
+			drop(inst,1);
+			put(m,"\r\nCONNECT FAIL\r\n");
+			Sim_count(&w->stats.failed,1);
+		}else{
+			m->state = MODEM_CONNECTED;
+			set_events(inst,EPOLLIN);
+			put(m,"\r\nCONNECT OK\r\n");
+			Sim_count(&w->stats.connected,1);
+			inst->connectedAt = inst->authStatus == SIM_AUTH_SUCCESS?0:Sim_nowUs();
+			inst->tlmCheck = 1;
+		}
+		Sim_wake(inst);
+		return;
+	}
+	if(m->state != MODEM_CONNECTED || !(events & (EPOLLIN|EPOLLHUP|EPOLLERR)))
+		return;
+	room = out_free(m)-IPD_HEAD_MAX;
+	if(room < MODEM_IPD_MAX){   //wait until the firmware has read more
+		set_events(inst,0);
+		return;
+	}
+	n = (int)read(m->fd,data,sizeof(data));
+	if(n < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if(n <= 0){
+		drop(inst,1);
+		put(m,"\r\nCLOSED\r\n");
+		Sim_count(&w->stats.closed,1);
+		Sim_wake(inst);
+		return;
+	}
+	if(m->sentAt){
+		Sim_hist(w->stats.rtt,(unsigned long long)(Sim_nowUs()-m->sentAt));
+		m->sentAt = 0;
+	}
+	snprintf(head,sizeof(head),"\r\n+IPD,%d:",n);
+	put(m,head);
+	put_bytes(m,data,n);
+	Sim_wake(inst);
+}
+
+/**
+ * @brief	  virtual clock: take the socket event held back once the instance reached its dueAt,
+                called every millisecond of the instance
+ * @return	Nothing
+ */
+void Modem_poll(INSTANCE_T *inst)
+{
+	MODEM_T *m = &inst->modem;
+	if(!m->held || inst->bootAt+inst->ms < m->dueAt)
+		return;
+	m->held = 0;
+	inst->dataAt = 0;
+	Modem_event(inst,EPOLLIN);
+	if(m->state == MODEM_CONNECTED && m->events == 0 && out_free(m) >= MODEM_IPD_MAX+IPD_HEAD_MAX)
+		set_events(inst,EPOLLIN);
+}
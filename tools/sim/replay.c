@@ -0,0 +1,274 @@
+/*
+ * @brief: replay of an AT UART capture(Capture.h) into the receive path of the simulated firmware
+ *
+ * The dump SWAuthDemo.c prints("cap begin ...", "cap <hex>"... and "cap end <CRC16>" lines,
+ * anywhere in a debug log, the last complete one is taken; fleetsim -c makes the simulated
+ * devices print them too) is read back into its records. fleetsim -P then runs one instance
+ * that, instead of main(), calls checkSockRecvData() and userIdle() in a loop like main() does,
+ * while the recieved records are put on the UART at their original times, multiplied by -x,
+ * through the same baud limited UART interrupt as the modem output. What the device sent is
+ * only shown, nothing answers it, and the answers to its commands, which Air202.c read on the
+ * device, reach checkSockRecvData() here and show up as -2.
+ *
+ * Every result of checkSockRecvData() is printed with the time since the latest bytes were put
+ * on the line, so the output of two firmware builds can be compared with diff; -V makes the
+ * times the same on every run. The summary gives the results by kind, that latency, and the CPU
+ * time the receive path took per call that had data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+#define LINE_MAX_LEN    (1024)
+#define SHOW_MAX        (48)        /* bytes of a record or message printed */
+#define RESULTS         (8)         /* 0 a message,1..7 the errors -1..-7 of checkSockRecvData */
+
+typedef struct REPLAY_REC{
+	long long t;        /* ms after the oldest record */
+	int tx;
+	int len;
+	const uint8_t *data;
+}REPLAY_REC_T;
+
+static uint8_t *dump;
+static int dumpSize;
+static unsigned long dumpFirst,dumpLost;
+static REPLAY_REC_T *recs;
+static int recCount,nextRec;
+static long long startAt;           /* ms of the instance the oldest record is due */
+static long long fedAt = -1;        /* ms the latest recieved record was put on the line */
+static unsigned long results[RESULTS],rxBytes,txBytes,latencyCount;
+static long long latencySum,latencyMax,cpuNs,cpuCalls;
+
+static int hex_value(int c)
+{
+	if(c >= '0' && c <= '9')
+		return c-'0';
+	if(c >= 'A' && c <= 'F')
+		return c-'A'+10;
+	if(c >= 'a' && c <= 'f')
+		return c-'a'+10;
+	return -1;
+}
+
+/* the records of dump,oldest first */
+static int parse_records(void)
+{
+	long long t = 0;
+	unsigned long dt;
+	int pos = 0,shift,len;
+	uint8_t b;
+
+	recs = (REPLAY_REC_T*)calloc((size_t)dumpSize/2+1,sizeof(REPLAY_REC_T));
+	if(recs == NULL)
+		return -1;
+	while(pos < dumpSize){
+		dt = 0;
+		shift = 0;
+		do{
+			if(pos >= dumpSize || shift > 28)
+				return -1;
+			b = dump[pos++];
+			dt |= (unsigned long)(b & 0x7F)<<shift;
+			shift += 7;
+		}while(b & 0x80);
+		if(pos >= dumpSize)
+			return -1;
+		len = dump[pos] & 0x7F;
+		recs[recCount].tx = (dump[pos++] & 0x80) != 0;
+		if(len == 0 || pos+len > dumpSize)
+			return -1;
+		if(recCount > 0)    //the first one follows a record that was overwritten
+			t += (long long)dt;
+		recs[recCount].t = t;
+		recs[recCount].len = len;
+		recs[recCount].data = dump+pos;
+		pos += len;
+		recCount++;
+	}
+	return 0;
+}
+
+/**
+ * @brief	  read the last complete capture dump of a log,checked with the firmware's CRC16
+ * @return	return 0 if read successfully ,otherwise, return nagative value
+ */
+int Replay_load(const char *path,const FIRMWARE_T *fw)
+{
+	FILE *fp = fopen(path,"r");
+	char line[LINE_MAX_LEN],*p;
+	uint8_t *buf = NULL;
+	unsigned long first,size,lost,crc;
+	int n = -1,h,l;     //bytes collected,-1 outside a dump
+
+	if(fw->recv == NULL || fw->rxBuff == NULL || fw->inBuffer == NULL || fw->rxBuffSize <= 0 ||
+		(fw->rxBuffSize & (fw->rxBuffSize-1))){
+		fprintf(stderr,"the firmware has no checkSockRecvData,rxbuff or socketBuffer\n");
+		return -1;
+	}
+	if(fp == NULL){
+		perror(path);
+		return -1;
+	}
+	while(fgets(line,sizeof(line),fp) != NULL){
+		p = strstr(line,"cap ");
+		if(p == NULL)
+			continue;
+		p += 4;
+		if(sscanf(p,"begin %lu %lu %lu",&first,&size,&lost) == 3){
+			free(buf);
+			buf = (uint8_t*)malloc(size+1);
+			n = buf != NULL?0:-1;
+		}else if(n >= 0 && sscanf(p,"end %lx",&crc) == 1){
+			if((unsigned long)n == size && fw->crc16((char*)buf,(unsigned int)n) == crc){
+				free(dump);
+				dump = buf;
+				dumpSize = n;
+				dumpFirst = first;
+				dumpLost = lost;
+				buf = NULL;
+			}else{
+				fprintf(stderr,"%s: a dump with a bad CRC or length skipped\n",path);
+			}
+			n = -1;
+		}else if(n >= 0){
+			while((h = hex_value(p[0])) >= 0 && (l = hex_value(p[1])) >= 0 && (unsigned long)n < size){
+				buf[n++] = (uint8_t)(h<<4 | l);
+				p += 2;
+			}
+		}
+	}
+	free(buf);
+	fclose(fp);
+	if(dump == NULL){
+		fprintf(stderr,"%s: no complete capture dump\n",path);
+		return -1;
+	}
+	if(parse_records()){
+		fprintf(stderr,"%s: the dump is not a capture\n",path);
+		return -1;
+	}
+	return 0;
+}
+
+static void show(long long at,const char *what,const char *data,int size,long long latency)
+{
+	char text[4*SHOW_MAX+1];
+	int i,n = 0;
+	for(i=0;i<size && i < SHOW_MAX;i++){
+		unsigned char c = (unsigned char)data[i];
+		if(c == '\r' || c == '\n')
+			n += sprintf(text+n,"\\%c",c == '\r'?'r':'n');
+		else if(c >= 0x20 && c < 0x7F)
+			text[n++] = (char)c;
+		else
+			n += sprintf(text+n,"\\x%02X",c);
+	}
+	text[n] = '\0';
+	printf("%10.3f %-4s %s%s",(at-startAt)/1000.0,what,text,size > SHOW_MAX?"...":"");
+	if(latency >= 0)
+		printf("  %lldms",latency);
+	printf("\n");
+}
+
+static long long due(int i)
+{
+	return startAt+(long long)(recs[i].t*simConfig.replayScale);
+}
+
+/**
+ * @brief	  put the recieved records that are due on the line,every millisecond of the instance
+ * @return	Nothing
+ */
+void Replay_poll(INSTANCE_T *inst)
+{
+	long long now = inst->bootAt+inst->ms;
+	const REPLAY_REC_T *r;
+
+	while(nextRec < recCount && due(nextRec) <= now){
+		r = &recs[nextRec++];
+		show(now,r->tx?"tx":"rx",(const char*)r->data,r->len,-1);
+		if(r->tx){
+			txBytes += (unsigned long)r->len;
+		}else{
+			Modem_feed(inst,(const char*)r->data,r->len);
+			rxBytes += (unsigned long)r->len;
+			fedAt = now;
+		}
+	}
+	inst->dataAt = nextRec < recCount?due(nextRec):0;
+}
+
+static long long cpu_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts);
+	return ts.tv_sec*1000000000LL+ts.tv_nsec;
+}
+
+/**
+ * @brief	  the instance of fleetsim -P: the receive part of the main loop until the capture ran out
+ * @return	Nothing
+ */
+void Replay_run(void)
+{
+	INSTANCE_T *inst = simWorker->cur;
+	FIRMWARE_T *fw = &simWorker->fw;
+	long long t0,now,latency;
+	int ret;
+
+	RingBuffer_Init(fw->rxRing,fw->rxBuff,1,fw->rxBuffSize);
+	if(fw->poolInit != NULL)
+		fw->poolInit();
+	startAt = inst->bootAt+inst->ms+1;
+	inst->dataAt = startAt;
+	printf("capture of %d bytes,%d records from %lums,%lu lost before it\n",dumpSize,recCount,dumpFirst,dumpLost);
+	while(nextRec < recCount || Modem_pending(&inst->modem) || Sim_rxWaiting(inst)){
+		t0 = cpu_now();
+		ret = fw->recv();
+		if(ret != -1){  //-1 only says there was nothing
+			cpuNs += cpu_now()-t0;
+			cpuCalls++;
+			now = inst->bootAt+inst->ms;
+			latency = fedAt >= 0?now-fedAt:-1;
+			if(latency >= 0){
+				latencySum += latency;
+				latencyCount++;
+				if(latency > latencyMax)
+					latencyMax = latency;
+			}
+			if(ret > 0){
+				results[0]++;
+				show(now,"msg",fw->inBuffer,ret,latency);
+			}else{
+				results[ret < -(RESULTS-1)?RESULTS-1:-ret]++;
+				printf("%10.3f %-4s %d  %lldms\n",(now-startAt)/1000.0,"err",ret,latency);
+			}
+		}
+		userIdle();
+	}
+	Sim_stop();
+}
+
+/**
+ * @brief	  print the summary of the replay
+ * @return	Nothing
+ */
+void Replay_report(void)
+{
+	int i;
+	printf("replay  %d records,recieved %lu bytes,sent %lu bytes,time scale %g\n",recCount,rxBytes,txBytes,
+		simConfig.replayScale);
+	printf("results messages %lu",results[0]);
+	for(i=1;i<RESULTS;i++){
+		if(results[i])
+			printf(",%d: %lu",-i,results[i]);
+	}
+	printf("\n");
+	printf("latency avg %.1fms max %lldms from the latest bytes on the line to the result\n",
+		latencyCount?(double)latencySum/latencyCount:0.0,latencyMax);
+	printf("cpu     %.1fus per call with data,%lld calls\n",cpuCalls?cpuNs/1e3/cpuCalls:0.0,cpuCalls);
+}
@@ -0,0 +1,201 @@
+#ifndef _SIM_H
+#define _SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <netinet/in.h>
+#include "chip.h"
+#include "Telemetry.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * Fleet simulator internals, shared by fleetsim.c(scheduler), hal.c(chip and board layer the
+ * firmware calls) and modem.c(AT command set of the Air202 and its TCP socket).
+ */
+
+#define SIM_STACK_SIZE      (64*1024)   /* reserved per instance,only the pages touched are resident */
+#define SIM_AUTH_SUCCESS    (0)         /* AUTH_STATUS_SUCCESS of SWAuthDemo.c,authInfo.status */
+#define MODEM_IN_SIZE       (512)       /* command line,or data of one send */
+#define MODEM_OUT_SIZE      (2048)      /* toward the UART,a power of two */
+#define MODEM_IPD_MAX       (1024)      /* socket bytes in one +IPD */
+#define HIST_SUB_BITS       (3)
+#define HIST_SIZE           (16+(64-4)*(1<<HIST_SUB_BITS))
+#define CONSOLE_KEYS        "c"         /* CONSOLE_DUMP_CMD of SWAuthDemo.c */
+
+enum MODEM_STATE{
+	MODEM_IDLE,
+	MODEM_CONNECTING,
+	MODEM_CONNECTED,
+	MODEM_CLOSED,       /* the server closed,or the connect failed */
+};
+
+enum MODEM_MODE{
+	MODEM_COMMAND,
+	MODEM_DATA_CTRLZ,   /* AT+CIPSEND,data up to 0x1A */
+	MODEM_DATA_LEN,     /* AT+CIPSEND=n,n bytes of data */
+};
+
+typedef struct MODEM{
+	int fd;                 /* socket,-1 none */
+	int state;
+	int mode;
+	int echo;
+	int events;             /* epoll events set */
+	int sendLen;            /* bytes expected in MODEM_DATA_LEN */
+	int inLen;
+	uint32_t outHead;
+	uint32_t outTail;
+	long long sentAt;       /* us,a send not answered yet,0 none */
+	int awaiting;           /* virtual clock: a connect or send the server has not answered */
+	int held;               /* virtual clock: a socket event kept until dueAt */
+	long long dueAt;        /* virtual clock: ms the network delivers the answer */
+	long long awaitSince;   /* real us the wait began */
+	char in[MODEM_IN_SIZE];
+	char out[MODEM_OUT_SIZE];
+}MODEM_T;
+
+/* the firmware as loaded by one worker,with the symbols the scheduler calls */
+typedef struct FIRMWARE{
+	void *handle;
+	int (*main)(void);
+	void (*sysTick)(void);
+	void (*uartIrq)(void);
+	void (*userIdle)(void);
+	uint16_t (*crc16)(char *p,unsigned int length);
+	const volatile int *authStatus;
+	RINGBUFF_T *rxRing;     /* rxring,bytes the UART interrupt stored */
+	const int *rxUnread;    /* rxUnreadCount,bytes given back with AT_Unread */
+	char *rxBuff;           /* rxbuff,the storage of rxRing */
+	int rxBuffSize;
+	int (*recv)(void);      /* checkSockRecvData,for the replay */
+	void (*poolInit)(void);
+	const char *inBuffer;   /* socketBuffer.inBuffer,the latest message recieved */
+	const TELEMETRY_T *telemetry;   /* telemetry,NULL in a firmware without it */
+	uint8_t *ram;           /* its writable data: .data and .bss */
+	size_t ramSize;
+	uint8_t *image;         /* ram as loaded,what every boot starts from */
+}FIRMWARE_T;
+
+/* counters of one worker,written by it alone and read by the statistics thread */
+typedef struct SIM_STATS{
+	unsigned long boots;            /* restarts included */
+	unsigned long connects;         /* AT+CIPSTART */
+	unsigned long connected;        /* CONNECT OK */
+	unsigned long failed;           /* CONNECT FAIL */
+	unsigned long closed;           /* connections lost after CONNECT OK */
+	unsigned long down;             /* connections ended,lost or closed by a command */
+	unsigned long sent;             /* messages */
+	unsigned long authorized;       /* authorizations completed */
+	unsigned long tlmFirst;         /* first telemetry records after CONNECT OK */
+	unsigned long tlmUnregistered;  /* of them,without a sample or with one not registered */
+	unsigned long stackMax;         /* bytes of stack resident,at exit */
+	unsigned long stackSum;
+	unsigned long rtt[HIST_SIZE];   /* us from a send to the first bytes of the reply */
+	unsigned long auth[HIST_SIZE];  /* us from CONNECT OK to the first authorization */
+	unsigned long lag[HIST_SIZE];   /* us an instance ran later than it asked to */
+}SIM_STATS_T;
+
+struct WORKER;
+
+typedef struct INSTANCE{
+	int id;
+	int booted;
+	int queued;
+	int heapPos;            /* -1 not sleeping */
+	int wakeOnData;
+	int authStatus;         /* authInfo.status seen last */
+	uint32_t ms;            /* SysTick interrupts since boot */
+	uint32_t draws;         /* latencies drawn */
+	long long dataAt;       /* ms bytes for the UART are due,a sleep waiting for data ends then,0 none */
+	long long consoleAt;    /* s of uptime the next console command is typed */
+	int consoleKey;         /* of simConfig.consoleKeys,typed one per call */
+	uint64_t uartBytes;     /* bytes the UART has carried since boot */
+	long long bootAt;       /* ms of the worker clock */
+	long long wakeAt;
+	long long resetAt;      /* restart then,0 never */
+	long long connectedAt;  /* us,CONNECT OK not followed by an authorization yet,0 none */
+	int tlmCheck;           /* CONNECT OK not followed by a telemetry record yet */
+	uint32_t tlmStart;      /* telemetry.win.start seen last */
+	struct WORKER *worker;
+	uint8_t *ram;           /* firmware data while another instance runs */
+	uint8_t *flash;
+	uint8_t *stack;
+	ucontext_t ctx;
+	MODEM_T modem;
+}INSTANCE_T;
+
+typedef struct WORKER{
+	pthread_t tid;
+	int id;
+	int ep;
+	FIRMWARE_T fw;
+	INSTANCE_T *inst;
+	int count;
+	INSTANCE_T *cur;        /* running */
+	INSTANCE_T *resident;   /* whose data is in fw.ram */
+	INSTANCE_T **runq;
+	int runHead;
+	int runCount;
+	INSTANCE_T **heap;      /* sleeping,by wakeAt */
+	int heapCount;
+	long long now;          /* ms,the virtual clock with simConfig.virtualClock */
+	int awaiting;           /* instances whose modem.awaiting is set */
+	ucontext_t sched;
+	SIM_STATS_T stats;
+}WORKER_T;
+
+typedef struct SIM_CONFIG{
+	struct sockaddr_in server;
+	int baud;               /* UART speed,0 carries everything at once */
+	int pollMs;             /* an idle main loop sleeps that long unless the modem has data */
+	int resetS;             /* restart an instance that long after its connection is lost,0 never */
+	int trace;              /* firmware output of the instances below this id is printed */
+	int virtualClock;       /* time jumps to the next event instead of following the wall clock */
+	int latencyMs;          /* virtual clock: network round trip,give or take half */
+	long long stopMs;       /* virtual clock: workers stop there,0 never */
+	int consoleS;           /* type consoleKeys on the console of traced instances that often,0 never */
+	const char *consoleKeys;
+	int replay;             /* one instance replays a capture(replay.c) instead of running main() */
+	double replayScale;     /* times between the records are multiplied by it */
+}SIM_CONFIG_T;
+
+extern SIM_CONFIG_T simConfig;
+extern __thread WORKER_T *simWorker;
+
+long long Sim_realUs(void);
+long long Sim_nowUs(void);
+long long Sim_nowMs(void);
+void Sim_count(unsigned long *c,unsigned long n);
+void Sim_hist(unsigned long *hist,unsigned long long us);
+void Sim_sleep(INSTANCE_T *inst,long long until,int wakeOnData);
+void Sim_wake(INSTANCE_T *inst);
+void Sim_wakeAt(INSTANCE_T *inst,long long at);
+int Sim_latency(INSTANCE_T *inst);
+int Sim_rxWaiting(const INSTANCE_T *inst);
+void userIdle(void);    /* hal.c,in place of the firmware's */
+void Sim_stop(void);
+
+void Modem_init(MODEM_T *m);
+void Modem_reset(INSTANCE_T *inst);
+void Modem_input(INSTANCE_T *inst,const char *data,int size);
+int Modem_pending(const MODEM_T *m);
+int Modem_read(INSTANCE_T *inst,char *buf,int size);
+void Modem_event(INSTANCE_T *inst,uint32_t events);
+void Modem_poll(INSTANCE_T *inst);
+void Modem_feed(INSTANCE_T *inst,const char *data,int size);
+
+int Replay_load(const char *path,const FIRMWARE_T *fw);
+void Replay_run(void);
+void Replay_poll(INSTANCE_T *inst);
+void Replay_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * @brief: decoder of the binary trace log(Trace.h) in a debug UART log (host tool)
+ *
+ * Build: gcc -O2 -Itools/sim/include -IAir202 -IHistogram -ITrace -ICRC16 -o trace_decode tools/trace_decode.c CRC16/lib_crc16.c
+ * Usage: trace_decode [log...]
+ *        trace_decode -g
+ *
+ * Copies the logs(stdin without one) to stdout with every "trc <hex>" line that drainTrace() in
+ * SWAuthDemo.c printed replaced by its records, one line each: what came before "trc " on the
+ * line(e.g. the time and device of fleetsim -v), the time of the record in s since reset and the
+ * text of TraceEvents.h. The formats are compiled in, so the decoder must be built from the
+ * sources of the firmware that wrote the log; the TRACE_BOOT record of every boot carries the
+ * TRACE_TABLE_CRC of the firmware and a log of a different table is pointed out.
+ *
+ * -g prints TRACE_TABLE_CRC of the table as it is now, to paste into TraceEvents.h after the
+ * list changed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Air202.h"
+#include "Trace.h"
+#include "lib_crc16.h"
+
+#define LINE_MAX_LEN    (4096)
+#define FORMAT_MAX      (16)        /* one conversion,"%08X" */
+
+typedef struct EVENT{
+	const char *name;
+	const char *format;
+}EVENT_T;
+
+#define EVENT_ROW(id,format)    {#id,format},
+static const EVENT_T events[TRACE_EVENT_MAX] = {TRACE_EVENT_LIST(EVENT_ROW)};
+#define AT_CMD_NAME(id,name)    name,
+static const char *atCmds[AT_CMD_MAX] = {AT_CMD_LIST(AT_CMD_NAME)};
+
+static unsigned tableCrc;
+
+/* CRC16 of the names and formats with their terminating NULs,in the order of the list */
+static unsigned table_crc(void)
+{
+	CRC16_CTX_T crc;
+	int i;
+	crc16_init(&crc);
+	for(i=0;i<TRACE_EVENT_MAX;i++){
+		crc16_update(&crc,events[i].name,(unsigned)strlen(events[i].name)+1);
+		crc16_update(&crc,events[i].format,(unsigned)strlen(events[i].format)+1);
+	}
+	return crc16_final(&crc);
+}
+
+static int hex_value(int c)
+{
+	if(c >= '0' && c <= '9')
+		return c-'0';
+	if(c >= 'A' && c <= 'F')
+		return c-'A'+10;
+	if(c >= 'a' && c <= 'f')
+		return c-'a'+10;
+	return -1;
+}
+
+/* print format with the arguments of a record */
+static void print_event(const char *format,const uint32_t *args,int argc)
+{
+	char spec[FORMAT_MAX];
+	const char *p = format;
+	int n,used = 0;
+	uint32_t v;
+
+	while(*p){
+		if(*p != '%'){
+			putchar(*p++);
+			continue;
+		}
+		if(p[1] == '%'){
+			putchar('%');
+			p += 2;
+			continue;
+		}
+		n = (int)strspn(p+1,"-+ #0123456789")+1;
+		if(n+2 > FORMAT_MAX || p[n] == '\0'){
+			fputs(p,stdout);
+			return;
+		}
+		memcpy(spec,p,(size_t)n);
+		v = (used < argc)?args[used]:0;
+		used++;
+		switch(p[n]){
+		case 'k':
+			fputs(v < AT_CMD_MAX?atCmds[v]:"?",stdout);
+			break;
+		case 'd':
+		case 'u':
+		case 'x':
+		case 'X':
+			spec[n] = p[n];
+			spec[n+1] = '\0';
+			if(p[n] == 'd')
+				printf(spec,(int)(int32_t)v);
+			else
+				printf(spec,(unsigned)v);
+			break;
+		default:
+			printf("?%c",p[n]);
+			break;
+		}
+		p += n+1;
+	}
+}
+
+/* the records of one "trc" line,prefix is what came before it */
+static void decode_line(const char *prefix,int prefixLen,const char *hex)
+{
+	uint32_t words[LINE_MAX_LEN/8];
+	int n = 0,i,pos,id,argc,d;
+
+	while(n < (int)(sizeof(words)/sizeof(words[0]))){
+		words[n] = 0;
+		for(i=0;i<8;i++){
+			if((d = hex_value(hex[i])) < 0)
+				break;
+			words[n] = words[n]<<4 | (uint32_t)d;
+		}
+		if(i < 8)
+			break;
+		hex += 8;
+		n++;
+	}
+	for(pos=0;pos<n;pos += 2+argc){
+		id = (int)(words[pos]>>8);
+		argc = (int)(words[pos] & 0xFF);
+		printf("%.*s",prefixLen,prefix);
+		if(id >= TRACE_EVENT_MAX || argc > TRACE_ARGS_MAX || pos+2+argc > n){
+			printf("trc bad record %08X,the rest of the line is skipped\n",(unsigned)words[pos]);
+			return;
+		}
+		printf("[%u.%03u] ",(unsigned)(words[pos+1]/1000),(unsigned)(words[pos+1]%1000));
+		print_event(events[id].format,words+pos+2,argc);
+		if(id == TRACE_BOOT && argc > 0 && words[pos+2] != tableCrc)
+			printf(" (trace_decode has table %04X,the formats may not match)",tableCrc);
+		printf("\n");
+	}
+}
+
+static void decode(FILE *fp)
+{
+	char line[LINE_MAX_LEN];
+	char *p;
+
+	while(fgets(line,sizeof(line),fp) != NULL){
+		p = strstr(line,"trc ");
+		if(p == NULL){
+			fputs(line,stdout);
+			continue;
+		}
+		decode_line(line,(int)(p-line),p+4);
+	}
+}
+
+int main(int argc,char **argv)
+{
+	FILE *fp;
+	int i;
+
+	tableCrc = table_crc();
+	if(argc == 2 && !strcmp(argv[1],"-g")){
+		printf("/* generated by tools/trace_decode -g */\n#define TRACE_TABLE_CRC     (0x%04X)\n",tableCrc);
+		return 0;
+	}
+	if(tableCrc != TRACE_TABLE_CRC)
+		fprintf(stderr,"TRACE_TABLE_CRC is out of date,run trace_decode -g\n");
+	if(argc < 2){
+		decode(stdin);
+		return 0;
+	}
+	for(i=1;i<argc;i++){
+		fp = fopen(argv[i],"r");
+		if(fp == NULL){
+			perror(argv[i]);
+			return 1;
+		}
+		decode(fp);
+		fclose(fp);
+	}
+	return 0;
+}
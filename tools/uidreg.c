@@ -0,0 +1,727 @@
+/*
+ * @brief: memory-mapped UID license registry,the table of uidreg.h and a command line tool for it (host tool)
+ *
+ * Build: gcc -O2 -pthread -DUIDREG_MAIN -Itools -o uidreg tools/uidreg.c
+ *        servers compile tools/uidreg.c without UIDREG_MAIN and include uidreg.h
+ * Usage: uidreg create <reg> <capacity>              empty registry for capacity UIDs
+ *        uidreg import <reg> [-r] <file>             add "UID [KEY|-] [expiry] [features]" lines,
+ *                                                    or with -r the records of uidtool gen, active
+ *        uidreg set <reg> <UID> <active|revoked|none> [expiry [features]]
+ *        uidreg get <reg> <UID>...
+ *        uidreg stats <reg>                          fill and probe lengths
+ *        uidreg grow <reg> <new reg> <capacity>      copy into a larger table
+ *        uidreg bench [-j threads] [-n lookups] [-w] <reg>
+ *                                                    random lookups of present and absent UIDs,
+ *                                                    -w updates licenses meanwhile and checks
+ *                                                    that no reader sees a torn one
+ *
+ * Features default to 1 (LEASE_FEATURE_APP) and expiry to 0, a license that does not run out.
+ * Import and set are writers and wait for no one: a second writer fails at once instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "uidreg.h"
+
+#define UIDREG_MIN_BITS     (6)
+
+static uint64_t uid_hash(const uint8_t *uid)
+{
+	uint64_t a,b;
+	memcpy(&a,uid,8);
+	memcpy(&b,uid+8,8);
+	a ^= b*0x9E3779B97F4A7C15ULL;   /* UIDs are random,but a batch may share a prefix */
+	a ^= a>>31;
+	a *= 0xD6E8FEB86659FD93ULL;
+	a ^= a>>32;
+	return a;
+}
+
+/**
+ * @brief	  create an empty registry with room for capacity UIDs,rounded up to a power of two slots
+                with UIDREG_MAX_LOAD percent of them used. The slots are a sparse hole until written
+ * @return  return 0 if created ,otherwise, return nagative value
+ */
+int UidReg_create(const char *path,uint64_t capacity)
+{
+	UIDREG_HEADER_T header;
+	uint8_t block[UIDREG_HEADER_SIZE];
+	int bits = UIDREG_MIN_BITS,fd;
+
+	while(bits < 40 && (1ULL<<bits)*UIDREG_MAX_LOAD/100 < capacity)
+		bits++;
+	fd = open(path,O_RDWR|O_CREAT|O_EXCL,0644);
+	if(fd < 0)
+		return -1;
+	memset(&header,0,sizeof(header));
+	header.magic = UIDREG_MAGIC;
+	header.slotBits = (uint32_t)bits;
+	memset(block,0,sizeof(block));
+	memcpy(block,&header,sizeof(header));
+	if(ftruncate(fd,UIDREG_HEADER_SIZE+(off_t)sizeof(UIDREG_ENTRY_T)*((off_t)1<<bits)) ||
+		pwrite(fd,block,sizeof(block),0) != (ssize_t)sizeof(block)){
+		close(fd);
+		unlink(path);
+		return -2;
+	}
+	return close(fd)?-2:0;
+}
+
+/**
+ * @brief	  map a registry,a writable one also takes the writer lock
+ * @return  return 0 if opened ,otherwise, return nagative value
+ */
+int UidReg_open(UIDREG_T *reg,const char *path,int writable)
+{
+	UIDREG_HEADER_T header;
+	struct stat st;
+	void *map;
+
+	memset(reg,0,sizeof(UIDREG_T));
+	reg->fd = open(path,writable?O_RDWR:O_RDONLY);
+	if(reg->fd < 0)
+		return -1;
+	if(writable && flock(reg->fd,LOCK_EX|LOCK_NB)){
+		close(reg->fd);
+		return -2;  /* another writer */
+	}
+	if(fstat(reg->fd,&st) || pread(reg->fd,&header,sizeof(header),0) != (ssize_t)sizeof(header) ||
+		header.magic != UIDREG_MAGIC || header.slotBits < UIDREG_MIN_BITS || header.slotBits > 40 ||
+		(uint64_t)st.st_size != UIDREG_HEADER_SIZE+sizeof(UIDREG_ENTRY_T)*(1ULL<<header.slotBits)){
+		close(reg->fd);
+		return -3;
+	}
+	map = mmap(NULL,st.st_size,writable?PROT_READ|PROT_WRITE:PROT_READ,MAP_SHARED,reg->fd,0);
+	if(map == MAP_FAILED){
+		close(reg->fd);
+		return -4;
+	}
+	reg->header = (UIDREG_HEADER_T*)map;
+	reg->slots = (UIDREG_ENTRY_T*)((char*)map+UIDREG_HEADER_SIZE);
+	reg->mask = (1ULL<<header.slotBits)-1;
+	reg->mapSize = st.st_size;
+	reg->writable = writable;
+	return 0;
+}
+
+void UidReg_close(UIDREG_T *reg)
+{
+	if(reg->header != NULL)
+		munmap(reg->header,reg->mapSize);
+	if(reg->fd >= 0)
+		close(reg->fd);
+	reg->header = NULL;
+	reg->fd = -1;
+}
+
+/**
+ * @brief	  look up a raw UID,safe against a writer in this or another process
+ * @return  the entry,or NULL if the UID is not registered
+ */
+const UIDREG_ENTRY_T *UidReg_find(const UIDREG_T *reg,const uint8_t *uid)
+{
+	uint64_t i = uid_hash(uid) & reg->mask,n;
+	const UIDREG_ENTRY_T *e;
+
+	for(n=0;n<=reg->mask;n++){
+		e = &reg->slots[i];
+		if(!(__atomic_load_n(&e->flags,__ATOMIC_ACQUIRE) & UIDREG_USED))
+			return NULL;
+		if(!memcmp(e->uid,uid,UIDREG_UID_SIZE))
+			return e;
+		i = (i+1) & reg->mask;
+	}
+	return NULL;
+}
+
+/**
+ * @brief	  the license of an entry,read at once
+ * @return  the license word,see UIDREG_LICENSE
+ */
+uint64_t UidReg_license(const UIDREG_ENTRY_T *entry)
+{
+	return __atomic_load_n(&entry->license,__ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief	  copy the key of an entry
+ * @return  return 0 if it has one ,otherwise, return nagative value
+ */
+int UidReg_key(const UIDREG_ENTRY_T *entry,uint8_t *key)
+{
+	if(!(__atomic_load_n(&entry->flags,__ATOMIC_ACQUIRE) & UIDREG_HAS_KEY))
+		return -1;
+	memcpy(key,entry->key,UIDREG_KEY_SIZE);
+	return 0;
+}
+
+/**
+ * @brief	  add a UID or change its license,key may be NULL. A key is set once and not replaced
+ * @return  return 0 if stored ,otherwise, return nagative value(-2 full,-3 a different key is set)
+ */
+int UidReg_put(UIDREG_T *reg,const uint8_t *uid,const uint8_t *key,uint64_t license)
+{
+	uint64_t i = uid_hash(uid) & reg->mask,n;
+	UIDREG_ENTRY_T *e;
+
+	if(!reg->writable)
+		return -1;
+	for(n=0;n<=reg->mask;n++){
+		e = &reg->slots[i];
+		if(!(e->flags & UIDREG_USED))
+			break;
+		if(!memcmp(e->uid,uid,UIDREG_UID_SIZE)){
+			if(key != NULL && (e->flags & UIDREG_HAS_KEY) && memcmp(e->key,key,UIDREG_KEY_SIZE))
+				return -3;
+			if(key != NULL && !(e->flags & UIDREG_HAS_KEY)){
+				memcpy(e->key,key,UIDREG_KEY_SIZE);
+				__atomic_store_n(&e->flags,e->flags | UIDREG_HAS_KEY,__ATOMIC_RELEASE);
+			}
+			__atomic_store_n(&e->license,license,__ATOMIC_RELEASE);
+			return 0;
+		}
+		i = (i+1) & reg->mask;
+	}
+	if(n > reg->mask || reg->header->count*100 >= (reg->mask+1)*UIDREG_MAX_LOAD)
+		return -2;
+	memcpy(e->uid,uid,UIDREG_UID_SIZE);
+	if(key != NULL)
+		memcpy(e->key,key,UIDREG_KEY_SIZE);
+	e->license = license;
+	e->added = (uint32_t)time(NULL);
+	__atomic_store_n(&e->flags,UIDREG_USED | (key != NULL?UIDREG_HAS_KEY:0),__ATOMIC_RELEASE);
+	__atomic_store_n(&reg->header->count,reg->header->count+1,__ATOMIC_RELAXED);
+	return 0;
+}
+
+/**
+ * @brief	  change the license of a registered UID
+ * @return  return 0 if changed ,otherwise, return nagative value(not registered)
+ */
+int UidReg_setLicense(UIDREG_T *reg,const uint8_t *uid,uint64_t license)
+{
+	UIDREG_ENTRY_T *e = (UIDREG_ENTRY_T*)UidReg_find(reg,uid);
+	if(e == NULL || !reg->writable)
+		return -1;
+	__atomic_store_n(&e->license,license,__ATOMIC_RELEASE);
+	return 0;
+}
+
+#ifdef UIDREG_MAIN
+/*****************************************************************************
+ * command line tool
+ ****************************************************************************/
+
+#include <pthread.h>
+
+#define THREADS_MAX     (64)
+#define SAMPLE_MAX      (1<<20)     /* present UIDs the benchmark draws from */
+#define IMPORT_BATCH    (1<<22)     /* lines sorted by slot before they are inserted */
+
+static const char *stateNames[] = {"none","active","revoked"};
+
+static int hex_bytes(const char *hex,uint8_t *out,int n)
+{
+	int i,v,h;
+	if((int)strlen(hex) < 2*n)
+		return -1;
+	for(i=0;i<2*n;i++){
+		h = hex[i];
+		if(h >= '0' && h <= '9') v = h-'0';
+		else if(h >= 'A' && h <= 'F') v = h-'A'+10;
+		else if(h >= 'a' && h <= 'f') v = h-'a'+10;
+		else return -1;
+		if(i & 1)
+			out[i/2] |= (uint8_t)v;
+		else
+			out[i/2] = (uint8_t)(v<<4);
+	}
+	return 0;
+}
+
+static void print_hex(const uint8_t *data,int n)
+{
+	int i;
+	for(i=0;i<n;i++)
+		printf("%02X",data[i]);
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+static int open_or_complain(UIDREG_T *reg,const char *path,int writable)
+{
+	static const char *why[] = {"","cannot open","another writer has it open","not a registry","cannot map"};
+	int ret = UidReg_open(reg,path,writable);
+	if(ret)
+		fprintf(stderr,"%s: %s\n",path,why[-ret]);
+	return ret;
+}
+
+static int put_or_complain(UIDREG_T *reg,const uint8_t *uid,const uint8_t *key,uint64_t license,const char *where,int line)
+{
+	int ret = UidReg_put(reg,uid,key,license);
+	if(ret == -2)
+		fprintf(stderr,"%s:%d: registry full,uidreg grow it\n",where,line);
+	else if(ret == -3)
+		fprintf(stderr,"%s:%d: UID has a different key\n",where,line);
+	return ret;
+}
+
+static int cmd_create(int argc,char **argv)
+{
+	if(argc != 2 || atoll(argv[1]) <= 0)
+		return 2;
+	if(UidReg_create(argv[0],(uint64_t)atoll(argv[1]))){
+		perror(argv[0]);
+		return 1;
+	}
+	return 0;
+}
+
+/* an import line waiting in the batch */
+typedef struct IMPORT_ITEM{
+	uint64_t home;          /* slot the UID hashes to */
+	uint64_t license;
+	uint8_t uid[UIDREG_UID_SIZE];
+	uint8_t key[UIDREG_KEY_SIZE];
+	int hasKey;
+	int line;
+}IMPORT_ITEM_T;
+
+static int import_cmp(const void *a,const void *b)
+{
+	uint64_t x = ((const IMPORT_ITEM_T*)a)->home,y = ((const IMPORT_ITEM_T*)b)->home;
+	return (x > y)-(x < y);
+}
+
+/* insert a batch in slot order,so the table is written in one sweep instead of a page fault and
+   a random disk block per UID */
+static int import_batch(UIDREG_T *reg,IMPORT_ITEM_T *batch,unsigned long n,const char *path)
+{
+	unsigned long i;
+	qsort(batch,n,sizeof(IMPORT_ITEM_T),import_cmp);
+	for(i=0;i<n;i++)
+		if(put_or_complain(reg,batch[i].uid,batch[i].hasKey?batch[i].key:NULL,batch[i].license,path,batch[i].line))
+			return -1;
+	return 0;
+}
+
+static int cmd_import(int argc,char **argv)
+{
+	char line[256],uidHex[64],keyHex[64];
+	uint8_t rec[34];
+	unsigned long expiry,features,n = 0,bad = 0,batched = 0;
+	int records = 0,lineNo = 0,fields,ret = 0;
+	double start = now_s();
+	IMPORT_ITEM_T *batch,*item;
+	UIDREG_T reg;
+	FILE *fp;
+
+	if(argc == 3 && !strcmp(argv[1],"-r")){
+		records = 1;
+		argv[1] = argv[2];
+		argc--;
+	}
+	if(argc != 2)
+		return 2;
+	batch = malloc(sizeof(IMPORT_ITEM_T)*IMPORT_BATCH);
+	if(batch == NULL || open_or_complain(&reg,argv[0],1)){
+		free(batch);
+		return 1;
+	}
+	fp = fopen(argv[1],records?"rb":"r");
+	if(fp == NULL){
+		perror(argv[1]);
+		UidReg_close(&reg);
+		free(batch);
+		return 1;
+	}
+	while(!ret){
+		item = &batch[batched];
+		item->hasKey = 0;
+		if(records){    /* 32 hex digits and their CRC16,written by uidtool gen */
+			if(fread(rec,1,sizeof(rec),fp) != sizeof(rec))
+				break;
+			rec[32] = '\0';
+			item->line = ++lineNo;
+			if(hex_bytes((char*)rec,item->uid,UIDREG_UID_SIZE)){
+				bad++;
+				continue;
+			}
+			item->license = UIDREG_LICENSE(UIDREG_ACTIVE,1,0);
+		}else{
+			if(fgets(line,sizeof(line),fp) == NULL)
+				break;
+			item->line = ++lineNo;
+			expiry = 0;
+			features = 1;
+			fields = sscanf(line,"%63s %63s %lu %lu",uidHex,keyHex,&expiry,&features);
+			if(fields < 1 || uidHex[0] == '#')
+				continue;
+			item->hasKey = (fields >= 2 && strcmp(keyHex,"-"));
+			if(strlen(uidHex) != 2*UIDREG_UID_SIZE || hex_bytes(uidHex,item->uid,UIDREG_UID_SIZE) ||
+				(item->hasKey && (strlen(keyHex) != 2*UIDREG_KEY_SIZE || hex_bytes(keyHex,item->key,UIDREG_KEY_SIZE)))){
+				fprintf(stderr,"%s:%d: bad line\n",argv[1],lineNo);
+				bad++;
+				continue;
+			}
+			item->license = UIDREG_LICENSE(UIDREG_ACTIVE,features,expiry);
+		}
+		item->home = uid_hash(item->uid) & reg.mask;
+		if(++batched == IMPORT_BATCH){
+			ret = import_batch(&reg,batch,batched,argv[1]);
+			n += batched;
+			batched = 0;
+		}
+	}
+	if(!ret && batched){
+		ret = import_batch(&reg,batch,batched,argv[1]);
+		n += batched;
+	}
+	fclose(fp);
+	fprintf(stderr,"%lu read,%lu bad,%llu in the registry,%.2f s\n",n,bad,
+		(unsigned long long)reg.header->count,now_s()-start);
+	UidReg_close(&reg);
+	free(batch);
+	return (ret || bad)?1:0;
+}
+
+static int cmd_set(int argc,char **argv)
+{
+	uint8_t uid[UIDREG_UID_SIZE];
+	unsigned long expiry = 0,features = 1;
+	int state,ret;
+	UIDREG_T reg;
+
+	if(argc < 3 || argc > 5 || hex_bytes(argv[1],uid,UIDREG_UID_SIZE))
+		return 2;
+	for(state=0;state<3 && strcmp(argv[2],stateNames[state]);state++);
+	if(state == 3)
+		return 2;
+	if(argc >= 4)
+		expiry = strtoul(argv[3],NULL,0);
+	if(argc == 5)
+		features = strtoul(argv[4],NULL,0);
+	if(open_or_complain(&reg,argv[0],1))
+		return 1;
+	ret = put_or_complain(&reg,uid,NULL,UIDREG_LICENSE(state,features,expiry),argv[1],0);
+	UidReg_close(&reg);
+	return ret?1:0;
+}
+
+static int cmd_get(int argc,char **argv)
+{
+	const UIDREG_ENTRY_T *e;
+	uint8_t uid[UIDREG_UID_SIZE],key[UIDREG_KEY_SIZE];
+	uint64_t lic;
+	int i,missing = 0;
+	UIDREG_T reg;
+
+	if(argc < 2)
+		return 2;
+	if(open_or_complain(&reg,argv[0],0))
+		return 1;
+	for(i=1;i<argc;i++){
+		if(hex_bytes(argv[i],uid,UIDREG_UID_SIZE) || (e = UidReg_find(&reg,uid)) == NULL){
+			printf("%s not registered\n",argv[i]);
+			missing = 1;
+			continue;
+		}
+		lic = UidReg_license(e);
+		print_hex(uid,UIDREG_UID_SIZE);
+		printf(" %s expiry %lu features %lx added %lu key ",UIDREG_STATE(lic) <= 2?stateNames[UIDREG_STATE(lic)]:"?",
+			(unsigned long)UIDREG_EXPIRY(lic),(unsigned long)UIDREG_FEATURES(lic),(unsigned long)e->added);
+		if(UidReg_key(e,key))
+			printf("-");
+		else
+			print_hex(key,UIDREG_KEY_SIZE);
+		printf("\n");
+	}
+	UidReg_close(&reg);
+	return missing;
+}
+
+static int cmd_stats(int argc,char **argv)
+{
+	uint64_t i,used = 0,probes = 0,maxProbe = 0,home,d,states[3] = {0,0,0};
+	UIDREG_T reg;
+	double start = now_s();
+
+	if(argc != 1)
+		return 2;
+	if(open_or_complain(&reg,argv[0],0))
+		return 1;
+	for(i=0;i<=reg.mask;i++){
+		if(!(reg.slots[i].flags & UIDREG_USED))
+			continue;
+		used++;
+		home = uid_hash(reg.slots[i].uid) & reg.mask;
+		d = ((i-home) & reg.mask)+1;
+		probes += d;
+		if(d > maxProbe)
+			maxProbe = d;
+		if(UIDREG_STATE(reg.slots[i].license) < 3)
+			states[UIDREG_STATE(reg.slots[i].license)]++;
+	}
+	printf("%llu of %llu slots used(%.1f%%),%llu active %llu revoked %llu none,probes avg %.2f max %llu,"
+		"%.1f MB,scanned in %.2f s\n",(unsigned long long)used,(unsigned long long)reg.mask+1,100.0*used/(reg.mask+1),
+		(unsigned long long)states[UIDREG_ACTIVE],(unsigned long long)states[UIDREG_REVOKED],
+		(unsigned long long)states[UIDREG_NONE],used?(double)probes/used:0.0,(unsigned long long)maxProbe,
+		reg.mapSize/1e6,now_s()-start);
+	if(used != reg.header->count)
+		printf("header count %llu does not match\n",(unsigned long long)reg.header->count);
+	UidReg_close(&reg);
+	return 0;
+}
+
+static int cmd_grow(int argc,char **argv)
+{
+	UIDREG_T from,to;
+	uint64_t i;
+	int ret = 0;
+
+	if(argc != 3 || atoll(argv[2]) <= 0)
+		return 2;
+	if(open_or_complain(&from,argv[0],1))  /* as a writer,so nothing changes while copying */
+		return 1;
+	if(UidReg_create(argv[1],(uint64_t)atoll(argv[2]))){
+		perror(argv[1]);
+		UidReg_close(&from);
+		return 1;
+	}
+	if(open_or_complain(&to,argv[1],1)){
+		UidReg_close(&from);
+		return 1;
+	}
+	for(i=0;i<=from.mask && !ret;i++){
+		const UIDREG_ENTRY_T *e = &from.slots[i];
+		if(!(e->flags & UIDREG_USED))
+			continue;
+		ret = put_or_complain(&to,e->uid,(e->flags & UIDREG_HAS_KEY)?e->key:NULL,e->license,argv[1],0);
+		if(!ret)
+			to.slots[(UidReg_find(&to,e->uid)-to.slots)].added = e->added;
+	}
+	fprintf(stderr,"%llu UIDs in %llu slots\n",(unsigned long long)to.header->count,(unsigned long long)to.mask+1);
+	UidReg_close(&to);
+	UidReg_close(&from);
+	return ret?1:0;
+}
+
+/*****************************************************************************
+ * benchmark
+ ****************************************************************************/
+
+typedef struct BENCH{
+	UIDREG_T *reg;
+	uint8_t (*sample)[UIDREG_UID_SIZE];
+	unsigned long sampleCount;
+	unsigned long lookups;
+	int write;                  /* a writer runs,licenses are checked */
+	volatile int stop;
+	unsigned long updates;
+}BENCH_T;
+
+typedef struct BENCH_THREAD{
+	pthread_t tid;
+	BENCH_T *bench;
+	unsigned long seed;
+	unsigned long found,missed,torn;
+	double hitNs,missNs;
+}BENCH_THREAD_T;
+
+static unsigned long next_rand(unsigned long *s)
+{
+	*s ^= *s<<13;
+	*s ^= *s>>7;
+	*s ^= *s<<17;
+	return *s;
+}
+
+/* a license the writer may have stored: active or revoked,expiry and features derived from the state */
+static int license_whole(uint64_t lic)
+{
+	int state = UIDREG_STATE(lic);
+	if(state == UIDREG_ACTIVE && UIDREG_FEATURES(lic) == 1)
+		return 1;
+	return state == UIDREG_REVOKED && UIDREG_FEATURES(lic) == 0 && UIDREG_EXPIRY(lic) == 0xFFFFFFFFUL;
+}
+
+static void *bench_reader(void *arg)
+{
+	BENCH_THREAD_T *t = (BENCH_THREAD_T*)arg;
+	BENCH_T *b = t->bench;
+	const UIDREG_ENTRY_T *e;
+	uint8_t uid[UIDREG_UID_SIZE];
+	unsigned long i,j;
+	double start;
+
+	start = now_s();
+	for(i=0;i<b->lookups;i++){
+		e = UidReg_find(b->reg,b->sample[next_rand(&t->seed) % b->sampleCount]);
+		if(e != NULL){
+			t->found++;
+			if(b->write && !license_whole(UidReg_license(e)))
+				t->torn++;
+		}
+	}
+	t->hitNs = (now_s()-start)*1e9/b->lookups;
+	start = now_s();
+	for(i=0;i<b->lookups;i++){
+		for(j=0;j<UIDREG_UID_SIZE;j+=8){
+			unsigned long r = next_rand(&t->seed);
+			memcpy(uid+j,&r,8);
+		}
+		if(UidReg_find(b->reg,uid) == NULL)
+			t->missed++;
+	}
+	t->missNs = (now_s()-start)*1e9/b->lookups;
+	return NULL;
+}
+
+static void *bench_writer(void *arg)
+{
+	BENCH_T *b = (BENCH_T*)arg;
+	unsigned long seed = 88172645463325252UL,i;
+	while(!b->stop){
+		i = next_rand(&seed) % b->sampleCount;
+		UidReg_setLicense(b->reg,b->sample[i],(seed & 1)?UIDREG_LICENSE(UIDREG_ACTIVE,1,0):
+			UIDREG_LICENSE(UIDREG_REVOKED,0,0xFFFFFFFFUL));
+		b->updates++;
+	}
+	return NULL;
+}
+
+static int cmd_bench(int argc,char **argv)
+{
+	BENCH_THREAD_T t[THREADS_MAX];
+	pthread_t writer;
+	BENCH_T b;
+	UIDREG_T reg;
+	unsigned long found = 0,missed = 0,torn = 0,step,used,i;
+	double hitNs = 0,missNs = 0,start,open;
+	int threads = (int)sysconf(_SC_NPROCESSORS_ONLN),write = 0,n;
+
+	memset(&b,0,sizeof(b));
+	b.lookups = 10000000;
+	while(argc > 0 && argv[0][0] == '-'){
+		if(!strcmp(argv[0],"-w")){
+			write = 1;
+		}else if(!strcmp(argv[0],"-j") && argc > 1){
+			threads = atoi(argv[1]);
+			argc--;
+			argv++;
+		}else if(!strcmp(argv[0],"-n") && argc > 1){
+			b.lookups = strtoul(argv[1],NULL,0);
+			argc--;
+			argv++;
+		}else{
+			break;
+		}
+		argc--;
+		argv++;
+	}
+	if(argc != 1 || b.lookups == 0)
+		return 2;
+	if(threads < 1)
+		threads = 1;
+	if(threads > THREADS_MAX)
+		threads = THREADS_MAX;
+	start = now_s();
+	if(open_or_complain(&reg,argv[0],write))
+		return 1;
+	open = now_s()-start;
+	if(reg.header->count == 0){
+		fprintf(stderr,"%s: empty\n",argv[0]);
+		UidReg_close(&reg);
+		return 1;
+	}
+	/* present UIDs spread over the table,this first pass also faults its pages in */
+	b.reg = &reg;
+	b.sample = malloc(sizeof(*b.sample)*SAMPLE_MAX);
+	if(b.sample == NULL)
+		return 1;
+	step = (unsigned long)(reg.header->count/SAMPLE_MAX)+1;
+	for(i=0,used=0;i<=reg.mask && b.sampleCount < SAMPLE_MAX;i++)
+		if((reg.slots[i].flags & UIDREG_USED) && used++ % step == 0)
+			memcpy(b.sample[b.sampleCount++],reg.slots[i].uid,UIDREG_UID_SIZE);
+	b.write = write;
+	if(write){
+		for(i=0;i<b.sampleCount;i++)   /* licenses the torn read check knows */
+			UidReg_setLicense(&reg,b.sample[i],UIDREG_LICENSE(UIDREG_ACTIVE,1,0));
+		pthread_create(&writer,NULL,bench_writer,&b);
+	}
+	for(n=0;n<threads;n++){
+		memset(&t[n],0,sizeof(t[n]));
+		t[n].bench = &b;
+		t[n].seed = 0x9E3779B97F4A7C15UL*(n+1);
+		pthread_create(&t[n].tid,NULL,bench_reader,&t[n]);
+	}
+	for(n=0;n<threads;n++){
+		pthread_join(t[n].tid,NULL);
+		found += t[n].found;
+		missed += t[n].missed;
+		torn += t[n].torn;
+		hitNs += t[n].hitNs/threads;
+		missNs += t[n].missNs/threads;
+	}
+	if(write){
+		b.stop = 1;
+		pthread_join(writer,NULL);
+	}
+	printf("%llu UIDs in %llu slots,opened in %.1f us,%d threads:hit %.0f ns(%.1f M/s) miss %.0f ns(%.1f M/s)",
+		(unsigned long long)reg.header->count,(unsigned long long)reg.mask+1,open*1e6,threads,hitNs,threads*1e3/hitNs,
+		missNs,threads*1e3/missNs);
+	if(write)
+		printf(",%lu updates,%lu torn",b.updates,torn);
+	printf("\n");
+	if(found != b.lookups*threads || missed != b.lookups*threads)
+		printf("lookups went wrong: %lu of %lu found,%lu of %lu missed\n",found,b.lookups*threads,missed,b.lookups*threads);
+	free(b.sample);
+	UidReg_close(&reg);
+	return (torn || found != b.lookups*threads)?1:0;
+}
+
+int main(int argc,char **argv)
+{
+	int ret = 2;
+
+	if(argc >= 2){
+		if(!strcmp(argv[1],"create"))
+			ret = cmd_create(argc-2,argv+2);
+		else if(!strcmp(argv[1],"import"))
+			ret = cmd_import(argc-2,argv+2);
+		else if(!strcmp(argv[1],"set"))
+			ret = cmd_set(argc-2,argv+2);
+		else if(!strcmp(argv[1],"get"))
+			ret = cmd_get(argc-2,argv+2);
+		else if(!strcmp(argv[1],"stats"))
+			ret = cmd_stats(argc-2,argv+2);
+		else if(!strcmp(argv[1],"grow"))
+			ret = cmd_grow(argc-2,argv+2);
+		else if(!strcmp(argv[1],"bench"))
+			ret = cmd_bench(argc-2,argv+2);
+	}
+	if(ret == 2)
+		fprintf(stderr,"usage: %s create <reg> <capacity>\n"
+			"       %s import <reg> [-r] <file>\n"
+			"       %s set <reg> <UID> <active|revoked|none> [expiry [features]]\n"
+			"       %s get <reg> <UID>...\n"
+			"       %s stats <reg>\n"
+			"       %s grow <reg> <new reg> <capacity>\n"
+			"       %s bench [-j threads] [-n lookups] [-w] <reg>\n",
+			argv[0],argv[0],argv[0],argv[0],argv[0],argv[0],argv[0]);
+	return ret;
+}
+#endif
@@ -0,0 +1,88 @@
+#ifndef _UIDREG_H
+#define _UIDREG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/*
+ * UID license registry: an open-addressing hash table of the devices a server knows, kept in a
+ * file that is mapped rather than loaded, so a server starts at once whatever its size and the
+ * pages it touches are all it reads.
+ *
+ *   header    UIDREG_HEADER_SIZE bytes,UIDREG_HEADER_T
+ *   slots     capacity(a power of two) UIDREG_ENTRY_T of 64 bytes,one cache line each
+ *
+ * A slot is keyed by the raw 16 byte UID (the 32 hex digits getUID() reads, as bytes) and found
+ * by linear probing from a hash of it. Slots are only ever added, never moved or emptied: a
+ * device that loses its license is set to UIDREG_REVOKED. The one writer (UidReg_open with
+ * writable,which takes an exclusive flock) fills in a slot and then publishes it with a release
+ * store of its flags, and a license is one 64 bit word stored at once, so any number of readers
+ * in any number of processes look up without locks and never see half an entry. The key is
+ * published the same way by UIDREG_HAS_KEY and does not change once set.
+ *
+ * The table does not grow in place: uidreg grow copies it into a larger file, which the servers
+ * pick up when restarted.
+ */
+
+#define UIDREG_MAGIC            (0x31524455UL)  /* "UDR1" */
+#define UIDREG_HEADER_SIZE      (64)
+#define UIDREG_UID_SIZE         (16)
+#define UIDREG_KEY_SIZE         (16)
+#define UIDREG_MAX_LOAD         (90)            /* percent of the slots a writer fills at most */
+
+/* entry flags */
+#define UIDREG_USED             (1UL<<0)
+#define UIDREG_HAS_KEY          (1UL<<1)
+
+/* license states */
+#define UIDREG_NONE             (0)             /* known device,no license */
+#define UIDREG_ACTIVE           (1)
+#define UIDREG_REVOKED          (2)
+
+/* license word: state in bits 0-7, features 8-31, expiry 32-63 (Unix seconds, 0 never) */
+#define UIDREG_LICENSE(state,features,expiry)   ((uint64_t)(expiry)<<32 | (uint64_t)((features) & 0xFFFFFFUL)<<8 | ((state) & 0xFF))
+#define UIDREG_STATE(lic)       ((int)((lic) & 0xFF))
+#define UIDREG_FEATURES(lic)    ((uint32_t)((lic)>>8) & 0xFFFFFFUL)
+#define UIDREG_EXPIRY(lic)      ((uint32_t)((lic)>>32))
+
+typedef struct UIDREG_HEADER{
+	uint32_t magic;
+	uint32_t slotBits;      /* capacity = 1<<slotBits */
+	uint64_t count;         /* slots used */
+}UIDREG_HEADER_T;
+
+typedef struct UIDREG_ENTRY{
+	uint32_t flags;
+	uint32_t added;         /* Unix seconds */
+	uint64_t license;
+	uint8_t uid[UIDREG_UID_SIZE];
+	uint8_t key[UIDREG_KEY_SIZE];   /* challenge MAC key(Chaskey.h) when UIDREG_HAS_KEY */
+	uint8_t reserved[16];
+}UIDREG_ENTRY_T;
+
+typedef struct UIDREG{
+	UIDREG_HEADER_T *header;
+	UIDREG_ENTRY_T *slots;
+	uint64_t mask;
+	uint64_t mapSize;
+	int fd;
+	int writable;
+}UIDREG_T;
+
+int UidReg_create(const char *path,uint64_t capacity);
+int UidReg_open(UIDREG_T *reg,const char *path,int writable);
+void UidReg_close(UIDREG_T *reg);
+const UIDREG_ENTRY_T *UidReg_find(const UIDREG_T *reg,const uint8_t *uid);
+int UidReg_put(UIDREG_T *reg,const uint8_t *uid,const uint8_t *key,uint64_t license);
+int UidReg_setLicense(UIDREG_T *reg,const uint8_t *uid,uint64_t license);
+uint64_t UidReg_license(const UIDREG_ENTRY_T *entry);
+int UidReg_key(const UIDREG_ENTRY_T *entry,uint8_t *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
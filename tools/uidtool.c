@@ -0,0 +1,653 @@
+/*
+ * @brief: generate, patch and verify the UID record of SWAuthDemo images (host tool)
+ *
+ * Build: gcc -O2 -pthread -DCRC16_IMPL=3 -ICRC16 -o uidtool tools/uidtool.c CRC16/lib_crc16.c
+ * Usage: uidtool gen <count> <records.bin>           count random UIDs, one record each
+ *        uidtool list <records.bin>                  print UID and CRC of every record
+ *        uidtool patch <image> <UID|records.bin:n> [out]
+ *                                                    write the record at UID_ADDR, in place
+ *                                                    unless out is given
+ *        uidtool verify [-j threads] [-r] <file>...  check images, or record files with -r
+ *        uidtool key <image> <32 hex digits> [out]   write the challenge MAC key at KEY_ADDR
+ *
+ * A UID record is what getUID() reads at UID_ADDR: 32 ASCII hex digits followed by
+ * calculate_crc16() of them, big-endian. Images are raw .bin files starting at flash address 0
+ * or Intel HEX files (.hex). A patched .hex is written back as 16 byte data records in address
+ * order. verify prints one line per bad record and exits 1 if there was any; the CRC runs on
+ * the slicing-by-4 kernel of lib_crc16 (CRC16_IMPL 3) and files or record ranges are spread
+ * over the threads, so a large set is limited by disk and memory bandwidth.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lib_crc16.h"
+
+#define UID_ADDR        (0xF000)            /* keep in step with SWAuthDemo.c */
+#define UID_SIZE        (32)
+#define KEY_ADDR        (0xF040)            /* MAC key: KEY_SIZE bytes and their CRC16,big-endian */
+#define KEY_SIZE        (16)
+#define RECORD_SIZE     (UID_SIZE+2)
+#define IMAGE_MAX       (1UL<<20)           /* largest .hex address range handled */
+#define THREADS_MAX     (64)
+
+enum RECORD_STATUS{
+	RECORD_OK = 0,
+	RECORD_BAD_CRC = -1,
+	RECORD_NOT_HEX = -2,        /* CRC good but the firmware cannot use it for binary frames */
+	RECORD_MISSING = -3,        /* image does not reach UID_ADDR */
+	RECORD_READ_ERROR = -4,
+};
+
+/* image in memory,addresses 0..size-1,used marks bytes present in a .hex file */
+typedef struct IMAGE{
+	unsigned char *data;
+	unsigned char *used;
+	unsigned long size;
+	int hex;
+}IMAGE_T;
+
+static const char hexDigits[] = "0123456789ABCDEF";
+static unsigned char hexValid[256];     /* 1 for '0'-'9','A'-'F','a'-'f',set up by main */
+
+static void make_record(const char *uid,unsigned char *rec)
+{
+	uint16_t crc;
+	memcpy(rec,uid,UID_SIZE);
+	crc = calculate_crc16((char*)rec,UID_SIZE);
+	rec[UID_SIZE] = (unsigned char)(crc>>8);
+	rec[UID_SIZE+1] = (unsigned char)crc;
+}
+
+static int check_record(const unsigned char *rec)
+{
+	int i,valid = 1;
+	if(calculate_crc16((char*)rec,UID_SIZE) != (rec[UID_SIZE]<<8 | rec[UID_SIZE+1]))
+		return RECORD_BAD_CRC;
+	for(i=0;i<UID_SIZE;i++)    /* no branch per digit,random UIDs would mispredict most of them */
+		valid &= hexValid[rec[i]];
+	return valid?RECORD_OK:RECORD_NOT_HEX;
+}
+
+static const char *status_text(int status)
+{
+	switch(status){
+	case RECORD_OK:         return "ok";
+	case RECORD_BAD_CRC:    return "CRC mismatch";
+	case RECORD_NOT_HEX:    return "UID is not hex";
+	case RECORD_MISSING:    return "no UID record";
+	default:                return "read error";
+	}
+}
+
+static int is_hex_file(const char *path)
+{
+	const char *dot = strrchr(path,'.');
+	return dot != NULL && (!strcmp(dot,".hex") || !strcmp(dot,".HEX") || !strcmp(dot,".ihx"));
+}
+
+/*****************************************************************************
+ * Intel HEX
+ ****************************************************************************/
+
+static int hex_byte(const char *p)
+{
+	int i,v = 0;
+	for(i=0;i<2;i++){
+		v <<= 4;
+		if(p[i] >= '0' && p[i] <= '9') v |= p[i]-'0';
+		else if(p[i] >= 'A' && p[i] <= 'F') v |= p[i]-'A'+10;
+		else if(p[i] >= 'a' && p[i] <= 'f') v |= p[i]-'a'+10;
+		else return -1;
+	}
+	return v;
+}
+
+/* parse data,extended segment and extended linear address records into img */
+static int hex_load(FILE *fp,IMAGE_T *img,const char *path)
+{
+	char line[600];
+	unsigned char rec[256+5];
+	unsigned long base = 0,addr;
+	int lineNo = 0,n,i,v,sum;
+
+	img->data = malloc(IMAGE_MAX);
+	img->used = calloc(1,IMAGE_MAX);
+	if(img->data == NULL || img->used == NULL)
+		return -1;
+	memset(img->data,0xFF,IMAGE_MAX);
+	img->size = 0;
+	img->hex = 1;
+	while(fgets(line,sizeof(line),fp) != NULL){
+		lineNo++;
+		if(line[0] != ':')
+			continue;
+		for(n=0,sum=0;n<(int)sizeof(rec);n++){
+			v = hex_byte(line+1+2*n);
+			if(v < 0)
+				break;
+			rec[n] = (unsigned char)v;
+			sum += v;
+		}
+		if(n < 5 || n != rec[0]+5 || (sum & 0xFF)){
+			fprintf(stderr,"%s:%d: bad record\n",path,lineNo);
+			return -1;
+		}
+		switch(rec[3]){
+		case 0x00:
+			addr = base+(rec[1]<<8 | rec[2]);
+			if(addr+rec[0] > IMAGE_MAX){
+				fprintf(stderr,"%s:%d: address 0x%lX out of range\n",path,lineNo,addr);
+				return -1;
+			}
+			for(i=0;i<rec[0];i++){
+				img->data[addr+i] = rec[4+i];
+				img->used[addr+i] = 1;
+			}
+			if(addr+rec[0] > img->size)
+				img->size = addr+rec[0];
+			break;
+		case 0x01:
+			return 0;
+		case 0x02:
+			base = (unsigned long)(rec[4]<<8 | rec[5])<<4;
+			break;
+		case 0x04:
+			base = (unsigned long)(rec[4]<<8 | rec[5])<<16;
+			break;
+		default:    /* start address records */
+			break;
+		}
+	}
+	return 0;
+}
+
+static void hex_line(FILE *fp,int type,unsigned long addr,const unsigned char *data,int n)
+{
+	int i,sum = n+(int)((addr>>8)&0xFF)+(int)(addr&0xFF)+type;
+	fprintf(fp,":%02X%04lX%02X",n,addr&0xFFFF,type);
+	for(i=0;i<n;i++){
+		fprintf(fp,"%02X",data[i]);
+		sum += data[i];
+	}
+	fprintf(fp,"%02X\n",(-sum)&0xFF);
+}
+
+static int hex_save(FILE *fp,const IMAGE_T *img)
+{
+	unsigned long addr = 0,upper = 0,end;
+	unsigned char ela[2];
+
+	while(addr < img->size){
+		if(!img->used[addr]){
+			addr++;
+			continue;
+		}
+		if((addr>>16) != upper){
+			upper = addr>>16;
+			ela[0] = (unsigned char)(upper>>8);
+			ela[1] = (unsigned char)upper;
+			hex_line(fp,0x04,0,ela,2);
+		}
+		for(end=addr;end<img->size && img->used[end] && end-addr < 16 && (end>>16) == upper;end++){}
+		hex_line(fp,0x00,addr,img->data+addr,(int)(end-addr));
+		addr = end;
+	}
+	hex_line(fp,0x01,0,NULL,0);
+	return ferror(fp)?-1:0;
+}
+
+/*****************************************************************************
+ * images
+ ****************************************************************************/
+
+static int image_load(const char *path,IMAGE_T *img)
+{
+	FILE *fp = fopen(path,"rb");
+	long len;
+	int ret = 0;
+
+	memset(img,0,sizeof(*img));
+	if(fp == NULL){
+		perror(path);
+		return -1;
+	}
+	if(is_hex_file(path)){
+		ret = hex_load(fp,img,path);
+	}else{
+		fseek(fp,0,SEEK_END);
+		len = ftell(fp);
+		fseek(fp,0,SEEK_SET);
+		img->size = (unsigned long)len;
+		img->data = malloc(len > 0?len:1);
+		if(img->data == NULL || fread(img->data,1,len,fp) != (size_t)len)
+			ret = -1;
+	}
+	fclose(fp);
+	return ret;
+}
+
+static void image_free(IMAGE_T *img)
+{
+	free(img->data);
+	free(img->used);
+}
+
+static int image_save(const char *path,IMAGE_T *img)
+{
+	FILE *fp = fopen(path,"wb");
+	int ret;
+	if(fp == NULL){
+		perror(path);
+		return -1;
+	}
+	if(img->hex)
+		ret = hex_save(fp,img);
+	else
+		ret = (fwrite(img->data,1,img->size,fp) == img->size)?0:-1;
+	if(fclose(fp))
+		ret = -1;
+	return ret;
+}
+
+/* write len bytes at addr,a .bin image is grown with erased flash(0xFF) so they fit */
+static int image_put(IMAGE_T *img,unsigned long addr,const unsigned char *data,int len)
+{
+	unsigned char *grown;
+	int i;
+	if(!img->hex && img->size < addr+len){
+		grown = realloc(img->data,addr+len);
+		if(grown == NULL)
+			return -1;
+		memset(grown+img->size,0xFF,addr+len-img->size);
+		img->data = grown;
+		img->size = addr+len;
+	}
+	for(i=0;i<len;i++){
+		img->data[addr+i] = data[i];
+		if(img->hex)
+			img->used[addr+i] = 1;
+	}
+	if(img->size < addr+len)
+		img->size = addr+len;
+	return 0;
+}
+
+/* the record of one image,.bin files are mapped instead of read */
+static int image_check(const char *path,unsigned char *rec)
+{
+	IMAGE_T img;
+	struct stat st;
+	unsigned char *map;
+	int fd,i;
+
+	if(!is_hex_file(path)){
+		fd = open(path,O_RDONLY);
+		if(fd < 0 || fstat(fd,&st)){
+			if(fd >= 0)
+				close(fd);
+			return RECORD_READ_ERROR;
+		}
+		if(st.st_size < UID_ADDR+RECORD_SIZE){
+			close(fd);
+			return RECORD_MISSING;
+		}
+		map = mmap(NULL,UID_ADDR+RECORD_SIZE,PROT_READ,MAP_PRIVATE,fd,0);
+		close(fd);
+		if(map == MAP_FAILED)
+			return RECORD_READ_ERROR;
+		memcpy(rec,map+UID_ADDR,RECORD_SIZE);
+		munmap(map,UID_ADDR+RECORD_SIZE);
+		return check_record(rec);
+	}
+	if(image_load(path,&img)){
+		image_free(&img);
+		return RECORD_READ_ERROR;
+	}
+	for(i=0;i<RECORD_SIZE && img.used[UID_ADDR+i];i++)
+		rec[i] = img.data[UID_ADDR+i];
+	image_free(&img);
+	return (i < RECORD_SIZE)?RECORD_MISSING:check_record(rec);
+}
+
+/*****************************************************************************
+ * verify,work is handed out in pieces through an atomic counter
+ ****************************************************************************/
+
+typedef struct VERIFY_JOB{
+	char **files;
+	int fileCount;
+	const unsigned char *records;   /* -r: mapped record file */
+	unsigned long recordCount;
+	unsigned long next;             /* next file or first record of the next piece */
+	unsigned long bad;
+	unsigned long bytes;
+	pthread_mutex_t lock;
+}VERIFY_JOB_T;
+
+#define RECORDS_PER_PIECE   (4096)
+
+static void report(VERIFY_JOB_T *job,const char *what,unsigned long index,int status,const unsigned char *rec)
+{
+	pthread_mutex_lock(&job->lock);
+	job->bad++;
+	if(status == RECORD_BAD_CRC || status == RECORD_NOT_HEX)
+		printf("%s:%lu: %s, UID %.32s CRC %02X%02X expected %04X\n",what,index,status_text(status),
+			(const char*)rec,rec[UID_SIZE],rec[UID_SIZE+1],calculate_crc16((char*)rec,UID_SIZE));
+	else
+		printf("%s: %s\n",what,status_text(status));
+	pthread_mutex_unlock(&job->lock);
+}
+
+static void *verify_worker(void *arg)
+{
+	VERIFY_JOB_T *job = (VERIFY_JOB_T*)arg;
+	unsigned char rec[RECORD_SIZE];
+	unsigned long i,first,last;
+	int status;
+
+	while(1){
+		if(job->records == NULL){
+			i = __sync_fetch_and_add(&job->next,1);
+			if(i >= (unsigned long)job->fileCount)
+				break;
+			status = image_check(job->files[i],rec);
+			if(status != RECORD_OK)
+				report(job,job->files[i],UID_ADDR,status,rec);
+			__sync_fetch_and_add(&job->bytes,RECORD_SIZE);
+			continue;
+		}
+		first = __sync_fetch_and_add(&job->next,RECORDS_PER_PIECE);
+		if(first >= job->recordCount)
+			break;
+		last = first+RECORDS_PER_PIECE;
+		if(last > job->recordCount)
+			last = job->recordCount;
+		for(i=first;i<last;i++){
+			status = check_record(job->records+i*RECORD_SIZE);
+			if(status != RECORD_OK)
+				report(job,job->files[0],i,status,job->records+i*RECORD_SIZE);
+		}
+		__sync_fetch_and_add(&job->bytes,(last-first)*RECORD_SIZE);
+	}
+	return NULL;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+static int run_verify(VERIFY_JOB_T *job,int threads)
+{
+	pthread_t tid[THREADS_MAX];
+	double start = now_s(),spent;
+	int i;
+
+	pthread_mutex_init(&job->lock,NULL);
+	for(i=0;i<threads;i++)
+		if(pthread_create(&tid[i],NULL,verify_worker,job))
+			break;
+	if(i == 0)
+		verify_worker(job);
+	while(i-- > 0)
+		pthread_join(tid[i],NULL);
+	spent = now_s()-start;
+	fprintf(stderr,"%lu checked, %lu bad, %.1f MB/s of records\n",
+		job->records?job->recordCount:(unsigned long)job->fileCount,job->bad,spent > 0?job->bytes/spent/1e6:0.0);
+	return job->bad?1:0;
+}
+
+static int cmd_verify(int argc,char **argv)
+{
+	VERIFY_JOB_T job;
+	struct stat st;
+	int threads = (int)sysconf(_SC_NPROCESSORS_ONLN),records = 0,fd,ret,i;
+
+	while(argc > 0 && argv[0][0] == '-'){
+		if(!strcmp(argv[0],"-r")){
+			records = 1;
+		}else if(!strcmp(argv[0],"-j") && argc > 1){
+			threads = atoi(argv[1]);
+			argc--;
+			argv++;
+		}else{
+			break;
+		}
+		argc--;
+		argv++;
+	}
+	if(argc < 1)
+		return 2;
+	if(threads < 1)
+		threads = 1;
+	if(threads > THREADS_MAX)
+		threads = THREADS_MAX;
+	memset(&job,0,sizeof(job));
+	job.files = argv;
+	job.fileCount = argc;
+	if(!records)
+		return run_verify(&job,threads);
+
+	ret = 0;
+	for(i=0;i<argc;i++){    /* record files one after the other,each split over the threads */
+		fd = open(argv[i],O_RDONLY);
+		if(fd < 0 || fstat(fd,&st)){
+			perror(argv[i]);
+			ret = 1;
+			if(fd >= 0)
+				close(fd);
+			continue;
+		}
+		if(st.st_size % RECORD_SIZE)
+			fprintf(stderr,"%s: %ld trailing bytes ignored\n",argv[i],(long)(st.st_size % RECORD_SIZE));
+		job.recordCount = st.st_size/RECORD_SIZE;
+		job.records = NULL;
+		if(job.recordCount)
+			job.records = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE|MAP_POPULATE,fd,0);
+		close(fd);
+		if(job.records == MAP_FAILED || job.records == NULL){
+			if(job.records == MAP_FAILED)
+				perror(argv[i]);
+			continue;
+		}
+		job.files = argv+i;
+		job.next = job.bad = job.bytes = 0;
+		ret |= run_verify(&job,threads);
+		munmap((void*)job.records,st.st_size);
+	}
+	return ret;
+}
+
+/*****************************************************************************
+ * gen,list,patch
+ ****************************************************************************/
+
+static int cmd_gen(int argc,char **argv)
+{
+	unsigned char raw[UID_SIZE/2],rec[RECORD_SIZE];
+	char uid[UID_SIZE];
+	FILE *rnd,*out;
+	long count,n;
+	int i;
+
+	if(argc != 2 || (count = atol(argv[0])) <= 0)
+		return 2;
+	rnd = fopen("/dev/urandom","rb");
+	out = fopen(argv[1],"wb");
+	if(rnd == NULL || out == NULL){
+		perror(rnd == NULL?"/dev/urandom":argv[1]);
+		return 1;
+	}
+	for(n=0;n<count;n++){
+		if(fread(raw,1,sizeof(raw),rnd) != sizeof(raw))
+			return 1;
+		for(i=0;i<UID_SIZE/2;i++){
+			uid[2*i] = hexDigits[raw[i]>>4];
+			uid[2*i+1] = hexDigits[raw[i]&0x0F];
+		}
+		make_record(uid,rec);
+		fwrite(rec,1,RECORD_SIZE,out);
+	}
+	fclose(rnd);
+	if(fclose(out)){
+		perror(argv[1]);
+		return 1;
+	}
+	fprintf(stderr,"%ld records written to %s\n",count,argv[1]);
+	return 0;
+}
+
+static int cmd_list(int argc,char **argv)
+{
+	unsigned char rec[RECORD_SIZE];
+	FILE *fp;
+	unsigned long n = 0;
+	int status,bad = 0;
+
+	if(argc != 1)
+		return 2;
+	fp = fopen(argv[0],"rb");
+	if(fp == NULL){
+		perror(argv[0]);
+		return 1;
+	}
+	while(fread(rec,1,RECORD_SIZE,fp) == RECORD_SIZE){
+		status = check_record(rec);
+		printf("%lu %.32s %02X%02X%s%s\n",n++,(const char*)rec,rec[UID_SIZE],rec[UID_SIZE+1],
+			status?" ":"",status?status_text(status):"");
+		bad |= (status != RECORD_OK);
+	}
+	fclose(fp);
+	return bad;
+}
+
+/* the UID to patch in: 32 hex digits,or record n of a record file given as file:n */
+static int get_patch_record(const char *arg,unsigned char *rec)
+{
+	const char *colon = strrchr(arg,':');
+	char path[4096];
+	FILE *fp;
+	long index;
+
+	if(strlen(arg) == UID_SIZE && strspn(arg,"0123456789ABCDEFabcdef") == UID_SIZE){
+		make_record(arg,rec);
+		return 0;
+	}
+	if(colon == NULL || colon-arg >= (long)sizeof(path))
+		return -1;
+	memcpy(path,arg,colon-arg);
+	path[colon-arg] = '\0';
+	index = atol(colon+1);
+	fp = fopen(path,"rb");
+	if(fp == NULL){
+		perror(path);
+		return -1;
+	}
+	if(index < 0 || fseek(fp,index*RECORD_SIZE,SEEK_SET) || fread(rec,1,RECORD_SIZE,fp) != RECORD_SIZE){
+		fprintf(stderr,"%s: no record %ld\n",path,index);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	return check_record(rec) == RECORD_OK?0:-1;
+}
+
+static int cmd_patch(int argc,char **argv)
+{
+	unsigned char rec[RECORD_SIZE];
+	IMAGE_T img;
+	int ret;
+
+	if(argc < 2 || argc > 3)
+		return 2;
+	if(get_patch_record(argv[1],rec)){
+		fprintf(stderr,"%s: not a UID or a good record\n",argv[1]);
+		return 1;
+	}
+	if(image_load(argv[0],&img)){
+		image_free(&img);
+		return 1;
+	}
+	if(argc == 3 && is_hex_file(argv[2]) != img.hex){
+		fprintf(stderr,"%s: must be the same format as %s\n",argv[2],argv[0]);
+		image_free(&img);
+		return 1;
+	}
+	ret = image_put(&img,UID_ADDR,rec,RECORD_SIZE) || image_save(argc == 3?argv[2]:argv[0],&img);
+	image_free(&img);
+	if(!ret)
+		fprintf(stderr,"UID %.32s CRC %02X%02X at 0x%04X\n",(const char*)rec,rec[UID_SIZE],rec[UID_SIZE+1],UID_ADDR);
+	return ret;
+}
+
+static int cmd_key(int argc,char **argv)
+{
+	unsigned char rec[KEY_SIZE+2];
+	uint16_t crc;
+	IMAGE_T img;
+	int i,v,ret;
+
+	if(argc < 2 || argc > 3)
+		return 2;
+	for(i=0;i<KEY_SIZE;i++){
+		v = (strlen(argv[1]) == 2*KEY_SIZE)?hex_byte(argv[1]+2*i):-1;
+		if(v < 0){
+			fprintf(stderr,"%s: key must be %d hex digits\n",argv[1],2*KEY_SIZE);
+			return 1;
+		}
+		rec[i] = (unsigned char)v;
+	}
+	crc = calculate_crc16((char*)rec,KEY_SIZE);
+	rec[KEY_SIZE] = (unsigned char)(crc>>8);
+	rec[KEY_SIZE+1] = (unsigned char)crc;
+	if(image_load(argv[0],&img)){
+		image_free(&img);
+		return 1;
+	}
+	if(argc == 3 && is_hex_file(argv[2]) != img.hex){
+		fprintf(stderr,"%s: must be the same format as %s\n",argv[2],argv[0]);
+		image_free(&img);
+		return 1;
+	}
+	ret = image_put(&img,KEY_ADDR,rec,sizeof(rec)) || image_save(argc == 3?argv[2]:argv[0],&img);
+	image_free(&img);
+	return ret;
+}
+
+int main(int argc,char **argv)
+{
+	int ret = 2,i;
+
+	for(i=0;i<16;i++){
+		hexValid[(unsigned char)hexDigits[i]] = 1;
+		hexValid[(unsigned char)(hexDigits[i]|0x20)] = 1;   /* '0'-'9' are unchanged */
+	}
+	if(argc >= 2){
+		if(!strcmp(argv[1],"gen"))
+			ret = cmd_gen(argc-2,argv+2);
+		else if(!strcmp(argv[1],"list"))
+			ret = cmd_list(argc-2,argv+2);
+		else if(!strcmp(argv[1],"patch"))
+			ret = cmd_patch(argc-2,argv+2);
+		else if(!strcmp(argv[1],"verify"))
+			ret = cmd_verify(argc-2,argv+2);
+		else if(!strcmp(argv[1],"key"))
+			ret = cmd_key(argc-2,argv+2);
+	}
+	if(ret == 2)
+		fprintf(stderr,"usage: %s gen <count> <records.bin>\n"
+			"       %s list <records.bin>\n"
+			"       %s patch <image.bin|image.hex> <UID|records.bin:n> [out]\n"
+			"       %s verify [-j threads] [-r] <file>...\n"
+			"       %s key <image.bin|image.hex> <32 hex digits> [out]\n",argv[0],argv[0],argv[0],argv[0],argv[0]);
+	return ret;
+}